@@ -109,7 +109,7 @@
 #define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 1
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_STATIC_ALLOCATION         gAppUseStaticAllocation_d
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configTOTAL_HEAP_SIZE                   ((size_t)(gTotalHeapSize_c))
 #define configAPPLICATION_ALLOCATED_HEAP        0
@@ -124,10 +124,17 @@
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           gAppUseRunTimeStats_d
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+#if configGENERATE_RUN_TIME_STATS
+/* SysTick is programmed by the port after this hook, the counter reads it lazily */
+extern uint32_t AppStats_GetRunTimeCounter(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        AppStats_GetRunTimeCounter()
+#endif
+
 /* Task aware debugging. */
 #define configRECORD_STACK_HIGH_ADDRESS         1
 
@@ -1,10 +1,22 @@
 #include "LED.h"
 #include "ledcontrol.h"
+#include "ledcontrol_ack.h"
+#include "ledcontrol_txq.h"
+#include "ledcontrol_nv.h"
+#include "ledcontrol_sec.h"
+#include "ledcontrol_relay.h"
+#include "ledcontrol_ota.h"
+#include "ledcontrol_test.h"
+#include "ledcontrol_stats.h"
+#include "ledcontrol_static.h"
+#include "ledcontrol_host.h"
 
 #include "MemManager.h"
+#include "FunctionLib.h"
 #include "Messaging.h"
 #include "TimersManager.h"
 #include "SecLib.h"
+#include "RNG_Interface.h"
 #include "Panic.h"
 #include "fsl_xcvr.h"
 #include "fsl_os_abstraction.h"
@@ -21,8 +33,79 @@
 static void App_Thread (uint32_t param); 
 /*Application event handler*/
 static void App_HandleEvents(osaEventFlags_t flags);
+/*Decodes the received frame and acts on it*/
+static void App_RxDispatch(void);
 /*Function that reads latest byte from Serial Manager*/
 static void App_UpdateUartData(uint8_t* pData);
+/*Acts on one UART command byte*/
+static void App_UartCommand(uint8_t data);
+/*Queues the toggle of one LED, FALSE if the command queue is full*/
+static bool_t App_LedCommand(uint8_t devId, uint8_t led);
+/*Aborts the current radio sequence and starts listening again*/
+static void App_RearmRx(void);
+/*Serializes gTxPacket and starts transmitting it*/
+static bool_t App_TransmitPacket(void);
+/*Adds the ack owed to the peer, encodes the frame and transmits it*/
+static bool_t App_SendFrame(app_frame_t* pFrame, app_ack_rx_t* pAckRx);
+/*Queues a frame in its traffic class and sends it if the radio is free*/
+static void App_QueueFrame(app_tx_class_t txClass, app_frame_t* pFrame, app_ack_rx_t* pAckRx);
+/*Starts the next queued frame that may go now, FALSE if none was started*/
+static bool_t App_TxKick(void);
+/*Starts the next queued frame or, if none may go now, listens*/
+static void App_RadioIdle(void);
+#if gAppUseSecLib_d
+/*Verifies and decrypts gRxPacket if it comes from a peer of this node*/
+static bool_t App_Unprotect(void);
+#endif
+#if gAppUseRelay_d
+/*Passes gRxPacket to the relay layer, FALSE if it is not for this node*/
+static bool_t App_RelayReceive(void);
+#endif
+#if gAppUseRelay_d || gAppUseOta_d
+/*Seeds the relay frame ids and jitter, and the OTA answer slots, from the chip UID*/
+static uint32_t App_UidSeed(void);
+#endif
+#if gAppUseOta_d && defined(LEDCONTROL_MASTER)
+/*Queues the next OTA broadcast, or arms mAppOtaTmrId for it*/
+static void App_OtaPump(void);
+#endif
+#if gAppUseRadioTest_d
+/*Lends the radio to the test mode*/
+static void App_TestStart(void);
+/*Takes the radio back from the test mode with the LED network configuration*/
+static void App_TestStop(void);
+/*Hands radio and timer events to the test mode*/
+static void App_TestEvents(osaEventFlags_t flags);
+/*Arms mAppTestTmrId for the delay the test mode asked for, stops it on 0*/
+static void App_TestArm(uint32_t delayMs);
+#endif
+#ifdef LEDCONTROL_MASTER
+/*Prints the UART digit of every LED command confirmed by an ack*/
+static void App_ConfirmCommands(const app_frame_t* pFrame);
+/*Answers a join request with the id allocated to the requesting chip*/
+static void App_JoinAssign(const app_frame_t* pFrame);
+/*Tells the host whether a slave answered its last presence probe*/
+static void App_ReportPresence(uint8_t devId, bool connected);
+/*Slave to probe after devId*/
+static uint8_t App_NextProbeId(uint8_t devId);
+#if gAppUseHostFrames_d
+/*Decodes the host records waiting in the Serial Manager*/
+static void App_HostRead(void);
+/*Acts on a record from the host*/
+static void App_HostRecord(const app_host_record_t* pRecord);
+/*Encodes a record and writes it to the host*/
+static void App_HostSend(uint8_t type, const uint8_t* pPayload, uint8_t len);
+#endif
+#else
+/*Sends the pending ack now or once gAppAckDelayMs_c expires*/
+static void App_ScheduleAck(void);
+/*Sends a join request and schedules the next one*/
+static void App_JoinRequest(void);
+/*Adopts the id of an assignment addressed to this chip*/
+static void App_JoinAssigned(const app_frame_t* pFrame);
+/*Restores the LED state saved before the last reset*/
+static void App_RestoreLeds(void);
+#endif
 
 
 /*Generic FSK RX callback*/
@@ -39,6 +122,20 @@ static void App_SerialCallback(void* param);
 
 /*Timer manager callback function*/
 static void App_TimerCallback(void* param);
+/*Reply guard timer callback*/
+static void App_TxTimerCallback(void* param);
+#if gAppUseRelay_d
+/*Relay jitter timer callback*/
+static void App_RelayTimerCallback(void* param);
+#endif
+#if gAppUseOta_d
+/*OTA step timer callback*/
+static void App_OtaTimerCallback(void* param);
+#endif
+#if gAppUseRadioTest_d
+/*Radio test step timer callback*/
+static void App_TestTimerCallback(void* param);
+#endif
 
 
 //application specific genfsk init
@@ -59,19 +156,87 @@ static osaEventId_t mAppThreadEvt;
 /*variable to store key pressed by user*/
 static uint8_t mAppUartData = 0;
 
+#if gAppUseHostFrames_d && defined(LEDCONTROL_MASTER)
+/*record from the host being received*/
+static app_host_rx_t mAppHostRx;
+#endif
+
 
 
 
 #ifdef LEDCONTROL_MASTER
-static connectivity_states_t conState = gAppSlave1Check;
+/*slave probed last, gAppFrameInvalidId_c before the first probe, and whether
+  it answered*/
+static uint8_t mAppProbeId = gAppFrameInvalidId_c;
+static bool_t mAppProbeAnswered;
+#endif
+
+#ifdef LEDCONTROL_MASTER
+/*sequence numbers sent to and received from each slave*/
+static app_ack_tx_t mAppAckTx[LEDCONTROL_MAX_SLAVES];
+static app_ack_rx_t mAppAckRx[LEDCONTROL_MAX_SLAVES];
+#if gAppUseSecLib_d
+/*lowest frame counter accepted from each slave, kept in NVM*/
+static uint32_t mAppSecRx[LEDCONTROL_MAX_SLAVES];
+#endif
+
+/*chip UID of every assigned id, kept in NVM*/
+static app_join_table_t mAppJoinTable;
+#else
+/*sequence numbers received from the master*/
+static app_ack_rx_t mAppAckRx;
+#if gAppUseSecLib_d
+/*lowest frame counter accepted from the master, kept in NVM*/
+static uint32_t mAppSecRx;
+#endif
+
+/*own id, gAppFrameUnassignedId_c until the master assigns one*/
+static uint8_t mAppDeviceId = gAppFrameUnassignedId_c;
+
+/*chip UID sent in join requests*/
+static uint8_t mAppUid[gAppJoinUidLen_c];
+#if gAppUseSecLib_d
+/*random challenge of the last join request, echoed by its assignment*/
+static uint32_t mAppJoinChallenge;
+#endif
+
+/*LED on/off state restored at boot, one mAppLedState bit per LED command*/
+static uint8_t mAppLedState;
 #endif
 
+/*channel and TX power, restored from NVM before the radio is configured*/
+static app_link_params_t mAppLinkParams = {gGenFskDefaultChannel_c, gGenFskDefaultTxPowerLevel_c};
+
+/*LED command sent for each UART digit of a device*/
+static const uint8_t mAppLedCommands[LEDCONTROL_LEDS_PER_DEVICE] = {'r', 'g', 'b'};
+
 /*structure to store information regarding latest received packet*/
 static ct_rx_indication_t mAppRxLatestPacket;
 
 /*latest generic fsk event status*/
 static genfskEventStatus_t mAppGenfskStatus;
 
+/*a frame is on air, the receiver is re-armed once it is done*/
+static bool_t mAppTxBusy = FALSE;
+
+/*releases frames held by the TX queue reply guard*/
+static uint8_t mAppTxTmrId;
+
+#if gAppUseRelay_d
+/*releases the pending forward once its jitter is over*/
+static uint8_t mAppRelayTmrId;
+#endif
+
+#if gAppUseOta_d
+/*next OTA step of the master, the answer slot of a slave*/
+static uint8_t mAppOtaTmrId;
+#endif
+
+#if gAppUseRadioTest_d
+/*next step of the radio test mode*/
+static uint8_t mAppTestTmrId;
+#endif
+
 // transmission buffer and packet
 static uint8_t* gTxBuffer;
 static GENFSK_packet_t gTxPacket;
@@ -80,6 +245,14 @@ static GENFSK_packet_t gTxPacket;
 static uint8_t* gRxBuffer;
 static GENFSK_packet_t gRxPacket;
 
+#if gAppUseStaticAllocation_d
+//link time storage behind the buffer/payload pointers above
+static uint8_t mAppTxBufferStorage[gGenFskDefaultMaxBufferSize_c] APP_STATIC_RADIO;
+static uint8_t mAppTxPayloadStorage[gGenFskMaxPayloadLen_c] APP_STATIC_RADIO;
+static uint8_t mAppRxBufferStorage[gGenFskDefaultMaxBufferSize_c + gGenFskDefaultCrcSize_c] APP_STATIC_RADIO;
+static uint8_t mAppRxPayloadStorage[gGenFskMaxPayloadLen_c + gGenFskDefaultCrcSize_c] APP_STATIC_RADIO;
+#endif
+
 //length of genfsk buffer
 uint16_t buffLen;
 
@@ -98,51 +271,131 @@ void main_task(uint32_t param)
 {  
     if (!platformInitialized)
     {
+        bool_t genfskAllocFailed = FALSE;
+
         platformInitialized = 1;
         
         hardware_init();
+        AppStats_BootMark(gAppBootHardware_c);
         
         /* Framework init */
         MEM_Init();
 
-        //initialize Serial Manager
-        SerialManager_Init();
-        LED_Init();
+        /*identity first, a slave filters frames on its id as soon as RX is armed*/
+        AppNv_Init();
+        AppNv_Register(gAppNvLinkParams_c, &mAppLinkParams, sizeof(mAppLinkParams));
+        if(!AppNv_Restore(gAppNvLinkParams_c))
+        {
+            AppNv_SaveOnIdle(gAppNvLinkParams_c);
+        }
+#ifdef LEDCONTROL_MASTER
+        AppJoin_LoadTable(&mAppJoinTable);
+#else
+        AppJoin_GetUid(mAppUid);
+#ifdef LEDCONTROL_DEVICE_ID
+        mAppDeviceId = LEDCONTROL_DEVICE_ID;
+#else
+        mAppDeviceId = AppJoin_LoadIdentity();
+#endif
+#endif
+#if gAppUseSecLib_d
+        /*frames received as soon as RX is armed are verified*/
         SecLib_Init();
 #ifdef LEDCONTROL_MASTER
-        TMR_Init();
-        mAppTmrId = TMR_AllocateTimer();
+        AppSec_Init(TRUE, 0);
+        AppSec_LoadReplay(mAppSecRx, LEDCONTROL_MAX_SLAVES);
+#else
+        {
+            uint32_t seed;
 
+            //join challenges and the first frame counter must differ across resets
+            (void)RNG_Init();
+            RNG_GetRandomNo(&seed);
+            AppSec_Init(FALSE, seed);
+        }
+        AppSec_LoadReplay(&mAppSecRx, 1);
+#endif
+#endif
+#if gAppUseRelay_d
+#if defined(LEDCONTROL_MASTER)
+        AppRelay_Init(TRUE, FALSE, App_UidSeed());
+#elif defined(LEDCONTROL_RELAY)
+        AppRelay_Init(FALSE, TRUE, App_UidSeed());
+#else
+        AppRelay_Init(FALSE, FALSE, App_UidSeed());
 #endif
+#endif
+#if gAppUseOta_d
+#ifdef LEDCONTROL_MASTER
+        AppOta_Init(TRUE, App_UidSeed());
+#else
+        AppOta_Init(FALSE, App_UidSeed());
+#endif
+#endif
+
+        /*create app thread event, the GENFSK callbacks post to it*/
+        mAppThreadEvt = OSA_EventCreate(TRUE);
 
+        /*the receiver comes up before anything else so a slave that resets
+          misses as few commands as possible*/
         GENFSK_Init();
-        
 
+        /* GENFSK LL Init with the application radio, packet, CRC and whitener
+           config applied once, instead of defaults that gFsk_Init overwrites */
+        if(gGenfskSuccess_c != GENFSK_AllocInstance(&mAppGenfskId, &radioConfig, &pktConfig, &bitProcConfig))
+        {
+        	genfskAllocFailed = TRUE;
+        }
+        AppStats_BootMark(gAppBootRadioInit_c);
 
-        
-        /*create app thread event*/
-        mAppThreadEvt = OSA_EventCreate(TRUE);
-        
+        gFsk_Init();
+        App_RearmRx();
+        AppStats_BootMark(gAppBootRxArmed_c);
+
+        //initialize Serial Manager
+        SerialManager_Init();
+        LED_Init();
+#ifndef LEDCONTROL_MASTER
+        App_RestoreLeds();
+#endif
+        /*presence probes on the master, join retries and delayed acks on a slave*/
+        TMR_Init();
+        mAppTmrId = TMR_AllocateTimer();
+        mAppTxTmrId = TMR_AllocateTimer();
+#if gAppUseRelay_d
+        mAppRelayTmrId = TMR_AllocateTimer();
+#endif
+#if gAppUseOta_d
+        mAppOtaTmrId = TMR_AllocateTimer();
+#endif
+#if gAppUseRadioTest_d
+        mAppTestTmrId = TMR_AllocateTimer();
+#endif
 
         /*initialize the application interface id*/
         Serial_InitInterface(&mAppSerId, 
                              APP_SERIAL_INTERFACE_TYPE, 
                              APP_SERIAL_INTERFACE_INSTANCE);
+#if gAppUseHostFrames_d && defined(LEDCONTROL_MASTER)
+        /*records take the bytes the text took, a faster line takes the batches*/
+        Serial_SetBaudRate(mAppSerId, gAppHostBaudRate_c);
+#else
         /*set baudrate to 115200*/
         Serial_SetBaudRate(mAppSerId, 
                            APP_SERIAL_INTERFACE_SPEED);
+#endif
         /*set Serial Manager receive callback*/
         Serial_SetRxCallBack(mAppSerId, App_SerialCallback, NULL);
-        
-
-
+#if gAppUseRadioTest_d
+        AppTest_Init(mAppGenfskId, mAppSerId);
+#endif
+        AppStats_BootMark(gAppBootDone_c);
 
-        /* GENFSK LL Init with default register config */
-        if(gGenfskSuccess_c != GENFSK_AllocInstance(&mAppGenfskId, NULL, NULL, NULL))
+        if(genfskAllocFailed)
         {
-        	Serial_Print(mAppGenfskId,"Allocation failed...\r\n",gAllowToBlock_d);
+        	Serial_Print(mAppSerId,"Allocation failed...\r\n",gAllowToBlock_d);
         }
-
+        AppStats_BootDump(mAppSerId);
     }
     
     /* Call application task */
@@ -160,327 +413,329 @@ void main_task(uint32_t param)
 void App_Thread (uint32_t param)
 {
     osaEventFlags_t mAppThreadEvtFlags = 0;
+    uint32_t idleMs;
     
-    gFsk_Init();
 #ifdef LEDCONTROL_MASTER
     TMR_EnableTimer(mAppTmrId);
     TMR_StartIntervalTimer(mAppTmrId,LEDCONTROL_CONNECTIONCHECK_TIMEOUT_MILLISECONDS, App_TimerCallback, NULL);
+#else
+    if(mAppDeviceId == gAppFrameUnassignedId_c)
+    {
+        //first request in a random slot, slaves often power up together
+        TMR_StartSingleShotTimer(mAppTmrId, AppJoin_NextAttemptMs(), App_TimerCallback, NULL);
+    }
 #endif
-    GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
     while(1)
     {
-        (void)OSA_EventWait(mAppThreadEvt, gCtEvtEventsAll_c, FALSE, osaWaitForever_c ,&mAppThreadEvtFlags);
+        /*wakes up for the NVM writes coalesced by AppNv_SaveOnIdle and the
+          OTA pages waiting to be programmed*/
+        mAppThreadEvtFlags = 0;
+        idleMs = AppNv_IdleTimeoutMs();
+#if gAppUseOta_d
+        if(AppOta_IdleTimeoutMs() < idleMs)
+        {
+            idleMs = AppOta_IdleTimeoutMs();
+        }
+#endif
+        (void)OSA_EventWait(mAppThreadEvt, gCtEvtEventsAll_c, FALSE, idleMs ,&mAppThreadEvtFlags);
         if(mAppThreadEvtFlags)
         {
         	App_HandleEvents(mAppThreadEvtFlags);/*handle app events*/
+        	AppStats_MemSample();
         }
+        AppNv_Idle();
+#if gAppUseSecLib_d
+        AppSec_Idle();
+#endif
+#if gAppUseOta_d
+        AppOta_Idle();
+#endif
     }
 }
 
+/*! *********************************************************************************
+* \brief  Handles every event of one wait. The event is auto-clear, so each flag
+*         set has its own block; one left unhandled would be lost.
+*
+* \param[in] flags  events returned by OSA_EventWait
+*
+********************************************************************************** */
 void App_HandleEvents(osaEventFlags_t flags)
 {
+#if gAppUseRadioTest_d
+    bool_t testing = AppTest_Active();
+#endif
+
     if(flags & gCtEvtUart_c)
     {
+#if gAppUseHostFrames_d && defined(LEDCONTROL_MASTER)
+        App_HostRead();
+#else
         App_UpdateUartData(&mAppUartData);
+        App_UartCommand(mAppUartData);
+#endif
+    }
+#if gAppUseRadioTest_d
+    if(testing || AppTest_Active())
+    {
+    	//the test mode owns the radio, the LED network is paused; the radio
+    	//events of a mode the UART command just left or entered are stale
+    	if(testing && AppTest_Active())
+    	{
+    		App_TestEvents(flags & (gCtEvtRxDone_c | gCtEvtTxDone_c | gCtEvtTest_c));
+    	}
+    	flags &= ~(osaEventFlags_t)(gCtEvtRxDone_c | gCtEvtTxDone_c | gCtEvtTest_c);
+    }
+#endif
+    if(flags & gCtEvtRxDone_c) //received comms
+    {
+    	App_RxDispatch();
+    }
+    if(flags & gCtEvtTxDone_c)
+    {
+#if !(gAppUseHostFrames_d && defined(LEDCONTROL_MASTER))
+    	Serial_Print(mAppSerId,"Finished transmission\r\n",gAllowToBlock_d);
+#endif
+    	mAppTxBusy = FALSE;
+    	AppTxq_TxDone();
+#if gAppUseOta_d && defined(LEDCONTROL_MASTER)
+    	App_OtaPump();
+#endif
+    	App_RadioIdle();
+    }
+    if(flags & gCtEvtTimerExpired_c)
+    {
+#ifdef LEDCONTROL_MASTER
+		app_frame_t probe = {0};
 
+		if(mAppProbeId != gAppFrameInvalidId_c)
+		{
+			App_ReportPresence(mAppProbeId, mAppProbeAnswered);
+		}
+		mAppProbeId = App_NextProbeId(mAppProbeId);
+		mAppProbeAnswered = FALSE;
 
+		probe.devId = mAppProbeId;
+		probe.command = 'v';
+		//held while a command waits for its ack, never aborts one
+		App_QueueFrame(gAppTxClassProbe_c, &probe, &mAppAckRx[mAppProbeId]);
+#else
+		app_frame_t ack = {0};
 
-		if(
-				  (mAppUartData != '1')
-				&&(mAppUartData != '2')
-				&&(mAppUartData != '3')
-				&&(mAppUartData != '4')
-				&&(mAppUartData != '5')
-				&&(mAppUartData != '6')
-				&&(mAppUartData != '7')
-				&&(mAppUartData != '8')
-				&&(mAppUartData != '9')
-		  )
+		if(mAppDeviceId == gAppFrameUnassignedId_c)
 		{
-			GENFSK_AbortAll();
-			GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
+			App_JoinRequest();
 		}
-		else
+		else if(mAppAckRx.pending)
 		{
-			int command = (mAppUartData - '0')-1;//convert to int
-			gTxPacket.header.lengthField = gGenFskMinPayloadLen_c;
-			switch(command)
-			{
-			case 0:
-				//Device ID 0, red LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ZERO;
-				gTxPacket.payload[1] = 'r';
-				break;
-			case 1:
-				//Device ID 0, green LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ZERO;
-				gTxPacket.payload[1] = 'g';
-				break;
-			case 2:
-				//Device ID 0, blue LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ZERO;
-				gTxPacket.payload[1] = 'b';
-				break;
-			case 3:
-				//Device ID 1, red LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ONE;
-				gTxPacket.payload[1] = 'r';
-				break;
-			case 4:
-				//Device ID 1, green LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ONE;
-				gTxPacket.payload[1] = 'g';
-				break;
-			case 5:
-				//Device ID 1, blue LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ONE;
-				gTxPacket.payload[1] = 'b';
-				break;
-			case 6:
-				//Device ID 2, red LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_TWO;
-				gTxPacket.payload[1] = 'r';
-				break;
-			case 7:
-				//Device ID 2, green LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_TWO;
-				gTxPacket.payload[1] = 'g';
-				break;
-			case 8:
-				//Device ID 2, blue LED
-				gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_TWO;
-				gTxPacket.payload[1] = 'b';
-				break;
-			default:
-				break;
-
-				buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-				GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-				GENFSK_AbortAll();
-				GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
-			}
+			//ack delay expired without a reply to carry the ack
+			ack.devId = mAppDeviceId;
+			ack.command = gAppAckCmd_c;
+			App_QueueFrame(gAppTxClassAck_c, &ack, &mAppAckRx);
 		}
+#endif
+
+    }
+    if(flags & gCtEvtTxQueue_c)
+    {
+    	//reply guard over, send what it held back
+    	(void)App_TxKick();
     }
-    else if(flags & gCtEvtRxDone_c) //received comms
+#if gAppUseRelay_d
+    if(flags & gCtEvtRelay_c)
     {
+    	app_frame_t frame;
 
-    	GENFSK_ByteArrayToPacket(mAppGenfskId, mAppRxLatestPacket.pBuffer, &gRxPacket);
-    	uint8_t devID = gRxPacket.payload[0];
-    	uint8_t data = gRxPacket.payload[1];
+    	//jitter over, forward unless another relay's copy was heard meanwhile
+    	if(AppRelay_Release(&frame))
+    	{
+    		App_QueueFrame(gAppTxClassRelay_c, &frame, NULL);
+    	}
+    }
+#endif
+#if gAppUseOta_d
+    if(flags & gCtEvtOta_c)
+    {
 #ifdef LEDCONTROL_MASTER
+    	//TX gap, NACK or status window over
+    	App_OtaPump();
+#else
+    	app_frame_t frame;
 
-    	if(data == 'v')
+    	//answer slot reached, unless another slave's NACK covered ours
+    	if((mAppDeviceId != gAppFrameUnassignedId_c) && AppOta_ClientReply(&frame))
     	{
-    		if((conState == gAppSlave1Check) && (devID = LEDCONTROL_DEVICE_ID_ZERO))
-    		{
-    			slave1connected = true;
-    		}
-    		else if((conState == gAppSlave2Check) && (devID = LEDCONTROL_DEVICE_ID_ONE))
-    		{
-    			slave2connected = true;
-    		}
-    		else if((conState == gAppSlave3Check) && (devID = LEDCONTROL_DEVICE_ID_TWO))
-    		{
-    			slave3connected = true;
-    		}
-    		else
-    		{
-    			//bad packet, ignore
-    		}
+    		frame.devId = mAppDeviceId;
+    		App_QueueFrame(gAppTxClassOta_c, &frame, NULL);
     	}
-    	else
-    	{
-        	//TODO: Print suitable data back to indicate successful slave reception of data
-    		if(devID == 0)
-    		{
-    			if(data == 'r')
-    			{
-    				Serial_Print(mAppSerId,"1",gAllowToBlock_d);
-    			}
-    			else if(data == 'g')
-    			{
-    				Serial_Print(mAppSerId,"2",gAllowToBlock_d);
-    			}
-    			else if(data == 'b')
-    			{
-    				Serial_Print(mAppSerId,"3",gAllowToBlock_d);
-    			}
-    			else
-    			{
-    				//bad data
-    			}
-    		}
-    		else if(devID == 1)
-    		{
-    			if(data == 'r')
-    			{
-    				Serial_Print(mAppSerId,"4",gAllowToBlock_d);
-    			}
-    			else if(data == 'g')
-    			{
-    				Serial_Print(mAppSerId,"5",gAllowToBlock_d);
-    			}
-    			else if(data == 'b')
-    			{
-    				Serial_Print(mAppSerId,"6",gAllowToBlock_d);
-    			}
-    			else
-    			{
-    				//bad data
-    			}
-    		}
-    		else if(devID == 2)
-    		{
-    			if(data == 'r')
-    			{
-    				Serial_Print(mAppSerId,"7",gAllowToBlock_d);
-    			}
-    			else if(data == 'g')
-    			{
-    				Serial_Print(mAppSerId,"8",gAllowToBlock_d);
-    			}
-    			else if(data == 'b')
-    			{
-    				Serial_Print(mAppSerId,"9",gAllowToBlock_d);
-    			}
-    			else
-    			{
-    				//bad data
-    			}
-    		}
-    		else
-    		{
-    			//bad data
-    		}
-    		GENFSK_AbortAll();
-			GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
+#endif
+    }
+#endif
 
-    	}
+}
+
+/*! *********************************************************************************
+* \brief  Handles the frame of the last gCtEvtRxDone_c: decodes it, acts on the
+*         command and puts the radio back to work.
+*
+********************************************************************************** */
+APP_RAMFUNC static void App_RxDispatch(void)
+{
+	AppStats_LatencyDispatch();
+
+	app_frame_t frame;
+
+	GENFSK_ByteArrayToPacket(mAppGenfskId, mAppRxLatestPacket.pBuffer, &gRxPacket);
+	if(!mAppRxLatestPacket.crcValid ||
+#if gAppUseRelay_d
+	   !App_RelayReceive() ||
+#endif
+#if gAppUseSecLib_d
+	   !App_Unprotect() ||
+#endif
+	   !AppFrame_Decode(&gRxPacket, &frame))
+	{
+		//corrupted, truncated, forged or replayed frame
+		frame.devId = gAppFrameInvalidId_c;
+		frame.command = 0;
+	}
+	uint8_t devID = frame.devId;
+	uint8_t data = frame.command;
+#ifdef LEDCONTROL_MASTER
+#if gAppUseOta_d
+	if(!mAppRxLatestPacket.crcValid)
+	{
+		//OTA NACKs of two slaves in the same slot
+		AppOta_ServerGarbled();
+	}
+#endif
+	if((devID == gAppFrameUnassignedId_c) && (data == gAppJoinCmdRequest_c))
+	{
+		App_JoinAssign(&frame);
+	}
+	else if(devID < LEDCONTROL_MAX_SLAVES)
+	{
+#if gAppUseSecLib_d
+		if(frame.flags & (gAppFrameFlagSeq_c | gAppFrameFlagAck_c))
+		{
+			//a replay of it after a reset would confirm commands again
+			AppSec_SaveReplay(devID);
+		}
+#endif
+		if(frame.flags & gAppFrameFlagSeq_c)
+		{
+			//acked on the next frame sent to this slave
+			(void)AppAck_Receive(&mAppAckRx[devID], frame.seq);
+		}
+		if(frame.flags & gAppFrameFlagAck_c)
+		{
+			App_ConfirmCommands(&frame);
+		}
+#if gAppUseOta_d
+		if((data == gAppOtaCmdNack_c) || (data == gAppOtaCmdStatus_c))
+		{
+			AppOta_ServerReceive(&frame);
+		}
+#endif
+	}
 
+	if((data == 'v') && (devID == mAppProbeId))
+	{
+		mAppProbeAnswered = TRUE;
+	}
+	App_RadioIdle();
 
 #else
-    	if(devID == LEDCONTROL_DEVICE_ID)
-    	{
-    		gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID;
+	if((devID == gAppFrameUnassignedId_c) && (data == gAppJoinCmdAssign_c))
+	{
+		App_JoinAssigned(&frame);
+		App_RadioIdle();
+	}
+	else if((devID == mAppDeviceId) && (mAppDeviceId != gAppFrameUnassignedId_c))
+	{
+		bool_t isNew = TRUE;
+
+#if gAppUseSecLib_d
+		if(frame.flags & (gAppFrameFlagSeq_c | gAppFrameFlagAck_c))
+		{
+			//a replay of it after a reset would toggle the LED again
+			AppSec_SaveReplay(0);
+		}
+#endif
+
+		if(frame.flags & gAppFrameFlagSeq_c)
+		{
+			//a repeated command is acked again but not applied twice
+			isNew = AppAck_Receive(&mAppAckRx, frame.seq);
+		}
 
-			if(data == 'r')
+		if((data == 'r') || (data == 'g') || (data == 'b'))
+		{
+			if(isNew && (data == 'r'))
 			{
 				Led2Toggle();
-				gTxPacket.payload[1] = 'r';
-				buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-				GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-				GENFSK_AbortAll();
-				GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
+				mAppLedState ^= 0x01;
 			}
-			else if(data == 'g')
+			else if(isNew && (data == 'g'))
 			{
 				Led3Toggle();
-				gTxPacket.payload[1] = 'g';
-				buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-				GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-				GENFSK_AbortAll();
-				GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
+				mAppLedState ^= 0x02;
 			}
-			else if(data == 'b')
+			else if(isNew && (data == 'b'))
 			{
 				Led4Toggle();
-				gTxPacket.payload[1] = 'b';
-				buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-				GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-				GENFSK_AbortAll();
-				GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
-			}
-			else if(data == 'v')
-			{
-				//this packet is so the master can check slave is still connected, send response back
-	    		Serial_Print(mAppSerId,"Right place\r\n",gAllowToBlock_d);
-				gTxPacket.payload[1] = 'v';
-				buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-				GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-				GENFSK_AbortAll();
-				GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
-			}
-			else
-			{
-				//bad data
-				Serial_Print(mAppSerId,"Bad data\r\n",gAllowToBlock_d);
-				GENFSK_AbortAll();
-				GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
-			}
-
-    	}
-    	else
-    	{
-    		//bad id
-    		GENFSK_AbortAll();
-    		GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
-    	}
-#endif
-    }
-    else if(flags & gCtEvtTxDone_c)
-    {
-    	Serial_Print(mAppSerId,"Finished transmission\r\n",gAllowToBlock_d);
-    	GENFSK_AbortAll();
-    	GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
-    }
-    else if(flags & gCtEvtTimerExpired_c)
-    {
-#ifdef LEDCONTROL_MASTER
-		if(conState == gAppSlave1Check)
-		{
-			if(!slave1connected)
-			{
-				Serial_Print(mAppSerId,"Slave 1 disconnected\r\n",gAllowToBlock_d);
+				mAppLedState ^= 0x04;
 			}
-			else
+			if(isNew)
 			{
-				Serial_Print(mAppSerId,"Slave 1 connected\r\n",gAllowToBlock_d);
+				//the new state is written once the commands settle
+				AppNv_SaveOnIdle(gAppNvLedState_c);
 			}
-			conState = gAppSlave2Check;
-			slave2connected = false;
-			gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ONE;
+			AppStats_LatencyReplyOwed();
+			App_ScheduleAck();
+			App_RadioIdle();
 		}
-		else if(conState == gAppSlave2Check)
+		else if(data == 'v')
 		{
-			if(!slave2connected)
-			{
-				Serial_Print(mAppSerId,"Slave 2 disconnected\r\n",gAllowToBlock_d);
-			}
-			else
-			{
-				Serial_Print(mAppSerId,"Slave 2 connected\r\n",gAllowToBlock_d);
-			}
-			conState = gAppSlave3Check;
-			slave3connected = false;
-			gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_TWO;
+			app_frame_t reply = {0};
+
+			//this packet is so the master can check slave is still connected, send response back
+			Serial_Print(mAppSerId,"Right place\r\n",gAllowToBlock_d);
+			//the reply carries any pending ack, no standalone ack is needed
+			TMR_StopTimer(mAppTmrId);
+			AppStats_LatencyReplyOwed();
+			reply.devId = mAppDeviceId;
+			reply.command = 'v';
+			App_QueueFrame(gAppTxClassProbe_c, &reply, &mAppAckRx);
 		}
-		else if(conState == gAppSlave3Check)
+		else
 		{
-			if(!slave3connected)
-			{
-				Serial_Print(mAppSerId,"Slave 3 disconnected\r\n",gAllowToBlock_d);
-			}
-			else
-			{
-				Serial_Print(mAppSerId,"Slave 3 connected\r\n",gAllowToBlock_d);
-			}
-			conState = gAppSlave1Check;
-			slave1connected = false;
-			gTxPacket.payload[0] = LEDCONTROL_DEVICE_ID_ZERO;
+			//bad data
+			Serial_Print(mAppSerId,"Bad data\r\n",gAllowToBlock_d);
+			App_RadioIdle();
 		}
-		else
+	}
+#if gAppUseOta_d
+	else if((devID == gAppFrameBroadcastId_c) ||
+	        ((devID < LEDCONTROL_MAX_SLAVES) && (data == gAppOtaCmdNack_c)))
+	{
+		//OTA broadcast, or the NACK of another slave that may cover ours
+		uint32_t delayMs = AppOta_ClientReceive(&frame);
+
+		if(delayMs)
 		{
-			//unreachable
+			TMR_StartSingleShotTimer(mAppOtaTmrId, delayMs, App_OtaTimerCallback, NULL);
 		}
-		gTxPacket.payload[1] = 'v';
-		buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
-		GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
-		GENFSK_AbortAll();
-		GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0);
+		App_RadioIdle();
+	}
 #endif
-
-    }
-
+	else
+	{
+		//bad id
+		App_RadioIdle();
+	}
+#endif
+	AppStats_LatencyEnd();
 }
 
 /*! *********************************************************************************
@@ -505,101 +760,1000 @@ static void App_UpdateUartData(uint8_t* pData)
 }
 
 
-
 /*! *********************************************************************************
-* \brief  This function represents the Generic FSK receive callback. 
-*         This function is called each time the Generic FSK Link Layer receives a 
-*         valid packet
-* \param[in]  pBuffer Pointer to receive buffer as byte array
-* \param[in]  timestamp Generic FSK timestamp for received packet
-* \param[in]  rssi The RSSI measured during the reception of the packet
+* \brief  Acts on one UART command byte: the test mode and an OTA upload take
+*         every byte, otherwise a dump command or the toggle digit of an LED.
 *
-********************************************************************************** */
-static void App_GenFskReceiveCallback(uint8_t *pBuffer, 
-                                      uint16_t bufferLength, 
-                                      uint64_t timestamp, 
-                                      uint8_t rssi,
-                                      uint8_t crcValid)
-{
-   mAppRxLatestPacket.pBuffer      = pBuffer;
-   mAppRxLatestPacket.bufferLength = bufferLength;
-   mAppRxLatestPacket.timestamp    = timestamp;
-   mAppRxLatestPacket.rssi         = rssi;
-   mAppRxLatestPacket.crcValid     = crcValid;
-   
-   /*send event to app thread*/
-   OSA_EventSet(mAppThreadEvt, gCtEvtRxDone_c);
-}
-
-/*! *********************************************************************************
-* \brief  This function represents the Generic FSK event notification callback. 
-*         This function is called each time the Generic FSK Link Layer has 
-*         a notification for the upper layer
-* \param[in]  event The event that generated the notification
-* \param[in]  eventStatus status of the event
+* \param[in] data  byte from the host
 *
 ********************************************************************************** */
-static void App_GenFskEventNotificationCallback(genfskEvent_t event, 
-                                                genfskEventStatus_t eventStatus)
-{
-   if(event & gGenfskTxEvent)
-   {
-       mAppGenfskStatus = eventStatus;
-       /*send event done*/
-       OSA_EventSet(mAppThreadEvt, gCtEvtTxDone_c);
-   }
-   if(event & gGenfskRxEvent)
-   {
-       if(eventStatus == gGenfskTimeout)
-       {
-           OSA_EventSet(mAppThreadEvt, gCtEvtSeqTimeout_c);
-       }
-       else
-       {
-           OSA_EventSet(mAppThreadEvt, gCtEvtRxFailed_c);
-       }
-   }
-}
-
-static void App_SerialCallback(void* param)
+static void App_UartCommand(uint8_t data)
 {
-    OSA_EventSet(mAppThreadEvt, gCtEvtUart_c);
-}
+#if gAppUseRadioTest_d
+    if(AppTest_Active())
+    {
+        //test command lines, the radio comes back after 'q'
+        App_TestArm(AppTest_UartByte(data));
+        if(!AppTest_Active())
+        {
+            App_TestStop();
+        }
+    }
+    else
+#endif
+#if gAppUseOta_d && defined(LEDCONTROL_MASTER)
+    if(AppOta_Uploading())
+    {
+        //image bytes, the session starts with the last one
+        AppOta_UploadByte(data);
+        App_OtaPump();
+    }
+    else if(data == gAppOtaUploadCmd_c)
+    {
+        AppOta_UploadStart(mAppSerId);
+    }
+    else
+#endif
+#if gAppUseRunTimeStats_d
+    if(data == gAppStatsDumpCmd_c)
+    {
+        AppStats_Dump(mAppSerId);
+    }
+    else
+#endif
+#if gAppUseLatencyStats_d
+    if(data == gAppStatsLatencyCmd_c)
+    {
+        AppStats_LatencyDump(mAppSerId);
+    }
+    else
+#endif
+#if gAppUseMemStats_d
+    if(data == gAppStatsMemCmd_c)
+    {
+        AppStats_MemDump(mAppSerId);
+    }
+    else
+#endif
+    if(data == gAppTxqDumpCmd_c)
+    {
+        AppTxq_Dump(mAppSerId);
+    }
+    else
+#if gAppUseSecLib_d
+    if(data == gAppSecDumpCmd_c)
+    {
+        AppSec_Dump(mAppSerId);
+    }
+    else
+#endif
+#if gAppUseRelay_d
+    if(data == gAppRelayDumpCmd_c)
+    {
+        AppRelay_Dump(mAppSerId);
+    }
+    else
+#endif
+#if gAppUseRadioTest_d
+    if(data == gAppTestCmd_c)
+    {
+        App_TestStart();
+    }
+    else
+#endif
+    if(
+              (data != '1')
+            &&(data != '2')
+            &&(data != '3')
+            &&(data != '4')
+            &&(data != '5')
+            &&(data != '6')
+            &&(data != '7')
+            &&(data != '8')
+            &&(data != '9')
+      )
+    {
+        App_RearmRx();
+    }
+    else
+    {
+        //digits 1-3 address device 0, 4-6 device 1, 7-9 device 2, each as red/green/blue
+        int command = (data - '0')-1;//convert to int
+
+        (void)App_LedCommand((uint8_t)(command / LEDCONTROL_LEDS_PER_DEVICE),
+                             (uint8_t)(command % LEDCONTROL_LEDS_PER_DEVICE));
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Queues the toggle of one LED. The master tracks its sequence number, the
+*         ack is mapped back to the LED; a full command queue takes nothing, so
+*         no ack is waited for in vain.
+*
+* \param[in] devId  slave id
+* \param[in] led    0 red, 1 green, 2 blue
+*
+* \return  FALSE if the command queue is full
+*
+********************************************************************************** */
+static bool_t App_LedCommand(uint8_t devId, uint8_t led)
+{
+    app_frame_t frame = {0};
+
+    if(AppTxq_Pending(gAppTxClassCommand_c) == gAppTxqDepth_c)
+    {
+        return FALSE;
+    }
+    frame.devId = devId;
+    frame.command = mAppLedCommands[led];
+#ifdef LEDCONTROL_MASTER
+    frame.flags = gAppFrameFlagSeq_c;
+    frame.seq = AppAck_Track(&mAppAckTx[devId], led);
+    App_QueueFrame(gAppTxClassCommand_c, &frame, &mAppAckRx[devId]);
+#else
+    App_QueueFrame(gAppTxClassCommand_c, &frame, NULL);
+#endif
+    return TRUE;
+}
+
+
+/*! *********************************************************************************
+* \brief  Aborts whatever the radio is doing and re-arms the receiver with the
+*         application RX buffer. Does nothing while a frame is being sent.
+*
+********************************************************************************** */
+APP_RAMFUNC static void App_RearmRx(void)
+{
+    if(mAppTxBusy)
+    {
+        //re-armed on gCtEvtTxDone_c, aborting here would lose the frame on air
+        return;
+    }
+#if gAppUseRadioTest_d
+    if(AppTest_Active())
+    {
+        //the test mode listens with its own buffer and sync address
+        return;
+    }
+#endif
+    GENFSK_AbortAll();
+    GENFSK_StartRx(mAppGenfskId, gRxBuffer, gGenFskDefaultMaxBufferSize_c+crcConfig.crcSize, 0, 0);
+    AppStats_LatencyMark(gAppLatRxToRearm_c);
+}
+
+/*! *********************************************************************************
+* \brief  Serializes gTxPacket into gTxBuffer and starts transmitting it, aborting
+*         any radio sequence in progress.
+*
+* \return  FALSE if the radio did not start, no gCtEvtTxDone_c will follow
+*
+********************************************************************************** */
+APP_RAMFUNC static bool_t App_TransmitPacket(void)
+{
+    buffLen = gTxPacket.header.lengthField+(gGenFskDefaultHeaderSizeBytes_c)+(gGenFskDefaultSyncAddrSize_c + 1);
+    GENFSK_PacketToByteArray(mAppGenfskId, &gTxPacket, gTxBuffer);
+    GENFSK_AbortAll();
+    if(gGenfskSuccess_c != GENFSK_StartTx(mAppGenfskId, gTxBuffer, buffLen, 0))
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Sends a frame, piggybacking the ack owed to the destination peer so that
+*         no separate ack frame is needed. The frame is protected in gTxPacket
+*         in the gAppUseSecLib_d build and gets its relay header in the
+*         gAppUseRelay_d build; forwarded raw frames are sent as received.
+*
+* \param[in] pFrame  frame to send, gains gAppFrameFlagAck_c if an ack is pending
+* \param[in] pAckRx  receive state of the destination peer, NULL if none
+*
+* \return  FALSE if the frame could not be protected or sent and was dropped
+*
+********************************************************************************** */
+APP_RAMFUNC static bool_t App_SendFrame(app_frame_t* pFrame, app_ack_rx_t* pAckRx)
+{
+    if(pAckRx)
+    {
+        AppAck_Attach(pAckRx, pFrame);
+    }
+    AppFrame_Encode(&gTxPacket, pFrame);
+    if(!(pFrame->flags & gAppFrameFlagRaw_c))
+    {
+#if gAppUseSecLib_d
+        if(!AppSec_Protect(&gTxPacket))
+        {
+            return FALSE;
+        }
+#endif
+#if gAppUseRelay_d
+        AppRelay_Stamp(&gTxPacket);
+#endif
+    }
+    if(!App_TransmitPacket())
+    {
+        return FALSE;
+    }
+    if(pAckRx)
+    {
+        //the frame carries what its peer is owed, acks and replies alike
+        AppStats_LatencyReplySent();
+    }
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Queues a frame and sends it at once if the radio is free and no higher
+*         class or reply guard holds it back. Nothing in progress is aborted.
+*
+* \param[in] txClass  traffic class of the frame
+* \param[in] pFrame   frame to send, copied
+* \param[in] pAckRx   receive state of the destination peer, NULL if none
+*
+********************************************************************************** */
+static void App_QueueFrame(app_tx_class_t txClass, app_frame_t* pFrame, app_ack_rx_t* pAckRx)
+{
+    (void)AppTxq_Enqueue(txClass, pFrame, pAckRx);
+    (void)App_TxKick();
+}
+
+/*! *********************************************************************************
+* \brief  Starts the next frame of the TX queue unless one is already on air. When
+*         the reply guard holds frames back, a timer posts gCtEvtTxQueue_c once it
+*         is over.
+*
+* \return  TRUE if a transmission was started
+*
+********************************************************************************** */
+APP_RAMFUNC static bool_t App_TxKick(void)
+{
+    app_frame_t frame;
+    app_ack_rx_t* pAckRx;
+    uint32_t waitMs;
+
+    if(mAppTxBusy)
+    {
+        return FALSE;
+    }
+#if gAppUseRadioTest_d
+    if(AppTest_Active())
+    {
+        //held in the queue until the test mode gives the radio back
+        return FALSE;
+    }
+#endif
+    if(!AppTxq_Dequeue(&frame, &pAckRx, &waitMs))
+    {
+        if(waitMs)
+        {
+            TMR_StartSingleShotTimer(mAppTxTmrId, waitMs, App_TxTimerCallback, NULL);
+        }
+        return FALSE;
+    }
+    if(!App_SendFrame(&frame, pAckRx))
+    {
+        //mAppTxBusy stays clear, a frame that never went on air gets no
+        //gCtEvtTxDone_c; the receiver may have been aborted for it
+        App_RearmRx();
+        return FALSE;
+    }
+    mAppTxBusy = TRUE;
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Called when the radio has nothing left to do for the current event:
+*         sends the next queued frame, or listens.
+*
+********************************************************************************** */
+APP_RAMFUNC static void App_RadioIdle(void)
+{
+    if(!App_TxKick())
+    {
+        App_RearmRx();
+    }
+}
+
+#if gAppUseSecLib_d
+/*! *********************************************************************************
+* \brief  Unprotects gRxPacket in place. The master checks the replay state of the
+*         sending slave; a slave only spends time on frames addressed to its own
+*         id, to the unassigned id while it joins, or OTA broadcasts.
+*
+* \return  FALSE if the frame is to be dropped
+*
+********************************************************************************** */
+static bool_t App_Unprotect(void)
+{
+    uint8_t devId = AppFrame_DevId(&gRxPacket);
+
+#ifdef LEDCONTROL_MASTER
+    //join requests are checked against the replay state of the UID's id by App_JoinAssign
+    return AppSec_Unprotect(&gRxPacket, (devId < LEDCONTROL_MAX_SLAVES) ? &mAppSecRx[devId] : NULL);
+#else
+    if((devId != mAppDeviceId) && (devId != gAppFrameUnassignedId_c) && (devId != gAppFrameBroadcastId_c))
+    {
+        return FALSE;
+    }
+    return AppSec_Unprotect(&gRxPacket, &mAppSecRx);
+#endif
+}
+#endif
+
+#if gAppUseRelay_d
+/*! *********************************************************************************
+* \brief  Lets the relay layer learn from gRxPacket and drop duplicates. A frame
+*         to forward is held for the jitter by mAppRelayTmrId.
+*
+* \return  TRUE if the frame is to be handled by this node
+*
+********************************************************************************** */
+static bool_t App_RelayReceive(void)
+{
+    uint32_t delayMs = 0;
+#ifdef LEDCONTROL_MASTER
+    uint8_t ownId = gAppFrameInvalidId_c;
+#else
+    uint8_t ownId = mAppDeviceId;
+#endif
+
+    switch(AppRelay_Receive(&gRxPacket, mAppRxLatestPacket.rssi, ownId, &delayMs))
+    {
+    case gAppRelayConsume_c:
+        return TRUE;
+    case gAppRelayForward_c:
+        TMR_StartSingleShotTimer(mAppRelayTmrId, delayMs, App_RelayTimerCallback, NULL);
+        return FALSE;
+    case gAppRelayConsumeForward_c:
+        TMR_StartSingleShotTimer(mAppRelayTmrId, delayMs, App_RelayTimerCallback, NULL);
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+#endif
+
+#if gAppUseRelay_d || gAppUseOta_d
+/*! *********************************************************************************
+* \brief  Folds the chip UID into a seed, so nodes reset together pick different
+*         frame ids, jitters and OTA answer slots.
+*
+* \return  seed for AppRelay_Init and AppOta_Init
+*
+********************************************************************************** */
+static uint32_t App_UidSeed(void)
+{
+    uint8_t uid[gAppJoinUidLen_c];
+    uint32_t seed = 0;
+    uint8_t i;
+
+    AppJoin_GetUid(uid);
+    for(i = 0; i < gAppJoinUidLen_c; i++)
+    {
+        seed = (seed << 8) ^ (seed >> 24) ^ uid[i];
+    }
+    return seed;
+}
+#endif
+
+#if gAppUseOta_d && defined(LEDCONTROL_MASTER)
+/*! *********************************************************************************
+* \brief  Keeps one OTA frame in the TX queue: the next one is built when the
+*         last has left, so LED commands and probes still go first. While the
+*         session waits for the slaves mAppOtaTmrId posts gCtEvtOta_c.
+*
+********************************************************************************** */
+static void App_OtaPump(void)
+{
+    app_frame_t frame;
+    uint32_t waitMs;
+
+    if(AppTxq_Pending(gAppTxClassOta_c))
+    {
+        return;
+    }
+    if(AppOta_ServerNext(&frame, &waitMs))
+    {
+        App_QueueFrame(gAppTxClassOta_c, &frame, NULL);
+    }
+    else if(waitMs)
+    {
+        TMR_StartSingleShotTimer(mAppOtaTmrId, waitMs, App_OtaTimerCallback, NULL);
+    }
+}
+#endif
+
+#if gAppUseRadioTest_d
+/*! *********************************************************************************
+* \brief  Lends the radio to the test mode on the LED network link. A frame on air
+*         is aborted and counted as sent, queued frames wait for App_TestStop;
+*         the master stops probing meanwhile.
+*
+********************************************************************************** */
+static void App_TestStart(void)
+{
+#ifdef LEDCONTROL_MASTER
+    TMR_StopTimer(mAppTmrId);
+#endif
+    if(mAppTxBusy)
+    {
+        mAppTxBusy = FALSE;
+        AppTxq_TxDone();
+    }
+    App_TestArm(AppTest_Start(mAppLinkParams.channel, mAppLinkParams.txPowerLevel));
+}
+
+/*! *********************************************************************************
+* \brief  Restores the radio, packet sync address and link of the LED network after
+*         the test mode, restarts the probes and sends what was queued meanwhile.
+*
+********************************************************************************** */
+static void App_TestStop(void)
+{
+    TMR_StopTimer(mAppTestTmrId);
+    (void)GENFSK_RadioConfig(mAppGenfskId, &radioConfig);
+    GENFSK_SetNetworkAddress(mAppGenfskId, 0, &ntwkAddr);
+    GENFSK_EnableNetworkAddress(mAppGenfskId, 0);
+    GENFSK_SetTxPowerLevel(mAppGenfskId, mAppLinkParams.txPowerLevel);
+    GENFSK_SetChannelNumber(mAppGenfskId, mAppLinkParams.channel);
+#ifdef LEDCONTROL_MASTER
+    TMR_StartIntervalTimer(mAppTmrId, LEDCONTROL_CONNECTIONCHECK_TIMEOUT_MILLISECONDS, App_TimerCallback, NULL);
+#endif
+    App_RadioIdle();
+}
+
+/*! *********************************************************************************
+* \brief  Passes a radio or timer event to the test mode and arms the timer for
+*         its next step.
+*
+* \param[in] flags  any of gCtEvtRxDone_c, gCtEvtTxDone_c and gCtEvtTest_c
+*
+********************************************************************************** */
+static void App_TestEvents(osaEventFlags_t flags)
+{
+    if(flags & gCtEvtRxDone_c)
+    {
+        App_TestArm(AppTest_RxDone(mAppRxLatestPacket.pBuffer, mAppRxLatestPacket.timestamp,
+                                   mAppRxLatestPacket.rssi, mAppRxLatestPacket.crcValid));
+    }
+    if(flags & gCtEvtTxDone_c)
+    {
+        App_TestArm(AppTest_TxDone());
+    }
+    if(flags & gCtEvtTest_c)
+    {
+        App_TestArm(AppTest_Timer());
+    }
+}
+
+static void App_TestArm(uint32_t delayMs)
+{
+    if(delayMs)
+    {
+        TMR_StartSingleShotTimer(mAppTestTmrId, delayMs, App_TestTimerCallback, NULL);
+    }
+    else
+    {
+        TMR_StopTimer(mAppTestTmrId);
+    }
+}
+#endif
+
+#ifdef LEDCONTROL_MASTER
+/*! *********************************************************************************
+* \brief  Prints the UART digit of each LED command the ack confirms, in the order
+*         the commands were sent, as one string.
+*
+* \param[in] pFrame  received frame carrying gAppFrameFlagAck_c
+*
+********************************************************************************** */
+static void App_ConfirmCommands(const app_frame_t* pFrame)
+{
+#if gAppUseHostFrames_d
+    //slave id, then the tags, which are the LEDs
+    uint8_t tags[gAppAckWindowBits_c + 2];
+    uint8_t count;
+    uint8_t i;
+
+    tags[0] = pFrame->devId;
+    count = AppAck_Confirm(&mAppAckTx[pFrame->devId], pFrame->ackSeq, pFrame->ackBitmap, &tags[1]);
+    if(count)
+    {
+        App_HostSend(gAppHostRecAcks_c, tags, (uint8_t)(count + 1U));
+    }
+#else
+    uint8_t tags[gAppAckWindowBits_c + 1];
+    char digits[gAppAckWindowBits_c + 2];
+    uint8_t count;
+    uint8_t i;
+
+    count = AppAck_Confirm(&mAppAckTx[pFrame->devId], pFrame->ackSeq, pFrame->ackBitmap, tags);
+    for(i = 0; i < count; i++)
+    {
+        digits[i] = (char)('1' + (pFrame->devId * LEDCONTROL_LEDS_PER_DEVICE) + tags[i]);
+    }
+    digits[count] = '\0';
+    if(count)
+    {
+        Serial_Print(mAppSerId, digits, gAllowToBlock_d);
+    }
+#endif
+
+    for(i = 0; i < LEDCONTROL_MAX_SLAVES; i++)
+    {
+        if(mAppAckTx[i].outstanding)
+        {
+            return;
+        }
+    }
+    //nothing left to wait for, probes may go
+    AppTxq_ReplyReceived();
+}
+/*! *********************************************************************************
+* \brief  Looks the requesting UID up in the slave table, allocating an id if it
+*         is new, and queues the assignment. A full table is answered with
+*         gAppFrameInvalidId_c.
+*         The per slave ack and replay state is reset for a new UID, and in the
+*         gAppUseSecLib_d build for a known one only when the request's frame
+*         counter is above the last one accepted from its id, which a recorded
+*         request never is. A stale request changes nothing; its assignment
+*         carries the counter floor the slave has to move to first.
+*
+* \param[in] pFrame  join request
+*
+********************************************************************************** */
+static void App_JoinAssign(const app_frame_t* pFrame)
+{
+    uint8_t data[gAppJoinAssignLen_c];
+    app_frame_t reply = {0};
+    bool_t isNew;
+    uint8_t id;
+#if gAppUseSecLib_d
+    uint32_t counter = AppSec_RxCounter();
+    uint32_t minCounter = counter + 1U;
+#endif
+
+    if(pFrame->dataLen < gAppJoinRequestLen_c)
+    {
+        return;
+    }
+    //a new entry reaches NVM on idle
+    id = AppJoin_Allocate(&mAppJoinTable, pFrame->pData, &isNew);
+#if gAppUseSecLib_d
+    if((id < LEDCONTROL_MAX_SLAVES) && !isNew && (counter < mAppSecRx[id]))
+    {
+        //a replay, or a slave that lost its NVM and reuses counters of this id
+        minCounter = mAppSecRx[id] + gAppSecRejoinSkip_c;
+    }
+    else if(id < LEDCONTROL_MAX_SLAVES)
+    {
+        FLib_MemSet(&mAppAckTx[id], 0, sizeof(mAppAckTx[id]));
+        FLib_MemSet(&mAppAckRx[id], 0, sizeof(mAppAckRx[id]));
+        mAppSecRx[id] = minCounter;
+        AppSec_SaveReplay(id);
+    }
+#else
+    //nothing tells a restarted slave from a replay without frame protection
+    if(id < LEDCONTROL_MAX_SLAVES)
+    {
+        FLib_MemSet(&mAppAckTx[id], 0, sizeof(mAppAckTx[id]));
+        FLib_MemSet(&mAppAckRx[id], 0, sizeof(mAppAckRx[id]));
+    }
+#endif
+
+    FLib_MemCpy(data, pFrame->pData, gAppJoinUidLen_c);
+    data[gAppJoinUidLen_c] = id;
+#if gAppUseSecLib_d
+    FLib_MemCpy(&data[gAppJoinUidLen_c + 1], &pFrame->pData[gAppJoinUidLen_c], gAppJoinChallengeLen_c);
+    data[gAppJoinAssignLen_c - 4] = (uint8_t)(minCounter >> 24);
+    data[gAppJoinAssignLen_c - 3] = (uint8_t)(minCounter >> 16);
+    data[gAppJoinAssignLen_c - 2] = (uint8_t)(minCounter >> 8);
+    data[gAppJoinAssignLen_c - 1] = (uint8_t)minCounter;
+#endif
+    reply.devId = gAppFrameUnassignedId_c;
+    reply.command = gAppJoinCmdAssign_c;
+    reply.dataLen = sizeof(data);
+    reply.pData = data;
+    (void)AppTxq_Enqueue(gAppTxClassAck_c, &reply, NULL);
+}
+
+/*! *********************************************************************************
+* \brief  Reports the result of the last presence probe of a slave, as a line
+*         or, in the gAppUseHostFrames_d build, as a record.
+*
+* \param[in] devId      slave id
+* \param[in] connected  the slave answered the probe
+*
+********************************************************************************** */
+static void App_ReportPresence(uint8_t devId, bool connected)
+{
+#if gAppUseHostFrames_d
+    uint8_t presence[2];
+
+    presence[0] = devId;
+    presence[1] = connected ? 1U : 0U;
+    App_HostSend(gAppHostRecPresence_c, presence, sizeof(presence));
+#else
+    //numbered from 1, ids past the UART digits take more than one
+    Serial_Print(mAppSerId, "Slave ", gAllowToBlock_d);
+    Serial_PrintDec(mAppSerId, (uint32_t)devId + 1U);
+    Serial_Print(mAppSerId, connected ? " connected\r\n" : " disconnected\r\n", gAllowToBlock_d);
+#endif
+}
+
+/*! *********************************************************************************
+* \brief  Moves the presence probe on to the next slave id in use: one the join
+*         table assigned or one of the LEDCONTROL_PINNED_SLAVES ids. Each slave
+*         is probed once every LEDCONTROL_CONNECTIONCHECK_TIMEOUT_MILLISECONDS
+*         times the ids in use.
+*
+* \param[in] devId  slave probed last, gAppFrameInvalidId_c to start over
+*
+* \return  slave id to probe
+*
+********************************************************************************** */
+static uint8_t App_NextProbeId(uint8_t devId)
+{
+    uint32_t i;
+
+    if(devId >= LEDCONTROL_MAX_SLAVES)
+    {
+        devId = LEDCONTROL_MAX_SLAVES - 1U;
+    }
+    for(i = 0; i < LEDCONTROL_MAX_SLAVES; i++)
+    {
+        devId = (uint8_t)((devId + 1U) % LEDCONTROL_MAX_SLAVES);
+        if((devId < LEDCONTROL_PINNED_SLAVES) || AppJoin_IsAssigned(&mAppJoinTable, devId))
+        {
+            break;
+        }
+    }
+    return devId;
+}
+
+#if gAppUseHostFrames_d
+/*! *********************************************************************************
+* \brief  Takes what the Serial Manager holds, up to one encoded record, and
+*         acts on the records completed; posts gCtEvtUart_c again while more is
+*         waiting, like App_UpdateUartData.
+*
+********************************************************************************** */
+static void App_HostRead(void)
+{
+    uint8_t buf[gAppHostEncodedMax_c];
+    app_host_record_t record;
+    uint16_t count = 0;
+    uint16_t i;
+
+    if(gSerial_Success_c != Serial_Read(mAppSerId, buf, sizeof(buf), &count))
+    {
+        return;
+    }
+    for(i = 0; i < count; i++)
+    {
+        if(AppHost_Receive(&mAppHostRx, buf[i], &record))
+        {
+            App_HostRecord(&record);
+        }
+    }
+    Serial_RxBufferByteCount(mAppSerId, &count);
+    if(count)
+    {
+        (void)OSA_EventSet(mAppThreadEvt, gCtEvtUart_c);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Queues the toggles of a gAppHostRecLeds_c record and answers with the
+*         pairs that found the command queue full, so the host knows at once,
+*         pairs past gAppHostLedPairsMax_c are ignored. The bytes of a
+*         gAppHostRecConsole_c record are UART commands; other types are left
+*         to newer firmware.
+*
+* \param[in] pRecord  record from the host
+*
+********************************************************************************** */
+static void App_HostRecord(const app_host_record_t* pRecord)
+{
+    uint8_t rejected[gAppHostPayloadMax_c];
+    uint8_t count = 0;
+    uint8_t i;
+    uint8_t led;
+
+    if(pRecord->type == gAppHostRecLeds_c)
+    {
+        rejected[count++] = pRecord->seq;
+        for(i = 0; (i + 1U < pRecord->len) && (i < 2U * gAppHostLedPairsMax_c); i += 2U)
+        {
+            uint8_t devId = pRecord->payload[i];
+            uint8_t mask = pRecord->payload[i + 1U];
+            uint8_t refused = 0;
+
+            for(led = 0; led < LEDCONTROL_LEDS_PER_DEVICE; led++)
+            {
+                if((mask & (1U << led)) &&
+                   ((devId >= LEDCONTROL_MAX_SLAVES) || !App_LedCommand(devId, led)))
+                {
+                    refused |= (uint8_t)(1U << led);
+                }
+            }
+            if(refused)
+            {
+                rejected[count++] = devId;
+                rejected[count++] = refused;
+            }
+        }
+        App_HostSend(gAppHostRecAccepted_c, rejected, count);
+    }
+    else if(pRecord->type == gAppHostRecConsole_c)
+    {
+        for(i = 0; i < pRecord->len; i++)
+        {
+            App_UartCommand(pRecord->payload[i]);
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Hands a whole record to the Serial Manager in one transfer, where the
+*         ASCII build printed a string per event.
+*
+********************************************************************************** */
+static void App_HostSend(uint8_t type, const uint8_t* pPayload, uint8_t len)
+{
+    uint8_t out[gAppHostEncodedMax_c];
+
+    (void)Serial_SyncWrite(mAppSerId, out, AppHost_Encode(type, pPayload, len, out));
+}
+#endif
+#else
+/*! *********************************************************************************
+* \brief  Registers the LED state record and drives the LEDs to the state saved
+*         before the last reset, all off if none was saved.
+*
+********************************************************************************** */
+static void App_RestoreLeds(void)
+{
+    AppNv_Register(gAppNvLedState_c, &mAppLedState, sizeof(mAppLedState));
+    if(!AppNv_Restore(gAppNvLedState_c))
+    {
+        mAppLedState = 0;
+    }
+    if(mAppLedState & 0x01)
+    {
+        Led2On();
+    }
+    else
+    {
+        Led2Off();
+    }
+    if(mAppLedState & 0x02)
+    {
+        Led3On();
+    }
+    else
+    {
+        Led3Off();
+    }
+    if(mAppLedState & 0x04)
+    {
+        Led4On();
+    }
+    else
+    {
+        Led4Off();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Queues a join request carrying the chip UID, and a new challenge in the
+*         gAppUseSecLib_d build, and arms the timer for the next one in a window
+*         twice as wide, in case no assignment comes back.
+*
+********************************************************************************** */
+static void App_JoinRequest(void)
+{
+    uint8_t data[gAppJoinRequestLen_c];
+    app_frame_t request = {0};
+
+    FLib_MemCpy(data, mAppUid, gAppJoinUidLen_c);
+#if gAppUseSecLib_d
+    RNG_GetRandomNo(&mAppJoinChallenge);
+    data[gAppJoinUidLen_c]     = (uint8_t)(mAppJoinChallenge >> 24);
+    data[gAppJoinUidLen_c + 1] = (uint8_t)(mAppJoinChallenge >> 16);
+    data[gAppJoinUidLen_c + 2] = (uint8_t)(mAppJoinChallenge >> 8);
+    data[gAppJoinUidLen_c + 3] = (uint8_t)mAppJoinChallenge;
+#endif
+    request.devId = gAppFrameUnassignedId_c;
+    request.command = gAppJoinCmdRequest_c;
+    request.dataLen = sizeof(data);
+    request.pData = data;
+    App_QueueFrame(gAppTxClassProbe_c, &request, NULL);
+    TMR_StartSingleShotTimer(mAppTmrId, AppJoin_NextAttemptMs(), App_TimerCallback, NULL);
+}
+
+/*! *********************************************************************************
+* \brief  Takes the id of an assignment carrying this chip's UID and stores it.
+*         Assignments for other chips, and gAppFrameInvalidId_c from a full table,
+*         leave the backoff running. In the gAppUseSecLib_d build the assignment
+*         must echo the last challenge, and one whose counter floor is above the
+*         frame counter only raises the counter: the master did not reset its
+*         state of the id, the next request gets the id.
+*
+* \param[in] pFrame  join assignment
+*
+********************************************************************************** */
+static void App_JoinAssigned(const app_frame_t* pFrame)
+{
+    uint8_t id;
+#if gAppUseSecLib_d
+    const uint8_t* pProof = &pFrame->pData[gAppJoinUidLen_c + 1];
+#endif
+
+    if((mAppDeviceId != gAppFrameUnassignedId_c) ||
+       (pFrame->dataLen < gAppJoinAssignLen_c) ||
+       !FLib_MemCmp(pFrame->pData, mAppUid, gAppJoinUidLen_c))
+    {
+        return;
+    }
+#if gAppUseSecLib_d
+    if((((uint32_t)pProof[0] << 24) | ((uint32_t)pProof[1] << 16) |
+        ((uint32_t)pProof[2] << 8) | (uint32_t)pProof[3]) != mAppJoinChallenge)
+    {
+        return;
+    }
+    pProof += gAppJoinChallengeLen_c;
+    if(AppSec_RaiseCounter(((uint32_t)pProof[0] << 24) | ((uint32_t)pProof[1] << 16) |
+                           ((uint32_t)pProof[2] << 8) | (uint32_t)pProof[3]))
+    {
+        return;
+    }
+#endif
+    id = pFrame->pData[gAppJoinUidLen_c];
+    if(id < gAppJoinMaxSlaves_c)
+    {
+        TMR_StopTimer(mAppTmrId);
+        mAppDeviceId = id;
+        AppJoin_SaveIdentity(id);
+#if gAppUseSecLib_d
+        //assignments to other chips are broadcast to all, only this one is worth a write
+        AppSec_SaveReplay(0);
+#endif
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Queues the pending ack right away when gAppAckDelayMs_c is 0. Otherwise
+*         the ack waits for a reply to ride on, or for the ack timer, so commands
+*         arriving meanwhile share one ack frame.
+*         The timer is not restarted by later commands, bounding the delay.
+*
+********************************************************************************** */
+static void App_ScheduleAck(void)
+{
+#if (gAppAckDelayMs_c == 0)
+    app_frame_t ack = {0};
+
+    ack.devId = mAppDeviceId;
+    ack.command = gAppAckCmd_c;
+    (void)AppTxq_Enqueue(gAppTxClassAck_c, &ack, &mAppAckRx);
+#else
+    if(!TMR_IsTimerActive(mAppTmrId))
+    {
+        TMR_StartSingleShotTimer(mAppTmrId, gAppAckDelayMs_c, App_TimerCallback, NULL);
+    }
+#endif
+}
+#endif
+
+/*! *********************************************************************************
+* \brief  This function represents the Generic FSK receive callback. 
+*         This function is called each time the Generic FSK Link Layer receives a 
+*         valid packet
+* \param[in]  pBuffer Pointer to receive buffer as byte array
+* \param[in]  timestamp Generic FSK timestamp for received packet
+* \param[in]  rssi The RSSI measured during the reception of the packet
+*
+********************************************************************************** */
+APP_RAMFUNC static void App_GenFskReceiveCallback(uint8_t *pBuffer, 
+                                      uint16_t bufferLength, 
+                                      uint64_t timestamp, 
+                                      uint8_t rssi,
+                                      uint8_t crcValid)
+{
+   AppStats_LatencyStart();
+
+   mAppRxLatestPacket.pBuffer      = pBuffer;
+   mAppRxLatestPacket.bufferLength = bufferLength;
+   mAppRxLatestPacket.timestamp    = timestamp;
+   mAppRxLatestPacket.rssi         = rssi;
+   mAppRxLatestPacket.crcValid     = crcValid;
+
+   AppStats_RadioInc(rxDone);
+   if(!crcValid)
+   {
+       AppStats_RadioInc(rxCrcError);
+   }
+   
+   /*send event to app thread*/
+   OSA_EventSet(mAppThreadEvt, gCtEvtRxDone_c);
+}
+
+/*! *********************************************************************************
+* \brief  This function represents the Generic FSK event notification callback. 
+*         This function is called each time the Generic FSK Link Layer has 
+*         a notification for the upper layer
+* \param[in]  event The event that generated the notification
+* \param[in]  eventStatus status of the event
+*
+********************************************************************************** */
+APP_RAMFUNC static void App_GenFskEventNotificationCallback(genfskEvent_t event, 
+                                                genfskEventStatus_t eventStatus)
+{
+   if(event & gGenfskTxEvent)
+   {
+       mAppGenfskStatus = eventStatus;
+       AppStats_RadioInc(txDone);
+       /*send event done*/
+       OSA_EventSet(mAppThreadEvt, gCtEvtTxDone_c);
+   }
+   if(event & gGenfskRxEvent)
+   {
+       if(eventStatus == gGenfskTimeout)
+       {
+           AppStats_RadioInc(rxTimeout);
+           OSA_EventSet(mAppThreadEvt, gCtEvtSeqTimeout_c);
+       }
+       else
+       {
+           AppStats_RadioInc(rxFailed);
+           OSA_EventSet(mAppThreadEvt, gCtEvtRxFailed_c);
+       }
+   }
+}
+
+static void App_SerialCallback(void* param)
+{
+    OSA_EventSet(mAppThreadEvt, gCtEvtUart_c);
+}
 
 
 static void gFsk_Init()
 {
 	GENFSK_RegisterCallbacks(mAppGenfskId, App_GenFskReceiveCallback, App_GenFskEventNotificationCallback);
-    gRxBuffer  = MEM_BufferAlloc(gGenFskDefaultMaxBufferSize_c +
+#if gAppUseStaticAllocation_d
+    gRxBuffer  = mAppRxBufferStorage;
+    gTxBuffer  = mAppTxBufferStorage;
+
+    gRxPacket.payload = mAppRxPayloadStorage;
+    gTxPacket.payload = mAppTxPayloadStorage;
+#else
+    gRxBuffer  = App_BufferAlloc(gGenFskDefaultMaxBufferSize_c +
                                  crcConfig.crcSize);
-    gTxBuffer  = MEM_BufferAlloc(gGenFskDefaultMaxBufferSize_c);
+    gTxBuffer  = App_BufferAlloc(gGenFskDefaultMaxBufferSize_c);
 
-    gRxPacket.payload = (uint8_t*)MEM_BufferAlloc(gGenFskMaxPayloadLen_c  +
+    gRxPacket.payload = (uint8_t*)App_BufferAlloc(gGenFskMaxPayloadLen_c  +
                                                        crcConfig.crcSize);
-    gTxPacket.payload = (uint8_t*)MEM_BufferAlloc(gGenFskMaxPayloadLen_c);
+    gTxPacket.payload = (uint8_t*)App_BufferAlloc(gGenFskMaxPayloadLen_c);
+#endif
 
     /*prepare the part of the tx packet that is common for all tests*/
     gTxPacket.addr = gGenFskDefaultSyncAddress_c;
     gTxPacket.header.h0Field = gGenFskDefaultH0Value_c;
     gTxPacket.header.h1Field = gGenFskDefaultH1Value_c;
-	gTxPacket.header.lengthField = gGenFskMinPayloadLen_c;
-    /*set bitrate*/
-    GENFSK_RadioConfig(mAppGenfskId, &radioConfig);
-    /*set packet config*/
-    GENFSK_SetPacketConfig(mAppGenfskId, &pktConfig);
-    /*set whitener config*/
-    GENFSK_SetWhitenerConfig(mAppGenfskId, &whitenConfig);
-    /*set crc config*/
-    GENFSK_SetCrcConfig(mAppGenfskId, &crcConfig);
+	gTxPacket.header.lengthField = gAppFrameMinPayloadLen_c;
+    /*bitrate, packet, whitener and crc config were applied by GENFSK_AllocInstance*/
 
     /*set network address at location 0 and enable it*/
     GENFSK_SetNetworkAddress(mAppGenfskId, 0, &ntwkAddr);
     GENFSK_EnableNetworkAddress(mAppGenfskId, 0);
 
     /*set tx power level*/
-    GENFSK_SetTxPowerLevel(mAppGenfskId, gGenFskDefaultTxPowerLevel_c);
+    GENFSK_SetTxPowerLevel(mAppGenfskId, mAppLinkParams.txPowerLevel);
     /*set channel: Freq = 2360MHz + ChannNumber*1MHz*/
-    GENFSK_SetChannelNumber(mAppGenfskId, gGenFskDefaultChannel_c);
+    GENFSK_SetChannelNumber(mAppGenfskId, mAppLinkParams.channel);
 }
 
 static void App_TimerCallback(void* param)
@@ -607,5 +1761,31 @@ static void App_TimerCallback(void* param)
     OSA_EventSet(mAppThreadEvt, gCtEvtTimerExpired_c);
 }
 
+static void App_TxTimerCallback(void* param)
+{
+    OSA_EventSet(mAppThreadEvt, gCtEvtTxQueue_c);
+}
+
+#if gAppUseRelay_d
+static void App_RelayTimerCallback(void* param)
+{
+    OSA_EventSet(mAppThreadEvt, gCtEvtRelay_c);
+}
+#endif
+
+#if gAppUseOta_d
+static void App_OtaTimerCallback(void* param)
+{
+    OSA_EventSet(mAppThreadEvt, gCtEvtOta_c);
+}
+#endif
+
+#if gAppUseRadioTest_d
+static void App_TestTimerCallback(void* param)
+{
+    OSA_EventSet(mAppThreadEvt, gCtEvtTest_c);
+}
+#endif
+
 
 
@@ -52,6 +52,80 @@
 #define FSL_RTOS_FREE_RTOS              1
 #define gTotalHeapSize_c                6000
 
+/*! *********************************************************************************
+ * 	Application Configuration
+ ********************************************************************************** */
+/* Enables the run time statistics build: per task CPU usage, radio counters and
+   the UART statistics dump */
+#ifndef gAppUseRunTimeStats_d
+#define gAppUseRunTimeStats_d           0
+#endif
+
+/* Enables the log2 latency histograms around the radio event handlers, the
+   boot phase timestamps and the UART histogram dump */
+#ifndef gAppUseLatencyStats_d
+#define gAppUseLatencyStats_d           0
+#endif
+
+/* Enables MEM pool usage tracking (peak, failures, requested sizes) and the UART
+   profile dump used by tools/poolgen.py */
+#ifndef gAppUseMemStats_d
+#define gAppUseMemStats_d               0
+#endif
+
+/* Uses the pool layout generated by tools/poolgen.py (app_pools.h) instead of
+   the default PoolsDetails_c below */
+#ifndef gAppUseGeneratedPools_d
+#define gAppUseGeneratedPools_d         0
+#endif
+
+/* Protects every frame with AES-128-CCM through SecLib and a replay counter
+   (ledcontrol_sec.h), all nodes must be built alike */
+#ifndef gAppUseSecLib_d
+#define gAppUseSecLib_d                 0
+#endif
+
+/* Adds a relay header to every frame so slaves out of range of the master are
+   reached through others (ledcontrol_relay.h), all nodes must be built alike;
+   slaves built with LEDCONTROL_RELAY also forward */
+#ifndef gAppUseRelay_d
+#define gAppUseRelay_d                  0
+#endif
+
+/* Takes a firmware image on the master UART and broadcasts it to every slave,
+   which hands it to the OTAP bootloader through OtaSupport (ledcontrol_ota.h);
+   all nodes must be built alike */
+#ifndef gAppUseOta_d
+#define gAppUseOta_d                    0
+#endif
+
+/* Adds the radio test mode: PER, range and continuous tests between two nodes
+   on any data rate, channel and TX power, with UART records for
+   tools/linktest.py (ledcontrol_test.h) */
+#ifndef gAppUseRadioTest_d
+#define gAppUseRadioTest_d              0
+#endif
+
+/* Makes the master talk COBS framed, CRC checked records to its host at
+   gAppHostBaudRate_c instead of ASCII digits and text (ledcontrol_host.h), for
+   the web bridge run with -f; the dumps and tools/ stay with the ASCII build */
+#ifndef gAppUseHostFrames_d
+#define gAppUseHostFrames_d             0
+#endif
+
+/* Enables the static allocation build: kernel tasks and the radio buffers are
+   placed at link time instead of coming from the FreeRTOS heap / MEM pools */
+#ifndef gAppUseStaticAllocation_d
+#define gAppUseStaticAllocation_d       0
+#endif
+
+/* Runs the radio hot path (GENFSK callbacks, frame dispatch, receiver re-arm)
+   from SRAM instead of flash (APP_RAMFUNC, ledcontrol_static.h); 0 keeps it
+   in flash, e.g. to compare the 'h' latency dumps of both builds */
+#ifndef gAppUseRamFunc_d
+#define gAppUseRamFunc_d                1
+#endif
+
 /*! *********************************************************************************
  * 	Drivers Configuration
  ********************************************************************************** */
@@ -70,18 +144,33 @@
 /* Defines Num of Serial Manager interfaces */
 #define gSerialManagerMaxInterfaces_c   1
 
+/* Defines the Serial Manager RX buffer size; the OTA upload sends
+   gAppOtaUartChunk_c bytes between two acks, more than the default 32 */
+#if gAppUseOta_d
+#define gSerialMgrRxBufSize_c           128
+#endif
+
+/* Keeps the OtaSupport image of an OTA slave in the internal storage region */
+#if gAppUseOta_d
+#define gEepromType_d                   gEepromDevice_InternalFlash_c
+#endif
+
 /* Defines Size for Timer Task*/
 #define gTmrTaskStackSize_c  384
 
 /* Defines pools by block size and number of blocks. Must be aligned to 4 bytes.*/
+#if gAppUseGeneratedPools_d
+#include "app_pools.h"
+#else
 #define PoolsDetails_c \
          _block_size_  32  _number_of_blocks_    6 _eol_  \
          _block_size_  64  _number_of_blocks_    3 _eol_  \
          _block_size_ 128  _number_of_blocks_    4 _eol_  \
          _block_size_ 512  _number_of_blocks_    4 _eol_
+#endif
 
 /* Defines number of timers needed by the application */
-#define gTmrApplicationTimers_c         1
+#define gTmrApplicationTimers_c         (2 + gAppUseRelay_d + gAppUseOta_d + gAppUseRadioTest_d)
 
 /* Defines number of timers needed by the protocol stack */
 #define gTmrStackTimers_c               3
@@ -10,6 +10,8 @@
 #include "EmbeddedTypes.h"
 #include "fsl_os_abstraction.h"
 #include "genfsk_interface.h"
+#include "ledcontrol_frame.h"
+#include "ledcontrol_join.h"
 
 /*! *********************************************************************************
 *************************************************************************************
@@ -17,13 +19,6 @@
 *************************************************************************************
 ********************************************************************************** */
 
-typedef enum
-{
-	gAppSlave1Check = 0,
-	gAppSlave2Check = 1,
-	gAppSlave3Check = 2,
-}connectivity_states_t;
-
 typedef enum ct_event_tag
 {
 	gCtEvtRxDone_c       = 0x00000001U,
@@ -37,9 +32,14 @@ typedef enum ct_event_tag
 	gCtEvtSelfEvent_c    = 0x00000080U,
 
 	gCtEvtWakeUp_c       = 0x00000100U,
+	gCtEvtTxQueue_c      = 0x00000200U,
+	gCtEvtRelay_c        = 0x00000400U,
+	gCtEvtOta_c          = 0x00000800U,
+
+	gCtEvtTest_c         = 0x00001000U,
 
-	gCtEvtMaxEvent_c     = 0x00000200U,
-	gCtEvtEventsAll_c    = 0x000003FFU
+	gCtEvtMaxEvent_c     = 0x00002000U,
+	gCtEvtEventsAll_c    = 0x00003FFFU
 }ct_event_t;
 
 
@@ -53,6 +53,13 @@ typedef struct ct_rx_indication_tag
     uint8_t crcValid;
 }ct_rx_indication_t;
 
+/*radio link parameters, the gAppNvLinkParams_c record*/
+typedef struct app_link_params_tag
+{
+    uint8_t channel;
+    uint8_t txPowerLevel;
+}app_link_params_t;
+
 typedef void (* pHookAppNotification) ( void );
 typedef void (* pTmrHookNotification) (void*);
 
@@ -107,30 +114,49 @@ typedef void (* pTmrHookNotification) (void*);
 
 #define gGenFskMinPayloadLen_c (6)
 
+/*LED commands, in the order of the UART digits for each device*/
+#define LEDCONTROL_LEDS_PER_DEVICE 3
+
 #define gGenFskDefaultPayloadLen_c (gGenFskMinPayloadLen_c)
 
 #define gGenFskDefaultMaxBufferSize_c (gGenFskDefaultSyncAddrSize_c + 1 + \
                                        gGenFskDefaultHeaderSizeBytes_c  + \
                                            gGenFskMaxPayloadLen_c)
 
-/*H0 and H1 config*/
-#define gGenFskDefaultH0Value_c        (0x0000)
-#define gGenFskDefaultH0Mask_c         ((1 << gGenFskDefaultH0FieldSize_c) - 1)
+/*crc size in bytes, depends on the frame profile*/
+#define gGenFskDefaultCrcSize_c gAppFrameCrcSize_c
 
+/*H0 and H1 config, the compact frame profile carries fields in them so they are not matched*/
+#define gGenFskDefaultH0Value_c        (0x0000)
 #define gGenFskDefaultH1Value_c        (0x0000)
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+#define gGenFskDefaultH0Mask_c         (0x0000)
+#define gGenFskDefaultH1Mask_c         (0x0000)
+#else
+#define gGenFskDefaultH0Mask_c         ((1 << gGenFskDefaultH0FieldSize_c) - 1)
 #define gGenFskDefaultH1Mask_c         ((1 << gGenFskDefaultH1FieldSize_c) - 1)
+#endif
 
 #define LEDCONTROL_DEVICE_ID_ZERO 0
 #define LEDCONTROL_DEVICE_ID_ONE 1
 #define LEDCONTROL_DEVICE_ID_TWO 2
 
+/*slaves the master keeps per device state for; the UART digits reach ids 0-2,
+  the records of the gAppUseHostFrames_d build every id*/
+#define LEDCONTROL_MAX_SLAVES gAppJoinMaxSlaves_c
+
+/*ids the master probes whether or not a slave joined for them, those of the UART
+  digits that pinned slaves (LEDCONTROL_DEVICE_ID) use*/
+#define LEDCONTROL_PINNED_SLAVES 3
+
 /*Master/Slave select*/
 #define LEDCONTROL_MASTER
 
-/*Device ID*/
-#ifndef LEDCONTROL_MASTER
-#define LEDCONTROL_DEVICE_ID LEDCONTROL_DEVICE_ID_ZERO
-#endif
+/*Device ID: define LEDCONTROL_DEVICE_ID to pin a slave to a fixed id, otherwise it
+  joins and gets one from the master at run time, so one slave image fits all*/
+
+/*Relay: in the gAppUseRelay_d build define LEDCONTROL_RELAY on a slave so it also
+  forwards frames for slaves out of range of the master*/
 
 #ifdef LEDCONTROL_MASTER
 #define LEDCONTROL_CONNECTIONCHECK_TIMEOUT_MILLISECONDS 2000 // number of milliseconds without reply before slave is considered disconnected
@@ -152,7 +178,7 @@ static GENFSK_packet_config_t pktConfig =
     .lengthBitOrder = gGenfskLengthBitLsbFirst,
     /*sync address bytes = size + 1*/
     .syncAddrSizeBytes = gGenFskDefaultSyncAddrSize_c,
-    .lengthAdjBytes = 3, /*length field not including CRC so adjust by crc len*/
+    .lengthAdjBytes = gGenFskDefaultCrcSize_c, /*length field not including CRC so adjust by crc len*/
     .h0SizeBits = gGenFskDefaultH0FieldSize_c,
     .h1SizeBits = gGenFskDefaultH1FieldSize_c,
     .h0Match = gGenFskDefaultH0Value_c, /*match field containing zeros*/
@@ -165,13 +191,18 @@ static GENFSK_packet_config_t pktConfig =
 static GENFSK_crc_config_t crcConfig =
 {
     .crcEnable = gGenfskCrcEnable,
-    .crcSize = 3,
+    .crcSize = gGenFskDefaultCrcSize_c,
     .crcStartByte = 4,
     .crcRefIn = gGenfskCrcInputNoRef,
     .crcRefOut = gGenfskCrcOutputNoRef,
     .crcByteOrder = gGenfskCrcLSByteFirst,
+#if (gGenFskDefaultCrcSize_c == 2)
+    .crcSeed = 0x0000FFFF, /*CRC-16/CCITT*/
+    .crcPoly = 0x00001021,
+#else
     .crcSeed = 0x00555555,
     .crcPoly = 0x0000065B,
+#endif
     .crcXorOut = 0
 };
 
@@ -194,6 +225,13 @@ static GENFSK_whitener_config_t whitenConfig =
     .manchesterInv = gGenfskManchesterNoInv,
 };
 
+/*bit processing configuration, handed to GENFSK_AllocInstance*/
+static GENFSK_bitproc_t bitProcConfig =
+{
+    .crcConfig = &crcConfig,
+    .whitenerConfig = &whitenConfig
+};
+
 /*radio configuration*/
 static GENFSK_radio_config_t radioConfig =
 {
@@ -218,8 +256,4 @@ uint8_t mAppSerId;
 /* Timer instance ID */
 uint8_t mAppTmrId;
 
-bool slave1connected = false;
-bool slave2connected = false;
-bool slave3connected = false;
-
 #endif /* _APPL_MAIN_H_ */
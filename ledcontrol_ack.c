@@ -0,0 +1,136 @@
+#include "ledcontrol_ack.h"
+
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Records a sequence number received from the peer and marks an ack as
+*         pending. Numbers more than gAppAckWindowBits_c behind the window, as
+*         sent by a peer that restarted, open a new window.
+*
+* \param[in,out] pRx  receive state of the peer
+* \param[in]     seq  received sequence number
+*
+* \return  TRUE if seq was not received before and the frame must be processed
+*
+********************************************************************************** */
+bool_t AppAck_Receive(app_ack_rx_t* pRx, uint8_t seq)
+{
+    uint8_t ahead = (uint8_t)(seq - pRx->lastSeq);
+    uint8_t behind = (uint8_t)(pRx->lastSeq - seq);
+    bool_t isNew = TRUE;
+
+    /*duplicates are acked again, the peer evidently missed the first ack*/
+    pRx->pending = TRUE;
+
+    if(!pRx->valid || ((ahead >= 0x80U) && (behind > gAppAckWindowBits_c)))
+    {
+        pRx->valid = TRUE;
+        pRx->lastSeq = seq;
+        pRx->bitmap = 0;
+    }
+    else if(ahead == 0)
+    {
+        isNew = FALSE;
+    }
+    else if(ahead < 0x80U)
+    {
+        /*the old lastSeq moves into the bitmap at position ahead - 1*/
+        if(ahead > gAppAckWindowBits_c)
+        {
+            pRx->bitmap = 0;
+        }
+        else
+        {
+            pRx->bitmap = (uint8_t)(((uint32_t)pRx->bitmap << ahead) | (1U << (ahead - 1U)));
+        }
+        pRx->lastSeq = seq;
+    }
+    else
+    {
+        uint8_t bit = (uint8_t)(1U << (behind - 1U));
+
+        isNew = (pRx->bitmap & bit) ? FALSE : TRUE;
+        pRx->bitmap |= bit;
+    }
+    return isNew;
+}
+
+/*! *********************************************************************************
+* \brief  Piggybacks the pending ack on a frame. The window is kept, so the next
+*         ack repeats it in case this frame is lost.
+*
+* \param[in,out] pRx     receive state of the destination peer
+* \param[in,out] pFrame  outgoing frame
+*
+********************************************************************************** */
+void AppAck_Attach(app_ack_rx_t* pRx, app_frame_t* pFrame)
+{
+    if(pRx->pending)
+    {
+        pFrame->flags |= gAppFrameFlagAck_c;
+        pFrame->ackSeq = pRx->lastSeq;
+        pFrame->ackBitmap = pRx->bitmap;
+        pRx->pending = FALSE;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Allocates a sequence number. When more than gAppAckTxDepth_c frames are
+*         unconfirmed the oldest one is forgotten.
+*
+* \param[in,out] pTx  send state of the destination peer
+* \param[in]     tag  value AppAck_Confirm returns for this frame
+*
+* \return  sequence number to send with gAppFrameFlagSeq_c
+*
+********************************************************************************** */
+uint8_t AppAck_Track(app_ack_tx_t* pTx, uint8_t tag)
+{
+    uint8_t seq = pTx->nextSeq++;
+    uint8_t slot = seq & (gAppAckTxDepth_c - 1U);
+
+    pTx->seq[slot] = seq;
+    pTx->tag[slot] = tag;
+    pTx->outstanding |= (uint16_t)(1U << slot);
+    return seq;
+}
+
+/*! *********************************************************************************
+* \brief  Releases every outstanding frame covered by a received ack. Frames
+*         confirmed by an earlier ack are not reported again.
+*
+* \param[in,out] pTx        send state of the peer that sent the ack
+* \param[in]     ackSeq     latest sequence number received by the peer
+* \param[in]     ackBitmap  bit n set: ackSeq - 1 - n was received
+* \param[out]    pTags      tags of the newly confirmed frames, oldest first
+*
+* \return  number of tags written
+*
+********************************************************************************** */
+uint8_t AppAck_Confirm(app_ack_tx_t* pTx, uint8_t ackSeq, uint8_t ackBitmap, uint8_t* pTags)
+{
+    uint8_t count = 0;
+    uint8_t back = gAppAckWindowBits_c + 1U;
+
+    while(back--)
+    {
+        uint8_t seq = (uint8_t)(ackSeq - back);
+        uint8_t slot = seq & (gAppAckTxDepth_c - 1U);
+
+        if(back && !(ackBitmap & (1U << (back - 1U))))
+        {
+            continue;
+        }
+        if((pTx->outstanding & (1U << slot)) && (pTx->seq[slot] == seq))
+        {
+            pTx->outstanding &= (uint16_t)~(1U << slot);
+            pTags[count++] = pTx->tag[slot];
+        }
+    }
+    return count;
+}
@@ -0,0 +1,86 @@
+#ifndef _LEDCONTROL_ACK_H_
+#define _LEDCONTROL_ACK_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "ledcontrol_frame.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Acknowledgements are not sent as a reply to each frame. A receiver records
+ * the sequence numbers it got in an app_ack_rx_t and the resulting ack rides
+ * on the next frame it sends to that peer (gAppFrameFlagAck_c). One ack
+ * covers ackSeq and, through ackBitmap, the gAppAckWindowBits_c numbers
+ * before it, so several commands are confirmed by a single frame and an ack
+ * lost on air is repeated by the next one.
+ */
+
+/*sequence numbers covered by ackBitmap, in addition to ackSeq*/
+#define gAppAckWindowBits_c          (8)
+
+/*frames a sender keeps waiting for their ack, power of two*/
+#define gAppAckTxDepth_c             (16)
+
+/*milliseconds a slave holds an ack hoping to aggregate it or piggyback it on
+  a reply, 0 sends a standalone ack for every command*/
+#ifndef gAppAckDelayMs_c
+#define gAppAckDelayMs_c             (5)
+#endif
+
+/*command of the standalone frame used when nothing else carries a pending ack*/
+#define gAppAckCmd_c                 'a'
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*receive side, one per peer*/
+typedef struct app_ack_rx_tag
+{
+    uint8_t lastSeq;        /*highest sequence number received*/
+    uint8_t bitmap;         /*bit n set: lastSeq - 1 - n was received*/
+    bool_t  valid;          /*lastSeq holds a received number*/
+    bool_t  pending;        /*the peer has not been sent the current window*/
+}app_ack_rx_t;
+
+/*send side, one per peer*/
+typedef struct app_ack_tx_tag
+{
+    uint8_t  nextSeq;
+    uint16_t outstanding;               /*bit n set: slot n waits for its ack*/
+    uint8_t  seq[gAppAckTxDepth_c];
+    uint8_t  tag[gAppAckTxDepth_c];     /*caller data returned on confirmation*/
+}app_ack_tx_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*records a received sequence number, FALSE if it is a duplicate*/
+bool_t AppAck_Receive(app_ack_rx_t* pRx, uint8_t seq);
+
+/*adds the pending ack, if any, to a frame about to be sent to the peer*/
+void AppAck_Attach(app_ack_rx_t* pRx, app_frame_t* pFrame);
+
+/*allocates the sequence number of an outgoing frame and remembers its tag*/
+uint8_t AppAck_Track(app_ack_tx_t* pTx, uint8_t tag);
+
+/*releases the frames confirmed by an ack, oldest first; pTags must hold
+  gAppAckWindowBits_c + 1 entries, returns how many were written*/
+uint8_t AppAck_Confirm(app_ack_tx_t* pTx, uint8_t ackSeq, uint8_t ackBitmap, uint8_t* pTags);
+
+#endif /* _LEDCONTROL_ACK_H_ */
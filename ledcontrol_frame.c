@@ -0,0 +1,147 @@
+#include "ledcontrol_frame.h"
+#include "ledcontrol_static.h"
+
+#include "FunctionLib.h"
+
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Builds a frame in the given packet according to gAppFrameProfile_c. The
+*         packet payload buffer must hold gGenFskMaxPayloadLen_c bytes.
+*
+* \param[out] pPacket  packet to fill, addr is left untouched; the relay header,
+*                      if any, is left for AppRelay_Stamp
+* \param[in]  pFrame   frame fields; seq and ackSeq/ackBitmap are only written
+*                      when the matching flag is set, only the two low flag bits
+*                      exist in the compact profile. A gAppFrameFlagRaw_c frame
+*                      is copied as is
+*
+********************************************************************************** */
+APP_RAMFUNC void AppFrame_Encode(GENFSK_packet_t* pPacket, const app_frame_t* pFrame)
+{
+    uint8_t* pPayload = &pPacket->payload[gAppFrameRelayLen_c];
+    uint8_t length = gAppFramePayloadOverhead_c;
+
+    if(pFrame->flags & gAppFrameFlagRaw_c)
+    {
+        pPacket->header.h0Field = pFrame->devId;
+        pPacket->header.h1Field = pFrame->flags & 0x03U;
+        FLib_MemCpy(pPacket->payload, pFrame->pData, pFrame->dataLen);
+        pPacket->header.lengthField = pFrame->dataLen;
+        return;
+    }
+
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+    pPacket->header.h0Field = pFrame->devId;
+    pPacket->header.h1Field = pFrame->flags & 0x03U;
+    pPayload[0] = pFrame->command;
+#else
+    pPacket->header.h0Field = 0;
+    pPacket->header.h1Field = 0;
+    pPayload[0] = pFrame->devId;
+    pPayload[1] = pFrame->command;
+    pPayload[2] = pFrame->flags;
+#endif
+
+    if(pFrame->flags & gAppFrameFlagSeq_c)
+    {
+        pPayload[length++] = pFrame->seq;
+    }
+    if(pFrame->flags & gAppFrameFlagAck_c)
+    {
+        pPayload[length++] = pFrame->ackSeq;
+        pPayload[length++] = pFrame->ackBitmap;
+    }
+    if(pFrame->dataLen)
+    {
+        FLib_MemCpy(&pPayload[length], pFrame->pData, pFrame->dataLen);
+        length += pFrame->dataLen;
+    }
+    if(length < gAppFrameMinPayloadLen_c)
+    {
+        FLib_MemSet(&pPayload[length], 0, gAppFrameMinPayloadLen_c - length);
+        length = gAppFrameMinPayloadLen_c;
+    }
+    pPacket->header.lengthField = gAppFrameRelayLen_c + length;
+}
+
+/*! *********************************************************************************
+* \brief  Splits a received packet into its frame fields. No data is copied.
+*
+* \param[in]  pPacket  packet filled by GENFSK_ByteArrayToPacket
+* \param[out] pFrame   decoded fields
+*
+* \return  FALSE if the payload is shorter than the profile overhead plus the
+*          optional fields announced by the flags
+*
+********************************************************************************** */
+APP_RAMFUNC bool_t AppFrame_Decode(GENFSK_packet_t* pPacket, app_frame_t* pFrame)
+{
+    uint8_t* pPayload = &pPacket->payload[gAppFrameRelayLen_c];
+    uint8_t offset = gAppFramePayloadOverhead_c;
+    uint8_t length = (uint8_t)pPacket->header.lengthField;
+
+    if(length < (gAppFrameRelayLen_c + gAppFramePayloadOverhead_c))
+    {
+        return FALSE;
+    }
+    length -= gAppFrameRelayLen_c;
+
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+    pFrame->devId = (uint8_t)pPacket->header.h0Field;
+    pFrame->flags = (uint8_t)pPacket->header.h1Field;
+    pFrame->command = pPayload[0];
+#else
+    pFrame->devId = pPayload[0];
+    pFrame->command = pPayload[1];
+    pFrame->flags = pPayload[2];
+#endif
+
+    if(pFrame->flags & gAppFrameFlagSeq_c)
+    {
+        if(length < offset + gAppFrameSeqLen_c)
+        {
+            return FALSE;
+        }
+        pFrame->seq = pPayload[offset];
+        offset += gAppFrameSeqLen_c;
+    }
+    if(pFrame->flags & gAppFrameFlagAck_c)
+    {
+        if(length < offset + gAppFrameAckLen_c)
+        {
+            return FALSE;
+        }
+        pFrame->ackSeq = pPayload[offset];
+        pFrame->ackBitmap = pPayload[offset + 1];
+        offset += gAppFrameAckLen_c;
+    }
+    pFrame->dataLen = (uint8_t)(length - offset);
+    pFrame->pData = &pPayload[offset];
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Reads the device id of an encoded frame without decoding it. Only the
+*         H0 field or the first payload byte after the relay header is used, so
+*         this also works on protected frames.
+*
+* \param[in] pPacket  received or encoded packet
+*
+* \return  device id, gAppFrameInvalidId_c if the packet is too short
+*
+********************************************************************************** */
+uint8_t AppFrame_DevId(const GENFSK_packet_t* pPacket)
+{
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+    return (uint8_t)pPacket->header.h0Field;
+#else
+    return (pPacket->header.lengthField > gAppFrameRelayLen_c) ?
+           pPacket->payload[gAppFrameRelayLen_c] : gAppFrameInvalidId_c;
+#endif
+}
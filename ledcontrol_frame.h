@@ -0,0 +1,147 @@
+#ifndef _LEDCONTROL_FRAME_H_
+#define _LEDCONTROL_FRAME_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "genfsk_interface.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Frame profiles, selected at compile time and identical on every node.
+ *
+ * Legacy:  payload = device id, command, flags, command data, padded up to
+ *          6 bytes, 24-bit CRC. H0/H1 are zero.
+ * Compact: H0 = device id, H1 = frame flags (2 bits), payload = command
+ *          followed by the command data only, 16-bit CRC by default.
+ *
+ * In both profiles the flags announce optional fields in front of the
+ * command data: the sender's sequence number, then an acknowledgement made
+ * of the latest sequence number received from the peer and a bitmap of the
+ * gAppAckWindowBits_c numbers before it (ledcontrol_ack.h).
+ *
+ * The gAppUseRelay_d build puts the relay header (ledcontrol_relay.h) in
+ * front of the payload of both profiles.
+ */
+#define gAppFrameProfileLegacy_c     (0)
+#define gAppFrameProfileCompact_c    (1)
+
+#ifndef gAppFrameProfile_c
+#define gAppFrameProfile_c           gAppFrameProfileCompact_c
+#endif
+
+/*crc size in bytes, 2 or 3 for the compact profile*/
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+#ifndef gAppFrameCrcSize_c
+#define gAppFrameCrcSize_c           (2)
+#endif
+#else
+#undef gAppFrameCrcSize_c
+#define gAppFrameCrcSize_c           (3)
+#endif
+
+/*payload bytes in front of the command data*/
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+#define gAppFramePayloadOverhead_c   (1)
+#else
+#define gAppFramePayloadOverhead_c   (3)
+#endif
+
+/*smallest payload the profile puts on air*/
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+#define gAppFrameMinPayloadLen_c     (gAppFramePayloadOverhead_c)
+#else
+#define gAppFrameMinPayloadLen_c     (6)
+#endif
+
+/*frame flags*/
+#define gAppFrameFlagSeq_c           (0x01U) /*seq field present, the peer owes an ack*/
+#define gAppFrameFlagAck_c           (0x02U) /*ackSeq/ackBitmap fields present*/
+
+/*never on air: pData is a complete payload to send as is, devId and the low
+  flag bits are the H0/H1 values; used to forward received frames*/
+#define gAppFrameFlagRaw_c           (0x80U)
+
+/*relay header in front of the payload*/
+#if gAppUseRelay_d
+#define gAppFrameRelayLen_c          (2)
+#else
+#define gAppFrameRelayLen_c          (0)
+#endif
+
+/*bytes the optional fields take in front of the command data*/
+#define gAppFrameSeqLen_c            (1)
+#define gAppFrameAckLen_c            (2)
+
+/*frame counter and MIC ledcontrol_sec.c adds to every frame*/
+#if gAppUseSecLib_d
+#define gAppFrameSecOverhead_c       (8)
+#else
+#define gAppFrameSecOverhead_c       (0)
+#endif
+
+/*device id never assigned to a node, used for frames that failed to decode*/
+#define gAppFrameInvalidId_c         (0xFE)
+
+/*device id of a slave that has not joined yet (ledcontrol_join.h)*/
+#define gAppFrameUnassignedId_c      (0xFD)
+
+/*device id of frames every slave takes, OTA broadcasts (ledcontrol_ota.h)*/
+#define gAppFrameBroadcastId_c       (0xFF)
+
+/*bytes on air for a frame carrying dataLen bytes of command data:
+  preamble + sync address + H0/length/H1 + relay header + payload + protection + crc*/
+#define gAppFrameAirBytes_c(dataLen) (1U + 4U + 2U + gAppFrameCrcSize_c + \
+    gAppFrameRelayLen_c + gAppFrameSecOverhead_c + \
+    (((gAppFramePayloadOverhead_c + (dataLen)) > gAppFrameMinPayloadLen_c) ? \
+      (gAppFramePayloadOverhead_c + (dataLen)) : gAppFrameMinPayloadLen_c))
+
+/*air time in microseconds at 1Mbps*/
+#define gAppFrameAirTimeUs_c(dataLen) (8U * gAppFrameAirBytes_c(dataLen))
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*decoded view of a frame, pData points into the packet payload. seq is only
+  valid with gAppFrameFlagSeq_c, ackSeq/ackBitmap with gAppFrameFlagAck_c*/
+typedef struct app_frame_tag
+{
+    uint8_t devId;
+    uint8_t command;
+    uint8_t flags;
+    uint8_t seq;
+    uint8_t ackSeq;
+    uint8_t ackBitmap;
+    uint8_t dataLen;
+    uint8_t* pData;
+}app_frame_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*fills the packet header and payload for a frame, pData may be NULL if dataLen is 0*/
+void AppFrame_Encode(GENFSK_packet_t* pPacket, const app_frame_t* pFrame);
+
+/*parses a received packet, FALSE if it is too short to be a frame*/
+bool_t AppFrame_Decode(GENFSK_packet_t* pPacket, app_frame_t* pFrame);
+
+/*device id of an encoded frame, readable while the rest is still protected;
+  gAppFrameInvalidId_c if the packet is too short*/
+uint8_t AppFrame_DevId(const GENFSK_packet_t* pPacket);
+
+#endif /* _LEDCONTROL_FRAME_H_ */
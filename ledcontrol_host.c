@@ -0,0 +1,210 @@
+#include "ledcontrol_host.h"
+
+#if gAppUseHostFrames_d
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#define mAppHostDelimiter_c          (0x00U)
+#define mAppHostHeaderLen_c          (2)
+#define mAppHostCrcLen_c             (2)
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static uint8_t AppHost_Unstuff(uint8_t* pBuf, uint8_t len);
+static uint16_t AppHost_Crc16(const uint8_t* pData, uint8_t len);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*sequence number of the next record sent*/
+static uint8_t mAppHostTxSeq;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Collects the bytes of a record up to its delimiter, then decodes and
+*         checks it. Anything between two delimiters that is not a valid record,
+*         such as a partial one from before a reset, is dropped.
+*
+* \param[in,out] pRx      receive state
+* \param[in]     byte     byte from the UART
+* \param[out]    pRecord  the record, valid when TRUE is returned
+*
+* \return  TRUE if the byte completed a valid record
+*
+********************************************************************************** */
+bool_t AppHost_Receive(app_host_rx_t* pRx, uint8_t byte, app_host_record_t* pRecord)
+{
+    uint8_t len;
+    uint8_t i;
+
+    if(byte != mAppHostDelimiter_c)
+    {
+        if(pRx->len < sizeof(pRx->buf))
+        {
+            pRx->buf[pRx->len++] = byte;
+        }
+        else
+        {
+            pRx->overflow = TRUE;
+        }
+        return FALSE;
+    }
+
+    len = pRx->len;
+    pRx->len = 0;
+    if(!len)
+    {
+        //the leading delimiter of a record, or two in a row
+        return FALSE;
+    }
+    if(pRx->overflow)
+    {
+        pRx->overflow = FALSE;
+        return FALSE;
+    }
+    len = AppHost_Unstuff(pRx->buf, len);
+    if((len < mAppHostHeaderLen_c + mAppHostCrcLen_c) || (len > gAppHostBodyMax_c) ||
+       (AppHost_Crc16(pRx->buf, (uint8_t)(len - mAppHostCrcLen_c)) !=
+        (uint16_t)(pRx->buf[len - 2] | ((uint16_t)pRx->buf[len - 1] << 8))))
+    {
+        return FALSE;
+    }
+
+    pRecord->type = pRx->buf[0];
+    pRecord->seq = pRx->buf[1];
+    pRecord->len = (uint8_t)(len - mAppHostHeaderLen_c - mAppHostCrcLen_c);
+    for(i = 0; i < pRecord->len; i++)
+    {
+        pRecord->payload[i] = pRx->buf[mAppHostHeaderLen_c + i];
+    }
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Builds type, seq, payload and CRC and stuffs them between two
+*         delimiters. The leading one ends whatever was printed before.
+*
+* \param[in]  type      app_host_rec_t
+* \param[in]  pPayload  payload bytes
+* \param[in]  len       at most gAppHostPayloadMax_c, longer payloads are cut
+* \param[out] pOut      gAppHostEncodedMax_c bytes
+*
+* \return  bytes written to pOut
+*
+********************************************************************************** */
+uint8_t AppHost_Encode(uint8_t type, const uint8_t* pPayload, uint8_t len, uint8_t* pOut)
+{
+    uint8_t body[gAppHostBodyMax_c];
+    uint8_t bodyLen = 0;
+    uint8_t outLen = 0;
+    uint8_t code = 0;
+    uint16_t crc;
+    uint8_t i;
+
+    if(len > gAppHostPayloadMax_c)
+    {
+        len = gAppHostPayloadMax_c;
+    }
+    body[bodyLen++] = type;
+    body[bodyLen++] = mAppHostTxSeq++;
+    for(i = 0; i < len; i++)
+    {
+        body[bodyLen++] = pPayload[i];
+    }
+    crc = AppHost_Crc16(body, bodyLen);
+    body[bodyLen++] = (uint8_t)crc;
+    body[bodyLen++] = (uint8_t)(crc >> 8);
+
+    //each run of non zero bytes is prefixed with its length + 1; a body never
+    //reaches the 254 byte runs that need an extra code
+    pOut[outLen++] = mAppHostDelimiter_c;
+    code = outLen++;
+    pOut[code] = 1;
+    for(i = 0; i < bodyLen; i++)
+    {
+        if(body[i] == mAppHostDelimiter_c)
+        {
+            code = outLen++;
+            pOut[code] = 1;
+        }
+        else
+        {
+            pOut[outLen++] = body[i];
+            pOut[code]++;
+        }
+    }
+    pOut[outLen++] = mAppHostDelimiter_c;
+    return outLen;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Reverses COBS in place.
+*
+* \return  length of the decoded body, 0 if the encoding is broken
+*
+********************************************************************************** */
+static uint8_t AppHost_Unstuff(uint8_t* pBuf, uint8_t len)
+{
+    uint8_t in = 0;
+    uint8_t out = 0;
+
+    while(in < len)
+    {
+        uint8_t code = pBuf[in++];
+        uint8_t i;
+
+        if(!code || (in + code - 1U > len))
+        {
+            return 0;
+        }
+        for(i = 1; i < code; i++)
+        {
+            pBuf[out++] = pBuf[in++];
+        }
+        if((code < 0xFFU) && (in < len))
+        {
+            pBuf[out++] = mAppHostDelimiter_c;
+        }
+    }
+    return out;
+}
+
+/*CRC-16/CCITT-FALSE, bitwise like the NVM records, a record is a few bytes*/
+static uint16_t AppHost_Crc16(const uint8_t* pData, uint8_t len)
+{
+    uint16_t crc = 0xFFFFU;
+    uint8_t i;
+    uint8_t bit;
+
+    for(i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)pData[i] << 8;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef _LEDCONTROL_HOST_H_
+#define _LEDCONTROL_HOST_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Framed UART link between the master and its host, the gAppUseHostFrames_d
+ * build. Instead of one ASCII digit per LED command and free-form text back,
+ * both directions carry records:
+ *
+ *   0x00 | COBS(type, seq, payload, crc low, crc high) | 0x00
+ *
+ * COBS leaves 0x00 only as the delimiter, so a receiver is in step again at
+ * the next one after a lost byte or text printed between records; the
+ * CRC-16/CCITT-FALSE over type, seq and payload drops a garbled record. Each
+ * direction numbers its records; the host counts the gaps of both, its own
+ * through the seqs the master echoes.
+ *
+ *   host to master
+ *     gAppHostRecLeds_c      up to gAppHostLedPairsMax_c pairs of slave id and
+ *                            LED mask, bit 0 red, 1 green, 2 blue: toggles,
+ *                            lowest LED first
+ *     gAppHostRecConsole_c   bytes for the UART commands of the ASCII build
+ *   master to host
+ *     gAppHostRecAccepted_c  seq of a gAppHostRecLeds_c record, then the pairs
+ *                            the TX queue had no room for
+ *     gAppHostRecAcks_c      slave id, then the LEDs, 0-2, whose toggles an ack
+ *                            confirmed, in the order they were sent
+ *     gAppHostRecPresence_c  slave id, 1 connected or 0 disconnected
+ *
+ * server/web_frame.h mirrors these values for the web bridge.
+ */
+
+/*payload bytes of one record*/
+#define gAppHostPayloadMax_c         (32)
+
+/*type, seq, payload and CRC*/
+#define gAppHostBodyMax_c            (gAppHostPayloadMax_c + 4)
+
+/*pairs of a gAppHostRecLeds_c record, so the refused ones fit the answer*/
+#define gAppHostLedPairsMax_c        ((gAppHostPayloadMax_c - 1) / 2)
+
+/*encoded record with both delimiters, COBS adds one byte per 254*/
+#define gAppHostEncodedMax_c         (gAppHostBodyMax_c + 1 + 2)
+
+/*line rate of the framed build, APP_SERIAL_INTERFACE_SPEED stays with the
+  ASCII one*/
+#ifndef gAppHostBaudRate_c
+#define gAppHostBaudRate_c           (1000000U)
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef enum
+{
+    gAppHostRecLeds_c     = 0x01,
+    gAppHostRecConsole_c  = 0x02,
+    gAppHostRecAccepted_c = 0x81,
+    gAppHostRecAcks_c     = 0x82,
+    gAppHostRecPresence_c = 0x83
+}app_host_rec_t;
+
+/*a decoded record*/
+typedef struct app_host_record_tag
+{
+    uint8_t type;
+    uint8_t seq;
+    uint8_t len;
+    uint8_t payload[gAppHostPayloadMax_c];
+}app_host_record_t;
+
+/*receive state: the encoded bytes since the last delimiter*/
+typedef struct app_host_rx_tag
+{
+    uint8_t buf[gAppHostEncodedMax_c];
+    uint8_t len;
+    bool_t  overflow;      /*longer than any record, dropped at the delimiter*/
+}app_host_rx_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*takes one received byte, TRUE once it completed a valid record*/
+bool_t AppHost_Receive(app_host_rx_t* pRx, uint8_t byte, app_host_record_t* pRecord);
+
+/*encodes a record with the next sequence number, pOut must hold
+  gAppHostEncodedMax_c bytes; returns the number written*/
+uint8_t AppHost_Encode(uint8_t type, const uint8_t* pPayload, uint8_t len, uint8_t* pOut);
+
+#endif /* _LEDCONTROL_HOST_H_ */
@@ -0,0 +1,257 @@
+#include "ledcontrol_join.h"
+#include "ledcontrol_frame.h"
+#include "ledcontrol_nv.h"
+
+#include "FunctionLib.h"
+#include "fsl_device_registers.h"
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+/*slave table entries held by each of its NVM records*/
+#define mAppJoinTableChunk_c         (gAppNvMaxRecordLen_c / gAppJoinUidLen_c)
+
+#if (gAppJoinMaxSlaves_c > (mAppJoinTableChunk_c * gAppNvSlaveTableRecords_c))
+#error "gAppJoinMaxSlaves_c exceeds the slave table NVM records"
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/*slave identity record*/
+typedef struct app_join_identity_tag
+{
+    uint8_t uid[gAppJoinUidLen_c];
+    uint8_t devId;
+}app_join_identity_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static uint32_t AppJoin_Random(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*backoff state, slave only*/
+static uint32_t mAppJoinRandom;
+static uint32_t mAppJoinWindow = gAppJoinMinWindow_c;
+
+/*RAM copy of the identity record, slave only*/
+static app_join_identity_t mAppJoinIdentity;
+
+/*slave table entry of an id not allocated, erased flash*/
+static const uint8_t mAppJoinFreeUid[gAppJoinUidLen_c] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Reads the low 64 bits of the chip unique identification register.
+*
+* \param[out] pUid  gAppJoinUidLen_c bytes, least significant first
+*
+********************************************************************************** */
+void AppJoin_GetUid(uint8_t* pUid)
+{
+    uint32_t low = SIM->UIDL;
+    uint32_t mid = SIM->UIDML;
+    uint8_t i;
+
+    for(i = 0; i < 4; i++)
+    {
+        pUid[i] = (uint8_t)(low >> (8 * i));
+        pUid[i + 4] = (uint8_t)(mid >> (8 * i));
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Returns the device id previously assigned to this chip. The UID is
+*         stored with it so an NVM image copied from another board is ignored.
+*         The backoff generator is seeded from the UID, so slaves powering up
+*         together pick different slots.
+*
+* \return  stored id, gAppFrameUnassignedId_c if the slave has to join
+*
+********************************************************************************** */
+uint8_t AppJoin_LoadIdentity(void)
+{
+    uint8_t uid[gAppJoinUidLen_c];
+    uint8_t i;
+
+    AppJoin_GetUid(uid);
+    mAppJoinRandom = 0x9E3779B9U;
+    for(i = 0; i < gAppJoinUidLen_c; i++)
+    {
+        mAppJoinRandom = (mAppJoinRandom ^ uid[i]) * 0x01000193U;
+    }
+    if(!mAppJoinRandom)
+    {
+        mAppJoinRandom = 1;
+    }
+    mAppJoinWindow = gAppJoinMinWindow_c;
+
+    AppNv_Register(gAppNvIdentity_c, &mAppJoinIdentity, sizeof(mAppJoinIdentity));
+    if(AppNv_Restore(gAppNvIdentity_c) &&
+       FLib_MemCmp(mAppJoinIdentity.uid, uid, gAppJoinUidLen_c) &&
+       (mAppJoinIdentity.devId < gAppJoinMaxSlaves_c))
+    {
+        return mAppJoinIdentity.devId;
+    }
+    return gAppFrameUnassignedId_c;
+}
+
+/*! *********************************************************************************
+* \brief  Picks a random slot in the current contention window, then doubles the
+*         window up to gAppJoinMaxWindow_c. The first call only draws the slot of
+*         the first request.
+*
+* \return  delay in milliseconds
+*
+********************************************************************************** */
+uint32_t AppJoin_NextAttemptMs(void)
+{
+    uint32_t slot = AppJoin_Random() % mAppJoinWindow;
+
+    if(mAppJoinWindow < gAppJoinMaxWindow_c)
+    {
+        mAppJoinWindow <<= 1;
+    }
+    return gAppJoinReplyTimeoutMs_c + (slot * gAppJoinSlotMs_c);
+}
+
+/*! *********************************************************************************
+* \brief  Persists the id the master assigned to this chip, on the next
+*         AppNv_Idle.
+*
+* \param[in] devId  assigned device id
+*
+********************************************************************************** */
+void AppJoin_SaveIdentity(uint8_t devId)
+{
+    AppJoin_GetUid(mAppJoinIdentity.uid);
+    mAppJoinIdentity.devId = devId;
+    AppNv_SaveOnIdle(gAppNvIdentity_c);
+    mAppJoinWindow = gAppJoinMinWindow_c;
+}
+
+/*! *********************************************************************************
+* \brief  Registers the slave table with NVM and loads it. The table is split over
+*         gAppNvSlaveTableRecords_c records, so a join rewrites one of them only;
+*         a part NVM holds none of starts empty.
+*
+* \param[out] pTable  master slave table, kept as the RAM copy of the records
+*
+********************************************************************************** */
+void AppJoin_LoadTable(app_join_table_t* pTable)
+{
+    uint8_t chunk;
+
+    for(chunk = 0; chunk < gAppNvSlaveTableRecords_c; chunk++)
+    {
+        uint32_t first = (uint32_t)chunk * mAppJoinTableChunk_c;
+        app_nv_record_t record = (app_nv_record_t)(gAppNvSlaveTable_c + chunk);
+        uint32_t count;
+
+        if(first >= gAppJoinMaxSlaves_c)
+        {
+            break;
+        }
+        count = gAppJoinMaxSlaves_c - first;
+        if(count > mAppJoinTableChunk_c)
+        {
+            count = mAppJoinTableChunk_c;
+        }
+        AppNv_Register(record, pTable->uid[first], (uint16_t)(count * gAppJoinUidLen_c));
+        if(!AppNv_Restore(record))
+        {
+            FLib_MemSet(pTable->uid[first], 0xFF, count * gAppJoinUidLen_c);
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Looks the UID up in the slave table and allocates the lowest free id if
+*         it is not there. A new entry is written on the next AppNv_Idle, so
+*         bursts of joins cost one flash write per table record.
+*
+* \param[in,out] pTable  master slave table
+* \param[in]     pUid    UID from the join request
+* \param[out]    pIsNew  TRUE if an entry was allocated
+*
+* \return  device id, gAppFrameInvalidId_c if the table is full
+*
+********************************************************************************** */
+uint8_t AppJoin_Allocate(app_join_table_t* pTable, const uint8_t* pUid, bool_t* pIsNew)
+{
+    uint8_t freeId = gAppFrameInvalidId_c;
+    uint8_t id;
+
+    *pIsNew = FALSE;
+    for(id = 0; id < gAppJoinMaxSlaves_c; id++)
+    {
+        if(FLib_MemCmp(pTable->uid[id], (void*)pUid, gAppJoinUidLen_c))
+        {
+            return id;
+        }
+        if((freeId == gAppFrameInvalidId_c) &&
+           FLib_MemCmp(pTable->uid[id], (void*)mAppJoinFreeUid, gAppJoinUidLen_c))
+        {
+            freeId = id;
+        }
+    }
+
+    if(freeId != gAppFrameInvalidId_c)
+    {
+        FLib_MemCpy(pTable->uid[freeId], (void*)pUid, gAppJoinUidLen_c);
+        AppNv_SaveOnIdle((app_nv_record_t)(gAppNvSlaveTable_c + (freeId / mAppJoinTableChunk_c)));
+        *pIsNew = TRUE;
+    }
+    return freeId;
+}
+
+/*! *********************************************************************************
+* \brief  Tells whether the slave table holds a UID for an id.
+*
+* \param[in] pTable  master slave table
+* \param[in] devId   slave id
+*
+* \return  TRUE if the id is assigned
+*
+********************************************************************************** */
+bool_t AppJoin_IsAssigned(const app_join_table_t* pTable, uint8_t devId)
+{
+    return (devId < gAppJoinMaxSlaves_c) &&
+           !FLib_MemCmp((void*)pTable->uid[devId], (void*)mAppJoinFreeUid, gAppJoinUidLen_c);
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*xorshift32, only spreads backoff slots*/
+static uint32_t AppJoin_Random(void)
+{
+    mAppJoinRandom ^= mAppJoinRandom << 13;
+    mAppJoinRandom ^= mAppJoinRandom >> 17;
+    mAppJoinRandom ^= mAppJoinRandom << 5;
+    return mAppJoinRandom;
+}
@@ -0,0 +1,123 @@
+#ifndef _LEDCONTROL_JOIN_H_
+#define _LEDCONTROL_JOIN_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Join handshake. A slave built without LEDCONTROL_DEVICE_ID has no id until
+ * the master assigns one:
+ *
+ *   slave  -> master  devId = gAppFrameUnassignedId_c, 'j', chip UID
+ *   master -> slave   devId = gAppFrameUnassignedId_c, 'J', chip UID, id
+ *
+ * The master gives a UID it already knows the same id again, so a slave that
+ * lost its identity gets it back. Requests from slaves powering up together
+ * are spread by a randomized binary exponential backoff over slots of
+ * gAppJoinSlotMs_c; the window doubles after every unanswered request.
+ * tools/ledsim.py join models the same policy for a whole fleet.
+ *
+ * In the gAppUseSecLib_d build the request also carries a random challenge,
+ * and the assignment echoes it along with the lowest frame counter the
+ * master accepts from the slave:
+ *
+ *   slave  -> master  'j', chip UID, challenge
+ *   master -> slave   'J', chip UID, id, challenge, counter floor
+ *
+ * The master resets its ack and replay state of a known UID only when the
+ * request's frame counter is above the last one it accepted from that id, so
+ * a recorded request changes nothing. A slave that lost its NVM restarts its
+ * counter below that: it is answered with a floor gAppSecRejoinSkip_c higher,
+ * raises its counter to it instead of taking the id and gets the id with its
+ * next request. A slave only takes an assignment echoing its last challenge,
+ * never a recorded one.
+ */
+
+#define gAppJoinCmdRequest_c         'j'
+#define gAppJoinCmdAssign_c          'J'
+
+/*bytes of the chip unique id carried by join frames*/
+#define gAppJoinUidLen_c             (8)
+
+#if gAppUseSecLib_d
+/*bytes of the challenge and of the counter floor, both big endian*/
+#define gAppJoinChallengeLen_c       (4)
+#define gAppJoinFloorLen_c           (4)
+#else
+#define gAppJoinChallengeLen_c       (0)
+#define gAppJoinFloorLen_c           (0)
+#endif
+
+/*join frame data lengths*/
+#define gAppJoinRequestLen_c         (gAppJoinUidLen_c + gAppJoinChallengeLen_c)
+#define gAppJoinAssignLen_c          (gAppJoinUidLen_c + 1 + gAppJoinChallengeLen_c + gAppJoinFloorLen_c)
+
+/*devices the master can assign ids to, ids are 0 .. gAppJoinMaxSlaves_c - 1*/
+#ifndef gAppJoinMaxSlaves_c
+#define gAppJoinMaxSlaves_c          (128)
+#endif
+
+/*backoff slot, longer than request + assignment air time and turnarounds*/
+#define gAppJoinSlotMs_c             (2)
+
+/*contention window in slots, first attempt and ceiling*/
+#define gAppJoinMinWindow_c          (16)
+#define gAppJoinMaxWindow_c          (1024)
+
+/*time a slave waits for the assignment before backing off again*/
+#define gAppJoinReplyTimeoutMs_c     (10)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*master side slave table, stored in NVM as is over the slave table records.
+  A free entry reads as erased flash (all 0xFF), which is never a valid chip UID*/
+typedef struct app_join_table_tag
+{
+    uint8_t uid[gAppJoinMaxSlaves_c][gAppJoinUidLen_c];
+}app_join_table_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*reads the chip unique id*/
+void AppJoin_GetUid(uint8_t* pUid);
+
+/*slave: device id stored in NVM for this chip, gAppFrameUnassignedId_c if none;
+  also seeds the backoff*/
+uint8_t AppJoin_LoadIdentity(void);
+
+/*slave: milliseconds until the next join request, widens the window each call*/
+uint32_t AppJoin_NextAttemptMs(void);
+
+/*slave: stores an assigned id in NVM on the next AppNv_Idle*/
+void AppJoin_SaveIdentity(uint8_t devId);
+
+/*master: registers the slave table with NVM and loads it, empty if none was stored*/
+void AppJoin_LoadTable(app_join_table_t* pTable);
+
+/*master: id for a UID, known or newly allocated; gAppFrameInvalidId_c when the
+  table is full. *pIsNew is set when the table changed, NVM is updated on idle*/
+uint8_t AppJoin_Allocate(app_join_table_t* pTable, const uint8_t* pUid, bool_t* pIsNew);
+
+/*master: TRUE if the table holds a UID for devId*/
+bool_t AppJoin_IsAssigned(const app_join_table_t* pTable, uint8_t devId);
+
+#endif /* _LEDCONTROL_JOIN_H_ */
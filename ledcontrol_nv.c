@@ -0,0 +1,625 @@
+#include "ledcontrol_nv.h"
+
+#ifdef LEDCONTROL_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define FLib_MemCpy(pDst, pSrc, cBytes)  memcpy((pDst), (pSrc), (cBytes))
+#define FLib_MemSet(pDst, val, cBytes)   memset((pDst), (val), (cBytes))
+#define FLib_MemCmp(pA, pB, cBytes)      (memcmp((pA), (pB), (cBytes)) == 0)
+#else
+#include "Flash_Adapter.h"
+#include "FunctionLib.h"
+#include "fsl_os_abstraction.h"
+#endif
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+#define mAppNvSectorMagic_c          (0x564E434CU) /*"LCNV"*/
+
+/*mAppNvIndex value of a record that was never stored*/
+#define mAppNvNone_c                 (0xFFFFU)
+
+/*record byte of unprogrammed space*/
+#define mAppNvErased_c               (0xFFU)
+
+#define mAppNvAlign(length)          (((uint32_t)(length) + 3U) & ~3U)
+#define mAppNvEntrySize(length)      ((uint32_t)sizeof(app_nv_entry_t) + mAppNvAlign(length))
+
+/*region offset of a sector*/
+#define mAppNvSectorOffset(sector)   ((uint32_t)(sector) * gAppNvSectorSize_c)
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/*programmed when a sector becomes the active one*/
+typedef struct app_nv_sector_tag
+{
+    uint32_t magic;
+    uint32_t seq;           /*activation order, the highest is the active sector*/
+    uint32_t magicInv;
+    uint32_t reserved;
+}app_nv_sector_t;
+
+/*programmed in front of every record copy, in the same flash write as the data*/
+typedef struct app_nv_entry_tag
+{
+    uint8_t  record;
+    uint8_t  reserved;
+    uint16_t length;
+    uint16_t crc;           /*over record, length and data*/
+    uint16_t crcInv;
+}app_nv_entry_t;
+
+/*RAM copy registered by the record owner*/
+typedef struct app_nv_binding_tag
+{
+    void* pData;
+    uint16_t length;
+}app_nv_binding_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static bool_t AppNv_BackendInit(void);
+static bool_t AppNv_FlashErase(uint8_t sector);
+static bool_t AppNv_FlashProgram(uint32_t offset, const void* pData, uint32_t length);
+static uint32_t AppNv_NowMs(void);
+
+static bool_t AppNv_Stored(uint8_t record);
+static bool_t AppNv_SectorValid(uint8_t sector);
+static uint32_t AppNv_ScanSector(uint8_t sector);
+static bool_t AppNv_ActivateSector(uint8_t sector, uint32_t seq);
+static bool_t AppNv_Reclaim(void);
+static bool_t AppNv_Append(uint8_t record, const void* pData, uint16_t length);
+static uint16_t AppNv_Crc16(uint8_t record, uint16_t length, const uint8_t* pData);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*first byte of the region, reads go straight through it*/
+static uint8_t* mAppNvBase;
+
+#ifdef LEDCONTROL_HOST
+static uint8_t mAppNvImage[gAppNvSectors_c * gAppNvSectorSize_c];
+static FILE* mAppNvFile;
+#endif
+
+static app_nv_binding_t mAppNvBindings[gAppNvRecordMax_c];
+
+/*region offset of the newest copy of each record*/
+static uint16_t mAppNvIndex[gAppNvRecordMax_c];
+
+/*sector records are appended to, its activation sequence and the next free offset*/
+static uint8_t  mAppNvActive;
+static uint32_t mAppNvSeq;
+static uint32_t mAppNvWriteOffset;
+
+/*records changed since the last write and the time of the first change*/
+static uint32_t mAppNvDirty;
+static uint32_t mAppNvDirtySince;
+
+/*copying live records out of the oldest sector, no further sector switch allowed*/
+static bool_t mAppNvReclaiming;
+
+/*entry assembled in RAM, flash cannot be read while it is programmed*/
+static uint32_t mAppNvEntryBuffer[(sizeof(app_nv_entry_t) + gAppNvMaxRecordLen_c) / sizeof(uint32_t)];
+
+#ifndef LEDCONTROL_HOST
+/*linker symbol, MKW41Z512xxx4_connectivity.ld*/
+extern uint32_t NV_STORAGE_END_ADDRESS[];
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Scans the log once, oldest sector first, so the index ends up pointing
+*         at the newest copy of each record. Formats an empty or foreign region and
+*         finishes a reclaim cut short by a reset.
+*
+********************************************************************************** */
+void AppNv_Init(void)
+{
+    bool_t found = FALSE;
+    uint8_t sector;
+    uint8_t i;
+
+    FLib_MemSet(mAppNvIndex, 0xFF, sizeof(mAppNvIndex));
+    mAppNvDirty = 0;
+    if(!AppNv_BackendInit())
+    {
+        return;
+    }
+
+    for(sector = 0; sector < gAppNvSectors_c; sector++)
+    {
+        const app_nv_sector_t* pHeader = (const app_nv_sector_t*)(mAppNvBase + mAppNvSectorOffset(sector));
+
+        if(AppNv_SectorValid(sector) && (!found || (pHeader->seq > mAppNvSeq)))
+        {
+            mAppNvActive = sector;
+            mAppNvSeq = pHeader->seq;
+            found = TRUE;
+        }
+    }
+    if(!found)
+    {
+        (void)AppNv_ActivateSector(0, 1);
+        return;
+    }
+
+    /*sectors are activated in turn, the one after the active one is the oldest*/
+    for(i = 1; i <= gAppNvSectors_c; i++)
+    {
+        sector = (uint8_t)((mAppNvActive + i) % gAppNvSectors_c);
+        if(AppNv_SectorValid(sector))
+        {
+            uint32_t end = AppNv_ScanSector(sector);
+
+            if(sector == mAppNvActive)
+            {
+                mAppNvWriteOffset = end;
+            }
+        }
+    }
+
+    /*the spare must be erased, unless a reset hit the last reclaim*/
+    (void)AppNv_Reclaim();
+}
+
+/*! *********************************************************************************
+* \brief  Binds a record id to its RAM copy.
+*
+* \param[in] record  record id
+* \param[in] pData   RAM copy, stays owned by the caller
+* \param[in] length  record length, up to gAppNvMaxRecordLen_c
+*
+********************************************************************************** */
+void AppNv_Register(app_nv_record_t record, void* pData, uint16_t length)
+{
+    if((record < gAppNvRecordMax_c) && (length <= gAppNvMaxRecordLen_c))
+    {
+        mAppNvBindings[record].pData = pData;
+        mAppNvBindings[record].length = length;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Copies the newest stored copy of a record into its RAM copy.
+*
+* \param[in] record  registered record id
+*
+* \return  FALSE if no copy of the registered length is stored
+*
+********************************************************************************** */
+bool_t AppNv_Restore(app_nv_record_t record)
+{
+    const app_nv_entry_t* pEntry;
+
+    if((record >= gAppNvRecordMax_c) || (mAppNvIndex[record] == mAppNvNone_c) ||
+       (mAppNvBindings[record].pData == NULL))
+    {
+        return FALSE;
+    }
+    pEntry = (const app_nv_entry_t*)(mAppNvBase + mAppNvIndex[record]);
+    if(pEntry->length != mAppNvBindings[record].length)
+    {
+        return FALSE;
+    }
+    FLib_MemCpy(mAppNvBindings[record].pData, (void*)(pEntry + 1), pEntry->length);
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Marks a record for the next AppNv_Idle write. The coalescing delay runs
+*         from the first change, so a record changing continuously is still written
+*         every gAppNvCoalesceMs_c.
+*
+* \param[in] record  registered record id
+*
+********************************************************************************** */
+void AppNv_SaveOnIdle(app_nv_record_t record)
+{
+    if(record >= gAppNvRecordMax_c)
+    {
+        return;
+    }
+    if(!mAppNvDirty)
+    {
+        mAppNvDirtySince = AppNv_NowMs();
+    }
+    mAppNvDirty |= (1UL << record);
+}
+
+/*! *********************************************************************************
+* \brief  Writes a record at once instead of on idle, unless its newest stored
+*         copy already holds the RAM copy.
+*
+* \param[in] record  registered record id
+*
+* \return  FALSE on a flash error
+*
+********************************************************************************** */
+bool_t AppNv_Flush(app_nv_record_t record)
+{
+    if((record >= gAppNvRecordMax_c) || (mAppNvBindings[record].pData == NULL))
+    {
+        return FALSE;
+    }
+    mAppNvDirty &= ~(1UL << record);
+    if(AppNv_Stored(record))
+    {
+        return TRUE;
+    }
+    return AppNv_Append(record, mAppNvBindings[record].pData, mAppNvBindings[record].length);
+}
+
+/*! *********************************************************************************
+* \brief  Time the application task may sleep before AppNv_Idle has to run.
+*
+* \return  milliseconds, gAppNvIdleNever_c if no record is waiting
+*
+********************************************************************************** */
+uint32_t AppNv_IdleTimeoutMs(void)
+{
+    uint32_t elapsed;
+
+    if(!mAppNvDirty)
+    {
+        return gAppNvIdleNever_c;
+    }
+    elapsed = AppNv_NowMs() - mAppNvDirtySince;
+    return (elapsed >= gAppNvCoalesceMs_c) ? 0 : (gAppNvCoalesceMs_c - elapsed);
+}
+
+/*! *********************************************************************************
+* \brief  Appends the changed records once the coalescing delay is over. A record
+*         whose RAM copy equals its newest stored copy is not written again. On a
+*         flash error the records stay marked and are retried one delay later.
+*
+********************************************************************************** */
+void AppNv_Idle(void)
+{
+    uint32_t failed = 0;
+    uint8_t record;
+
+    if(AppNv_IdleTimeoutMs() != 0)
+    {
+        return;
+    }
+
+    for(record = 0; record < gAppNvRecordMax_c; record++)
+    {
+        app_nv_binding_t* pBinding = &mAppNvBindings[record];
+
+        if(!(mAppNvDirty & (1UL << record)) || (pBinding->pData == NULL) || AppNv_Stored(record))
+        {
+            continue;
+        }
+        if(!AppNv_Append(record, pBinding->pData, pBinding->length))
+        {
+            failed |= (1UL << record);
+        }
+    }
+
+    mAppNvDirty = failed;
+    mAppNvDirtySince = AppNv_NowMs();
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*TRUE if the newest stored copy of a registered record equals its RAM copy*/
+static bool_t AppNv_Stored(uint8_t record)
+{
+    const app_nv_entry_t* pEntry;
+
+    if(mAppNvIndex[record] == mAppNvNone_c)
+    {
+        return FALSE;
+    }
+    pEntry = (const app_nv_entry_t*)(mAppNvBase + mAppNvIndex[record]);
+    return ((pEntry->length == mAppNvBindings[record].length) &&
+            FLib_MemCmp((void*)(pEntry + 1), mAppNvBindings[record].pData, pEntry->length)) ? TRUE : FALSE;
+}
+
+/*TRUE if the sector carries an activation header*/
+static bool_t AppNv_SectorValid(uint8_t sector)
+{
+    const app_nv_sector_t* pHeader = (const app_nv_sector_t*)(mAppNvBase + mAppNvSectorOffset(sector));
+
+    return ((pHeader->magic == mAppNvSectorMagic_c) && (pHeader->magicInv == ~mAppNvSectorMagic_c)) ? TRUE : FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Indexes the records of one sector. Scanning stops at erased space, or at
+*         an entry torn by a reset, in which case the sector counts as full.
+*
+* \param[in] sector  sector with a valid header
+*
+* \return  offset of the first free byte in the sector
+*
+********************************************************************************** */
+static uint32_t AppNv_ScanSector(uint8_t sector)
+{
+    uint32_t offset = sizeof(app_nv_sector_t);
+
+    while((offset + sizeof(app_nv_entry_t)) <= gAppNvSectorSize_c)
+    {
+        const app_nv_entry_t* pEntry = (const app_nv_entry_t*)(mAppNvBase + mAppNvSectorOffset(sector) + offset);
+
+        if(pEntry->record == mAppNvErased_c)
+        {
+            /*entries are programmed header first, nothing follows an erased header*/
+            return offset;
+        }
+        if((pEntry->record >= gAppNvRecordMax_c) ||
+           (pEntry->length > gAppNvMaxRecordLen_c) ||
+           ((offset + mAppNvEntrySize(pEntry->length)) > gAppNvSectorSize_c) ||
+           ((uint16_t)(pEntry->crc ^ pEntry->crcInv) != 0xFFFFU) ||
+           (pEntry->crc != AppNv_Crc16(pEntry->record, pEntry->length, (const uint8_t*)(pEntry + 1))))
+        {
+            return gAppNvSectorSize_c;
+        }
+        mAppNvIndex[pEntry->record] = (uint16_t)(mAppNvSectorOffset(sector) + offset);
+        offset += mAppNvEntrySize(pEntry->length);
+    }
+    return offset;
+}
+
+/*! *********************************************************************************
+* \brief  Erases a sector and makes it the active one.
+*
+* \param[in] sector  sector to activate
+* \param[in] seq     activation sequence, higher than any other sector's
+*
+* \return  FALSE on a flash error
+*
+********************************************************************************** */
+static bool_t AppNv_ActivateSector(uint8_t sector, uint32_t seq)
+{
+    app_nv_sector_t header;
+
+    header.magic = mAppNvSectorMagic_c;
+    header.seq = seq;
+    header.magicInv = ~mAppNvSectorMagic_c;
+    header.reserved = 0xFFFFFFFFU;
+
+    if(!AppNv_FlashErase(sector) ||
+       !AppNv_FlashProgram(mAppNvSectorOffset(sector), &header, sizeof(header)))
+    {
+        return FALSE;
+    }
+    mAppNvActive = sector;
+    mAppNvSeq = seq;
+    mAppNvWriteOffset = sizeof(header);
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Copies the live records of the oldest sector into the active one and
+*         erases it, so it can serve as the spare. Nothing to do if it is erased.
+*
+* \return  FALSE if a record could not be copied, the sector is then kept
+*
+********************************************************************************** */
+static bool_t AppNv_Reclaim(void)
+{
+    uint8_t oldest = (uint8_t)((mAppNvActive + 1U) % gAppNvSectors_c);
+    bool_t status = TRUE;
+    uint8_t record;
+
+    if(!AppNv_SectorValid(oldest))
+    {
+        return TRUE;
+    }
+
+    mAppNvReclaiming = TRUE;
+    for(record = 0; (record < gAppNvRecordMax_c) && status; record++)
+    {
+        if((mAppNvIndex[record] != mAppNvNone_c) &&
+           ((mAppNvIndex[record] / gAppNvSectorSize_c) == oldest))
+        {
+            const app_nv_entry_t* pEntry = (const app_nv_entry_t*)(mAppNvBase + mAppNvIndex[record]);
+
+            status = AppNv_Append(record, pEntry + 1, pEntry->length);
+        }
+    }
+    mAppNvReclaiming = FALSE;
+
+    return status ? AppNv_FlashErase(oldest) : FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Appends a copy of a record to the active sector, moving on to the spare
+*         sector first if it does not fit.
+*
+* \param[in] record  record id
+* \param[in] pData   record data, may point into the region
+* \param[in] length  record length
+*
+* \return  FALSE on a flash error or if the live records no longer fit a sector
+*
+********************************************************************************** */
+static bool_t AppNv_Append(uint8_t record, const void* pData, uint16_t length)
+{
+    app_nv_entry_t* pEntry = (app_nv_entry_t*)mAppNvEntryBuffer;
+    uint32_t size = mAppNvEntrySize(length);
+
+    if((mAppNvWriteOffset + size) > gAppNvSectorSize_c)
+    {
+        uint8_t next = (uint8_t)((mAppNvActive + 1U) % gAppNvSectors_c);
+
+        if(mAppNvReclaiming ||
+           !AppNv_ActivateSector(next, mAppNvSeq + 1U) ||
+           !AppNv_Reclaim() ||
+           ((mAppNvWriteOffset + size) > gAppNvSectorSize_c))
+        {
+            return FALSE;
+        }
+    }
+
+    /*copy first, pData may be in the sector a reclaim is about to erase*/
+    FLib_MemSet(mAppNvEntryBuffer, mAppNvErased_c, size);
+    FLib_MemCpy(pEntry + 1, (void*)pData, length);
+    pEntry->record = record;
+    pEntry->reserved = mAppNvErased_c;
+    pEntry->length = length;
+    pEntry->crc = AppNv_Crc16(record, length, (const uint8_t*)(pEntry + 1));
+    pEntry->crcInv = (uint16_t)~pEntry->crc;
+
+    if(!AppNv_FlashProgram(mAppNvSectorOffset(mAppNvActive) + mAppNvWriteOffset, pEntry, size))
+    {
+        /*whatever was programmed is torn, do not append behind it*/
+        mAppNvWriteOffset = gAppNvSectorSize_c;
+        return FALSE;
+    }
+    mAppNvIndex[record] = (uint16_t)(mAppNvSectorOffset(mAppNvActive) + mAppNvWriteOffset);
+    mAppNvWriteOffset += size;
+    return TRUE;
+}
+
+/*CRC-16/CCITT-FALSE over the record id, length and data, bitwise, records are short*/
+static uint16_t AppNv_Crc16(uint8_t record, uint16_t length, const uint8_t* pData)
+{
+    uint8_t prefix[3];
+    uint16_t crc = 0xFFFFU;
+    uint32_t i;
+    uint8_t bit;
+
+    prefix[0] = record;
+    prefix[1] = (uint8_t)length;
+    prefix[2] = (uint8_t)(length >> 8);
+
+    for(i = 0; i < (sizeof(prefix) + length); i++)
+    {
+        crc ^= (uint16_t)((i < sizeof(prefix)) ? prefix[i] : pData[i - sizeof(prefix)]) << 8;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+#ifdef LEDCONTROL_HOST
+/*! *********************************************************************************
+* \brief  Host backend: loads the flash image file, creating an erased one if it
+*         does not exist.
+*
+********************************************************************************** */
+static bool_t AppNv_BackendInit(void)
+{
+    const char* pPath = getenv("LEDCONTROL_NV_IMAGE");
+
+    if(pPath == NULL)
+    {
+        pPath = "ledcontrol_nv.bin";
+    }
+    FLib_MemSet(mAppNvImage, mAppNvErased_c, sizeof(mAppNvImage));
+    mAppNvBase = mAppNvImage;
+
+    if(mAppNvFile != NULL)
+    {
+        fclose(mAppNvFile);
+    }
+    mAppNvFile = fopen(pPath, "r+b");
+    if(mAppNvFile == NULL)
+    {
+        mAppNvFile = fopen(pPath, "w+b");
+        if(mAppNvFile == NULL)
+        {
+            return FALSE;
+        }
+    }
+    if(fread(mAppNvImage, 1, sizeof(mAppNvImage), mAppNvFile) != sizeof(mAppNvImage))
+    {
+        /*new or short image, the missing part reads as erased*/
+        rewind(mAppNvFile);
+        fwrite(mAppNvImage, 1, sizeof(mAppNvImage), mAppNvFile);
+        fflush(mAppNvFile);
+    }
+    return TRUE;
+}
+
+/*host backend: erased flash reads as 0xFF*/
+static bool_t AppNv_FlashErase(uint8_t sector)
+{
+    FLib_MemSet(&mAppNvImage[mAppNvSectorOffset(sector)], mAppNvErased_c, gAppNvSectorSize_c);
+    fseek(mAppNvFile, (long)mAppNvSectorOffset(sector), SEEK_SET);
+    return ((fwrite(&mAppNvImage[mAppNvSectorOffset(sector)], 1, gAppNvSectorSize_c, mAppNvFile) == gAppNvSectorSize_c) &&
+            (fflush(mAppNvFile) == 0)) ? TRUE : FALSE;
+}
+
+/*host backend: programming can only clear bits, like flash*/
+static bool_t AppNv_FlashProgram(uint32_t offset, const void* pData, uint32_t length)
+{
+    const uint8_t* pBytes = (const uint8_t*)pData;
+    uint32_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        mAppNvImage[offset + i] &= pBytes[i];
+    }
+    fseek(mAppNvFile, (long)offset, SEEK_SET);
+    return ((fwrite(&mAppNvImage[offset], 1, length, mAppNvFile) == length) &&
+            (fflush(mAppNvFile) == 0)) ? TRUE : FALSE;
+}
+
+static uint32_t AppNv_NowMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000U) + ((uint64_t)now.tv_nsec / 1000000U));
+}
+#else
+/*target backend: NVM_region through the framework flash adapter*/
+static bool_t AppNv_BackendInit(void)
+{
+    NV_Init();
+    mAppNvBase = (uint8_t*)NV_STORAGE_END_ADDRESS;
+    return TRUE;
+}
+
+static bool_t AppNv_FlashErase(uint8_t sector)
+{
+    return (kStatus_FLASH_Success == NV_FlashEraseSector(&gFlashConfig,
+                                                         (uint32_t)(mAppNvBase + mAppNvSectorOffset(sector)),
+                                                         gAppNvSectorSize_c)) ? TRUE : FALSE;
+}
+
+static bool_t AppNv_FlashProgram(uint32_t offset, const void* pData, uint32_t length)
+{
+    return (kStatus_FLASH_Success == NV_FlashProgramUnaligned(&gFlashConfig,
+                                                              (uint32_t)(mAppNvBase + offset),
+                                                              length, (uint8_t*)pData)) ? TRUE : FALSE;
+}
+
+static uint32_t AppNv_NowMs(void)
+{
+    return OSA_TimeGetMsec();
+}
+#endif
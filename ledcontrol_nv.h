@@ -0,0 +1,109 @@
+#ifndef _LEDCONTROL_NV_H_
+#define _LEDCONTROL_NV_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Application records kept in NVM_region (MKW41Z512xxx4_connectivity.ld) as a
+ * log: every save appends a new copy of the record to the active sector, the
+ * newest copy wins. Sectors are used in turn, so they wear evenly. One sector
+ * is always kept erased. When the active sector fills up, the spare becomes
+ * active and the live records of the oldest sector are copied over before it
+ * is erased to become the spare. On boot the log is scanned once into a RAM
+ * index, after which a record is found in O(1).
+ *
+ * Owners register the RAM copy of each record, mark it with AppNv_SaveOnIdle
+ * on change and the application task calls AppNv_Idle; records are written
+ * gAppNvCoalesceMs_c after the first change, so bursts of changes cost one
+ * flash write, and unchanged records none.
+ *
+ * The LEDCONTROL_HOST build keeps the region in a file instead
+ * (LEDCONTROL_NV_IMAGE, default ledcontrol_nv.bin) with the same erase and
+ * program rules as flash, so the store can be exercised off target.
+ */
+
+/*must match the linker script: m_sector_size and gNVMSectorCountLink_d*/
+#define gAppNvSectorSize_c           (2048)
+#define gAppNvSectors_c              (4)
+
+/*largest record; all live records together must fit one sector with room
+  left for one more copy of the largest*/
+#define gAppNvMaxRecordLen_c         (128)
+
+/*records covering the master slave table, gAppNvMaxRecordLen_c bytes each*/
+#define gAppNvSlaveTableRecords_c    (8)
+
+/*records covering the replay state of the frame protection, one per
+  gAppNvMaxRecordLen_c bytes of it*/
+#define gAppNvSecReplayRecords_c     (4)
+
+/*delay between the first change of a record and its flash write*/
+#ifndef gAppNvCoalesceMs_c
+#define gAppNvCoalesceMs_c           (1000)
+#endif
+
+/*AppNv_IdleTimeoutMs value when nothing is waiting, same as osaWaitForever_c*/
+#define gAppNvIdleNever_c            (0xFFFFFFFFU)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*record ids*/
+typedef enum
+{
+    gAppNvIdentity_c = 0,   /*slave: chip UID and the device id it was assigned*/
+    gAppNvLedState_c,       /*slave: LED on/off state*/
+    gAppNvLinkParams_c,     /*channel and TX power*/
+    gAppNvSlaveTable_c,     /*master: chip UID of every assigned device id, split
+                              over gAppNvSlaveTableRecords_c records*/
+    gAppNvSecCounter_c = gAppNvSlaveTable_c + gAppNvSlaveTableRecords_c,
+                            /*first frame counter not reserved yet (ledcontrol_sec.h)*/
+    gAppNvSecReplay_c,      /*lowest frame counter accepted from each peer, split
+                              over gAppNvSecReplayRecords_c records*/
+    gAppNvRecordMax_c = gAppNvSecReplay_c + gAppNvSecReplayRecords_c
+}app_nv_record_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*prepares the flash driver and indexes the log, call once before the others*/
+void AppNv_Init(void);
+
+/*binds a record id to the RAM copy its owner keeps*/
+void AppNv_Register(app_nv_record_t record, void* pData, uint16_t length);
+
+/*copies the stored record into its RAM copy, FALSE if none of that length is stored*/
+bool_t AppNv_Restore(app_nv_record_t record);
+
+/*marks a record as changed, cheap enough for the radio event handlers*/
+void AppNv_SaveOnIdle(app_nv_record_t record);
+
+/*writes a record now, for values that must be in flash before they are used*/
+bool_t AppNv_Flush(app_nv_record_t record);
+
+/*milliseconds until AppNv_Idle has a write to do, gAppNvIdleNever_c if none*/
+uint32_t AppNv_IdleTimeoutMs(void);
+
+/*writes the changed records whose coalescing delay is over. Stalls the core
+  while programming and, when a sector fills up, erasing*/
+void AppNv_Idle(void);
+
+#endif /* _LEDCONTROL_NV_H_ */
@@ -0,0 +1,1401 @@
+#include "ledcontrol_ota.h"
+#include "ledcontrol_nv.h"
+#include "ledcontrol_relay.h"
+
+#ifdef LEDCONTROL_HOST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define FLib_MemCpy(pDst, pSrc, cBytes)  memcpy((pDst), (pSrc), (cBytes))
+#define FLib_MemSet(pDst, val, cBytes)   memset((pDst), (val), (cBytes))
+#define Serial_Print(serId, pString, allowToBlock)  ((void)(serId), fputs((pString), stdout))
+#define Serial_PrintDec(serId, value)               ((void)(serId), printf("%u", (unsigned)(value)))
+#else
+#include "Flash_Adapter.h"
+#include "OtaSupport.h"
+#include "FunctionLib.h"
+#include "SerialManager.h"
+#include "fsl_os_abstraction.h"
+#include "fsl_device_registers.h"
+#endif
+
+#if gAppUseOta_d
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+#define mAppOtaErased_c              (0xFFU)
+#define mAppOtaNoPage_c              (0xFFFFU)
+
+#define mAppOtaHeaderLen_c           (16)
+
+#if defined(gSerialMgrRxBufSize_c) && (gSerialMgrRxBufSize_c <= gAppOtaUartChunk_c)
+#error "gSerialMgrRxBufSize_c must hold a whole gAppOtaUartChunk_c upload chunk"
+#endif
+/*blocks never cross a flash page, the last one of each page is shorter*/
+#define mAppOtaBlocksPerPage_c       ((gAppOtaPageSize_c + gAppOtaBlockLen_c - 1U) / gAppOtaBlockLen_c)
+#define mAppOtaBlocks(size)          ((((size) / gAppOtaPageSize_c) * mAppOtaBlocksPerPage_c) + \
+                                      ((((size) % gAppOtaPageSize_c) + gAppOtaBlockLen_c - 1U) / gAppOtaBlockLen_c))
+#define mAppOtaMaxBlocks_c           mAppOtaBlocks(gAppOtaMaxImageLen_c)
+#define mAppOtaPages(size)           (((size) + gAppOtaPageSize_c - 1U) / gAppOtaPageSize_c)
+#define mAppOtaWindows(blocks)       (((blocks) + gAppOtaWindowBlocks_c - 1U) / gAppOtaWindowBlocks_c)
+
+/*TRUE while AppOta_Idle still has storage sectors to erase for the upload*/
+#define mAppOtaErasing()             (mAppOtaEraseNext < mAppOtaEraseEnd)
+
+/*time the master listens for NACKs after a query; relayed NACKs also wait out
+  the jitter of every hop*/
+#if gAppUseRelay_d
+#define mAppOtaCollectMs(slots)      ((((slots) + 2U) * gAppOtaSlotMs_c) + \
+                                      (2U * gAppRelayMaxHops_c * (gAppRelayJitterMs_c + 1U)))
+#else
+#define mAppOtaCollectMs(slots)      (((slots) + 2U) * gAppOtaSlotMs_c)
+#endif
+
+/*a relay holds one forward at a time, the master sends no faster than the
+  relays release them*/
+#if gAppUseRelay_d
+#define mAppOtaTxGapMs_c             (gAppRelayJitterMs_c + 2)
+#else
+#define mAppOtaTxGapMs_c             (0)
+#endif
+
+/*status collection after the commit, the slaves check the CRC-32 first*/
+#define mAppOtaVerifyMs_c            (500)
+#define mAppOtaStatusWaitMs_c        (mAppOtaVerifyMs_c + ((gAppOtaStatusSlots_c + 2) * gAppOtaSlotMs_c))
+
+/*a slave resets once its status had time to reach the master*/
+#define mAppOtaResetDelayMs_c        (mAppOtaStatusWaitMs_c)
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+typedef enum
+{
+    mAppOtaIdle_c = 0,
+    mAppOtaUpload_c,        /*master: image coming from the UART*/
+    mAppOtaAnnounce_c,      /*master: sending 'U'*/
+    mAppOtaStream_c,        /*master: sending the blocks of sendMask, then 'Q'*/
+    mAppOtaCollect_c,       /*master: collecting NACKs for the window*/
+    mAppOtaCommit_c,        /*master: sending 'C'*/
+    mAppOtaStatus_c,        /*master: collecting 'K'*/
+    mAppOtaReceive_c,       /*slave: taking blocks*/
+    mAppOtaDone_c           /*slave: status known, waiting for the reset*/
+}app_ota_state_t;
+
+/*one RAM copy of a flash page*/
+typedef struct app_ota_page_tag
+{
+    uint16_t page;          /*mAppOtaNoPage_c when free*/
+    uint16_t programmed;    /*bytes already in flash*/
+    bool_t complete;        /*every block of the page arrived*/
+    uint32_t data[gAppOtaPageSize_c / sizeof(uint32_t)];
+}app_ota_page_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static uint32_t AppOta_Capacity(void);
+static void AppOta_EraseStart(uint32_t size);
+static bool_t AppOta_EraseStep(void);
+static void AppOta_UploadDone(uint8_t status);
+static uint32_t AppOta_BlockOffset(uint16_t index);
+static uint8_t AppOta_BlockLength(uint16_t index);
+static uint32_t AppOta_PageLength(uint16_t page);
+static app_ota_page_t* AppOta_NextPage(void);
+static bool_t AppOta_StoreBlock(uint16_t index, const uint8_t* pData);
+static bool_t AppOta_PageComplete(uint16_t page);
+static void AppOta_ForgetPage(uint16_t page);
+static bool_t AppOta_ProgramChunk(app_ota_page_t* pBuffer, uint32_t length);
+static bool_t AppOta_Received(uint16_t index);
+static uint32_t AppOta_MissingMask(uint16_t window);
+static bool_t AppOta_FirstGap(uint16_t lastWindow, uint16_t* pWindow, uint32_t* pMask);
+static app_ota_status_t AppOta_Finish(void);
+static uint32_t AppOta_Crc32(uint32_t crc, const uint8_t* pData, uint32_t length);
+static void AppOta_Frame(app_frame_t* pFrame, uint8_t command, uint8_t dataLen);
+static void AppOta_Put32(uint8_t* pDst, uint32_t value);
+static uint32_t AppOta_Get32(const uint8_t* pSrc);
+static uint32_t AppOta_Random(void);
+static void AppOta_PrintStatus(uint8_t devId, uint8_t status);
+
+static bool_t AppOta_BackendInit(void);
+static const uint8_t* AppOta_Storage(void);
+static uint32_t AppOta_StorageSize(void);
+static bool_t AppOta_FlashErase(uint32_t offset);
+static bool_t AppOta_FlashProgram(uint32_t offset, const void* pData, uint32_t length);
+static bool_t AppOta_ImageStart(uint32_t size);
+static bool_t AppOta_ImagePush(const uint8_t* pData, uint32_t length);
+static bool_t AppOta_ImageRead(uint32_t offset, uint8_t* pData, uint32_t length);
+static bool_t AppOta_ImageCommit(void);
+static void AppOta_ImageCancel(void);
+static uint32_t AppOta_NowMs(void);
+static void AppOta_Reset(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+#ifdef LEDCONTROL_HOST
+static uint8_t mAppOtaImage[gAppOtaHostStorageSize_c];
+static FILE* mAppOtaFile;
+static uint32_t mAppOtaPushed;
+#else
+/*internal storage region, MKW41Z512xxx4_connectivity.ld*/
+extern uint32_t INT_STORAGE_START[];
+extern uint32_t INT_STORAGE_SIZE[];
+#endif
+
+static app_ota_state_t mAppOtaState;
+static bool_t mAppOtaIsServer;
+static uint8_t mAppOtaSerId;
+
+/*image of the running session*/
+static uint8_t mAppOtaSession;
+static uint32_t mAppOtaSize;
+static uint32_t mAppOtaCrc;
+static uint16_t mAppOtaBlocks;
+
+/*master: storage sectors of the upload erased so far and to erase*/
+static uint16_t mAppOtaEraseNext;
+static uint16_t mAppOtaEraseEnd;
+
+/*master: window in progress, the window and blocks still to send, the
+  lowest window NACKed with its gaps, the NACK slots offered, whether NACKs
+  collided and the quiet rounds of the last window*/
+static uint16_t mAppOtaWindow;
+static uint8_t mAppOtaRound;
+static uint8_t mAppOtaRepeat;
+static uint16_t mAppOtaSendWindow;
+static uint32_t mAppOtaSendMask;
+static uint16_t mAppOtaNackWindow;
+static uint32_t mAppOtaNackMask;
+static uint8_t mAppOtaNackSlots;
+static bool_t mAppOtaGarbled;
+static uint8_t mAppOtaQuietRounds;
+static uint32_t mAppOtaUntil;
+static uint32_t mAppOtaNextTxAt;
+static uint32_t mAppOtaStartedAt;
+static uint32_t mAppOtaBlocksSent;
+static uint32_t mAppOtaRepairsSent;
+
+/*master: upload state*/
+static uint8_t mAppOtaHeader[mAppOtaHeaderLen_c];
+static uint32_t mAppOtaUploaded;
+static uint32_t mAppOtaLastByteAt;
+
+/*slave: blocks received, two page buffers, the page the image continues
+  with and the answer in waiting*/
+static uint8_t mAppOtaBitmap[(mAppOtaMaxBlocks_c + 7U) / 8U];
+static app_ota_page_t mAppOtaPages[2];
+static uint16_t mAppOtaNextPage;
+static app_ota_status_t mAppOtaStatus;
+static uint32_t mAppOtaResetAt;
+static bool_t mAppOtaReplyValid;
+static uint8_t mAppOtaReplyCmd;
+static uint16_t mAppOtaReplyWindow;
+static uint32_t mAppOtaReplyMask;
+
+static uint8_t mAppOtaTxData[gAppOtaMaxDataLen_c];
+static uint32_t mAppOtaRandom;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Opens the storage region. The master sends, slaves receive.
+*
+* \param[in] isServer  TRUE on the master
+* \param[in] seed      spreads the NACK and status slots of slaves, e.g. the chip UID
+*
+********************************************************************************** */
+void AppOta_Init(bool_t isServer, uint32_t seed)
+{
+    mAppOtaIsServer = isServer;
+    mAppOtaState = mAppOtaIdle_c;
+    mAppOtaRandom = seed | 1U;
+    mAppOtaSession = (uint8_t)AppOta_Random();
+    mAppOtaPages[0].page = mAppOtaNoPage_c;
+    mAppOtaPages[1].page = mAppOtaNoPage_c;
+    (void)AppOta_BackendInit();
+}
+
+/*! *********************************************************************************
+* \brief  Switches the UART to the upload: a mAppOtaHeaderLen_c byte header
+*         (magic, image size, CRC-32, reserved, little endian) then the image.
+*         Progress is acked as #O,A,imageBytesTaken every gAppOtaUartChunk_c
+*         bytes; the sender waits for each ack, so pages can be programmed
+*         while nothing arrives. The first ack, #O,A,0, comes once the storage
+*         is erased. The end is reported as #O,U,size,status.
+*
+* \param[in] serId  Serial Manager interface the image comes from
+*
+********************************************************************************** */
+void AppOta_UploadStart(uint8_t serId)
+{
+    if(!mAppOtaIsServer || (mAppOtaState != mAppOtaIdle_c))
+    {
+        return;
+    }
+    mAppOtaSerId = serId;
+    mAppOtaUploaded = 0;
+    mAppOtaLastByteAt = AppOta_NowMs();
+    mAppOtaPages[0].page = 0;
+    mAppOtaState = mAppOtaUpload_c;
+}
+
+/*! *********************************************************************************
+* \brief  Tells whether UART bytes belong to the upload. An upload that stalled
+*         for gAppOtaUploadTimeoutMs_c is dropped here.
+*
+* \return  TRUE while an upload is in progress
+*
+********************************************************************************** */
+bool_t AppOta_Uploading(void)
+{
+    if((mAppOtaState == mAppOtaUpload_c) &&
+       ((AppOta_NowMs() - mAppOtaLastByteAt) > gAppOtaUploadTimeoutMs_c))
+    {
+        mAppOtaState = mAppOtaIdle_c;
+        mAppOtaPages[0].page = mAppOtaNoPage_c;
+        mAppOtaEraseEnd = 0;
+    }
+    return (mAppOtaState == mAppOtaUpload_c) ? TRUE : FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Takes one byte of the upload. The storage is erased by AppOta_Idle
+*         once the header is in, each page is programmed as soon as it is full
+*         and the image is checked against its CRC-32 before a session starts.
+*
+* \param[in] byte  UART byte
+*
+********************************************************************************** */
+void AppOta_UploadByte(uint8_t byte)
+{
+    app_ota_page_t* pBuffer = &mAppOtaPages[0];
+    uint32_t offset;
+    uint8_t status = gAppOtaStatusOk_c;
+
+    mAppOtaLastByteAt = AppOta_NowMs();
+    if(mAppOtaUploaded < mAppOtaHeaderLen_c)
+    {
+        mAppOtaHeader[mAppOtaUploaded++] = byte;
+        if(mAppOtaUploaded < mAppOtaHeaderLen_c)
+        {
+            return;
+        }
+        mAppOtaSize = AppOta_Get32(&mAppOtaHeader[4]);
+        mAppOtaCrc = AppOta_Get32(&mAppOtaHeader[8]);
+        if((AppOta_Get32(mAppOtaHeader) != gAppOtaUploadMagic_c) || !mAppOtaSize ||
+           (mAppOtaSize > AppOta_Capacity()))
+        {
+            status = gAppOtaStatusTooLarge_c;
+        }
+        else
+        {
+            /*AppOta_Idle acks once the storage is erased*/
+            AppOta_EraseStart(mAppOtaSize);
+            pBuffer->programmed = 0;
+            FLib_MemSet(pBuffer->data, mAppOtaErased_c, gAppOtaPageSize_c);
+            return;
+        }
+    }
+    else
+    {
+        offset = mAppOtaUploaded - mAppOtaHeaderLen_c;
+        ((uint8_t*)pBuffer->data)[offset % gAppOtaPageSize_c] = byte;
+        mAppOtaUploaded++;
+        offset++;
+        if(((offset % gAppOtaPageSize_c) == 0U) || (offset == mAppOtaSize))
+        {
+            if(!AppOta_ProgramChunk(pBuffer, gAppOtaPageSize_c))
+            {
+                status = gAppOtaStatusFlash_c;
+            }
+            pBuffer->page++;
+            pBuffer->programmed = 0;
+            FLib_MemSet(pBuffer->data, mAppOtaErased_c, gAppOtaPageSize_c);
+        }
+        if((status == gAppOtaStatusOk_c) && (offset < mAppOtaSize))
+        {
+            if((offset % gAppOtaUartChunk_c) == 0U)
+            {
+                Serial_Print(mAppOtaSerId, "#O,A,", gAllowToBlock_d);
+                Serial_PrintDec(mAppOtaSerId, offset);
+                Serial_Print(mAppOtaSerId, "\r\n", gAllowToBlock_d);
+            }
+            return;
+        }
+        if((status == gAppOtaStatusOk_c) &&
+           (AppOta_Crc32(0, AppOta_Storage(), mAppOtaSize) != mAppOtaCrc))
+        {
+            status = gAppOtaStatusCrc_c;
+        }
+    }
+
+    AppOta_UploadDone(status);
+}
+
+/*! *********************************************************************************
+* \brief  Steps the session of the master: announce, then for every window
+*         its blocks, a query and the repair rounds, and at
+*         last the commit. Ends with
+*           #O,D,size,ms,blocksSent,repairsSent
+*         after the statuses of the slaves (#O,S,devId,status) came in.
+*
+* \param[out] pFrame   broadcast frame to queue, pData valid until the next call
+* \param[out] pWaitMs  when FALSE is returned, time until the next step
+*
+* \return  TRUE if a frame is to be sent
+*
+********************************************************************************** */
+bool_t AppOta_ServerNext(app_frame_t* pFrame, uint32_t* pWaitMs)
+{
+    uint32_t now = AppOta_NowMs();
+    uint16_t index;
+
+    *pWaitMs = 0;
+    if(((mAppOtaState == mAppOtaAnnounce_c) || (mAppOtaState == mAppOtaStream_c) ||
+        (mAppOtaState == mAppOtaCommit_c)) && ((int32_t)(mAppOtaNextTxAt - now) > 0))
+    {
+        *pWaitMs = mAppOtaNextTxAt - now;
+        return FALSE;
+    }
+    mAppOtaNextTxAt = now + mAppOtaTxGapMs_c;
+    while(1)
+    {
+        switch(mAppOtaState)
+        {
+        case mAppOtaAnnounce_c:
+            mAppOtaTxData[0] = mAppOtaSession;
+            mAppOtaTxData[1] = gAppOtaBlockLen_c;
+            AppOta_Put32(&mAppOtaTxData[2], mAppOtaSize);
+            AppOta_Put32(&mAppOtaTxData[6], mAppOtaCrc);
+            AppOta_Frame(pFrame, gAppOtaCmdAnnounce_c, 10);
+            if(++mAppOtaRepeat == gAppOtaRepeat_c)
+            {
+                mAppOtaWindow = 0;
+                mAppOtaRound = 0;
+                mAppOtaSendMask = 0xFFFFFFFFU;
+                mAppOtaSendWindow = 0;
+                mAppOtaState = mAppOtaStream_c;
+            }
+            return TRUE;
+
+        case mAppOtaCollect_c:
+        case mAppOtaStatus_c:
+            if((int32_t)(mAppOtaUntil - now) > 0)
+            {
+                *pWaitMs = mAppOtaUntil - now;
+                return FALSE;
+            }
+            if(mAppOtaState == mAppOtaStatus_c)
+            {
+                Serial_Print(mAppOtaSerId, "#O,D,", gAllowToBlock_d);
+                Serial_PrintDec(mAppOtaSerId, mAppOtaSize);
+                Serial_Print(mAppOtaSerId, ",", gAllowToBlock_d);
+                Serial_PrintDec(mAppOtaSerId, now - mAppOtaStartedAt);
+                Serial_Print(mAppOtaSerId, ",", gAllowToBlock_d);
+                Serial_PrintDec(mAppOtaSerId, mAppOtaBlocksSent);
+                Serial_Print(mAppOtaSerId, ",", gAllowToBlock_d);
+                Serial_PrintDec(mAppOtaSerId, mAppOtaRepairsSent);
+                Serial_Print(mAppOtaSerId, "\r\n", gAllowToBlock_d);
+                mAppOtaState = mAppOtaIdle_c;
+                return FALSE;
+            }
+            if((mAppOtaState == mAppOtaCollect_c) && mAppOtaGarbled &&
+               (mAppOtaNackSlots < gAppOtaMaxNackSlots_c))
+            {
+                /*more slaves answer than there are slots*/
+                mAppOtaNackSlots *= 2U;
+            }
+            else if((mAppOtaState == mAppOtaCollect_c) && !mAppOtaGarbled &&
+                    (mAppOtaNackSlots > gAppOtaNackSlots_c))
+            {
+                mAppOtaNackSlots /= 2U;
+            }
+            if((mAppOtaNackMask || mAppOtaGarbled) && (mAppOtaRound + 1U < gAppOtaMaxRounds_c))
+            {
+                /*a garbled round only asks again*/
+                mAppOtaRound++;
+                mAppOtaSendMask = mAppOtaNackMask;
+                mAppOtaSendWindow = mAppOtaNackWindow;
+                mAppOtaQuietRounds = 0;
+            }
+            else if(((uint32_t)(mAppOtaWindow + 1U) * gAppOtaWindowBlocks_c) < mAppOtaBlocks)
+            {
+                mAppOtaWindow++;
+                mAppOtaRound = 0;
+                mAppOtaSendMask = 0xFFFFFFFFU;
+                mAppOtaSendWindow = mAppOtaWindow;
+            }
+            else if(++mAppOtaQuietRounds < gAppOtaRepeat_c)
+            {
+                /*slaves that missed the last query get another one before the commit*/
+                mAppOtaSendMask = 0;
+            }
+            else
+            {
+                mAppOtaRepeat = 0;
+                mAppOtaState = mAppOtaCommit_c;
+                break;
+            }
+            mAppOtaState = mAppOtaStream_c;
+            break;
+
+        case mAppOtaStream_c:
+            while(mAppOtaSendMask)
+            {
+                uint8_t bit = 0;
+
+                while(!(mAppOtaSendMask & (1UL << bit)))
+                {
+                    bit++;
+                }
+                mAppOtaSendMask &= ~(1UL << bit);
+                index = (uint16_t)((mAppOtaSendWindow * gAppOtaWindowBlocks_c) + bit);
+                if(index >= mAppOtaBlocks)
+                {
+                    mAppOtaSendMask = 0;
+                    break;
+                }
+                mAppOtaTxData[0] = (uint8_t)index;
+                mAppOtaTxData[1] = (uint8_t)(index >> 8);
+                FLib_MemCpy(&mAppOtaTxData[2], (void*)&AppOta_Storage()[AppOta_BlockOffset(index)],
+                            AppOta_BlockLength(index));
+                AppOta_Frame(pFrame, gAppOtaCmdBlock_c, (uint8_t)(2U + AppOta_BlockLength(index)));
+                mAppOtaBlocksSent++;
+                if(mAppOtaRound)
+                {
+                    mAppOtaRepairsSent++;
+                }
+                return TRUE;
+            }
+            mAppOtaTxData[0] = mAppOtaSession;
+            mAppOtaTxData[1] = (uint8_t)mAppOtaWindow;
+            mAppOtaTxData[2] = (uint8_t)(mAppOtaWindow >> 8);
+            mAppOtaTxData[3] = mAppOtaNackSlots;
+            AppOta_Frame(pFrame, gAppOtaCmdQuery_c, 4);
+            mAppOtaNackMask = 0;
+            mAppOtaNackWindow = mAppOtaWindow;
+            mAppOtaGarbled = FALSE;
+            mAppOtaUntil = now + mAppOtaCollectMs(mAppOtaNackSlots);
+            mAppOtaState = mAppOtaCollect_c;
+            return TRUE;
+
+        case mAppOtaCommit_c:
+            mAppOtaTxData[0] = mAppOtaSession;
+            AppOta_Frame(pFrame, gAppOtaCmdCommit_c, 1);
+            if(++mAppOtaRepeat == gAppOtaRepeat_c)
+            {
+                mAppOtaUntil = now + mAppOtaStatusWaitMs_c;
+                mAppOtaState = mAppOtaStatus_c;
+            }
+            return TRUE;
+
+        default:
+            return FALSE;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Adds the gaps of a NACK to the next repair round, or prints the status
+*         a slave reported after the commit. A round repairs one window, the
+*         lowest any slave reported.
+*
+* \param[in] pFrame  decoded 'N' or 'K' frame
+*
+********************************************************************************** */
+void AppOta_ServerReceive(const app_frame_t* pFrame)
+{
+    if(!mAppOtaIsServer || !pFrame->dataLen || (pFrame->pData[0] != mAppOtaSession))
+    {
+        return;
+    }
+    if((pFrame->command == gAppOtaCmdNack_c) && (pFrame->dataLen >= 7) &&
+       (mAppOtaState == mAppOtaCollect_c))
+    {
+        uint16_t window = (uint16_t)(pFrame->pData[1] | ((uint16_t)pFrame->pData[2] << 8));
+
+        /*the lowest gap is repaired first, the others are asked for again*/
+        if(window < mAppOtaNackWindow)
+        {
+            mAppOtaNackWindow = window;
+            mAppOtaNackMask = 0;
+        }
+        if(window == mAppOtaNackWindow)
+        {
+            mAppOtaNackMask |= AppOta_Get32(&pFrame->pData[3]);
+        }
+    }
+    else if((pFrame->command == gAppOtaCmdStatus_c) && (pFrame->dataLen >= 2))
+    {
+        AppOta_PrintStatus(pFrame->devId, pFrame->pData[1]);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Tells the master a frame failed its CRC. While NACKs are collected this
+*         is taken as NACKs sent in the same slot: the query is repeated with
+*         twice the slots, up to gAppOtaMaxNackSlots_c.
+*
+********************************************************************************** */
+void AppOta_ServerGarbled(void)
+{
+    if(mAppOtaIsServer && (mAppOtaState == mAppOtaCollect_c))
+    {
+        mAppOtaGarbled = TRUE;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Handles a broadcast of the master, or a NACK of another slave.
+*
+* \param[in] pFrame  decoded OTA frame
+*
+* \return  milliseconds until AppOta_ClientReply has an answer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppOta_ClientReceive(const app_frame_t* pFrame)
+{
+    const uint8_t* pData = pFrame->pData;
+    uint16_t window;
+    uint32_t mask;
+
+    if(mAppOtaIsServer || (mAppOtaState == mAppOtaUpload_c))
+    {
+        return 0;
+    }
+    switch(pFrame->command)
+    {
+    case gAppOtaCmdAnnounce_c:
+        if((pFrame->dataLen < 10) || (pData[1] != gAppOtaBlockLen_c) ||
+           ((mAppOtaState != mAppOtaIdle_c) && (pData[0] == mAppOtaSession)))
+        {
+            return 0;
+        }
+        mAppOtaSession = pData[0];
+        mAppOtaSize = AppOta_Get32(&pData[2]);
+        mAppOtaCrc = AppOta_Get32(&pData[6]);
+        mAppOtaBlocks = (uint16_t)mAppOtaBlocks(mAppOtaSize);
+        mAppOtaStatus = gAppOtaStatusOk_c;
+        mAppOtaResetAt = 0;
+        mAppOtaReplyValid = FALSE;
+        mAppOtaPages[0].page = mAppOtaNoPage_c;
+        mAppOtaPages[1].page = mAppOtaNoPage_c;
+        mAppOtaNextPage = 0;
+        FLib_MemSet(mAppOtaBitmap, 0, sizeof(mAppOtaBitmap));
+        /*drops the image of an earlier session*/
+        AppOta_ImageCancel();
+        if(!mAppOtaSize || (mAppOtaSize > AppOta_Capacity()))
+        {
+            mAppOtaStatus = gAppOtaStatusTooLarge_c;
+        }
+        else if(!AppOta_ImageStart(mAppOtaSize))
+        {
+            mAppOtaStatus = gAppOtaStatusFlash_c;
+        }
+        mAppOtaState = mAppOtaReceive_c;
+        return 0;
+
+    case gAppOtaCmdBlock_c:
+        if((mAppOtaState != mAppOtaReceive_c) || (mAppOtaStatus != gAppOtaStatusOk_c) || (pFrame->dataLen < 2))
+        {
+            return 0;
+        }
+        window = (uint16_t)(pData[0] | ((uint16_t)pData[1] << 8));
+        if((window < mAppOtaBlocks) && (pFrame->dataLen == (2U + AppOta_BlockLength(window))) &&
+           !AppOta_StoreBlock(window, &pData[2]))
+        {
+            mAppOtaStatus = gAppOtaStatusFlash_c;
+        }
+        return 0;
+
+    case gAppOtaCmdQuery_c:
+        if((mAppOtaState != mAppOtaReceive_c) || (mAppOtaStatus != gAppOtaStatusOk_c) ||
+           (pFrame->dataLen < 4) || (pData[0] != mAppOtaSession) || !pData[3])
+        {
+            return 0;
+        }
+        /*the first gap up to the queried window, a slave that missed an
+          earlier query still gets it repaired*/
+        if(!AppOta_FirstGap((uint16_t)(pData[1] | ((uint16_t)pData[2] << 8)), &window, &mask))
+        {
+            return 0;
+        }
+        mAppOtaReplyCmd = gAppOtaCmdNack_c;
+        mAppOtaReplyWindow = window;
+        mAppOtaReplyMask = mask;
+        mAppOtaReplyValid = TRUE;
+        return 1U + (gAppOtaSlotMs_c * (AppOta_Random() % pData[3]));
+
+    case gAppOtaCmdNack_c:
+        /*another slave asks for at least the same blocks, the master resends to all*/
+        if(mAppOtaReplyValid && (mAppOtaReplyCmd == gAppOtaCmdNack_c) && (pFrame->dataLen >= 7) &&
+           (pData[0] == mAppOtaSession) &&
+           ((pData[1] | ((uint16_t)pData[2] << 8)) == mAppOtaReplyWindow) &&
+           ((AppOta_Get32(&pData[3]) & mAppOtaReplyMask) == mAppOtaReplyMask))
+        {
+            mAppOtaReplyValid = FALSE;
+        }
+        return 0;
+
+    case gAppOtaCmdCommit_c:
+        if((mAppOtaState != mAppOtaReceive_c) || !pFrame->dataLen || (pData[0] != mAppOtaSession))
+        {
+            return 0;
+        }
+        mAppOtaStatus = AppOta_Finish();
+        mAppOtaState = mAppOtaDone_c;
+        if(mAppOtaStatus != gAppOtaStatusOk_c)
+        {
+            AppOta_ImageCancel();
+        }
+        else
+        {
+            mAppOtaResetAt = AppOta_NowMs() + mAppOtaResetDelayMs_c;
+            if(!mAppOtaResetAt)
+            {
+                mAppOtaResetAt = 1;
+            }
+        }
+        mAppOtaReplyCmd = gAppOtaCmdStatus_c;
+        mAppOtaReplyValid = TRUE;
+        return 1U + (gAppOtaSlotMs_c * (AppOta_Random() % gAppOtaStatusSlots_c));
+
+    default:
+        return 0;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Builds the NACK or status scheduled by AppOta_ClientReceive.
+*
+* \param[out] pFrame  frame to queue, the caller sets devId
+*
+* \return  FALSE if there is nothing to send
+*
+********************************************************************************** */
+bool_t AppOta_ClientReply(app_frame_t* pFrame)
+{
+    if(!mAppOtaReplyValid)
+    {
+        return FALSE;
+    }
+    mAppOtaReplyValid = FALSE;
+    mAppOtaTxData[0] = mAppOtaSession;
+    if(mAppOtaReplyCmd == gAppOtaCmdNack_c)
+    {
+        mAppOtaTxData[1] = (uint8_t)mAppOtaReplyWindow;
+        mAppOtaTxData[2] = (uint8_t)(mAppOtaReplyWindow >> 8);
+        AppOta_Put32(&mAppOtaTxData[3], mAppOtaReplyMask);
+        AppOta_Frame(pFrame, gAppOtaCmdNack_c, 7);
+    }
+    else
+    {
+        mAppOtaTxData[1] = (uint8_t)mAppOtaStatus;
+        AppOta_Frame(pFrame, gAppOtaCmdStatus_c, 2);
+    }
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Time until AppOta_Idle has a sector to erase, a page chunk to program
+*         or a reset to do.
+*
+* \return  milliseconds, gAppNvIdleNever_c if nothing is waiting
+*
+********************************************************************************** */
+uint32_t AppOta_IdleTimeoutMs(void)
+{
+    uint32_t now;
+
+    if(mAppOtaErasing() || ((mAppOtaState == mAppOtaReceive_c) && (AppOta_NextPage() != NULL)))
+    {
+        return 0;
+    }
+    if(mAppOtaResetAt)
+    {
+        now = AppOta_NowMs();
+        return ((int32_t)(mAppOtaResetAt - now) > 0) ? (mAppOtaResetAt - now) : 0U;
+    }
+    return gAppNvIdleNever_c;
+}
+
+/*! *********************************************************************************
+* \brief  Master: erases the next storage sector of the upload, one per call,
+*         so the radio is not stalled for the whole region. Slave: adds
+*         gAppOtaProgramChunk_c bytes of the next page of the image, once it
+*         is complete, and frees its buffer once the page is stored; the
+*         first chunk of a page also erases its sector. Resets into a
+*         verified image once its status had time to go out.
+*
+********************************************************************************** */
+void AppOta_Idle(void)
+{
+    app_ota_page_t* pBuffer;
+
+    if(mAppOtaErasing())
+    {
+        if(!AppOta_EraseStep())
+        {
+            mAppOtaEraseEnd = 0;
+            AppOta_UploadDone(gAppOtaStatusFlash_c);
+        }
+        else
+        {
+            /*the sender waits for the first ack meanwhile*/
+            mAppOtaLastByteAt = AppOta_NowMs();
+            if(!mAppOtaErasing())
+            {
+                Serial_Print(mAppOtaSerId, "#O,A,0\r\n", gAllowToBlock_d);
+            }
+        }
+        return;
+    }
+
+    pBuffer = AppOta_NextPage();
+    if((pBuffer != NULL) && (mAppOtaState == mAppOtaReceive_c))
+    {
+        if(!AppOta_ProgramChunk(pBuffer, gAppOtaProgramChunk_c))
+        {
+            mAppOtaStatus = gAppOtaStatusFlash_c;
+        }
+        if(pBuffer->programmed >= AppOta_PageLength(pBuffer->page))
+        {
+            pBuffer->page = mAppOtaNoPage_c;
+            mAppOtaNextPage++;
+        }
+    }
+
+    if(mAppOtaResetAt && ((int32_t)(mAppOtaResetAt - AppOta_NowMs()) <= 0))
+    {
+        mAppOtaResetAt = 0;
+        AppOta_Reset();
+    }
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*largest image: the storage region less its last sector, where OtaSupport
+  keeps the sector bitmap of a slave; the master takes no larger image than
+  its slaves*/
+static uint32_t AppOta_Capacity(void)
+{
+    uint32_t capacity = AppOta_StorageSize();
+
+    if(capacity < (2U * gAppOtaPageSize_c))
+    {
+        return 0;
+    }
+    capacity -= gAppOtaPageSize_c;
+
+    return (capacity < gAppOtaMaxImageLen_c) ? capacity : gAppOtaMaxImageLen_c;
+}
+
+/*queues the erase of the sectors an image of the given size takes for
+  AppOta_Idle*/
+static void AppOta_EraseStart(uint32_t size)
+{
+    mAppOtaEraseNext = 0;
+    mAppOtaEraseEnd = (uint16_t)mAppOtaPages(size);
+}
+
+/*erases the next queued sector*/
+static bool_t AppOta_EraseStep(void)
+{
+    return AppOta_FlashErase((uint32_t)(mAppOtaEraseNext++) * gAppOtaPageSize_c);
+}
+
+/*! *********************************************************************************
+* \brief  Ends an upload: reports it as #O,U,size,status and starts the session
+*         if the image is in.
+*
+* \param[in] status  app_ota_status_t of the upload
+*
+********************************************************************************** */
+static void AppOta_UploadDone(uint8_t status)
+{
+    Serial_Print(mAppOtaSerId, "#O,U,", gAllowToBlock_d);
+    Serial_PrintDec(mAppOtaSerId, mAppOtaSize);
+    Serial_Print(mAppOtaSerId, ",", gAllowToBlock_d);
+    Serial_PrintDec(mAppOtaSerId, status);
+    Serial_Print(mAppOtaSerId, "\r\n", gAllowToBlock_d);
+    mAppOtaPages[0].page = mAppOtaNoPage_c;
+    mAppOtaState = mAppOtaIdle_c;
+    if(status == gAppOtaStatusOk_c)
+    {
+        mAppOtaSession++;
+        mAppOtaBlocks = (uint16_t)mAppOtaBlocks(mAppOtaSize);
+        mAppOtaRepeat = 0;
+        mAppOtaBlocksSent = 0;
+        mAppOtaRepairsSent = 0;
+        mAppOtaStartedAt = AppOta_NowMs();
+        mAppOtaNextTxAt = mAppOtaStartedAt;
+        mAppOtaNackSlots = gAppOtaNackSlots_c;
+        mAppOtaQuietRounds = 0;
+        mAppOtaState = mAppOtaAnnounce_c;
+    }
+}
+
+/*storage offset of a block*/
+static uint32_t AppOta_BlockOffset(uint16_t index)
+{
+    return ((uint32_t)(index / mAppOtaBlocksPerPage_c) * gAppOtaPageSize_c) +
+           ((uint32_t)(index % mAppOtaBlocksPerPage_c) * gAppOtaBlockLen_c);
+}
+
+/*image bytes of a block, short at the end of a page and of the image*/
+static uint8_t AppOta_BlockLength(uint16_t index)
+{
+    uint32_t offset = AppOta_BlockOffset(index);
+    uint32_t length = gAppOtaPageSize_c - (offset % gAppOtaPageSize_c);
+
+    if(length > gAppOtaBlockLen_c)
+    {
+        length = gAppOtaBlockLen_c;
+    }
+    if((offset + length) > mAppOtaSize)
+    {
+        length = (offset < mAppOtaSize) ? (mAppOtaSize - offset) : 0U;
+    }
+    return (uint8_t)length;
+}
+
+/*image bytes of a page, short for the last one*/
+static uint32_t AppOta_PageLength(uint16_t page)
+{
+    uint32_t offset = (uint32_t)page * gAppOtaPageSize_c;
+
+    return ((offset + gAppOtaPageSize_c) > mAppOtaSize) ? (mAppOtaSize - offset) : gAppOtaPageSize_c;
+}
+
+/*slave: the buffer of the page the image continues with, NULL if that page
+  is not complete yet; OtaSupport takes the image in order*/
+static app_ota_page_t* AppOta_NextPage(void)
+{
+    app_ota_page_t* pBuffer = &mAppOtaPages[mAppOtaNextPage & 1U];
+
+    return ((pBuffer->page == mAppOtaNextPage) && pBuffer->complete) ? pBuffer : NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Copies a block into the buffer of its page. The buffer may still hold
+*         the page two before: if that page is complete and the image
+*         continues with it, its rest is stored now; if not, the block is
+*         dropped and asked for again once the earlier pages are repaired. A
+*         buffer holding a later page that is not complete gives it up for the
+*         earlier one, its blocks are asked for again.
+*
+* \param[in] index  block index, below mAppOtaBlocks
+* \param[in] pData  AppOta_BlockLength(index) bytes
+*
+* \return  FALSE if the flash could not be programmed
+*
+********************************************************************************** */
+static bool_t AppOta_StoreBlock(uint16_t index, const uint8_t* pData)
+{
+    uint16_t page = (uint16_t)(index / mAppOtaBlocksPerPage_c);
+    app_ota_page_t* pBuffer = &mAppOtaPages[page & 1U];
+
+    if(AppOta_Received(index))
+    {
+        return TRUE;
+    }
+    if(pBuffer->page != page)
+    {
+        if(pBuffer->page != mAppOtaNoPage_c)
+        {
+            if(pBuffer == AppOta_NextPage())
+            {
+                if(!AppOta_ProgramChunk(pBuffer, gAppOtaPageSize_c))
+                {
+                    return FALSE;
+                }
+                mAppOtaNextPage++;
+            }
+            else if(pBuffer->complete || (pBuffer->page < page))
+            {
+                return TRUE;
+            }
+            else
+            {
+                AppOta_ForgetPage(pBuffer->page);
+            }
+        }
+        pBuffer->page = page;
+        pBuffer->programmed = 0;
+        pBuffer->complete = FALSE;
+        FLib_MemSet(pBuffer->data, mAppOtaErased_c, gAppOtaPageSize_c);
+    }
+    FLib_MemCpy(&((uint8_t*)pBuffer->data)[AppOta_BlockOffset(index) % gAppOtaPageSize_c], (void*)pData,
+                AppOta_BlockLength(index));
+    mAppOtaBitmap[index >> 3] |= (uint8_t)(1U << (index & 7U));
+    pBuffer->complete = AppOta_PageComplete(page);
+    return TRUE;
+}
+
+/*TRUE if every block of the page arrived*/
+static bool_t AppOta_PageComplete(uint16_t page)
+{
+    uint32_t index = (uint32_t)page * mAppOtaBlocksPerPage_c;
+    uint32_t end = index + mAppOtaBlocksPerPage_c;
+
+    if(end > mAppOtaBlocks)
+    {
+        end = mAppOtaBlocks;
+    }
+    for(; index < end; index++)
+    {
+        if(!AppOta_Received((uint16_t)index))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*marks the blocks of a page as missing again*/
+static void AppOta_ForgetPage(uint16_t page)
+{
+    uint32_t index = (uint32_t)page * mAppOtaBlocksPerPage_c;
+    uint32_t end = index + mAppOtaBlocksPerPage_c;
+
+    for(; (index < end) && (index < mAppOtaBlocks); index++)
+    {
+        mAppOtaBitmap[index >> 3] &= (uint8_t)~(1U << (index & 7U));
+    }
+}
+
+/*stores up to length more image bytes of a page buffer: the master programs
+  its storage, a slave adds them to the image*/
+static bool_t AppOta_ProgramChunk(app_ota_page_t* pBuffer, uint32_t length)
+{
+    uint32_t left = AppOta_PageLength(pBuffer->page) - pBuffer->programmed;
+    const uint8_t* pData = &((uint8_t*)pBuffer->data)[pBuffer->programmed];
+    bool_t status;
+
+    if(length > left)
+    {
+        length = left;
+    }
+    if(mAppOtaIsServer)
+    {
+        status = AppOta_FlashProgram(((uint32_t)pBuffer->page * gAppOtaPageSize_c) + pBuffer->programmed,
+                                     pData, length);
+    }
+    else
+    {
+        status = AppOta_ImagePush(pData, length);
+    }
+    pBuffer->programmed += (uint16_t)length;
+    return status;
+}
+
+/*first window up to lastWindow with blocks missing, and its gaps*/
+static bool_t AppOta_FirstGap(uint16_t lastWindow, uint16_t* pWindow, uint32_t* pMask)
+{
+    uint16_t window;
+
+    for(window = 0; window <= lastWindow; window++)
+    {
+        *pMask = AppOta_MissingMask(window);
+        if(*pMask)
+        {
+            *pWindow = window;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static bool_t AppOta_Received(uint16_t index)
+{
+    return (mAppOtaBitmap[index >> 3] & (1U << (index & 7U))) ? TRUE : FALSE;
+}
+
+/*blocks of a window that did not arrive, bit n for block window * W + n*/
+static uint32_t AppOta_MissingMask(uint16_t window)
+{
+    uint32_t mask = 0;
+    uint32_t index;
+    uint8_t bit;
+
+    for(bit = 0; bit < gAppOtaWindowBlocks_c; bit++)
+    {
+        index = ((uint32_t)window * gAppOtaWindowBlocks_c) + bit;
+        if((index < mAppOtaBlocks) && !AppOta_Received((uint16_t)index))
+        {
+            mask |= (1UL << bit);
+        }
+    }
+    return mask;
+}
+
+/*! *********************************************************************************
+* \brief  Ends the session of a slave: stores what is left in the page
+*         buffers, checks the CRC-32 of the stored image and hands it to the
+*         bootloader.
+*
+* \return  status reported to the master
+*
+********************************************************************************** */
+static app_ota_status_t AppOta_Finish(void)
+{
+    app_ota_page_t* pBuffer;
+    uint8_t* pChunk = (uint8_t*)mAppOtaPages[0].data;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t crc = 0;
+    uint16_t window;
+    uint32_t mask;
+
+    if(mAppOtaStatus != gAppOtaStatusOk_c)
+    {
+        return mAppOtaStatus;
+    }
+    if(AppOta_FirstGap((uint16_t)(mAppOtaWindows(mAppOtaBlocks) - 1U), &window, &mask))
+    {
+        return gAppOtaStatusMissing_c;
+    }
+    while((pBuffer = AppOta_NextPage()) != NULL)
+    {
+        if(!AppOta_ProgramChunk(pBuffer, gAppOtaPageSize_c))
+        {
+            return gAppOtaStatusFlash_c;
+        }
+        pBuffer->page = mAppOtaNoPage_c;
+        mAppOtaNextPage++;
+    }
+    if(mAppOtaNextPage < mAppOtaPages(mAppOtaSize))
+    {
+        return gAppOtaStatusMissing_c;
+    }
+
+    /*read back through a page buffer, both are free now*/
+    for(offset = 0; offset < mAppOtaSize; offset += length)
+    {
+        length = mAppOtaSize - offset;
+        if(length > gAppOtaPageSize_c)
+        {
+            length = gAppOtaPageSize_c;
+        }
+        if(!AppOta_ImageRead(offset, pChunk, length))
+        {
+            return gAppOtaStatusFlash_c;
+        }
+        crc = AppOta_Crc32(crc, pChunk, length);
+    }
+    if(crc != mAppOtaCrc)
+    {
+        return gAppOtaStatusCrc_c;
+    }
+    return AppOta_ImageCommit() ? gAppOtaStatusOk_c : gAppOtaStatusFlash_c;
+}
+
+/*CRC-32/ISO-HDLC, the zlib one, four bits at a time*/
+static uint32_t AppOta_Crc32(uint32_t crc, const uint8_t* pData, uint32_t length)
+{
+    static const uint32_t table[16] =
+    {
+        0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+        0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+    };
+
+    crc = ~crc;
+    while(length--)
+    {
+        crc ^= *pData++;
+        crc = (crc >> 4) ^ table[crc & 0x0FU];
+        crc = (crc >> 4) ^ table[crc & 0x0FU];
+    }
+    return ~crc;
+}
+
+/*broadcast frame over mAppOtaTxData*/
+static void AppOta_Frame(app_frame_t* pFrame, uint8_t command, uint8_t dataLen)
+{
+    FLib_MemSet(pFrame, 0, sizeof(*pFrame));
+    pFrame->devId = gAppFrameBroadcastId_c;
+    pFrame->command = command;
+    pFrame->pData = mAppOtaTxData;
+    pFrame->dataLen = dataLen;
+}
+
+static void AppOta_Put32(uint8_t* pDst, uint32_t value)
+{
+    pDst[0] = (uint8_t)value;
+    pDst[1] = (uint8_t)(value >> 8);
+    pDst[2] = (uint8_t)(value >> 16);
+    pDst[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t AppOta_Get32(const uint8_t* pSrc)
+{
+    return (uint32_t)pSrc[0] | ((uint32_t)pSrc[1] << 8) | ((uint32_t)pSrc[2] << 16) | ((uint32_t)pSrc[3] << 24);
+}
+
+/*xorshift32, spreads the NACK and status slots*/
+static uint32_t AppOta_Random(void)
+{
+    mAppOtaRandom ^= mAppOtaRandom << 13;
+    mAppOtaRandom ^= mAppOtaRandom >> 17;
+    mAppOtaRandom ^= mAppOtaRandom << 5;
+    return mAppOtaRandom;
+}
+
+static void AppOta_PrintStatus(uint8_t devId, uint8_t status)
+{
+    Serial_Print(mAppOtaSerId, "#O,S,", gAllowToBlock_d);
+    Serial_PrintDec(mAppOtaSerId, devId);
+    Serial_Print(mAppOtaSerId, ",", gAllowToBlock_d);
+    Serial_PrintDec(mAppOtaSerId, status);
+    Serial_Print(mAppOtaSerId, "\r\n", gAllowToBlock_d);
+}
+
+#ifdef LEDCONTROL_HOST
+/*! *********************************************************************************
+* \brief  Host backend: loads the storage image file, creating an erased one if
+*         it does not exist.
+*
+********************************************************************************** */
+static bool_t AppOta_BackendInit(void)
+{
+    const char* pPath = getenv("LEDCONTROL_OTA_IMAGE");
+
+    if(pPath == NULL)
+    {
+        pPath = "ledcontrol_ota.bin";
+    }
+    FLib_MemSet(mAppOtaImage, mAppOtaErased_c, sizeof(mAppOtaImage));
+    if(mAppOtaFile != NULL)
+    {
+        fclose(mAppOtaFile);
+    }
+    mAppOtaFile = fopen(pPath, "r+b");
+    if(mAppOtaFile == NULL)
+    {
+        mAppOtaFile = fopen(pPath, "w+b");
+        if(mAppOtaFile == NULL)
+        {
+            return FALSE;
+        }
+    }
+    if(fread(mAppOtaImage, 1, sizeof(mAppOtaImage), mAppOtaFile) != sizeof(mAppOtaImage))
+    {
+        rewind(mAppOtaFile);
+        fwrite(mAppOtaImage, 1, sizeof(mAppOtaImage), mAppOtaFile);
+        fflush(mAppOtaFile);
+    }
+    return TRUE;
+}
+
+static const uint8_t* AppOta_Storage(void)
+{
+    return mAppOtaImage;
+}
+
+static uint32_t AppOta_StorageSize(void)
+{
+    return sizeof(mAppOtaImage);
+}
+
+/*host backend: erased flash reads as 0xFF*/
+static bool_t AppOta_FlashErase(uint32_t offset)
+{
+    FLib_MemSet(&mAppOtaImage[offset], mAppOtaErased_c, gAppOtaPageSize_c);
+    fseek(mAppOtaFile, (long)offset, SEEK_SET);
+    return ((fwrite(&mAppOtaImage[offset], 1, gAppOtaPageSize_c, mAppOtaFile) == gAppOtaPageSize_c) &&
+            (fflush(mAppOtaFile) == 0)) ? TRUE : FALSE;
+}
+
+/*host backend: programming can only clear bits, like flash*/
+static bool_t AppOta_FlashProgram(uint32_t offset, const void* pData, uint32_t length)
+{
+    const uint8_t* pBytes = (const uint8_t*)pData;
+    uint32_t i;
+
+    for(i = 0; i < length; i++)
+    {
+        mAppOtaImage[offset + i] &= pBytes[i];
+    }
+    fseek(mAppOtaFile, (long)offset, SEEK_SET);
+    return ((fwrite(&mAppOtaImage[offset], 1, length, mAppOtaFile) == length) &&
+            (fflush(mAppOtaFile) == 0)) ? TRUE : FALSE;
+}
+
+/*host backend: a slave keeps the image at the start of its file, each
+  sector erased as the image reaches it, like OtaSupport*/
+static bool_t AppOta_ImageStart(uint32_t size)
+{
+    (void)size;
+    mAppOtaPushed = 0;
+    return TRUE;
+}
+
+static bool_t AppOta_ImagePush(const uint8_t* pData, uint32_t length)
+{
+    if(((mAppOtaPushed % gAppOtaPageSize_c) == 0U) && !AppOta_FlashErase(mAppOtaPushed))
+    {
+        return FALSE;
+    }
+    if(!AppOta_FlashProgram(mAppOtaPushed, pData, length))
+    {
+        return FALSE;
+    }
+    mAppOtaPushed += length;
+    return TRUE;
+}
+
+static bool_t AppOta_ImageRead(uint32_t offset, uint8_t* pData, uint32_t length)
+{
+    FLib_MemCpy(pData, &mAppOtaImage[offset], length);
+    return TRUE;
+}
+
+/*host backend: the verified image in the file is the result*/
+static bool_t AppOta_ImageCommit(void)
+{
+    return TRUE;
+}
+
+static void AppOta_ImageCancel(void)
+{
+}
+
+static uint32_t AppOta_NowMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000U) + ((uint64_t)now.tv_nsec / 1000000U));
+}
+
+static void AppOta_Reset(void)
+{
+    fflush(stdout);
+}
+#else
+/*target backend: the internal storage region through the framework flash adapter*/
+static bool_t AppOta_BackendInit(void)
+{
+    NV_Init();
+    return TRUE;
+}
+
+static const uint8_t* AppOta_Storage(void)
+{
+    return (const uint8_t*)INT_STORAGE_START;
+}
+
+static uint32_t AppOta_StorageSize(void)
+{
+    return (uint32_t)INT_STORAGE_SIZE;
+}
+
+static bool_t AppOta_FlashErase(uint32_t offset)
+{
+    return (kStatus_FLASH_Success == NV_FlashEraseSector(&gFlashConfig,
+                                                         (uint32_t)INT_STORAGE_START + offset,
+                                                         gAppOtaPageSize_c)) ? TRUE : FALSE;
+}
+
+static bool_t AppOta_FlashProgram(uint32_t offset, const void* pData, uint32_t length)
+{
+    return (kStatus_FLASH_Success == NV_FlashProgramUnaligned(&gFlashConfig,
+                                                              (uint32_t)INT_STORAGE_START + offset,
+                                                              length, (uint8_t*)pData)) ? TRUE : FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Target backend, slave: starts a new image in the OtaSupport storage
+*         (gEepromType_d internal flash, the same region). OtaSupport takes
+*         the image in order and erases each sector as the image reaches it.
+*
+* \param[in] size  image size in bytes
+*
+* \return  FALSE if OtaSupport refused the image
+*
+********************************************************************************** */
+static bool_t AppOta_ImageStart(uint32_t size)
+{
+    return (gOtaSucess_c == OTA_StartImage(size)) ? TRUE : FALSE;
+}
+
+static bool_t AppOta_ImagePush(const uint8_t* pData, uint32_t length)
+{
+    return (gOtaSucess_c == OTA_PushImageChunk((uint8_t*)pData, (uint16_t)length, NULL, NULL)) ? TRUE : FALSE;
+}
+
+static bool_t AppOta_ImageRead(uint32_t offset, uint8_t* pData, uint32_t length)
+{
+    return (gOtaSucess_c == OTA_ReadExternalMemory(pData, (uint16_t)length,
+                                                   gBootData_Image_Offset_c + offset)) ? TRUE : FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Target backend, slave: commits the verified image and sets the flag
+*         the OTAP bootloader (gUseBootloaderLink_d build) checks on the next
+*         reset. The sector bitmap lets the bootloader overwrite the code
+*         sectors only, below INT_STORAGE_START: the image itself, the NVM
+*         and the product info stay.
+*
+* \return  FALSE if OtaSupport failed
+*
+********************************************************************************** */
+static bool_t AppOta_ImageCommit(void)
+{
+    uint8_t bitmap[gBootData_SectorsBitmap_Size_c];
+    uint32_t sectors = (uint32_t)INT_STORAGE_START / gAppOtaPageSize_c;
+    uint32_t sector;
+
+    FLib_MemSet(bitmap, 0, sizeof(bitmap));
+    for(sector = 0; (sector < sectors) && ((sector >> 3) < sizeof(bitmap)); sector++)
+    {
+        bitmap[sector >> 3] |= (uint8_t)(1U << (sector & 7U));
+    }
+    if(gOtaSucess_c != OTA_CommitImage(bitmap))
+    {
+        return FALSE;
+    }
+    OTA_SetNewImageFlag();
+    return TRUE;
+}
+
+static void AppOta_ImageCancel(void)
+{
+    (void)OTA_CancelImage();
+}
+
+static uint32_t AppOta_NowMs(void)
+{
+    return OSA_TimeGetMsec();
+}
+
+static void AppOta_Reset(void)
+{
+    NVIC_SystemReset();
+}
+#endif
+
+#endif
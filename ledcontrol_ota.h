@@ -0,0 +1,182 @@
+#ifndef _LEDCONTROL_OTA_H_
+#define _LEDCONTROL_OTA_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "ledcontrol_frame.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Over-the-air update, gAppUseOta_d build. The image goes to the master over
+ * the UART (tools/otaload.py, 'o' command) into its internal storage region
+ * (MKW41Z512xxx4_connectivity.ld, gUseInternalStorageLink_d), then to every
+ * joined slave at once:
+ *
+ *   master -> all    'U' session, block length, image size, CRC-32
+ *                    slaves start a new OtaSupport image
+ *   master -> all    'D' block index, up to gAppOtaBlockLen_c image bytes,
+ *                    a block never crosses a flash page
+ *                    gAppOtaWindowBlocks_c blocks per window, then
+ *   master -> all    'Q' session, window, NACK slots
+ *   slave  -> master 'N' session, the first window up to the queried one
+ *                    it misses blocks in and their bitmap, after a random
+ *                    slot; a slave that hears a NACK covering its own gaps
+ *                    stays quiet
+ *                    the master resends the gaps of the lowest window
+ *                    reported and asks again, up to gAppOtaMaxRounds_c
+ *                    times per window; a frame that fails its CRC meanwhile
+ *                    is taken as colliding NACKs, the query is repeated
+ *                    with twice the slots, halved again after a clean
+ *                    round. The last window is queried until
+ *                    gAppOtaRepeat_c rounds in a row stay quiet
+ *   master -> all    'C' session, after the last window
+ *   slave  -> master 'K' session, status, after a random slot
+ *
+ * Slaves collect blocks in two RAM page buffers: while one fills, the page
+ * completed in the other is added to the OtaSupport image in small chunks
+ * from the application task, so the radio is never stalled for a whole
+ * page; OtaSupport takes the pages in order and erases each storage sector
+ * as the image reaches it. On commit a slave checks the CRC-32 of the stored
+ * image, commits it with OTA_CommitImage, sets OTA_SetNewImageFlag and
+ * resets; the NXP OTAP bootloader then copies it over the running one. The
+ * slaves must therefore run behind that bootloader and be linked for it,
+ * like the uploaded image: gUseBootloaderLink_d=1 and the .BootloaderFlags
+ * section OTA_SetNewImageFlag writes, from the SDK bootloader linker files;
+ * MKW41Z512xxx4_connectivity.ld does not have that layout. Nothing is
+ * switched unless the whole image verified.
+ * tools/ledsim.py ota models the transfer for a fleet.
+ */
+
+/*frame commands*/
+#define gAppOtaCmdAnnounce_c         'U'
+#define gAppOtaCmdBlock_c            'D'
+#define gAppOtaCmdQuery_c            'Q'
+#define gAppOtaCmdNack_c             'N'
+#define gAppOtaCmdCommit_c           'C'
+#define gAppOtaCmdStatus_c           'K'
+
+/*gGenFskMaxPayloadLen_c, 6-bit length field*/
+#define gAppOtaMaxPayloadLen_c       (63)
+
+/*image bytes per block: what is left of a full frame after the frame
+  overhead and the block index, in whole flash phrases*/
+#define gAppOtaBlockLen_c            ((gAppOtaMaxPayloadLen_c - gAppFrameRelayLen_c - \
+                                       gAppFrameSecOverhead_c - gAppFramePayloadOverhead_c - 2U) & ~7U)
+
+/*command data of the largest OTA frame, a block*/
+#define gAppOtaMaxDataLen_c          (2U + gAppOtaBlockLen_c)
+
+/*blocks per window, one bit each in a NACK*/
+#define gAppOtaWindowBlocks_c        (32)
+
+/*repair rounds per window before slaves still missing blocks are left behind*/
+#define gAppOtaMaxRounds_c           (8)
+
+/*NACK and status backoff: a slave answers in one of this many slots, the
+  NACK slots double up to gAppOtaMaxNackSlots_c while NACKs collide and
+  halve back after each round without collision*/
+#define gAppOtaSlotMs_c              (2)
+#define gAppOtaNackSlots_c           (8)
+#define gAppOtaMaxNackSlots_c        (128)
+#define gAppOtaStatusSlots_c         (128)
+
+/*announce and commit are repeated, they carry no window of their own; the
+  last window needs as many quiet rounds before the commit*/
+#define gAppOtaRepeat_c              (3)
+
+/*image bytes the application task programs per AppOta_Idle call*/
+#define gAppOtaProgramChunk_c        (64)
+
+/*flash page the RAM buffers hold, m_sector_size*/
+#define gAppOtaPageSize_c            (2048)
+
+/*UART upload: header in front of the image, acked every gAppOtaUartChunk_c bytes*/
+#define gAppOtaUploadMagic_c         (0x544F434CU) /*"LCOT"*/
+#define gAppOtaUartChunk_c           (64)
+
+/*UART command that starts an upload on the master*/
+#define gAppOtaUploadCmd_c           'o'
+
+/*largest image, sizes the block bitmap; the storage region must also hold
+  it and the OtaSupport sector bitmap*/
+#ifndef gAppOtaMaxImageLen_c
+#define gAppOtaMaxImageLen_c         (248U * 1024U)
+#endif
+
+/*an upload that stalls this long is dropped, the UART takes commands again*/
+#define gAppOtaUploadTimeoutMs_c     (2000)
+
+/*host build storage, a file (LEDCONTROL_OTA_IMAGE, default ledcontrol_ota.bin)*/
+#define gAppOtaHostStorageSize_c     (128U * 1024U)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*'K' status of a slave*/
+typedef enum
+{
+    gAppOtaStatusOk_c = 0,      /*verified and committed, the bootloader takes it on the reset*/
+    gAppOtaStatusMissing_c,     /*blocks left behind*/
+    gAppOtaStatusCrc_c,         /*stored image does not match the CRC-32*/
+    gAppOtaStatusFlash_c,       /*erase, program or OtaSupport failed*/
+    gAppOtaStatusTooLarge_c     /*image larger than the storage region*/
+}app_ota_status_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+#if gAppUseOta_d
+/*prepares the storage backend; seed spreads the slot choices of slaves*/
+void AppOta_Init(bool_t isServer, uint32_t seed);
+
+/*master: starts taking an image from the UART, acks go to serId*/
+void AppOta_UploadStart(uint8_t serId);
+
+/*master: TRUE while UART bytes belong to the upload*/
+bool_t AppOta_Uploading(void);
+
+/*master: one UART byte of the upload*/
+void AppOta_UploadByte(uint8_t byte);
+
+/*master: the next frame to broadcast; FALSE if none may go now, *pWaitMs is
+  then the time to call again, 0 if no session is running*/
+bool_t AppOta_ServerNext(app_frame_t* pFrame, uint32_t* pWaitMs);
+
+/*master: a NACK or status frame from a slave*/
+void AppOta_ServerReceive(const app_frame_t* pFrame);
+
+/*master: a frame failed its CRC, NACKs may have collided*/
+void AppOta_ServerGarbled(void);
+
+/*slave: an OTA frame; returns the delay in ms after which AppOta_ClientReply
+  has an answer, 0 if none is due*/
+uint32_t AppOta_ClientReceive(const app_frame_t* pFrame);
+
+/*slave: the answer scheduled by AppOta_ClientReceive, FALSE if it was
+  suppressed; devId is left to the caller*/
+bool_t AppOta_ClientReply(app_frame_t* pFrame);
+
+/*milliseconds until AppOta_Idle has work, gAppNvIdleNever_c if none*/
+uint32_t AppOta_IdleTimeoutMs(void);
+
+/*master: erases a storage sector; slave: stores a chunk of a completed
+  page, resets into a verified image*/
+void AppOta_Idle(void);
+#endif
+
+#endif /* _LEDCONTROL_OTA_H_ */
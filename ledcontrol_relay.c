@@ -0,0 +1,413 @@
+#include "ledcontrol_relay.h"
+#include "ledcontrol_join.h"
+#include "ledcontrol_stats.h"
+
+#include "FunctionLib.h"
+#include "SerialManager.h"
+#include "fsl_os_abstraction.h"
+
+#if gAppUseRelay_d
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+#if (gAppRelayHeaderLen_c != gAppFrameRelayLen_c)
+#error "gAppFrameRelayLen_c does not match the relay header"
+#endif
+
+#if (gAppRelayMaxHops_c >= gAppRelayDepthUnknown_c)
+#error "gAppRelayMaxHops_c must leave room for gAppRelayDepthUnknown_c"
+#endif
+
+/*relay header, first byte*/
+#define mAppRelayUp_c                (0x80U)
+#define mAppRelayDepthShift_c        (4)
+#define mAppRelayDepthMask_c         (0x07U)
+#define mAppRelayHopsMask_c          (0x07U)
+
+/*ages are kept in 256 ms ticks on 15 bits, 0 marks an entry never heard*/
+#define mAppRelayTickShift_c         (8)
+#define mAppRelayTickMask_c          (0x7FFFU)
+#define mAppRelayTimeoutTicks_c      (gAppRelayRouteTimeoutMs_c >> mAppRelayTickShift_c)
+
+/*route entry: the device sits deeper than this node, in the branch it serves*/
+#define mAppRelayRouteBelow_c        (0x8000U)
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+typedef struct app_relay_seen_tag
+{
+    uint8_t devId;
+    uint8_t up;
+    uint8_t frameId;
+}app_relay_seen_t;
+
+typedef struct app_relay_pending_tag
+{
+    app_relay_seen_t key;
+    uint8_t h0;
+    uint8_t h1;
+    uint8_t length;
+    bool_t valid;
+    uint8_t payload[gAppRelayMaxPayloadLen_c];
+}app_relay_pending_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static uint16_t AppRelay_Tick(void);
+static bool_t AppRelay_Fresh(uint16_t stamp, uint16_t now);
+static uint8_t AppRelay_CurrentDepth(uint16_t now);
+static bool_t AppRelay_Seen(const app_relay_seen_t* pKey);
+static void AppRelay_Remember(const app_relay_seen_t* pKey);
+static uint32_t AppRelay_Random(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+static bool_t mAppRelayIsMaster;
+static bool_t mAppRelayForward;
+
+/*own depth and the tick it was last confirmed at*/
+static uint8_t mAppRelayDepth = gAppRelayDepthUnknown_c;
+static uint16_t mAppRelayDepthAt;
+
+/*tick each device was last heard upstream, with mAppRelayRouteBelow_c*/
+static uint16_t mAppRelayRoutes[gAppJoinMaxSlaves_c];
+
+/*frames seen lately, oldest overwritten first*/
+static app_relay_seen_t mAppRelaySeen[gAppRelayDupCacheLen_c];
+static uint8_t mAppRelaySeenHead;
+static uint8_t mAppRelaySeenCount;
+
+static app_relay_pending_t mAppRelayPending;
+
+static uint8_t mAppRelayFrameId;
+static uint32_t mAppRelayRandom;
+
+static app_relay_stats_t mAppRelayStats;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Sets the node role. The master is depth 0 and never forwards.
+*
+* \param[in] isMaster  TRUE on the master
+* \param[in] forward   TRUE on slaves built as relays
+* \param[in] seed      starts the frame ids and the jitter, e.g. from the chip UID,
+*                      so slaves reset together do not pick the same values
+*
+********************************************************************************** */
+void AppRelay_Init(bool_t isMaster, bool_t forward, uint32_t seed)
+{
+    mAppRelayIsMaster = isMaster;
+    mAppRelayForward = (isMaster ? FALSE : forward);
+    mAppRelayDepth = (isMaster ? 0U : gAppRelayDepthUnknown_c);
+    mAppRelayRandom = seed | 1U;
+    mAppRelayFrameId = (uint8_t)AppRelay_Random();
+}
+
+/*! *********************************************************************************
+* \brief  Writes the relay header of a frame this node sends and remembers the
+*         frame, so copies forwarded back to this node are dropped. Call it after
+*         AppFrame_Encode and, in the gAppUseSecLib_d build, AppSec_Protect.
+*
+* \param[in,out] pPacket  encoded packet
+*
+********************************************************************************** */
+void AppRelay_Stamp(GENFSK_packet_t* pPacket)
+{
+    app_relay_seen_t key;
+
+    key.devId = AppFrame_DevId(pPacket);
+    key.up = (mAppRelayIsMaster ? 0U : 1U);
+    key.frameId = mAppRelayFrameId++;
+
+    pPacket->payload[0] = (uint8_t)((key.up ? mAppRelayUp_c : 0U) |
+                                    (AppRelay_CurrentDepth(AppRelay_Tick()) << mAppRelayDepthShift_c));
+    pPacket->payload[1] = key.frameId;
+    AppRelay_Remember(&key);
+}
+
+/*! *********************************************************************************
+* \brief  Learns the depth and the routes from a received frame, then decides
+*         whether this node consumes it, forwards it or drops it. A forward is
+*         copied aside and released by AppRelay_Release after the jitter, unless
+*         a copy from another relay that got as far is heard first.
+*
+* \param[in]  pPacket   packet filled by GENFSK_ByteArrayToPacket, still protected
+* \param[in]  rssi      RSSI of the packet, dBm as a signed byte
+* \param[in]  ownId     own device id, ignored on the master
+* \param[out] pDelayMs  jitter before AppRelay_Release, set on gAppRelayForward_c
+*
+* \return  what to do with the frame
+*
+********************************************************************************** */
+app_relay_action_t AppRelay_Receive(GENFSK_packet_t* pPacket, uint8_t rssi, uint8_t ownId, uint32_t* pDelayMs)
+{
+    uint16_t now = AppRelay_Tick();
+    uint8_t length = (uint8_t)pPacket->header.lengthField;
+    uint8_t depth;
+    uint8_t txDepth;
+    uint8_t hops;
+    bool_t forward = FALSE;
+    bool_t consume = FALSE;
+    app_relay_seen_t key;
+
+    if(length < gAppRelayHeaderLen_c)
+    {
+        return gAppRelayDrop_c;
+    }
+    key.devId = AppFrame_DevId(pPacket);
+    key.up = (pPacket->payload[0] & mAppRelayUp_c) ? 1U : 0U;
+    key.frameId = pPacket->payload[1];
+    txDepth = (pPacket->payload[0] >> mAppRelayDepthShift_c) & mAppRelayDepthMask_c;
+    hops = pPacket->payload[0] & mAppRelayHopsMask_c;
+
+    /*a node one hop closer to the master than any heard so far sets the depth*/
+    depth = AppRelay_CurrentDepth(now);
+    if(!mAppRelayIsMaster && !key.up && (txDepth < gAppRelayMaxHops_c) &&
+       ((int8_t)rssi >= gAppRelayMinRssi_c) && ((txDepth + 1U) <= depth))
+    {
+        mAppRelayDepth = txDepth + 1U;
+        mAppRelayDepthAt = (now ? now : 1U);
+        depth = mAppRelayDepth;
+    }
+
+    if(AppRelay_Seen(&key))
+    {
+        mAppRelayStats.duplicates++;
+        if(mAppRelayPending.valid &&
+           (mAppRelayPending.key.devId == key.devId) &&
+           (mAppRelayPending.key.up == key.up) &&
+           (mAppRelayPending.key.frameId == key.frameId) &&
+           (key.up ? (txDepth <= depth) : (txDepth >= depth)))
+        {
+            /*another relay at least as far along sent it already*/
+            mAppRelayPending.valid = FALSE;
+            mAppRelayStats.suppressed++;
+        }
+        return gAppRelayDrop_c;
+    }
+    AppRelay_Remember(&key);
+
+    if(mAppRelayIsMaster)
+    {
+        return (key.up ? gAppRelayConsume_c : gAppRelayDrop_c);
+    }
+
+    if(key.up)
+    {
+        if(mAppRelayPending.valid && !mAppRelayPending.key.up && (mAppRelayPending.key.devId == key.devId))
+        {
+            /*the destination of the pending forward already answers*/
+            mAppRelayPending.valid = FALSE;
+            mAppRelayStats.suppressed++;
+        }
+        if(key.devId < gAppJoinMaxSlaves_c)
+        {
+            mAppRelayRoutes[key.devId] = (now ? now : 1U) |
+                                         ((txDepth > depth) ? mAppRelayRouteBelow_c : 0U);
+        }
+        forward = (txDepth > depth);
+    }
+    else if(key.devId == ownId)
+    {
+        return gAppRelayConsume_c;
+    }
+    else if(key.devId == gAppFrameBroadcastId_c)
+    {
+        consume = TRUE;
+        forward = (txDepth < depth);
+    }
+    else
+    {
+        forward = (txDepth < depth);
+        if(forward && (key.devId < gAppJoinMaxSlaves_c))
+        {
+            uint16_t route = mAppRelayRoutes[key.devId];
+
+            /*a device heard lately outside this branch is served by another
+              relay, an unknown one is flooded*/
+            if(AppRelay_Fresh(route & mAppRelayTickMask_c, now) && !(route & mAppRelayRouteBelow_c))
+            {
+                forward = FALSE;
+            }
+        }
+    }
+
+    if(!forward || !mAppRelayForward || (depth == gAppRelayDepthUnknown_c) ||
+       (hops >= gAppRelayMaxHops_c))
+    {
+        return (consume ? gAppRelayConsume_c : gAppRelayDrop_c);
+    }
+    if(mAppRelayPending.valid || (length > gAppRelayMaxPayloadLen_c))
+    {
+        mAppRelayStats.overflow++;
+        return (consume ? gAppRelayConsume_c : gAppRelayDrop_c);
+    }
+
+    mAppRelayPending.key = key;
+    mAppRelayPending.h0 = (uint8_t)pPacket->header.h0Field;
+    mAppRelayPending.h1 = (uint8_t)pPacket->header.h1Field;
+    mAppRelayPending.length = length;
+    FLib_MemCpy(mAppRelayPending.payload, pPacket->payload, length);
+    mAppRelayPending.payload[0] = (uint8_t)((key.up ? mAppRelayUp_c : 0U) |
+                                            (depth << mAppRelayDepthShift_c) | (hops + 1U));
+    mAppRelayPending.valid = TRUE;
+    *pDelayMs = 1U + (AppRelay_Random() % gAppRelayJitterMs_c);
+    return (consume ? gAppRelayConsumeForward_c : gAppRelayForward_c);
+}
+
+/*! *********************************************************************************
+* \brief  Hands out the pending forward as a gAppFrameFlagRaw_c frame. The frame
+*         points into the relay state and has to be queued before the next
+*         AppRelay_Receive.
+*
+* \param[out] pFrame  raw frame, H0/H1 in devId and flags
+*
+* \return  FALSE if the forward was suppressed
+*
+********************************************************************************** */
+bool_t AppRelay_Release(app_frame_t* pFrame)
+{
+    if(!mAppRelayPending.valid)
+    {
+        return FALSE;
+    }
+    mAppRelayPending.valid = FALSE;
+    mAppRelayStats.forwarded++;
+
+    FLib_MemSet(pFrame, 0, sizeof(*pFrame));
+    pFrame->devId = mAppRelayPending.h0;
+    pFrame->flags = gAppFrameFlagRaw_c | (mAppRelayPending.h1 & 0x03U);
+    pFrame->pData = mAppRelayPending.payload;
+    pFrame->dataLen = mAppRelayPending.length;
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Current depth of this node.
+*
+* \return  hops to the master, gAppRelayDepthUnknown_c if none was learned lately
+*
+********************************************************************************** */
+uint8_t AppRelay_Depth(void)
+{
+    return AppRelay_CurrentDepth(AppRelay_Tick());
+}
+
+/*! *********************************************************************************
+* \brief  Prints the depth and the forwarding counters:
+*           #Y,depth,forwarded,suppressed,duplicates,overflow
+*           #E,0,cycles
+*         tools/ctstats.py decodes the records.
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppRelay_Dump(uint8_t serId)
+{
+    Serial_Print(serId, "#Y,", gAllowToBlock_d);
+    Serial_PrintDec(serId, AppRelay_Depth());
+    Serial_Print(serId, ",", gAllowToBlock_d);
+    Serial_PrintDec(serId, mAppRelayStats.forwarded);
+    Serial_Print(serId, ",", gAllowToBlock_d);
+    Serial_PrintDec(serId, mAppRelayStats.suppressed);
+    Serial_Print(serId, ",", gAllowToBlock_d);
+    Serial_PrintDec(serId, mAppRelayStats.duplicates);
+    Serial_Print(serId, ",", gAllowToBlock_d);
+    Serial_PrintDec(serId, mAppRelayStats.overflow);
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    Serial_Print(serId, "#E,0,", gAllowToBlock_d);
+    Serial_PrintDec(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*current time in 256 ms ticks, wraps every 2.3 hours*/
+static uint16_t AppRelay_Tick(void)
+{
+    return (uint16_t)((OSA_TimeGetMsec() >> mAppRelayTickShift_c) & mAppRelayTickMask_c);
+}
+
+/*TRUE if an entry stamped at the given tick was heard within the timeout*/
+static bool_t AppRelay_Fresh(uint16_t stamp, uint16_t now)
+{
+    return (stamp != 0U) && (((now - stamp) & mAppRelayTickMask_c) <= mAppRelayTimeoutTicks_c);
+}
+
+/*the learned depth, forgotten when no node closer to the master was heard lately*/
+static uint8_t AppRelay_CurrentDepth(uint16_t now)
+{
+    if(mAppRelayIsMaster)
+    {
+        return 0;
+    }
+    if((mAppRelayDepth != gAppRelayDepthUnknown_c) && !AppRelay_Fresh(mAppRelayDepthAt, now))
+    {
+        mAppRelayDepth = gAppRelayDepthUnknown_c;
+    }
+    return mAppRelayDepth;
+}
+
+/*TRUE if the frame is in the duplicate cache*/
+static bool_t AppRelay_Seen(const app_relay_seen_t* pKey)
+{
+    uint8_t i;
+
+    for(i = 0; i < mAppRelaySeenCount; i++)
+    {
+        const app_relay_seen_t* pSeen = &mAppRelaySeen[i];
+
+        if((pSeen->devId == pKey->devId) && (pSeen->up == pKey->up) && (pSeen->frameId == pKey->frameId))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*adds a frame to the duplicate cache*/
+static void AppRelay_Remember(const app_relay_seen_t* pKey)
+{
+    mAppRelaySeen[mAppRelaySeenHead] = *pKey;
+    mAppRelaySeenHead = (mAppRelaySeenHead + 1U) & (gAppRelayDupCacheLen_c - 1U);
+    if(mAppRelaySeenCount < gAppRelayDupCacheLen_c)
+    {
+        mAppRelaySeenCount++;
+    }
+}
+
+/*xorshift32, spreads the jitter and the first frame id*/
+static uint32_t AppRelay_Random(void)
+{
+    mAppRelayRandom ^= mAppRelayRandom << 13;
+    mAppRelayRandom ^= mAppRelayRandom >> 17;
+    mAppRelayRandom ^= mAppRelayRandom << 5;
+    return mAppRelayRandom;
+}
+
+#endif
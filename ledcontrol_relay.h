@@ -0,0 +1,127 @@
+#ifndef _LEDCONTROL_RELAY_H_
+#define _LEDCONTROL_RELAY_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "ledcontrol_frame.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Multi-hop relaying, gAppUseRelay_d build. Every frame starts with a relay
+ * header, left out of the frame protection because relays rewrite it:
+ *
+ *   bit 7     direction, set on frames towards the master
+ *   bits 6-4  depth of the node that put this copy on air, 0 = master
+ *   bits 2-0  hops travelled
+ *   byte 1    frame id, per originator, for the duplicate cache
+ *
+ * Each slave learns its depth as one more than the lowest depth it hears
+ * downstream frames from at gAppRelayMinRssi_c or better. A slave built with
+ * LEDCONTROL_RELAY also forwards:
+ *   - frames towards the master sent from deeper than itself;
+ *   - frames from the master sent from shallower than itself, unless the
+ *     destination is known to sit in another branch. A relay learns that
+ *     from the upstream frames it hears. Broadcasts, gAppFrameBroadcastId_c,
+ *     are taken by every slave and forwarded on every branch.
+ * Each forward is held for a random jitter and dropped if another relay's
+ * copy is heard first, or an answer from its destination. Every node drops
+ * copies it has already seen.
+ * tools/ledsim.py relay models the same rules on line and grid topologies.
+ */
+
+/*relay header length in front of the frame payload*/
+#define gAppRelayHeaderLen_c         (2)
+
+/*hops a frame may travel, the depth field saturates at gAppRelayDepthUnknown_c*/
+#ifndef gAppRelayMaxHops_c
+#define gAppRelayMaxHops_c           (4)
+#endif
+#define gAppRelayDepthUnknown_c      (7)
+
+/*weakest RSSI, dBm, of a link a depth is learned over*/
+#ifndef gAppRelayMinRssi_c
+#define gAppRelayMinRssi_c           (-85)
+#endif
+
+/*time a learned depth or route stays valid without being heard again*/
+#define gAppRelayRouteTimeoutMs_c    (30000)
+
+/*frames remembered by the duplicate cache, power of two*/
+#define gAppRelayDupCacheLen_c       (16)
+
+/*a forward waits 1 .. gAppRelayJitterMs_c ms, longer than one frame on air*/
+#define gAppRelayJitterMs_c          (4)
+
+/*largest payload a relay forwards, sizes the TX queue entries of relay builds;
+  OTA blocks fill a whole gGenFskMaxPayloadLen_c payload*/
+#if gAppUseOta_d
+#define gAppRelayMaxPayloadLen_c     (63)
+#else
+#define gAppRelayMaxPayloadLen_c     (32)
+#endif
+
+/*UART command that dumps the relay counters*/
+#define gAppRelayDumpCmd_c           'y'
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*what the receiver does with a frame*/
+typedef enum
+{
+    gAppRelayDrop_c = 0,    /*duplicate or not for this node*/
+    gAppRelayConsume_c,     /*hand it to AppFrame_Decode*/
+    gAppRelayForward_c,     /*not for this node, forward pending, see AppRelay_Release*/
+    gAppRelayConsumeForward_c /*broadcast, hand it to AppFrame_Decode and forward it too*/
+}app_relay_action_t;
+
+/*counters printed by AppRelay_Dump*/
+typedef struct app_relay_stats_tag
+{
+    uint32_t forwarded;     /*copies handed to the TX queue*/
+    uint32_t suppressed;    /*forwards dropped, another relay's copy or the answer was heard*/
+    uint32_t duplicates;    /*copies of frames already seen*/
+    uint32_t overflow;      /*forwards dropped, one was already pending or too long*/
+}app_relay_stats_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+#if gAppUseRelay_d
+/*sets the role; seed spreads the frame ids and jitter of slaves*/
+void AppRelay_Init(bool_t isMaster, bool_t forward, uint32_t seed);
+
+/*fills the relay header of a frame this node originates*/
+void AppRelay_Stamp(GENFSK_packet_t* pPacket);
+
+/*learns from a received frame and decides what to do with it; on
+  gAppRelayForward_c and gAppRelayConsumeForward_c *pDelayMs is the jitter
+  after which AppRelay_Release has to be called*/
+app_relay_action_t AppRelay_Receive(GENFSK_packet_t* pPacket, uint8_t rssi, uint8_t ownId, uint32_t* pDelayMs);
+
+/*the pending forward as a raw frame to queue, FALSE if it was suppressed*/
+bool_t AppRelay_Release(app_frame_t* pFrame);
+
+/*current depth, gAppRelayDepthUnknown_c until a downstream frame is heard*/
+uint8_t AppRelay_Depth(void);
+
+/*print the depth and forwarding counters on the given serial interface*/
+void AppRelay_Dump(uint8_t serId);
+#endif
+
+#endif /* _LEDCONTROL_RELAY_H_ */
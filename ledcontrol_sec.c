@@ -0,0 +1,679 @@
+#include "ledcontrol_sec.h"
+#include "ledcontrol_nv.h"
+#include "ledcontrol_join.h"
+#include "ledcontrol_stats.h"
+
+#ifdef LEDCONTROL_HOST
+#include <string.h>
+#define FLib_MemCpy(pDst, pSrc, cBytes)         memcpy((pDst), (pSrc), (cBytes))
+#define FLib_MemInPlaceCpy(pDst, pSrc, cBytes)  memmove((pDst), (pSrc), (cBytes))
+#define FLib_MemSet(pDst, val, cBytes)          memset((pDst), (val), (cBytes))
+#else
+#include "FunctionLib.h"
+#include "SerialManager.h"
+#include "SecLib.h"
+#include "fsl_device_registers.h"
+#endif
+
+#if gAppUseSecLib_d
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+#if ((gAppSecCounterLen_c + gAppSecMicLen_c) != gAppFrameSecOverhead_c)
+#error "gAppFrameSecOverhead_c does not match the protection layout"
+#endif
+
+/*payload bytes left in clear in front of the frame counter: the relay header,
+  rewritten on every hop and so not authenticated, then the authenticated
+  header bytes of the profile*/
+#if (gAppFrameProfile_c == gAppFrameProfileCompact_c)
+#define mAppSecClearLen_c            (gAppFrameRelayLen_c)
+#else
+#define mAppSecClearLen_c            (gAppFrameRelayLen_c + gAppFramePayloadOverhead_c)
+#endif
+
+/*authenticated data: H0, H1 and the clear payload bytes, or the whole frame
+  for join traffic, up to gGenFskMaxPayloadLen_c bytes*/
+#define mAppSecMaxAadLen_c           (2 + 63)
+
+/*sender role, first nonce byte*/
+#define mAppSecRoleSlave_c           (0x00U)
+#define mAppSecRoleMaster_c          (0x01U)
+
+#define mAppSecBlockLen_c            (16)
+
+/*replay state entries, 32-bit counters, held by each of its NVM records*/
+#define mAppSecReplayChunk_c         (gAppNvMaxRecordLen_c / 4)
+
+#if (gAppJoinMaxSlaves_c > (mAppSecReplayChunk_c * gAppNvSecReplayRecords_c))
+#error "gAppJoinMaxSlaves_c exceeds the replay state NVM records"
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+typedef struct app_sec_stats_tag
+{
+    uint32_t count;
+    uint32_t cyclesSum;
+    uint32_t cyclesMax;
+    uint32_t rejected;
+}app_sec_stats_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static uint8_t AppSec_Prepare(const GENFSK_packet_t* pPacket, uint8_t role, uint32_t counter,
+                              uint8_t dataLen, uint8_t* pAad, uint8_t* pNonce, uint8_t* pEncLen);
+static bool_t AppSec_Ccm(uint8_t* pData, uint8_t dataLen, uint8_t* pAad, uint8_t aadLen,
+                         uint8_t* pNonce, uint8_t* pMic, bool_t encrypt);
+static void AppSec_Record(app_sec_op_t op, uint32_t start);
+
+#ifdef LEDCONTROL_HOST
+static void AppSec_AesExpandKey(const uint8_t* pKey);
+static void AppSec_AesEncrypt(const uint8_t* pInput, uint8_t* pOutput);
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*network key, word aligned for the LTC*/
+static uint32_t mAppSecKey[4];
+
+/*next frame counter to send and the first one not yet reserved in NVM; the
+  limit is the RAM copy of the gAppNvSecCounter_c record*/
+static uint32_t mAppSecTxCounter;
+static uint32_t mAppSecCounterLimit;
+
+/*counter of the last frame accepted by AppSec_Unprotect*/
+static uint32_t mAppSecRxCounter;
+
+/*role written into the nonce of frames this node sends and receives*/
+static uint8_t mAppSecTxRole;
+static uint8_t mAppSecRxRole;
+
+static app_sec_stats_t mAppSecStats[gAppSecOpMax_c];
+
+#ifdef LEDCONTROL_HOST
+static const uint8_t mAppSecSbox[256] =
+{
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+/*expanded key, 11 round keys*/
+static uint8_t mAppSecRoundKeys[11 * mAppSecBlockLen_c];
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Loads the network key and restores the frame counter. The counter
+*         resumes at the end of the range reserved before the reset and a new
+*         range is written to NVM before the first frame is protected.
+*
+* \param[in] isMaster  TRUE on the master
+* \param[in] seed      random number, starts the counter of a slave without a
+*                      stored one at a random value, so join requests of new
+*                      slaves, or of one that lost its NVM, do not share
+*                      nonces; 0 on the master
+*
+********************************************************************************** */
+void AppSec_Init(bool_t isMaster, uint32_t seed)
+{
+    static const uint8_t key[mAppSecBlockLen_c] = gAppSecKey_c;
+
+    FLib_MemCpy(mAppSecKey, (void*)key, sizeof(mAppSecKey));
+#ifdef LEDCONTROL_HOST
+    AppSec_AesExpandKey(key);
+#endif
+    mAppSecTxRole = isMaster ? mAppSecRoleMaster_c : mAppSecRoleSlave_c;
+    mAppSecRxRole = isMaster ? mAppSecRoleSlave_c : mAppSecRoleMaster_c;
+
+    AppNv_Register(gAppNvSecCounter_c, &mAppSecCounterLimit, sizeof(mAppSecCounterLimit));
+    if(!AppNv_Restore(gAppNvSecCounter_c))
+    {
+        /*leaves at least 2^31 counters*/
+        mAppSecCounterLimit = (seed & 0x007FFFFFU) << 8;
+    }
+    mAppSecTxCounter = mAppSecCounterLimit;
+    mAppSecCounterLimit += gAppSecCounterReserve_c;
+    (void)AppNv_Flush(gAppNvSecCounter_c);
+}
+
+/*! *********************************************************************************
+* \brief  Inserts the frame counter behind the clear header, encrypts the rest of
+*         the payload in place and appends the MIC. The next counter step is
+*         reserved by AppSec_Idle; only when a burst used up the counters left
+*         before it ran does this wait for the NVM write.
+*
+* \param[in,out] pPacket  packet filled by AppFrame_Encode
+*
+* \return  FALSE if the frame counter could not be persisted, nothing to send
+*
+********************************************************************************** */
+bool_t AppSec_Protect(GENFSK_packet_t* pPacket)
+{
+    uint32_t start = AppStats_GetCycles();
+    uint8_t aad[mAppSecMaxAadLen_c];
+    uint8_t nonce[gAppSecNonceLen_c];
+    uint8_t* pPayload = pPacket->payload;
+    uint8_t length = (uint8_t)pPacket->header.lengthField;
+    uint8_t dataLen = (uint8_t)(length - mAppSecClearLen_c);
+    uint8_t aadLen;
+    uint8_t encLen;
+
+    if(mAppSecTxCounter == mAppSecCounterLimit)
+    {
+        mAppSecCounterLimit += gAppSecCounterReserve_c;
+        if(!AppNv_Flush(gAppNvSecCounter_c))
+        {
+            mAppSecCounterLimit -= gAppSecCounterReserve_c;
+            mAppSecStats[gAppSecOpProtect_c].rejected++;
+            return FALSE;
+        }
+    }
+
+    FLib_MemInPlaceCpy(&pPayload[mAppSecClearLen_c + gAppSecCounterLen_c],
+                       &pPayload[mAppSecClearLen_c], dataLen);
+    pPayload[mAppSecClearLen_c]     = (uint8_t)(mAppSecTxCounter >> 24);
+    pPayload[mAppSecClearLen_c + 1] = (uint8_t)(mAppSecTxCounter >> 16);
+    pPayload[mAppSecClearLen_c + 2] = (uint8_t)(mAppSecTxCounter >> 8);
+    pPayload[mAppSecClearLen_c + 3] = (uint8_t)mAppSecTxCounter;
+
+    aadLen = AppSec_Prepare(pPacket, mAppSecTxRole, mAppSecTxCounter, dataLen, aad, nonce, &encLen);
+    (void)AppSec_Ccm(&pPayload[mAppSecClearLen_c + gAppSecCounterLen_c], encLen, aad, aadLen, nonce,
+                     &pPayload[mAppSecClearLen_c + gAppSecCounterLen_c + dataLen], TRUE);
+    pPacket->header.lengthField = length + gAppFrameSecOverhead_c;
+    mAppSecTxCounter++;
+
+    AppSec_Record(gAppSecOpProtect_c, start);
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Checks the frame counter against the replay state, verifies the MIC
+*         while decrypting in place and removes the counter and MIC, so the
+*         packet looks as AppFrame_Encode left it on the sender.
+*
+* \param[in,out] pPacket       packet filled by GENFSK_ByteArrayToPacket
+* \param[in,out] pNextCounter  lowest counter accepted from the sender, NULL for
+*                              join traffic, checked by the caller against the
+*                              counter AppSec_RxCounter gives
+*
+* \return  FALSE if the frame is malformed, replayed or not authentic
+*
+********************************************************************************** */
+bool_t AppSec_Unprotect(GENFSK_packet_t* pPacket, uint32_t* pNextCounter)
+{
+    uint32_t start = AppStats_GetCycles();
+    uint8_t aad[mAppSecMaxAadLen_c];
+    uint8_t nonce[gAppSecNonceLen_c];
+    uint8_t* pPayload = pPacket->payload;
+    uint8_t length = (uint8_t)pPacket->header.lengthField;
+    uint8_t dataLen;
+    uint8_t aadLen;
+    uint8_t encLen;
+    uint32_t counter;
+
+    if(length < (mAppSecClearLen_c + gAppFrameSecOverhead_c))
+    {
+        mAppSecStats[gAppSecOpUnprotect_c].rejected++;
+        return FALSE;
+    }
+    dataLen = (uint8_t)(length - mAppSecClearLen_c - gAppFrameSecOverhead_c);
+    counter = ((uint32_t)pPayload[mAppSecClearLen_c] << 24) |
+              ((uint32_t)pPayload[mAppSecClearLen_c + 1] << 16) |
+              ((uint32_t)pPayload[mAppSecClearLen_c + 2] << 8) |
+               (uint32_t)pPayload[mAppSecClearLen_c + 3];
+    if(pNextCounter && (counter < *pNextCounter))
+    {
+        mAppSecStats[gAppSecOpUnprotect_c].rejected++;
+        return FALSE;
+    }
+
+    aadLen = AppSec_Prepare(pPacket, mAppSecRxRole, counter, dataLen, aad, nonce, &encLen);
+    if(!AppSec_Ccm(&pPayload[mAppSecClearLen_c + gAppSecCounterLen_c], encLen, aad, aadLen, nonce,
+                   &pPayload[mAppSecClearLen_c + gAppSecCounterLen_c + dataLen], FALSE))
+    {
+        mAppSecStats[gAppSecOpUnprotect_c].rejected++;
+        return FALSE;
+    }
+    FLib_MemInPlaceCpy(&pPayload[mAppSecClearLen_c],
+                       &pPayload[mAppSecClearLen_c + gAppSecCounterLen_c], dataLen);
+    pPacket->header.lengthField = length - gAppFrameSecOverhead_c;
+    if(pNextCounter)
+    {
+        *pNextCounter = counter + 1U;
+    }
+    mAppSecRxCounter = counter;
+
+    AppSec_Record(gAppSecOpUnprotect_c, start);
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Gives the frame counter of the last frame accepted by AppSec_Unprotect,
+*         for join requests whose replay state is kept by the caller.
+*
+* \return  frame counter
+*
+********************************************************************************** */
+uint32_t AppSec_RxCounter(void)
+{
+    return mAppSecRxCounter;
+}
+
+/*! *********************************************************************************
+* \brief  Moves the frame counter up to the floor the master sent with a join
+*         assignment. The new range is not reserved here, in the RX path:
+*         AppSec_Idle, or else AppSec_Protect before the first use, writes it.
+*         Until then the stored counter stays below the floor, a reset meanwhile
+*         only costs another join round.
+*
+* \param[in] minCounter  lowest counter the master accepts from this slave
+*
+* \return  TRUE if the counter was below it
+*
+********************************************************************************** */
+bool_t AppSec_RaiseCounter(uint32_t minCounter)
+{
+    if(minCounter <= mAppSecTxCounter)
+    {
+        return FALSE;
+    }
+    mAppSecTxCounter = minCounter;
+    mAppSecCounterLimit = minCounter;
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Registers the replay state with NVM and restores it, so frames accepted
+*         before a reset are refused after it as well. The state is split over
+*         gAppNvSecReplayRecords_c records like the slave table, a change
+*         rewrites one of them only.
+*
+* \param[in,out] pNextCounters  lowest counter accepted from each peer, kept as
+*                               the RAM copy of the records
+* \param[in]     peers          entries of pNextCounters, 1 on a slave
+*
+********************************************************************************** */
+void AppSec_LoadReplay(uint32_t* pNextCounters, uint32_t peers)
+{
+    uint32_t first;
+
+    for(first = 0; first < peers; first += mAppSecReplayChunk_c)
+    {
+        app_nv_record_t record = (app_nv_record_t)(gAppNvSecReplay_c + (first / mAppSecReplayChunk_c));
+        uint32_t count = peers - first;
+
+        if(count > mAppSecReplayChunk_c)
+        {
+            count = mAppSecReplayChunk_c;
+        }
+        AppNv_Register(record, &pNextCounters[first], (uint16_t)(count * sizeof(uint32_t)));
+        if(!AppNv_Restore(record))
+        {
+            FLib_MemSet(&pNextCounters[first], 0, count * sizeof(uint32_t));
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Marks the replay state of a peer for the next AppNv_Idle. Called for
+*         the frames a replay would act on again, not for every frame, so
+*         presence traffic alone does not wear the flash; the record written
+*         holds the latest counters of all its peers.
+*
+* \param[in] peer  index into the array given to AppSec_LoadReplay
+*
+********************************************************************************** */
+void AppSec_SaveReplay(uint32_t peer)
+{
+    AppNv_SaveOnIdle((app_nv_record_t)(gAppNvSecReplay_c + (peer / mAppSecReplayChunk_c)));
+}
+
+/*! *********************************************************************************
+* \brief  Reserves the next gAppSecCounterReserve_c frame counters once no more
+*         than gAppSecCounterLowWater_c are left, so the NVM write, possibly
+*         with a sector erase, happens here rather than in AppSec_Protect. A
+*         failed write is retried on the next call.
+*
+********************************************************************************** */
+void AppSec_Idle(void)
+{
+    if((mAppSecCounterLimit - mAppSecTxCounter) > gAppSecCounterLowWater_c)
+    {
+        return;
+    }
+    mAppSecCounterLimit += gAppSecCounterReserve_c;
+    if(!AppNv_Flush(gAppNvSecCounter_c))
+    {
+        mAppSecCounterLimit -= gAppSecCounterReserve_c;
+    }
+}
+
+#ifndef LEDCONTROL_HOST
+/*! *********************************************************************************
+* \brief  Prints the time spent protecting and unprotecting frames, next to the
+*         air time of the shortest protected frame:
+*           #C,cyclesPerSecond
+*           #K,op,count,cyclesSum,cyclesMax,rejected,airUs   one per app_sec_op_t
+*           #E,0,cycles
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppSec_Dump(uint8_t serId)
+{
+    uint32_t op;
+
+    Serial_Print(serId, "#C,", gAllowToBlock_d);
+    Serial_PrintDec(serId, SystemCoreClock);
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    for(op = 0; op < gAppSecOpMax_c; op++)
+    {
+        Serial_Print(serId, "#K,", gAllowToBlock_d);
+        Serial_PrintDec(serId, op);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppSecStats[op].count);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppSecStats[op].cyclesSum);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppSecStats[op].cyclesMax);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppSecStats[op].rejected);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, gAppFrameAirTimeUs_c(0));
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+    Serial_Print(serId, "#E,0,", gAllowToBlock_d);
+    Serial_PrintDec(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Builds the CCM nonce and authenticated data of a frame whose counter is
+*         already in place.
+*
+* \param[in]  pPacket  packet, clear header in place
+* \param[in]  role     role of the node that sent the frame
+* \param[in]  counter  frame counter
+* \param[in]  dataLen  bytes behind the frame counter, MIC excluded
+* \param[out] pAad     authenticated data, mAppSecMaxAadLen_c bytes
+* \param[out] pNonce   gAppSecNonceLen_c bytes
+* \param[out] pEncLen  bytes to encrypt behind the counter, 0 for join traffic
+*
+* \return  authenticated data length
+*
+********************************************************************************** */
+static uint8_t AppSec_Prepare(const GENFSK_packet_t* pPacket, uint8_t role, uint32_t counter,
+                              uint8_t dataLen, uint8_t* pAad, uint8_t* pNonce, uint8_t* pEncLen)
+{
+    const uint8_t* pPayload = pPacket->payload;
+    uint8_t devId = AppFrame_DevId(pPacket);
+    uint8_t aadLen = 0;
+    uint8_t i;
+
+    pNonce[0] = role;
+    pNonce[1] = devId;
+    pNonce[2] = (uint8_t)(counter >> 24);
+    pNonce[3] = (uint8_t)(counter >> 16);
+    pNonce[4] = (uint8_t)(counter >> 8);
+    pNonce[5] = (uint8_t)counter;
+    for(i = 6; i < gAppSecNonceLen_c; i++)
+    {
+        pNonce[i] = 0;
+    }
+
+    pAad[aadLen++] = (uint8_t)pPacket->header.h0Field;
+    pAad[aadLen++] = (uint8_t)pPacket->header.h1Field;
+    FLib_MemCpy(&pAad[aadLen], (void*)&pPayload[gAppFrameRelayLen_c], mAppSecClearLen_c - gAppFrameRelayLen_c);
+    aadLen += mAppSecClearLen_c - gAppFrameRelayLen_c;
+
+    *pEncLen = dataLen;
+    if(devId == gAppFrameUnassignedId_c)
+    {
+        /*the chip UID is needed in clear to answer, authenticate it only*/
+        FLib_MemCpy(&pAad[aadLen], (void*)&pPayload[mAppSecClearLen_c + gAppSecCounterLen_c], dataLen);
+        aadLen += dataLen;
+        *pEncLen = 0;
+    }
+    return aadLen;
+}
+
+/*! *********************************************************************************
+* \brief  AES-128-CCM with a gAppSecMicLen_c byte MIC, in place.
+*
+* \param[in,out] pData    plaintext in, ciphertext out, or the reverse
+* \param[in]     dataLen  bytes to encrypt or decrypt, may be 0
+* \param[in]     pAad     authenticated data
+* \param[in]     aadLen   authenticated data length
+* \param[in]     pNonce   gAppSecNonceLen_c bytes
+* \param[in,out] pMic     written when encrypting, checked when decrypting
+* \param[in]     encrypt  direction
+*
+* \return  FALSE if the MIC does not match
+*
+********************************************************************************** */
+#ifdef LEDCONTROL_HOST
+static bool_t AppSec_Ccm(uint8_t* pData, uint8_t dataLen, uint8_t* pAad, uint8_t aadLen,
+                         uint8_t* pNonce, uint8_t* pMic, bool_t encrypt)
+{
+    uint8_t mac[mAppSecBlockLen_c];
+    uint8_t ctr[mAppSecBlockLen_c];
+    uint8_t stream[mAppSecBlockLen_c];
+    uint8_t block[mAppSecBlockLen_c];
+    uint8_t diff = 0;
+    uint32_t pos;
+    uint8_t i;
+
+    /*counter blocks A_i: L - 1, nonce, i*/
+    ctr[0] = (uint8_t)(mAppSecBlockLen_c - 2 - gAppSecNonceLen_c);
+    FLib_MemCpy(&ctr[1], pNonce, gAppSecNonceLen_c);
+
+    /*B_0: Adata, (M - 2) / 2, L - 1, nonce, message length*/
+    mac[0] = (uint8_t)(((aadLen) ? 0x40U : 0U) | (((gAppSecMicLen_c - 2) / 2) << 3) | ctr[0]);
+    FLib_MemCpy(&mac[1], pNonce, gAppSecNonceLen_c);
+    mac[14] = 0;
+    mac[15] = dataLen;
+    AppSec_AesEncrypt(mac, mac);
+
+    /*authenticated data, prefixed with its 16-bit length*/
+    if(aadLen)
+    {
+        pos = 0;
+        i = 2;
+        mac[1] ^= aadLen;
+        while(pos < aadLen)
+        {
+            for(; (i < mAppSecBlockLen_c) && (pos < aadLen); i++)
+            {
+                mac[i] ^= pAad[pos++];
+            }
+            AppSec_AesEncrypt(mac, mac);
+            i = 0;
+        }
+    }
+
+    /*CTR from A_1 over the data, CBC-MAC over the plaintext*/
+    for(pos = 0; pos < dataLen; pos += mAppSecBlockLen_c)
+    {
+        uint8_t n = (uint8_t)(((dataLen - pos) < mAppSecBlockLen_c) ? (dataLen - pos) : mAppSecBlockLen_c);
+
+        ctr[14] = 0;
+        ctr[15] = (uint8_t)((pos / mAppSecBlockLen_c) + 1U);
+        AppSec_AesEncrypt(ctr, stream);
+        for(i = 0; i < n; i++)
+        {
+            block[i] = encrypt ? pData[pos + i] : (uint8_t)(pData[pos + i] ^ stream[i]);
+            pData[pos + i] ^= stream[i];
+            mac[i] ^= block[i];
+        }
+        AppSec_AesEncrypt(mac, mac);
+    }
+
+    /*MIC = T xor S_0*/
+    ctr[14] = 0;
+    ctr[15] = 0;
+    AppSec_AesEncrypt(ctr, stream);
+    for(i = 0; i < gAppSecMicLen_c; i++)
+    {
+        mac[i] ^= stream[i];
+        if(encrypt)
+        {
+            pMic[i] = mac[i];
+        }
+        else
+        {
+            diff |= (uint8_t)(pMic[i] ^ mac[i]);
+        }
+    }
+    return (diff == 0) ? TRUE : FALSE;
+}
+#else
+static bool_t AppSec_Ccm(uint8_t* pData, uint8_t dataLen, uint8_t* pAad, uint8_t aadLen,
+                         uint8_t* pNonce, uint8_t* pMic, bool_t encrypt)
+{
+    return (gSecSuccess_c == AES_128_CCM(pData, dataLen, pAad, aadLen, pNonce, gAppSecNonceLen_c,
+                                         (uint8_t*)mAppSecKey, pData, pMic, gAppSecMicLen_c,
+                                         encrypt ? gSecLib_CCM_Encrypt_c : gSecLib_CCM_Decrypt_c)) ? TRUE : FALSE;
+}
+#endif
+
+/*adds one operation to the overhead statistics*/
+static void AppSec_Record(app_sec_op_t op, uint32_t start)
+{
+    uint32_t cycles = AppStats_GetCycles() - start;
+
+    mAppSecStats[op].count++;
+    mAppSecStats[op].cyclesSum += cycles;
+    if(cycles > mAppSecStats[op].cyclesMax)
+    {
+        mAppSecStats[op].cyclesMax = cycles;
+    }
+}
+
+#ifdef LEDCONTROL_HOST
+/*GF(2^8) multiplication by x*/
+static uint8_t AppSec_Xtime(uint8_t a)
+{
+    return (uint8_t)((a << 1) ^ ((a & 0x80U) ? 0x1BU : 0x00U));
+}
+
+/*! *********************************************************************************
+* \brief  Host build: AES-128 key expansion, done once.
+*
+********************************************************************************** */
+static void AppSec_AesExpandKey(const uint8_t* pKey)
+{
+    uint8_t rcon = 0x01;
+    uint8_t temp[4];
+    uint8_t t;
+    uint32_t i;
+
+    FLib_MemCpy(mAppSecRoundKeys, pKey, mAppSecBlockLen_c);
+    for(i = mAppSecBlockLen_c; i < sizeof(mAppSecRoundKeys); i += 4)
+    {
+        FLib_MemCpy(temp, &mAppSecRoundKeys[i - 4], 4);
+        if((i % mAppSecBlockLen_c) == 0)
+        {
+            t = temp[0];
+            temp[0] = (uint8_t)(mAppSecSbox[temp[1]] ^ rcon);
+            temp[1] = mAppSecSbox[temp[2]];
+            temp[2] = mAppSecSbox[temp[3]];
+            temp[3] = mAppSecSbox[t];
+            rcon = AppSec_Xtime(rcon);
+        }
+        mAppSecRoundKeys[i]     = mAppSecRoundKeys[i - 16] ^ temp[0];
+        mAppSecRoundKeys[i + 1] = mAppSecRoundKeys[i - 15] ^ temp[1];
+        mAppSecRoundKeys[i + 2] = mAppSecRoundKeys[i - 14] ^ temp[2];
+        mAppSecRoundKeys[i + 3] = mAppSecRoundKeys[i - 13] ^ temp[3];
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Host build: encrypts one block with the expanded key, pInput and
+*         pOutput may be the same buffer.
+*
+********************************************************************************** */
+static void AppSec_AesEncrypt(const uint8_t* pInput, uint8_t* pOutput)
+{
+    uint8_t state[mAppSecBlockLen_c];
+    uint8_t shifted[mAppSecBlockLen_c];
+    uint8_t round;
+    uint8_t i;
+
+    for(i = 0; i < mAppSecBlockLen_c; i++)
+    {
+        state[i] = pInput[i] ^ mAppSecRoundKeys[i];
+    }
+    for(round = 1; round <= 10; round++)
+    {
+        /*SubBytes and ShiftRows, the state is stored column by column*/
+        for(i = 0; i < mAppSecBlockLen_c; i++)
+        {
+            shifted[i] = mAppSecSbox[state[(i + 4 * (i & 3)) & 15]];
+        }
+        for(i = 0; (round < 10) && (i < mAppSecBlockLen_c); i += 4)
+        {
+            uint8_t all = shifted[i] ^ shifted[i + 1] ^ shifted[i + 2] ^ shifted[i + 3];
+            uint8_t first = shifted[i];
+
+            state[i]     = shifted[i]     ^ all ^ AppSec_Xtime(shifted[i] ^ shifted[i + 1]);
+            state[i + 1] = shifted[i + 1] ^ all ^ AppSec_Xtime(shifted[i + 1] ^ shifted[i + 2]);
+            state[i + 2] = shifted[i + 2] ^ all ^ AppSec_Xtime(shifted[i + 2] ^ shifted[i + 3]);
+            state[i + 3] = shifted[i + 3] ^ all ^ AppSec_Xtime(shifted[i + 3] ^ first);
+        }
+        if(round == 10)
+        {
+            FLib_MemCpy(state, shifted, mAppSecBlockLen_c);
+        }
+        for(i = 0; i < mAppSecBlockLen_c; i++)
+        {
+            state[i] ^= mAppSecRoundKeys[(round * mAppSecBlockLen_c) + i];
+        }
+    }
+    FLib_MemCpy(pOutput, state, mAppSecBlockLen_c);
+}
+#endif
+
+#endif /* gAppUseSecLib_d */
@@ -0,0 +1,132 @@
+#ifndef _LEDCONTROL_SEC_H_
+#define _LEDCONTROL_SEC_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "ledcontrol_frame.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Frame protection, gAppUseSecLib_d build. Every frame is encoded as usual
+ * and then protected in place in the packet payload with AES-128-CCM under
+ * the network key:
+ *
+ *   clear header | frame counter | encrypted frame fields and data | MIC
+ *
+ * The clear header is what the profile needs to route the frame (H0/H1 in
+ * the compact profile, device id, command and flags in the legacy one); it is
+ * authenticated with the rest. The relay header of the gAppUseRelay_d build
+ * comes first and is neither encrypted nor authenticated. Join frames,
+ * addressed to gAppFrameUnassignedId_c, are authenticated only. The CCM
+ * nonce is made of the sender role, the device id and the frame counter, so
+ * each sender keeps one counter and never reuses it: the counter is persisted
+ * in NVM in steps of gAppSecCounterReserve_c before it is used, the next step
+ * by AppSec_Idle while gAppSecCounterLowWater_c counters are still left. A
+ * receiver accepts a counter only above the last one it accepted from that
+ * peer. That replay state is kept in NVM too, written on idle after the
+ * frames whose replay would act again (AppSec_SaveReplay), so a reset does
+ * not let recorded commands or acks in again. A slave that lost its NVM
+ * starts over at a random counter and is raised above the ones it used
+ * before by the join handshake (ledcontrol_join.h), so it does not reuse a
+ * nonce under its id.
+ *
+ * The target uses SecLib's AES_128_CCM, which runs on the KW41Z LTC; the LTC
+ * derives the round keys itself, the key is only kept word aligned in RAM.
+ * The LEDCONTROL_HOST build uses a software AES with the key schedule
+ * expanded once by AppSec_Init.
+ */
+
+/*bytes the protection adds to a frame*/
+#define gAppSecCounterLen_c          (4)
+#define gAppSecMicLen_c              (4)
+
+/*CCM nonce length, 2 byte length field*/
+#define gAppSecNonceLen_c            (13)
+
+/*128-bit network key shared by every node, override it per deployment*/
+#ifndef gAppSecKey_c
+#define gAppSecKey_c                 {0x4C, 0x45, 0x44, 0x43, 0x6F, 0x6E, 0x74, 0x72, \
+                                      0x6F, 0x6C, 0x20, 0x64, 0x65, 0x76, 0x20, 0x6B}
+#endif
+
+/*frame counters reserved by each NVM write of the counter*/
+#define gAppSecCounterReserve_c      (256)
+
+/*counters left when AppSec_Idle reserves the next step; only a burst longer
+  than this between two idle calls waits for the write in AppSec_Protect*/
+#define gAppSecCounterLowWater_c     (64)
+
+/*counters a slave that lost its NVM skips past the last one the master
+  accepted from it, covering the frames that never reached the master*/
+#define gAppSecRejoinSkip_c          (0x10000U)
+
+/*UART command that dumps the protection overhead*/
+#define gAppSecDumpCmd_c             'k'
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*operations timed by the overhead statistics*/
+typedef enum
+{
+    gAppSecOpProtect_c = 0,
+    gAppSecOpUnprotect_c,
+    gAppSecOpMax_c
+}app_sec_op_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+#if gAppUseSecLib_d
+/*loads the key and the frame counter, after AppNv_Init and SecLib_Init. seed
+  is a random number starting the counter when none is stored, 0 on the master*/
+void AppSec_Init(bool_t isMaster, uint32_t seed);
+
+/*protects an encoded frame in place, the payload buffer must have room for
+  the protection overhead; FALSE if no frame counter could be reserved*/
+bool_t AppSec_Protect(GENFSK_packet_t* pPacket);
+
+/*verifies and decrypts a received frame in place, leaving it ready for
+  AppFrame_Decode. pNextCounter is the lowest counter accepted from the peer,
+  advanced on success; NULL skips the replay check*/
+bool_t AppSec_Unprotect(GENFSK_packet_t* pPacket, uint32_t* pNextCounter);
+
+/*frame counter of the last frame AppSec_Unprotect accepted*/
+uint32_t AppSec_RxCounter(void);
+
+/*slave: moves the frame counter up to minCounter, the floor of a join
+  assignment; FALSE if it was there already*/
+bool_t AppSec_RaiseCounter(uint32_t minCounter);
+
+/*registers the lowest counters accepted from peers, pNextCounters[peers], with
+  NVM and restores them, 0 for a peer none is stored for; after AppSec_Init*/
+void AppSec_LoadReplay(uint32_t* pNextCounters, uint32_t peers);
+
+/*the replay state of a peer must survive a reset, written on the next AppNv_Idle*/
+void AppSec_SaveReplay(uint32_t peer);
+
+/*reserves the next frame counter step ahead of time, from the application task*/
+void AppSec_Idle(void);
+
+#ifndef LEDCONTROL_HOST
+/*print the protection overhead on the given serial interface*/
+void AppSec_Dump(uint8_t serId);
+#endif
+#endif
+
+#endif /* _LEDCONTROL_SEC_H_ */
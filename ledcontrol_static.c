@@ -0,0 +1,58 @@
+#include "ledcontrol_static.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*kernel owned tasks, sized by FreeRTOSConfig.h*/
+static StaticTask_t mIdleTaskTcb APP_STATIC_RTOS;
+static StackType_t mIdleTaskStack[configMINIMAL_STACK_SIZE] APP_STATIC_RTOS;
+
+#if (configUSE_TIMERS == 1)
+static StaticTask_t mTimerTaskTcb APP_STATIC_RTOS;
+static StackType_t mTimerTaskStack[configTIMER_TASK_STACK_DEPTH] APP_STATIC_RTOS;
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Provides the idle task memory when configSUPPORT_STATIC_ALLOCATION is set.
+*
+********************************************************************************** */
+void vApplicationGetIdleTaskMemory(StaticTask_t** ppxIdleTaskTCBBuffer,
+                                   StackType_t** ppxIdleTaskStackBuffer,
+                                   uint32_t* pulIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &mIdleTaskTcb;
+    *ppxIdleTaskStackBuffer = mIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+#if (configUSE_TIMERS == 1)
+/*! *********************************************************************************
+* \brief  Provides the timer service task memory when configSUPPORT_STATIC_ALLOCATION
+*         is set. The timer command queue is then created statically by the kernel.
+*
+********************************************************************************** */
+void vApplicationGetTimerTaskMemory(StaticTask_t** ppxTimerTaskTCBBuffer,
+                                    StackType_t** ppxTimerTaskStackBuffer,
+                                    uint32_t* pulTimerTaskStackSize)
+{
+    *ppxTimerTaskTCBBuffer = &mTimerTaskTcb;
+    *ppxTimerTaskStackBuffer = mTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
@@ -0,0 +1,41 @@
+#ifndef _LEDCONTROL_STATIC_H_
+#define _LEDCONTROL_STATIC_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Places a zero-initialised object in the per-subsystem .bss.app_<subsystem>
+ * input section. MKW41Z512xxx4_connectivity.ld groups these inside .bss and
+ * exports __app_<subsystem>_start__/__app_<subsystem>_end__ so the map file and
+ * tools/ramreport.py can report the RAM used by each subsystem.
+ */
+#define APP_STATIC_SECTION(subsystem) __attribute__((section(".bss.app_" #subsystem)))
+
+/*subsystems known to the linker script*/
+#define APP_STATIC_RADIO  APP_STATIC_SECTION(radio)
+#define APP_STATIC_RTOS   APP_STATIC_SECTION(rtos)
+#define APP_STATIC_STATS  APP_STATIC_SECTION(stats)
+
+/*
+ * Runs a function from SRAM, gAppUseRamFunc_d build: the function goes to the
+ * .ramfunc.app input section, which MKW41Z512xxx4_connectivity.ld keeps in
+ * flash and the startup copies to RAM along with .data. Calls between flash
+ * and SRAM are out of BL range, the linker adds long branch veneers. Meant for
+ * the few functions between a radio interrupt and the next GENFSK_StartRx;
+ * __ramfunc_size__ in the map file and tools/ramreport.py give the RAM cost.
+ * The choice of functions is not measured yet: their Thumb size and the 'h'
+ * latency histograms of both builds are still to be compared before the
+ * list grows.
+ */
+#if gAppUseRamFunc_d && !defined(LEDCONTROL_HOST)
+#define APP_RAMFUNC __attribute__((section(".ramfunc.app"), noinline))
+#else
+#define APP_RAMFUNC
+#endif
+
+#endif /* _LEDCONTROL_STATIC_H_ */
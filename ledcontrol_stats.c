@@ -0,0 +1,624 @@
+#include "ledcontrol_stats.h"
+#include "ledcontrol_static.h"
+
+#ifdef LEDCONTROL_HOST
+#include <stdio.h>
+#include <time.h>
+#else
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MemManager.h"
+#include "SerialManager.h"
+#include "fsl_os_abstraction.h"
+#include "fsl_device_registers.h"
+#endif
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#ifdef LEDCONTROL_HOST
+/*the host build prints the records on stdout, counts nanoseconds and has no
+  interrupts to mask, the probes run on the caller's thread*/
+#define Serial_Print(serId, pString, allowToBlock)  ((void)(serId), (void)fputs((pString), stdout))
+#define Serial_PrintDec(serId, value)              ((void)(serId), (void)printf("%u", (unsigned int)(value)))
+#define OSA_InterruptDisable()
+#define OSA_InterruptEnable()
+#define mAppStatsCyclesPerSecond_c                 (1000000000U)
+#else
+#define mAppStatsCyclesPerSecond_c                 (SystemCoreClock)
+#endif
+
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+#if gAppUseRunTimeStats_d || gAppUseMemStats_d
+typedef struct app_stats_pool_tag
+{
+    uint16_t blockSize;
+    uint16_t numBlocks;
+}app_stats_pool_t;
+#endif
+
+#if gAppUseMemStats_d
+/*usage profile of one MEM pool*/
+typedef struct app_stats_pool_usage_tag
+{
+    uint16_t peakUsed;    /*most blocks seen allocated at once*/
+    uint16_t maxRequest;  /*largest App_BufferAlloc request served by this pool*/
+    uint32_t requests;
+    uint32_t failures;
+}app_stats_pool_usage_t;
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+#ifndef LEDCONTROL_HOST
+static uint32_t AppStats_ReadSysTick(uint32_t* pCyclesInTick);
+#endif
+#if gAppUseRunTimeStats_d || gAppUseLatencyStats_d || gAppUseMemStats_d
+static void AppStats_PrintTag(uint8_t serId, char* pTag);
+static void AppStats_PrintField(uint8_t serId, uint32_t value);
+#endif
+#if gAppUseRunTimeStats_d || gAppUseMemStats_d
+static uint16_t AppStats_PoolFree(uint32_t pool);
+#endif
+#if gAppUseLatencyStats_d
+static void AppStats_LatencyRecord(app_stats_latency_t probe, uint32_t cycles);
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+#if gAppUseRunTimeStats_d || gAppUseMemStats_d
+/*pool layout, expanded from the same PoolsDetails_c the MemManager uses*/
+#undef _block_size_
+#undef _number_of_blocks_
+#undef _eol_
+#define _block_size_        {
+#define _number_of_blocks_  ,
+#define _eol_               },
+static const app_stats_pool_t mAppStatsPools[] = { PoolsDetails_c };
+#undef _block_size_
+#undef _number_of_blocks_
+#undef _eol_
+
+#define mAppStatsPoolCount_c (sizeof(mAppStatsPools) / sizeof(mAppStatsPools[0]))
+#endif
+
+#if gAppUseMemStats_d
+static app_stats_pool_usage_t mAppStatsPoolUsage[mAppStatsPoolCount_c] APP_STATIC_STATS;
+/*histogram of requested sizes, class i counts requests of (16*i, 16*(i+1)] bytes,
+  the last class everything larger*/
+static uint32_t mAppStatsMemClasses[gAppStatsMemClasses_c] APP_STATIC_STATS;
+#endif
+
+#if gAppUseRunTimeStats_d
+/*scratch area for uxTaskGetSystemState, only used by the dump*/
+static TaskStatus_t mAppStatsTasks[gAppStatsMaxTasks_c] APP_STATIC_STATS;
+#endif
+
+#if gAppUseLatencyStats_d
+/*stamp taken in the RX callback, valid while mAppLatRxPending is set*/
+static volatile uint32_t mAppLatRxStamp;
+static volatile bool_t mAppLatRxPending;
+/*stamps taken when App_HandleEvents picked the RX event up*/
+static uint32_t mAppLatDispatchStamp;
+static uint32_t mAppLatDispatchRxStamp;
+/*RX stamp of the oldest frame waiting for an answer, gAppLatRxToTx_c*/
+static uint32_t mAppLatReplyRxStamp;
+static bool_t mAppLatReplyOwed;
+
+static uint32_t mAppLatHist[gAppLatMax_c][gAppStatsLatencyBuckets_c] APP_STATIC_STATS;
+static uint32_t mAppBootStamps[gAppBootMax_c] APP_STATIC_STATS;
+static uint32_t mAppLatMax[gAppLatMax_c] APP_STATIC_STATS;
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+************************************************************************************/
+#if gAppUseRunTimeStats_d
+app_stats_radio_t gAppStatsRadio APP_STATIC_STATS;
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Returns the number of core clock cycles since the scheduler started.
+*         The Cortex-M0+ has no DWT cycle counter, so the value is built from the
+*         RTOS tick count and the current SysTick value. Wraps every 2^32 cycles.
+*
+********************************************************************************** */
+#ifdef LEDCONTROL_HOST
+uint32_t AppStats_GetCycles(void)
+{
+    struct timespec now;
+
+    /*nanoseconds on the host build*/
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec);
+}
+#else
+uint32_t AppStats_GetCycles(void)
+{
+    uint32_t cyclesInTick;
+    uint32_t ticks = AppStats_ReadSysTick(&cyclesInTick);
+
+    return (ticks * (SysTick->LOAD + 1U)) + cyclesInTick;
+}
+#endif
+
+#if gAppUseRunTimeStats_d
+/*! *********************************************************************************
+* \brief  FreeRTOS run time counter (portGET_RUN_TIME_COUNTER_VALUE). Same time base
+*         as AppStats_GetCycles, scaled down by gAppStatsRunTimeShift_c so the
+*         per-task totals do not wrap within a measurement session.
+*
+********************************************************************************** */
+uint32_t AppStats_GetRunTimeCounter(void)
+{
+    uint32_t cyclesInTick;
+    uint32_t ticks = AppStats_ReadSysTick(&cyclesInTick);
+
+    return (ticks * ((SysTick->LOAD + 1U) >> gAppStatsRunTimeShift_c)) +
+           (cyclesInTick >> gAppStatsRunTimeShift_c);
+}
+
+/*! *********************************************************************************
+* \brief  Prints one CSV record per line, each starting with '#' and a record type:
+*           #T,name,runTime,permille,stackFreeBytes   one per task
+*           #R,rxDone,rxCrcError,rxFailed,rxTimeout,txDone
+*           #M,blockSize,numBlocks,freeBlocks         one per MEM pool
+*           #E,totalRunTime,cycles                    end of dump
+*         tools/ctstats.py decodes the records and computes CPU load between dumps.
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppStats_Dump(uint8_t serId)
+{
+    uint32_t totalRunTime = 0;
+    UBaseType_t nTasks;
+    UBaseType_t i;
+
+    nTasks = uxTaskGetSystemState(mAppStatsTasks, gAppStatsMaxTasks_c, &totalRunTime);
+
+    for(i = 0; i < nTasks; i++)
+    {
+        uint32_t permille = 0;
+
+        if(totalRunTime)
+        {
+            permille = (uint32_t)(((uint64_t)mAppStatsTasks[i].ulRunTimeCounter * 1000U) / totalRunTime);
+        }
+        AppStats_PrintTag(serId, "#T,");
+        Serial_Print(serId, (char*)mAppStatsTasks[i].pcTaskName, gAllowToBlock_d);
+        AppStats_PrintField(serId, mAppStatsTasks[i].ulRunTimeCounter);
+        AppStats_PrintField(serId, permille);
+        AppStats_PrintField(serId, mAppStatsTasks[i].usStackHighWaterMark * sizeof(StackType_t));
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+
+    AppStats_PrintTag(serId, "#R");
+    AppStats_PrintField(serId, gAppStatsRadio.rxDone);
+    AppStats_PrintField(serId, gAppStatsRadio.rxCrcError);
+    AppStats_PrintField(serId, gAppStatsRadio.rxFailed);
+    AppStats_PrintField(serId, gAppStatsRadio.rxTimeout);
+    AppStats_PrintField(serId, gAppStatsRadio.txDone);
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+
+    for(i = 0; i < mAppStatsPoolCount_c; i++)
+    {
+        AppStats_PrintTag(serId, "#M");
+        AppStats_PrintField(serId, mAppStatsPools[i].blockSize);
+        AppStats_PrintField(serId, mAppStatsPools[i].numBlocks);
+        AppStats_PrintField(serId, AppStats_PoolFree(i));
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+
+    AppStats_PrintTag(serId, "#E");
+    AppStats_PrintField(serId, totalRunTime);
+    AppStats_PrintField(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+#endif
+
+#if gAppUseMemStats_d
+/*! *********************************************************************************
+* \brief  Allocates a MEM buffer like MEM_BufferAlloc and records the request size,
+*         the pool expected to serve it and whether the allocation failed.
+*
+* \param[in]  numBytes  requested size
+*
+* \return  buffer or NULL
+*
+********************************************************************************** */
+void* AppStats_MemAlloc(uint32_t numBytes)
+{
+    void* pBuffer = MEM_BufferAlloc(numBytes);
+    uint32_t sizeClass = numBytes ? ((numBytes - 1U) / gAppStatsMemClassSize_c) : 0U;
+    uint32_t i;
+
+    if(sizeClass >= gAppStatsMemClasses_c)
+    {
+        sizeClass = gAppStatsMemClasses_c - 1U;
+    }
+    mAppStatsMemClasses[sizeClass]++;
+
+    for(i = 0; i < mAppStatsPoolCount_c; i++)
+    {
+        if(numBytes <= mAppStatsPools[i].blockSize)
+        {
+            mAppStatsPoolUsage[i].requests++;
+            if(numBytes > mAppStatsPoolUsage[i].maxRequest)
+            {
+                mAppStatsPoolUsage[i].maxRequest = (uint16_t)numBytes;
+            }
+            if(NULL == pBuffer)
+            {
+                mAppStatsPoolUsage[i].failures++;
+            }
+            break;
+        }
+    }
+
+    AppStats_MemSampleImpl();
+    return pBuffer;
+}
+
+/*! *********************************************************************************
+* \brief  Samples the free block count of every pool and keeps the peak usage.
+*         Also catches framework allocations that do not go through
+*         App_BufferAlloc, as long as they are live when a sample is taken.
+*
+********************************************************************************** */
+void AppStats_MemSampleImpl(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < mAppStatsPoolCount_c; i++)
+    {
+        uint16_t used = mAppStatsPools[i].numBlocks - AppStats_PoolFree(i);
+
+        if(used > mAppStatsPoolUsage[i].peakUsed)
+        {
+            mAppStatsPoolUsage[i].peakUsed = used;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Prints the MEM usage profile consumed by tools/poolgen.py:
+*           #P,blockSize,numBlocks,peakUsed,maxRequest,requests,failures  per pool
+*           #Q,classUpperBytes,requests                                per used class
+*           #E,0,cycles
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppStats_MemDump(uint8_t serId)
+{
+    uint32_t i;
+
+    AppStats_MemSampleImpl();
+    for(i = 0; i < mAppStatsPoolCount_c; i++)
+    {
+        AppStats_PrintTag(serId, "#P");
+        AppStats_PrintField(serId, mAppStatsPools[i].blockSize);
+        AppStats_PrintField(serId, mAppStatsPools[i].numBlocks);
+        AppStats_PrintField(serId, mAppStatsPoolUsage[i].peakUsed);
+        AppStats_PrintField(serId, mAppStatsPoolUsage[i].maxRequest);
+        AppStats_PrintField(serId, mAppStatsPoolUsage[i].requests);
+        AppStats_PrintField(serId, mAppStatsPoolUsage[i].failures);
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+
+    for(i = 0; i < gAppStatsMemClasses_c; i++)
+    {
+        if(mAppStatsMemClasses[i])
+        {
+            AppStats_PrintTag(serId, "#Q");
+            AppStats_PrintField(serId, (i + 1U) * gAppStatsMemClassSize_c);
+            AppStats_PrintField(serId, mAppStatsMemClasses[i]);
+            Serial_Print(serId, "\r\n", gAllowToBlock_d);
+        }
+    }
+
+    AppStats_PrintTag(serId, "#E,0");
+    AppStats_PrintField(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+#endif
+
+#if gAppUseLatencyStats_d
+/*! *********************************************************************************
+* \brief  Stamps the end of a boot phase.
+*
+********************************************************************************** */
+void AppStats_BootMarkImpl(app_stats_boot_t phase)
+{
+    mAppBootStamps[phase] = AppStats_GetCycles();
+}
+
+/*! *********************************************************************************
+* \brief  Prints the boot phase stamps, cycles since the scheduler started:
+*           #C,cyclesPerSecond   core clock, 10^9 on the host build
+*           #B,phase,cycles   one per app_stats_boot_t
+*           #E,0,cycles
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppStats_BootDumpImpl(uint8_t serId)
+{
+    uint32_t phase;
+
+    AppStats_PrintTag(serId, "#C");
+    AppStats_PrintField(serId, mAppStatsCyclesPerSecond_c);
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    for(phase = 0; phase < gAppBootMax_c; phase++)
+    {
+        AppStats_PrintTag(serId, "#B");
+        AppStats_PrintField(serId, phase);
+        AppStats_PrintField(serId, mAppBootStamps[phase]);
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+    AppStats_PrintTag(serId, "#E,0");
+    AppStats_PrintField(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+
+/*! *********************************************************************************
+* \brief  Called from the GENFSK receive callback: starts timing a received frame.
+*
+********************************************************************************** */
+void AppStats_LatencyStartImpl(void)
+{
+    mAppLatRxStamp = AppStats_GetCycles();
+    mAppLatRxPending = TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Called when App_HandleEvents starts handling gCtEvtRxDone_c.
+*
+********************************************************************************** */
+void AppStats_LatencyDispatchImpl(void)
+{
+    mAppLatDispatchStamp = AppStats_GetCycles();
+    mAppLatDispatchRxStamp = mAppLatRxStamp;
+    if(mAppLatRxPending)
+    {
+        AppStats_LatencyRecord(gAppLatRxToDispatch_c, mAppLatDispatchStamp - mAppLatDispatchRxStamp);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Records the time from the frame's receive callback to this point, if the
+*         current radio operation was caused by a received frame.
+*
+* \param[in]  probe  gAppLatRxToRearm_c
+*
+********************************************************************************** */
+void AppStats_LatencyMarkImpl(app_stats_latency_t probe)
+{
+    if(mAppLatRxPending)
+    {
+        AppStats_LatencyRecord(probe, AppStats_GetCycles() - mAppLatRxStamp);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Called when App_HandleEvents is done with gCtEvtRxDone_c. A frame received
+*         after the re-arm (new stamp) stays pending for its own dispatch.
+*
+********************************************************************************** */
+void AppStats_LatencyEndImpl(void)
+{
+    if(mAppLatRxPending)
+    {
+        AppStats_LatencyRecord(gAppLatDispatchToEnd_c, AppStats_GetCycles() - mAppLatDispatchStamp);
+    }
+    OSA_InterruptDisable();
+    if(mAppLatRxStamp == mAppLatDispatchRxStamp)
+    {
+        mAppLatRxPending = FALSE;
+    }
+    OSA_InterruptEnable();
+}
+
+/*! *********************************************************************************
+* \brief  Called while handling a received frame that is to be answered, e.g. by
+*         an ack held back for gAppAckDelayMs_c. Later frames answered by the
+*         same frame keep the stamp of the first.
+*
+********************************************************************************** */
+void AppStats_LatencyReplyOwedImpl(void)
+{
+    if(!mAppLatReplyOwed)
+    {
+        mAppLatReplyRxStamp = mAppLatDispatchRxStamp;
+        mAppLatReplyOwed = TRUE;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Called once a frame that carries the owed answer is on air: records the
+*         time from the receive callback of the frame it answers.
+*
+********************************************************************************** */
+void AppStats_LatencyReplySentImpl(void)
+{
+    if(mAppLatReplyOwed)
+    {
+        AppStats_LatencyRecord(gAppLatRxToTx_c, AppStats_GetCycles() - mAppLatReplyRxStamp);
+        mAppLatReplyOwed = FALSE;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Prints the latency histograms while they keep being updated:
+*           #C,cyclesPerSecond   core clock, 10^9 on the host build
+*           #H,probe,count,maxCycles,bucket0,...   one per app_stats_latency_t
+*           #E,0,cycles
+*         Bucket i > 0 counts intervals in [2^(minLog2 + i), 2^(minLog2 + i + 1)).
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppStats_LatencyDump(uint8_t serId)
+{
+    uint32_t probe;
+    uint32_t bucket;
+
+    AppStats_PrintTag(serId, "#C");
+    AppStats_PrintField(serId, mAppStatsCyclesPerSecond_c);
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+
+    for(probe = 0; probe < gAppLatMax_c; probe++)
+    {
+        uint32_t count = 0;
+
+        for(bucket = 0; bucket < gAppStatsLatencyBuckets_c; bucket++)
+        {
+            count += mAppLatHist[probe][bucket];
+        }
+        AppStats_PrintTag(serId, "#H");
+        AppStats_PrintField(serId, probe);
+        AppStats_PrintField(serId, count);
+        AppStats_PrintField(serId, mAppLatMax[probe]);
+        for(bucket = 0; bucket < gAppStatsLatencyBuckets_c; bucket++)
+        {
+            AppStats_PrintField(serId, mAppLatHist[probe][bucket]);
+        }
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+
+    AppStats_PrintTag(serId, "#E,0");
+    AppStats_PrintField(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Reads the RTOS tick count and the cycles elapsed in the current tick.
+*         If SysTick reloaded but its interrupt has not run yet, the pending tick is
+*         counted here and VAL is re-read so both values are after the reload.
+*
+* \param[out] pCyclesInTick  cycles elapsed since the last reload
+*
+* \return  tick count
+*
+********************************************************************************** */
+#ifndef LEDCONTROL_HOST
+static uint32_t AppStats_ReadSysTick(uint32_t* pCyclesInTick)
+{
+    uint32_t ticks;
+    uint32_t val;
+
+    OSA_InterruptDisable();
+    ticks = xTaskGetTickCountFromISR();
+    val = SysTick->VAL;
+    if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        val = SysTick->VAL;
+        ticks++;
+    }
+    OSA_InterruptEnable();
+
+    *pCyclesInTick = SysTick->LOAD - val;
+    return ticks;
+}
+#endif
+
+#if gAppUseRunTimeStats_d || gAppUseLatencyStats_d || gAppUseMemStats_d
+static void AppStats_PrintTag(uint8_t serId, char* pTag)
+{
+    Serial_Print(serId, pTag, gAllowToBlock_d);
+}
+
+static void AppStats_PrintField(uint8_t serId, uint32_t value)
+{
+    Serial_Print(serId, ",", gAllowToBlock_d);
+    Serial_PrintDec(serId, value);
+}
+#endif
+
+#if gAppUseRunTimeStats_d || gAppUseMemStats_d
+/*! *********************************************************************************
+* \brief  Free blocks of one pool. MEM_GetAvailableBlocks counts the free blocks
+*         of every pool whose blocks are at least the given size, the pools are
+*         sorted by block size, so the count of the next larger pool is taken off.
+*         Both are read with interrupts masked, an allocation in between would
+*         skew the difference.
+*
+* \param[in] pool  index into mAppStatsPools
+*
+* \return  free blocks of that pool
+*
+********************************************************************************** */
+static uint16_t AppStats_PoolFree(uint32_t pool)
+{
+    uint32_t freeBlocks;
+
+    OSA_InterruptDisable();
+    freeBlocks = MEM_GetAvailableBlocks(mAppStatsPools[pool].blockSize);
+    if((pool + 1U) < mAppStatsPoolCount_c)
+    {
+        freeBlocks -= MEM_GetAvailableBlocks(mAppStatsPools[pool + 1U].blockSize);
+    }
+    OSA_InterruptEnable();
+
+    return (uint16_t)freeBlocks;
+}
+#endif
+
+#if gAppUseLatencyStats_d
+/*! *********************************************************************************
+* \brief  Adds an interval to its log2 histogram. The M0+ has no CLZ instruction,
+*         so the bucket is found with a short binary search.
+*
+********************************************************************************** */
+static void AppStats_LatencyRecord(app_stats_latency_t probe, uint32_t cycles)
+{
+    uint32_t value = cycles >> gAppStatsLatencyMinLog2_c;
+    uint32_t bucket = 0;
+
+    if(value >= (1U << 16)) { value >>= 16; bucket += 16; }
+    if(value >= (1U << 8))  { value >>= 8;  bucket += 8; }
+    if(value >= (1U << 4))  { value >>= 4;  bucket += 4; }
+    if(value >= (1U << 2))  { value >>= 2;  bucket += 2; }
+    if(value >= (1U << 1))  { bucket += 1; }
+
+    if(bucket >= gAppStatsLatencyBuckets_c)
+    {
+        bucket = gAppStatsLatencyBuckets_c - 1;
+    }
+    mAppLatHist[probe][bucket]++;
+    if(cycles > mAppLatMax[probe])
+    {
+        mAppLatMax[probe] = cycles;
+    }
+}
+#endif
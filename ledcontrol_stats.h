@@ -0,0 +1,171 @@
+#ifndef _LEDCONTROL_STATS_H_
+#define _LEDCONTROL_STATS_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#ifndef LEDCONTROL_HOST
+#include "MemManager.h"
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*UART command that dumps the statistics records*/
+#define gAppStatsDumpCmd_c           's'
+
+/*maximum number of tasks reported by a dump*/
+#ifndef gAppStatsMaxTasks_c
+#define gAppStatsMaxTasks_c          (10)
+#endif
+
+/*run time counter = core clock >> shift (1.3us at 48MHz, wraps after ~95 minutes)*/
+#define gAppStatsRunTimeShift_c      (6)
+
+#if gAppUseRunTimeStats_d
+#define AppStats_RadioInc(counter)   (gAppStatsRadio.counter++)
+#else
+#define AppStats_RadioInc(counter)
+#endif
+
+/*UART command that dumps the latency histograms*/
+#define gAppStatsLatencyCmd_c        'h'
+
+/*log2 histogram layout: bucket 0 holds everything below 2^(minLog2 + 1) cycles,
+  the last bucket everything from 2^(minLog2 + buckets - 1) cycles upwards*/
+#define gAppStatsLatencyBuckets_c    (16)
+#define gAppStatsLatencyMinLog2_c    (6)
+
+#if gAppUseLatencyStats_d
+#define AppStats_BootMark(phase)     AppStats_BootMarkImpl(phase)
+#define AppStats_BootDump(serId)     AppStats_BootDumpImpl(serId)
+#define AppStats_LatencyStart()      AppStats_LatencyStartImpl()
+#define AppStats_LatencyDispatch()   AppStats_LatencyDispatchImpl()
+#define AppStats_LatencyMark(probe)  AppStats_LatencyMarkImpl(probe)
+#define AppStats_LatencyEnd()        AppStats_LatencyEndImpl()
+#define AppStats_LatencyReplyOwed()  AppStats_LatencyReplyOwedImpl()
+#define AppStats_LatencyReplySent()  AppStats_LatencyReplySentImpl()
+#else
+#define AppStats_BootMark(phase)
+#define AppStats_BootDump(serId)
+#define AppStats_LatencyStart()
+#define AppStats_LatencyDispatch()
+#define AppStats_LatencyMark(probe)
+#define AppStats_LatencyEnd()
+#define AppStats_LatencyReplyOwed()
+#define AppStats_LatencyReplySent()
+#endif
+
+/*UART command that dumps the MEM pool usage profile*/
+#define gAppStatsMemCmd_c            'm'
+
+/*requested sizes are counted in classes of this many bytes, up to the largest pool*/
+#define gAppStatsMemClassSize_c      (16)
+#define gAppStatsMemClasses_c        (33)
+
+#if gAppUseMemStats_d
+#define App_BufferAlloc(size)        AppStats_MemAlloc(size)
+#define AppStats_MemSample()         AppStats_MemSampleImpl()
+#else
+#define App_BufferAlloc(size)        MEM_BufferAlloc(size)
+#define AppStats_MemSample()
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*radio event counters, updated from the GENFSK callbacks*/
+typedef struct app_stats_radio_tag
+{
+    uint32_t rxDone;
+    uint32_t rxCrcError;
+    uint32_t rxFailed;
+    uint32_t rxTimeout;
+    uint32_t txDone;
+}app_stats_radio_t;
+
+/*intervals measured from the receive callback of a frame*/
+typedef enum
+{
+    gAppLatRxToDispatch_c = 0, /*RX callback -> App_HandleEvents picks the event up*/
+    gAppLatDispatchToEnd_c,    /*App_HandleEvents RX handling time*/
+    gAppLatRxToRearm_c,        /*RX callback -> GENFSK_StartRx*/
+    gAppLatRxToTx_c,           /*slave: RX callback of a command -> GENFSK_StartTx of the
+                                 frame answering it, the ack frame after gAppAckDelayMs_c
+                                 included; the oldest command of a shared ack counts*/
+    gAppLatMax_c
+}app_stats_latency_t;
+
+/*boot phases stamped by main_task, in order*/
+typedef enum
+{
+    gAppBootHardware_c = 0, /*clocks and pins configured*/
+    gAppBootRadioInit_c,    /*GENFSK instance allocated and configured*/
+    gAppBootRxArmed_c,      /*first GENFSK_StartRx issued*/
+    gAppBootDone_c,         /*serial, LEDs and timers up*/
+    gAppBootMax_c
+}app_stats_boot_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+#if gAppUseRunTimeStats_d
+extern app_stats_radio_t gAppStatsRadio;
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*free running core cycle count built from the RTOS tick and SysTick*/
+uint32_t AppStats_GetCycles(void);
+
+#if gAppUseRunTimeStats_d
+/*FreeRTOS run time counter (see FreeRTOSConfig.h)*/
+uint32_t AppStats_GetRunTimeCounter(void);
+
+/*print all statistics records on the given serial interface*/
+void AppStats_Dump(uint8_t serId);
+#endif
+
+#if gAppUseMemStats_d
+/*MEM_BufferAlloc that records the request in the usage profile*/
+void* AppStats_MemAlloc(uint32_t numBytes);
+
+/*updates the per pool peak usage, use the AppStats_MemSample macro*/
+void AppStats_MemSampleImpl(void);
+
+/*print the MEM usage profile on the given serial interface*/
+void AppStats_MemDump(uint8_t serId);
+#endif
+
+#if gAppUseLatencyStats_d
+/*use the AppStats_Boot* and AppStats_Latency* macros rather than calling these directly*/
+void AppStats_BootMarkImpl(app_stats_boot_t phase);
+void AppStats_BootDumpImpl(uint8_t serId);
+void AppStats_LatencyStartImpl(void);
+void AppStats_LatencyDispatchImpl(void);
+void AppStats_LatencyMarkImpl(app_stats_latency_t probe);
+void AppStats_LatencyEndImpl(void);
+void AppStats_LatencyReplyOwedImpl(void);
+void AppStats_LatencyReplySentImpl(void);
+
+/*print the latency histograms on the given serial interface*/
+void AppStats_LatencyDump(uint8_t serId);
+#endif
+
+#endif /* _LEDCONTROL_STATS_H_ */
@@ -0,0 +1,1391 @@
+#include "ledcontrol_test.h"
+#include "ledcontrol_frame.h"
+
+#include "FunctionLib.h"
+#include "SerialManager.h"
+#include "fsl_os_abstraction.h"
+#include "fsl_xcvr.h"
+#include "fsl_device_registers.h"
+
+#if gAppUseRadioTest_d
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+/*sync address bytes = size + 1, H0/length/H1 take two bytes, as gGenFskDefault...*/
+#define mAppTestSyncAddrSize_c       (3)
+#define mAppTestHeaderBytes_c        (2)
+#define mAppTestFrameBytes(len)      (mAppTestSyncAddrSize_c + 1 + mAppTestHeaderBytes_c + (len))
+#define mAppTestBufferLen_c          (mAppTestFrameBytes(gAppTestMaxLen_c) + gAppFrameCrcSize_c)
+
+/*frame lengths, command byte included*/
+#define mAppTestSetupLen_c           (10)
+#define mAppTestPointLen_c           (2)
+#define mAppTestPingLen_c            (3)
+#define mAppTestPongLen_c            (4)
+#define mAppTestReportLen_c          (16 + (2 * gAppTestRssiBuckets_c))
+
+/*UART command line*/
+#define mAppTestLineLen_c            (48)
+#define mAppTestMaxArgs_c            (10)
+
+/*XCVR_DftTxLfsrReg lfsr_length: 0 is PRBS9, the longest sequence for PN*/
+#define mAppTestLfsrPrbs9_c          (0)
+#define mAppTestLfsrPn_c             (7)
+
+/*XCVR_DftTxCW protocol of the GENFSK channel plan, 2360MHz + channel*/
+#define mAppTestCwProtocol_c         (6)
+#define mAppTestBaseMhz_c            (2360)
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+typedef enum
+{
+    mAppTestOff_c = 0,
+    mAppTestMenu_c,          /*waiting for a command line*/
+    mAppTestPerTx_c,         /*P or W, mAppTestPerTxState*/
+    mAppTestResponder_c,     /*R, mAppTestPerRxState and mAppTestRangeRxState*/
+    mAppTestRangeTx_c,       /*G, mAppTestRangeTxState*/
+    mAppTestCont_c           /*C, mAppTestContState*/
+}app_test_role_t;
+
+typedef struct app_test_link_tag
+{
+    uint8_t rate;
+    uint8_t channel;
+    uint8_t power;
+}app_test_link_t;
+
+/*one PER point as set up by 'S'*/
+typedef struct app_test_point_tag
+{
+    uint8_t point;
+    app_test_link_t link;
+    uint16_t count;
+    uint8_t len;
+    uint8_t gapMs;
+}app_test_point_t;
+
+/*W command, P is a sweep of one point at the home link*/
+typedef struct app_test_sweep_tag
+{
+    uint8_t rates;
+    uint8_t chFirst;
+    uint8_t chLast;
+    uint8_t chStep;
+    uint8_t pwrFirst;
+    uint8_t pwrLast;
+    uint8_t pwrStep;
+    uint16_t count;
+    uint8_t len;
+    uint8_t gapMs;
+}app_test_sweep_t;
+
+typedef struct app_test_rssi_tag
+{
+    uint16_t count;
+    int8_t min;
+    int8_t max;
+    int32_t sum;
+}app_test_rssi_t;
+
+/*what the responder heard of a burst, the payload of 'r'*/
+typedef struct app_test_result_tag
+{
+    uint16_t received;
+    uint16_t crcErrors;
+    app_test_rssi_t rssi;
+    uint32_t spanUs;
+    uint16_t hist[gAppTestRssiBuckets_c];
+}app_test_result_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+
+static void AppTest_Command(void);
+static bool_t AppTest_StartSweep(const app_test_sweep_t* pSweep);
+static bool_t AppTest_StartCont(uint8_t mode);
+static void AppTest_Stop(void);
+static void AppTest_Expired(void);
+static void AppTest_Resume(void);
+
+static void AppTest_PerTxSetup(void);
+static void AppTest_PerTxSendSetup(void);
+static void AppTest_PerTxSendData(void);
+static void AppTest_PerTxSendEnd(void);
+static void AppTest_PerTxNextPoint(void);
+static void AppTest_PerTxReceive(const uint8_t* pPayload, uint8_t length);
+
+static void AppTest_ResponderReceive(const uint8_t* pPayload, uint8_t length, uint64_t timestamp, int8_t rssi);
+static void AppTest_ResponderEndBurst(void);
+static void AppTest_ResponderSendReport(void);
+static void AppTest_RangeRxSummary(void);
+
+static void AppTest_RangeTxSendPing(void);
+static void AppTest_RangeTxNextPing(void);
+static void AppTest_RangeTxSummary(void);
+
+static void AppTest_Tune(const app_test_link_t* pLink);
+static void AppTest_Listen(void);
+static void AppTest_Send(uint8_t length);
+static void AppTest_Arm(uint32_t delayMs);
+static uint32_t AppTest_WaitMs(void);
+static int8_t AppTest_ReadRssi(void);
+
+static void AppTest_RssiAdd(app_test_rssi_t* pRssi, int8_t rssi);
+static void AppTest_PrintPoint(const app_test_point_t* pPoint, const app_test_result_t* pResult);
+static void AppTest_PrintRssi(const app_test_rssi_t* pRssi);
+static void AppTest_PrintRecord(const char* pRecord);
+static void AppTest_PrintDec(uint32_t value);
+static void AppTest_PrintInt(int32_t value);
+static void AppTest_PrintEnd(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+static uint8_t mAppTestGenfskId;
+static uint8_t mAppTestSerId;
+
+static app_test_role_t mAppTestRole = mAppTestOff_c;
+
+/*link the tests meet on, and the one the radio is tuned to*/
+static app_test_link_t mAppTestHome;
+static app_test_link_t mAppTestTuned;
+static bool_t mAppTestTunedValid;
+
+/*radioConfig of ledcontrol.h, the data rate follows the test link*/
+static GENFSK_radio_config_t mAppTestRadioConfig =
+{
+    .radioMode = gGenfskGfskBt0p5h0p5,
+    .dataRate = gGenfskDR1Mbps
+};
+
+static const uint8_t mAppTestGenfskRates[gAppTestRates_c] =
+{
+    gGenfskDR1Mbps, gGenfskDR500Kbps, gGenfskDR250Kbps
+};
+
+static const uint8_t mAppTestXcvrRates[gAppTestRates_c] =
+{
+    DR_1MBPS, DR_500KBPS, DR_250KBPS
+};
+
+static GENFSK_nwk_addr_match_t mAppTestNwkAddr =
+{
+    .nwkAddrSizeBytes = mAppTestSyncAddrSize_c,
+    .nwkAddrThrBits = 0,
+    .nwkAddr = gAppTestSyncAddress_c,
+};
+
+static GENFSK_packet_t mAppTestTxPacket;
+static GENFSK_packet_t mAppTestRxPacket;
+static uint8_t mAppTestTxPayload[gAppTestMaxLen_c];
+static uint8_t mAppTestRxPayload[gAppTestMaxLen_c + gAppFrameCrcSize_c];
+static uint8_t mAppTestTxBuffer[mAppTestFrameBytes(gAppTestMaxLen_c)];
+static uint8_t mAppTestRxBuffer[mAppTestBufferLen_c];
+
+/*a test frame is on air*/
+static bool_t mAppTestTxBusy;
+
+/*AppTest_Timer is due at mAppTestDeadline*/
+static bool_t mAppTestArmed;
+static uint32_t mAppTestDeadline;
+
+static char mAppTestLine[mAppTestLineLen_c];
+static uint8_t mAppTestLineLen;
+
+/*PER transmitter*/
+static ct_per_tx_states_t mAppTestPerTxState = gPerTxStateInit_c;
+static app_test_sweep_t mAppTestSweep;
+static app_test_point_t mAppTestPoint;
+static uint16_t mAppTestSent;
+static uint8_t mAppTestTries;
+
+/*responder, the point of the last burst and what was heard of it*/
+static ct_per_rx_states_t mAppTestPerRxState = gPerRxStateInit_c;
+static ct_range_rx_states_t mAppTestRangeRxState = gRangeRxStateInit_c;
+static app_test_point_t mAppTestRxPoint;
+static app_test_result_t mAppTestResult;
+static bool_t mAppTestResultValid;
+static bool_t mAppTestBurstTuned;
+static uint64_t mAppTestFirstUs;
+static app_test_rssi_t mAppTestPingRssi;
+
+/*range transmitter*/
+static ct_range_tx_states_t mAppTestRangeTxState = gRangeTxStateInit_c;
+static uint16_t mAppTestPingCount;
+static uint8_t mAppTestPingGapMs;
+static uint16_t mAppTestPingIndex;
+static uint16_t mAppTestPingsSent;
+static app_test_rssi_t mAppTestRemoteRssi;
+static app_test_rssi_t mAppTestLocalRssi;
+
+/*continuous tests*/
+static ct_cont_tests_states_t mAppTestContState = gContStateInit_c;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Keeps the GENFSK instance and the UART for the test mode and prepares
+*         the test frame buffers. The radio is left alone until AppTest_Start.
+*
+* \param[in] genfskId  instance allocated by the application
+* \param[in] serId     interface the '#L' records are printed on
+*
+********************************************************************************** */
+void AppTest_Init(uint8_t genfskId, uint8_t serId)
+{
+    mAppTestGenfskId = genfskId;
+    mAppTestSerId = serId;
+
+    mAppTestTxPacket.addr = gAppTestSyncAddress_c;
+    mAppTestTxPacket.header.h0Field = 0;
+    mAppTestTxPacket.header.h1Field = 0;
+    mAppTestTxPacket.payload = mAppTestTxPayload;
+    mAppTestRxPacket.payload = mAppTestRxPayload;
+}
+
+/*! *********************************************************************************
+* \brief  TRUE between AppTest_Start and the 'q' command.
+*
+********************************************************************************** */
+bool_t AppTest_Active(void)
+{
+    return (mAppTestRole != mAppTestOff_c);
+}
+
+/*! *********************************************************************************
+* \brief  Takes the radio: switches to the test sync address and tunes the home
+*         link, taken from the LED network link at 1Mbps.
+*
+* \param[in] channel       channel of the LED network
+* \param[in] txPowerLevel  TX power of the LED network
+*
+* \return  delay before AppTest_Timer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppTest_Start(uint8_t channel, uint8_t txPowerLevel)
+{
+    GENFSK_AbortAll();
+    (void)GENFSK_SetNetworkAddress(mAppTestGenfskId, 0, &mAppTestNwkAddr);
+    (void)GENFSK_EnableNetworkAddress(mAppTestGenfskId, 0);
+
+    mAppTestHome.rate = gAppTestRate1Mbps_c;
+    mAppTestHome.channel = channel;
+    mAppTestHome.power = txPowerLevel;
+    mAppTestTunedValid = FALSE;
+    AppTest_Tune(&mAppTestHome);
+
+    mAppTestRole = mAppTestMenu_c;
+    mAppTestTxBusy = FALSE;
+    mAppTestArmed = FALSE;
+    mAppTestLineLen = 0;
+    AppTest_PrintRecord("#L,A,t");
+    AppTest_PrintEnd();
+    return 0;
+}
+
+/*! *********************************************************************************
+* \brief  Collects command lines. While a test runs any key other than the line
+*         ends stops it.
+*
+* \param[in] byte  UART byte
+*
+* \return  delay before AppTest_Timer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppTest_UartByte(uint8_t byte)
+{
+    if(mAppTestRole == mAppTestOff_c)
+    {
+        return 0;
+    }
+    if((byte == '\r') || (byte == '\n'))
+    {
+        if((mAppTestRole == mAppTestMenu_c) && mAppTestLineLen)
+        {
+            mAppTestLine[mAppTestLineLen] = '\0';
+            mAppTestLineLen = 0;
+            AppTest_Command();
+        }
+    }
+    else if(mAppTestRole != mAppTestMenu_c)
+    {
+        AppTest_Stop();
+        AppTest_PrintRecord("#L,F,stop");
+        AppTest_PrintEnd();
+    }
+    else if(mAppTestLineLen < (mAppTestLineLen_c - 1))
+    {
+        mAppTestLine[mAppTestLineLen++] = (char)byte;
+    }
+    AppTest_Resume();
+    return AppTest_WaitMs();
+}
+
+/*! *********************************************************************************
+* \brief  Hands a received test frame to the running test. Frames that failed
+*         their CRC only count as errors of a PER burst.
+*
+* \param[in] pBuffer    receive buffer the frame was written to
+* \param[in] timestamp  start of the frame in microseconds
+* \param[in] rssi       RSSI, dBm as a signed byte
+* \param[in] crcValid   CRC check result
+*
+* \return  delay before AppTest_Timer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppTest_RxDone(const uint8_t* pBuffer, uint64_t timestamp, uint8_t rssi, bool_t crcValid)
+{
+    uint8_t length;
+
+    GENFSK_ByteArrayToPacket(mAppTestGenfskId, (uint8_t*)pBuffer, &mAppTestRxPacket);
+    length = (uint8_t)mAppTestRxPacket.header.lengthField;
+    if(length > gAppTestMaxLen_c)
+    {
+        crcValid = FALSE;
+    }
+
+    if((mAppTestRole == mAppTestCont_c) && (mAppTestContState == gContStateRunRx_c))
+    {
+        AppTest_PrintRecord("#L,X");
+        AppTest_PrintDec(length);
+        AppTest_PrintInt((int8_t)rssi);
+        AppTest_PrintDec(crcValid ? 1U : 0U);
+        AppTest_PrintEnd();
+    }
+    else if(!crcValid || !length)
+    {
+        if((mAppTestRole == mAppTestResponder_c) &&
+           (mAppTestPerRxState == gPerRxStateStartTest_c) && mAppTestBurstTuned)
+        {
+            mAppTestResult.crcErrors++;
+        }
+    }
+    else if(mAppTestRole == mAppTestPerTx_c)
+    {
+        AppTest_PerTxReceive(mAppTestRxPayload, length);
+    }
+    else if(mAppTestRole == mAppTestResponder_c)
+    {
+        AppTest_ResponderReceive(mAppTestRxPayload, length, timestamp, (int8_t)rssi);
+    }
+    else if((mAppTestRole == mAppTestRangeTx_c) && (mAppTestRangeTxState == gRangeTxStateRunningTest_c) &&
+            (length >= mAppTestPongLen_c) && (mAppTestRxPayload[0] == gAppTestCmdPong_c) &&
+            ((mAppTestRxPayload[1] | ((uint16_t)mAppTestRxPayload[2] << 8)) == mAppTestPingIndex))
+    {
+        AppTest_RssiAdd(&mAppTestRemoteRssi, (int8_t)mAppTestRxPayload[3]);
+        AppTest_RssiAdd(&mAppTestLocalRssi, (int8_t)rssi);
+        AppTest_PrintRecord("#L,G");
+        AppTest_PrintDec(mAppTestPingIndex);
+        AppTest_PrintDec(1);
+        AppTest_PrintInt((int8_t)mAppTestRxPayload[3]);
+        AppTest_PrintInt((int8_t)rssi);
+        AppTest_PrintEnd();
+        AppTest_RangeTxNextPing();
+    }
+    AppTest_Resume();
+    return AppTest_WaitMs();
+}
+
+/*! *********************************************************************************
+* \brief  Moves the running test on once its frame is off the air.
+*
+* \return  delay before AppTest_Timer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppTest_TxDone(void)
+{
+    if(!mAppTestTxBusy)
+    {
+        //frame of the LED network aborted when the test mode started
+        return AppTest_WaitMs();
+    }
+    mAppTestTxBusy = FALSE;
+
+    if(mAppTestRole == mAppTestPerTx_c)
+    {
+        if(mAppTestPerTxState == gPerTxStateRunningTest_c)
+        {
+            mAppTestSent++;
+            if(mAppTestSent >= mAppTestPoint.count)
+            {
+                AppTest_Tune(&mAppTestHome);
+                mAppTestPerTxState = gPerTxStateIdle_c;
+                mAppTestTries = 0;
+                AppTest_PerTxSendEnd();
+            }
+            else if(mAppTestPoint.gapMs)
+            {
+                mAppTestPerTxState = gPerTxStateInputPacketDelay_c;
+                AppTest_Arm(mAppTestPoint.gapMs);
+            }
+            else
+            {
+                AppTest_PerTxSendData();
+            }
+        }
+    }
+    else if(mAppTestRole == mAppTestResponder_c)
+    {
+        if((mAppTestPerRxState == gPerRxStateStartTest_c) && !mAppTestBurstTuned)
+        {
+            //setup acked, meet the transmitter on the point
+            AppTest_Tune(&mAppTestRxPoint.link);
+            mAppTestBurstTuned = TRUE;
+            AppTest_Arm(gAppTestBurstIdleMs_c + mAppTestRxPoint.gapMs);
+        }
+    }
+    else
+    {
+        //a ping waits for its pong
+    }
+    AppTest_Resume();
+    return AppTest_WaitMs();
+}
+
+/*! *********************************************************************************
+* \brief  Runs the step the last returned delay was for. Early calls, after the
+*         step was moved, only return the time left.
+*
+* \return  delay before AppTest_Timer, 0 if none
+*
+********************************************************************************** */
+uint32_t AppTest_Timer(void)
+{
+    if(mAppTestArmed && ((int32_t)(OSA_TimeGetMsec() - mAppTestDeadline) >= 0))
+    {
+        mAppTestArmed = FALSE;
+        AppTest_Expired();
+        AppTest_Resume();
+    }
+    return AppTest_WaitMs();
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Parses and starts the command line in mAppTestLine.
+*
+********************************************************************************** */
+static void AppTest_Command(void)
+{
+    uint32_t args[mAppTestMaxArgs_c];
+    uint8_t count = 0;
+    const char* pChar = &mAppTestLine[1];
+    char command = mAppTestLine[0];
+    bool_t ok = FALSE;
+    app_test_sweep_t sweep;
+
+    //decimal fields separated by spaces or commas
+    while(*pChar && (count <= mAppTestMaxArgs_c))
+    {
+        if((*pChar == ' ') || (*pChar == ','))
+        {
+            pChar++;
+        }
+        else if((*pChar >= '0') && (*pChar <= '9') && (count < mAppTestMaxArgs_c))
+        {
+            args[count] = 0;
+            while((*pChar >= '0') && (*pChar <= '9') && (args[count] < 0x10000000U))
+            {
+                args[count] = (args[count] * 10U) + (uint32_t)(*pChar - '0');
+                pChar++;
+            }
+            count++;
+        }
+        else
+        {
+            count = mAppTestMaxArgs_c + 1U;
+        }
+    }
+
+    if((command == gAppTestQuitCmd_c) && (count == 0))
+    {
+        AppTest_Stop();
+        GENFSK_AbortAll();
+        mAppTestRole = mAppTestOff_c;
+        ok = TRUE;
+    }
+    else if((command == 'L') && (count == 3))
+    {
+        if((args[0] < gAppTestRates_c) && (args[1] <= gAppTestMaxChannel_c) &&
+           (args[2] <= gAppTestMaxTxPowerLevel_c))
+        {
+            mAppTestHome.rate = (uint8_t)args[0];
+            mAppTestHome.channel = (uint8_t)args[1];
+            mAppTestHome.power = (uint8_t)args[2];
+            AppTest_Tune(&mAppTestHome);
+            ok = TRUE;
+        }
+    }
+    else if((command == 'R') && (count == 0))
+    {
+        mAppTestRole = mAppTestResponder_c;
+        mAppTestPerRxState = gPerRxStateWaitStartTest_c;
+        mAppTestRangeRxState = gRangeRxStateIdle_c;
+        mAppTestResultValid = FALSE;
+        ok = TRUE;
+    }
+    else if((command == 'P') && (count == 3))
+    {
+        sweep.rates = (uint8_t)(1U << mAppTestHome.rate);
+        sweep.chFirst = sweep.chLast = mAppTestHome.channel;
+        sweep.pwrFirst = sweep.pwrLast = mAppTestHome.power;
+        sweep.chStep = sweep.pwrStep = 1;
+        sweep.count = (uint16_t)((args[0] <= gAppTestMaxCount_c) ? args[0] : 0U);
+        sweep.len = (uint8_t)((args[1] <= gAppTestMaxLen_c) ? args[1] : 0U);
+        sweep.gapMs = (uint8_t)((args[2] <= 0xFFU) ? args[2] : 0xFFU);
+        ok = (args[2] <= 0xFFU) && AppTest_StartSweep(&sweep);
+    }
+    else if((command == 'W') && (count == 10))
+    {
+        sweep.rates = (uint8_t)((args[0] < (1U << gAppTestRates_c)) ? args[0] : 0U);
+        sweep.chFirst = (uint8_t)args[1];
+        sweep.chLast = (uint8_t)args[2];
+        sweep.chStep = (uint8_t)args[3];
+        sweep.pwrFirst = (uint8_t)args[4];
+        sweep.pwrLast = (uint8_t)args[5];
+        sweep.pwrStep = (uint8_t)args[6];
+        sweep.count = (uint16_t)((args[7] <= gAppTestMaxCount_c) ? args[7] : 0U);
+        sweep.len = (uint8_t)((args[8] <= gAppTestMaxLen_c) ? args[8] : 0U);
+        sweep.gapMs = (uint8_t)args[9];
+        ok = (args[1] <= gAppTestMaxChannel_c) && (args[2] <= gAppTestMaxChannel_c) &&
+             (args[3] <= 0xFFU) && (args[4] <= gAppTestMaxTxPowerLevel_c) &&
+             (args[5] <= gAppTestMaxTxPowerLevel_c) && (args[6] <= 0xFFU) && (args[9] <= 0xFFU) &&
+             AppTest_StartSweep(&sweep);
+    }
+    else if((command == 'G') && (count == 2))
+    {
+        if((args[0] <= gAppTestMaxCount_c) && (args[1] <= 0xFFU))
+        {
+            mAppTestRole = mAppTestRangeTx_c;
+            mAppTestPingCount = (uint16_t)args[0];
+            mAppTestPingGapMs = (uint8_t)args[1];
+            mAppTestPingIndex = 0;
+            mAppTestPingsSent = 0;
+            FLib_MemSet(&mAppTestRemoteRssi, 0, sizeof(mAppTestRemoteRssi));
+            FLib_MemSet(&mAppTestLocalRssi, 0, sizeof(mAppTestLocalRssi));
+            mAppTestRangeTxState = gRangeTxStateStartTest_c;
+            AppTest_RangeTxSendPing();
+            ok = TRUE;
+        }
+    }
+    else if((command == 'C') && (count == 1))
+    {
+        ok = (args[0] <= (gContStateRunEd_c - gContStateRunIdle_c)) && AppTest_StartCont((uint8_t)args[0]);
+    }
+    else
+    {
+        //unknown command or wrong number of fields
+    }
+
+    AppTest_PrintRecord(ok ? "#L,A," : "#L,F,");
+    mAppTestLine[1] = '\0';
+    AppTest_PrintRecord(mAppTestLine);
+    AppTest_PrintEnd();
+}
+
+/*! *********************************************************************************
+* \brief  Checks a sweep and sets up its first point.
+*
+* \param[in] pSweep  W fields, or the single point of P
+*
+* \return  FALSE if a field is out of range
+*
+********************************************************************************** */
+static bool_t AppTest_StartSweep(const app_test_sweep_t* pSweep)
+{
+    uint8_t rate = 0;
+
+    if(!pSweep->rates || !pSweep->count || (pSweep->len < gAppTestMinLen_c) ||
+       !pSweep->chStep || !pSweep->pwrStep ||
+       (pSweep->chLast < pSweep->chFirst) || (pSweep->pwrLast < pSweep->pwrFirst))
+    {
+        return FALSE;
+    }
+    while(!(pSweep->rates & (1U << rate)))
+    {
+        rate++;
+    }
+    mAppTestSweep = *pSweep;
+    mAppTestPoint.point = 0;
+    mAppTestPoint.link.rate = rate;
+    mAppTestPoint.link.channel = pSweep->chFirst;
+    mAppTestPoint.link.power = pSweep->pwrFirst;
+    mAppTestPoint.count = pSweep->count;
+    mAppTestPoint.len = pSweep->len;
+    mAppTestPoint.gapMs = pSweep->gapMs;
+    mAppTestRole = mAppTestPerTx_c;
+    AppTest_PerTxSetup();
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Starts a continuous test on the home link. Transmissions use the XCVR
+*         test pattern generator and run until stopped.
+*
+* \param[in] mode  offset from gContStateRunIdle_c
+*
+* \return  TRUE, the mode was checked by the caller
+*
+********************************************************************************** */
+static bool_t AppTest_StartCont(uint8_t mode)
+{
+    uint8_t rate = mAppTestXcvrRates[mAppTestHome.rate];
+    uint16_t channel = mAppTestHome.channel;
+
+    AppTest_Tune(&mAppTestHome);
+    mAppTestContState = (ct_cont_tests_states_t)(gContStateRunIdle_c + mode);
+    mAppTestRole = mAppTestCont_c;
+
+    switch(mAppTestContState)
+    {
+    case gContStateRunPRBS_c:
+        (void)XCVR_DftTxLfsrReg(channel, GFSK_BT_0p5_h_0p5, (data_rate_t)rate, mAppTestLfsrPrbs9_c);
+        break;
+    case gContStateRunModTxOne_c:
+        (void)XCVR_DftTxPatternReg(channel, GFSK_BT_0p5_h_0p5, (data_rate_t)rate, 0xFFFFFFFFU);
+        break;
+    case gContStateRunModTxZero_c:
+        (void)XCVR_DftTxPatternReg(channel, GFSK_BT_0p5_h_0p5, (data_rate_t)rate, 0x00000000U);
+        break;
+    case gContStateRunModTxPN_c:
+        (void)XCVR_DftTxLfsrReg(channel, GFSK_BT_0p5_h_0p5, (data_rate_t)rate, mAppTestLfsrPn_c);
+        break;
+    case gContStateRunUnmodTx_c:
+        (void)XCVR_DftTxCW(mAppTestBaseMhz_c + channel, mAppTestCwProtocol_c);
+        break;
+    case gContStateRunEd_c:
+        AppTest_Arm(gAppTestEdPeriodMs_c);
+        break;
+    case gContStateRunRx_c:
+        break;
+    default:
+        //idle, nothing to run
+        mAppTestContState = gContStateIdle_c;
+        mAppTestRole = mAppTestMenu_c;
+        break;
+    }
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Stops the running test, printing what a range test gathered so far,
+*         and tunes the home link again.
+*
+********************************************************************************** */
+static void AppTest_Stop(void)
+{
+    if((mAppTestRole == mAppTestCont_c) &&
+       (mAppTestContState >= gContStateRunPRBS_c) && (mAppTestContState <= gContStateRunUnmodTx_c))
+    {
+        XCVR_ForceTxWd();
+        //the pattern generator overrode the channel
+        mAppTestTunedValid = FALSE;
+    }
+    if(mAppTestRole == mAppTestRangeTx_c)
+    {
+        AppTest_RangeTxSummary();
+    }
+    if((mAppTestRole == mAppTestResponder_c) && (mAppTestRangeRxState == gRangeRxStateRunningTest_c))
+    {
+        AppTest_RangeRxSummary();
+    }
+    mAppTestPerTxState = gPerTxStateInit_c;
+    mAppTestPerRxState = gPerRxStateIdle_c;
+    mAppTestRangeTxState = gRangeTxStateIdle_c;
+    mAppTestRangeRxState = gRangeRxStateIdle_c;
+    mAppTestContState = gContStateIdle_c;
+    mAppTestArmed = FALSE;
+    mAppTestTxBusy = FALSE;
+    mAppTestRole = mAppTestMenu_c;
+    AppTest_Tune(&mAppTestHome);
+}
+
+/*! *********************************************************************************
+* \brief  The deadline of the running test passed.
+*
+********************************************************************************** */
+static void AppTest_Expired(void)
+{
+    switch(mAppTestRole)
+    {
+    case mAppTestPerTx_c:
+        if(mAppTestPerTxState == gPerTxStateSelectPacketNum_c)
+        {
+            if(mAppTestTries < gAppTestSetupTries_c)
+            {
+                AppTest_PerTxSendSetup();
+            }
+            else
+            {
+                //no responder on the home link
+                AppTest_PrintRecord("#L,F,S");
+                AppTest_PrintDec(mAppTestPoint.point);
+                AppTest_PrintEnd();
+                AppTest_PerTxNextPoint();
+            }
+        }
+        else if(mAppTestPerTxState == gPerTxStateStartTest_c)
+        {
+            mAppTestSent = 0;
+            mAppTestPerTxState = gPerTxStateRunningTest_c;
+            AppTest_PerTxSendData();
+        }
+        else if(mAppTestPerTxState == gPerTxStateInputPacketDelay_c)
+        {
+            mAppTestPerTxState = gPerTxStateRunningTest_c;
+            AppTest_PerTxSendData();
+        }
+        else if(mAppTestPerTxState == gPerTxStateIdle_c)
+        {
+            //the responder goes home once the burst stays quiet, ask until then
+            if(mAppTestTries < (((gAppTestBurstIdleMs_c + mAppTestPoint.gapMs) / gAppTestReplyMs_c) +
+                                gAppTestSetupTries_c))
+            {
+                AppTest_PerTxSendEnd();
+            }
+            else
+            {
+                AppTest_PrintRecord("#L,F,E");
+                AppTest_PrintDec(mAppTestPoint.point);
+                AppTest_PrintEnd();
+                AppTest_PerTxNextPoint();
+            }
+        }
+        else
+        {
+            //nothing pending
+        }
+        break;
+
+    case mAppTestResponder_c:
+        if(mAppTestPerRxState == gPerRxStateStartTest_c)
+        {
+            AppTest_ResponderEndBurst();
+        }
+        else if(mAppTestRangeRxState == gRangeRxStateRunningTest_c)
+        {
+            AppTest_RangeRxSummary();
+        }
+        else
+        {
+            //nothing pending
+        }
+        break;
+
+    case mAppTestRangeTx_c:
+        if(mAppTestRangeTxState == gRangeTxStateRunningTest_c)
+        {
+            AppTest_PrintRecord("#L,G");
+            AppTest_PrintDec(mAppTestPingIndex);
+            AppTest_PrintDec(0);
+            AppTest_PrintInt(0);
+            AppTest_PrintInt(0);
+            AppTest_PrintEnd();
+            AppTest_RangeTxNextPing();
+        }
+        else if(mAppTestRangeTxState == gRangeTxWaitStartTest_c)
+        {
+            AppTest_RangeTxSendPing();
+        }
+        else
+        {
+            //nothing pending
+        }
+        break;
+
+    case mAppTestCont_c:
+        if(mAppTestContState == gContStateRunEd_c)
+        {
+            AppTest_PrintRecord("#L,D");
+            AppTest_PrintDec(mAppTestHome.channel);
+            AppTest_PrintInt(AppTest_ReadRssi());
+            AppTest_PrintEnd();
+            AppTest_Arm(gAppTestEdPeriodMs_c);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Listens when the current test state expects a frame, unless a test
+*         frame is on air.
+*
+********************************************************************************** */
+static void AppTest_Resume(void)
+{
+    bool_t listen;
+
+    if(mAppTestTxBusy)
+    {
+        return;
+    }
+    switch(mAppTestRole)
+    {
+    case mAppTestPerTx_c:
+        listen = (mAppTestPerTxState == gPerTxStateSelectPacketNum_c) ||
+                 (mAppTestPerTxState == gPerTxStateIdle_c);
+        break;
+    case mAppTestResponder_c:
+        listen = TRUE;
+        break;
+    case mAppTestRangeTx_c:
+        listen = (mAppTestRangeTxState == gRangeTxStateRunningTest_c);
+        break;
+    case mAppTestCont_c:
+        listen = (mAppTestContState == gContStateRunRx_c) || (mAppTestContState == gContStateRunEd_c);
+        break;
+    default:
+        listen = FALSE;
+        break;
+    }
+    if(listen)
+    {
+        AppTest_Listen();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Goes to the home link and offers the current point to the responder.
+*
+********************************************************************************** */
+static void AppTest_PerTxSetup(void)
+{
+    AppTest_Tune(&mAppTestHome);
+    mAppTestPerTxState = gPerTxStateSelectPacketNum_c;
+    mAppTestTries = 0;
+    AppTest_PerTxSendSetup();
+}
+
+static void AppTest_PerTxSendSetup(void)
+{
+    mAppTestTxPayload[0] = gAppTestCmdSetup_c;
+    mAppTestTxPayload[1] = mAppTestPoint.point;
+    mAppTestTxPayload[2] = mAppTestPoint.link.rate;
+    mAppTestTxPayload[3] = mAppTestPoint.link.channel;
+    mAppTestTxPayload[4] = mAppTestPoint.link.power;
+    mAppTestTxPayload[5] = (uint8_t)mAppTestPoint.count;
+    mAppTestTxPayload[6] = (uint8_t)(mAppTestPoint.count >> 8);
+    mAppTestTxPayload[7] = mAppTestPoint.len;
+    mAppTestTxPayload[8] = mAppTestPoint.gapMs;
+    mAppTestTxPayload[9] = 0;
+    mAppTestTries++;
+    AppTest_Send(mAppTestSetupLen_c);
+    AppTest_Arm(gAppTestReplyMs_c);
+}
+
+/*'D' frame mAppTestSent of the burst, padded with a pattern up to the point length*/
+static void AppTest_PerTxSendData(void)
+{
+    uint8_t i;
+
+    mAppTestTxPayload[0] = gAppTestCmdData_c;
+    mAppTestTxPayload[1] = mAppTestPoint.point;
+    mAppTestTxPayload[2] = (uint8_t)mAppTestSent;
+    mAppTestTxPayload[3] = (uint8_t)(mAppTestSent >> 8);
+    mAppTestTxPayload[4] = (uint8_t)mAppTestPoint.count;
+    mAppTestTxPayload[5] = (uint8_t)(mAppTestPoint.count >> 8);
+    for(i = gAppTestMinLen_c; i < mAppTestPoint.len; i++)
+    {
+        mAppTestTxPayload[i] = (uint8_t)(i + mAppTestSent);
+    }
+    AppTest_Send(mAppTestPoint.len);
+}
+
+static void AppTest_PerTxSendEnd(void)
+{
+    mAppTestTxPayload[0] = gAppTestCmdEnd_c;
+    mAppTestTxPayload[1] = mAppTestPoint.point;
+    mAppTestTries++;
+    AppTest_Send(mAppTestPointLen_c);
+    AppTest_Arm(gAppTestReplyMs_c);
+}
+
+/*! *********************************************************************************
+* \brief  Steps the power, then the channel, then the data rate of the sweep, and
+*         sets up the next point. After the last one the sweep ends at home.
+*
+********************************************************************************** */
+static void AppTest_PerTxNextPoint(void)
+{
+    app_test_link_t* pLink = &mAppTestPoint.link;
+
+    mAppTestPoint.point++;
+    if((uint16_t)(pLink->power + mAppTestSweep.pwrStep) <= mAppTestSweep.pwrLast)
+    {
+        pLink->power += mAppTestSweep.pwrStep;
+    }
+    else if((uint16_t)(pLink->channel + mAppTestSweep.chStep) <= mAppTestSweep.chLast)
+    {
+        pLink->power = mAppTestSweep.pwrFirst;
+        pLink->channel += mAppTestSweep.chStep;
+    }
+    else
+    {
+        do
+        {
+            pLink->rate++;
+        }while((pLink->rate < gAppTestRates_c) && !(mAppTestSweep.rates & (1U << pLink->rate)));
+        pLink->power = mAppTestSweep.pwrFirst;
+        pLink->channel = mAppTestSweep.chFirst;
+    }
+
+    if(pLink->rate < gAppTestRates_c)
+    {
+        AppTest_PerTxSetup();
+        return;
+    }
+    AppTest_PrintRecord("#L,Z");
+    AppTest_PrintDec(mAppTestPoint.point);
+    AppTest_PrintEnd();
+    mAppTestPerTxState = gPerTxStateInit_c;
+    mAppTestArmed = FALSE;
+    mAppTestRole = mAppTestMenu_c;
+    AppTest_Tune(&mAppTestHome);
+}
+
+/*! *********************************************************************************
+* \brief  Setup acks and reports from the responder.
+*
+* \param[in] pPayload  frame payload, command first
+* \param[in] length    payload length
+*
+********************************************************************************** */
+static void AppTest_PerTxReceive(const uint8_t* pPayload, uint8_t length)
+{
+    app_test_result_t result;
+    uint8_t i;
+
+    if((length < mAppTestPointLen_c) || (pPayload[1] != mAppTestPoint.point))
+    {
+        return;
+    }
+    if((pPayload[0] == gAppTestCmdSetupAck_c) && (mAppTestPerTxState == gPerTxStateSelectPacketNum_c))
+    {
+        AppTest_Tune(&mAppTestPoint.link);
+        mAppTestPerTxState = gPerTxStateStartTest_c;
+        AppTest_Arm(gAppTestSettleMs_c);
+    }
+    else if((pPayload[0] == gAppTestCmdReport_c) && (mAppTestPerTxState == gPerTxStateIdle_c) &&
+            (length >= mAppTestReportLen_c))
+    {
+        result.received = (uint16_t)(pPayload[2] | ((uint16_t)pPayload[3] << 8));
+        result.crcErrors = (uint16_t)(pPayload[4] | ((uint16_t)pPayload[5] << 8));
+        result.rssi.count = result.received;
+        result.rssi.min = (int8_t)pPayload[6];
+        result.rssi.max = (int8_t)pPayload[7];
+        result.rssi.sum = (int32_t)(pPayload[8] | ((uint32_t)pPayload[9] << 8) |
+                                    ((uint32_t)pPayload[10] << 16) | ((uint32_t)pPayload[11] << 24));
+        result.spanUs = pPayload[12] | ((uint32_t)pPayload[13] << 8) |
+                        ((uint32_t)pPayload[14] << 16) | ((uint32_t)pPayload[15] << 24);
+        for(i = 0; i < gAppTestRssiBuckets_c; i++)
+        {
+            result.hist[i] = (uint16_t)(pPayload[16 + (2 * i)] | ((uint16_t)pPayload[17 + (2 * i)] << 8));
+        }
+        AppTest_PrintPoint(&mAppTestPoint, &result);
+        AppTest_PerTxNextPoint();
+    }
+    else
+    {
+        //repeated ack or report
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Setups, burst frames, report requests and pings, as the responder.
+*
+* \param[in] pPayload   frame payload, command first
+* \param[in] length     payload length
+* \param[in] timestamp  start of the frame in microseconds
+* \param[in] rssi       RSSI of the frame, dBm
+*
+********************************************************************************** */
+static void AppTest_ResponderReceive(const uint8_t* pPayload, uint8_t length, uint64_t timestamp, int8_t rssi)
+{
+    uint16_t index;
+    uint8_t bucket;
+
+    switch(pPayload[0])
+    {
+    case gAppTestCmdSetup_c:
+        if((length < mAppTestSetupLen_c) || (pPayload[2] >= gAppTestRates_c) ||
+           (pPayload[3] > gAppTestMaxChannel_c) || (pPayload[4] > gAppTestMaxTxPowerLevel_c))
+        {
+            break;
+        }
+        if(mAppTestRangeRxState == gRangeRxStateRunningTest_c)
+        {
+            AppTest_RangeRxSummary();
+        }
+        mAppTestRxPoint.point = pPayload[1];
+        mAppTestRxPoint.link.rate = pPayload[2];
+        mAppTestRxPoint.link.channel = pPayload[3];
+        mAppTestRxPoint.link.power = pPayload[4];
+        mAppTestRxPoint.count = (uint16_t)(pPayload[5] | ((uint16_t)pPayload[6] << 8));
+        mAppTestRxPoint.len = pPayload[7];
+        mAppTestRxPoint.gapMs = pPayload[8];
+        FLib_MemSet(&mAppTestResult, 0, sizeof(mAppTestResult));
+        mAppTestResultValid = FALSE;
+        mAppTestBurstTuned = FALSE;
+        mAppTestArmed = FALSE;
+        mAppTestPerRxState = gPerRxStateStartTest_c;
+        //tuned to the point once the ack is off the air
+        mAppTestTxPayload[0] = gAppTestCmdSetupAck_c;
+        mAppTestTxPayload[1] = mAppTestRxPoint.point;
+        AppTest_Send(mAppTestPointLen_c);
+        break;
+
+    case gAppTestCmdData_c:
+        if((mAppTestPerRxState != gPerRxStateStartTest_c) || !mAppTestBurstTuned ||
+           (length < gAppTestMinLen_c) || (pPayload[1] != mAppTestRxPoint.point))
+        {
+            break;
+        }
+        index = (uint16_t)(pPayload[2] | ((uint16_t)pPayload[3] << 8));
+        if(!mAppTestResult.received)
+        {
+            mAppTestFirstUs = timestamp;
+        }
+        mAppTestResult.received++;
+        mAppTestResult.spanUs = (uint32_t)(timestamp - mAppTestFirstUs);
+        AppTest_RssiAdd(&mAppTestResult.rssi, rssi);
+        bucket = (rssi <= gAppTestRssiLowDbm_c) ? 0U : (uint8_t)((rssi - gAppTestRssiLowDbm_c) / gAppTestRssiStepDb_c);
+        if(bucket >= gAppTestRssiBuckets_c)
+        {
+            bucket = gAppTestRssiBuckets_c - 1U;
+        }
+        mAppTestResult.hist[bucket]++;
+        if((index + 1U) >= mAppTestRxPoint.count)
+        {
+            AppTest_ResponderEndBurst();
+        }
+        else
+        {
+            AppTest_Arm(gAppTestBurstIdleMs_c + mAppTestRxPoint.gapMs);
+        }
+        break;
+
+    case gAppTestCmdEnd_c:
+        if((length < mAppTestPointLen_c) || (pPayload[1] != mAppTestRxPoint.point))
+        {
+            break;
+        }
+        if(mAppTestPerRxState == gPerRxStateStartTest_c)
+        {
+            //a point on the home link itself, the request ends the burst
+            AppTest_ResponderEndBurst();
+        }
+        if(mAppTestResultValid)
+        {
+            AppTest_ResponderSendReport();
+        }
+        break;
+
+    case gAppTestCmdPing_c:
+        if((length < mAppTestPingLen_c) || (mAppTestPerRxState == gPerRxStateStartTest_c))
+        {
+            break;
+        }
+        AppTest_RssiAdd(&mAppTestPingRssi, rssi);
+        mAppTestRangeRxState = gRangeRxStateRunningTest_c;
+        AppTest_Arm(gAppTestRangeIdleMs_c);
+        mAppTestTxPayload[0] = gAppTestCmdPong_c;
+        mAppTestTxPayload[1] = pPayload[1];
+        mAppTestTxPayload[2] = pPayload[2];
+        mAppTestTxPayload[3] = (uint8_t)rssi;
+        AppTest_Send(mAppTestPongLen_c);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Goes back to the home link with the result of the burst and prints it,
+*         unless the setup ack was lost and nothing arrived.
+*
+********************************************************************************** */
+static void AppTest_ResponderEndBurst(void)
+{
+    mAppTestArmed = FALSE;
+    mAppTestPerRxState = gPerRxStateWaitStartTest_c;
+    mAppTestResultValid = TRUE;
+    AppTest_Tune(&mAppTestHome);
+    if(mAppTestResult.received || mAppTestResult.crcErrors)
+    {
+        AppTest_PrintPoint(&mAppTestRxPoint, &mAppTestResult);
+    }
+}
+
+static void AppTest_ResponderSendReport(void)
+{
+    uint8_t i;
+
+    mAppTestTxPayload[0] = gAppTestCmdReport_c;
+    mAppTestTxPayload[1] = mAppTestRxPoint.point;
+    mAppTestTxPayload[2] = (uint8_t)mAppTestResult.received;
+    mAppTestTxPayload[3] = (uint8_t)(mAppTestResult.received >> 8);
+    mAppTestTxPayload[4] = (uint8_t)mAppTestResult.crcErrors;
+    mAppTestTxPayload[5] = (uint8_t)(mAppTestResult.crcErrors >> 8);
+    mAppTestTxPayload[6] = (uint8_t)mAppTestResult.rssi.min;
+    mAppTestTxPayload[7] = (uint8_t)mAppTestResult.rssi.max;
+    mAppTestTxPayload[8] = (uint8_t)mAppTestResult.rssi.sum;
+    mAppTestTxPayload[9] = (uint8_t)((uint32_t)mAppTestResult.rssi.sum >> 8);
+    mAppTestTxPayload[10] = (uint8_t)((uint32_t)mAppTestResult.rssi.sum >> 16);
+    mAppTestTxPayload[11] = (uint8_t)((uint32_t)mAppTestResult.rssi.sum >> 24);
+    mAppTestTxPayload[12] = (uint8_t)mAppTestResult.spanUs;
+    mAppTestTxPayload[13] = (uint8_t)(mAppTestResult.spanUs >> 8);
+    mAppTestTxPayload[14] = (uint8_t)(mAppTestResult.spanUs >> 16);
+    mAppTestTxPayload[15] = (uint8_t)(mAppTestResult.spanUs >> 24);
+    for(i = 0; i < gAppTestRssiBuckets_c; i++)
+    {
+        mAppTestTxPayload[16 + (2 * i)] = (uint8_t)mAppTestResult.hist[i];
+        mAppTestTxPayload[17 + (2 * i)] = (uint8_t)(mAppTestResult.hist[i] >> 8);
+    }
+    AppTest_Send(mAppTestReportLen_c);
+}
+
+/*prints the pings heard since the range test started and forgets them*/
+static void AppTest_RangeRxSummary(void)
+{
+    mAppTestRangeRxState = gRangeRxStatePrintTestResults_c;
+    AppTest_PrintRecord("#L,R");
+    AppTest_PrintDec(mAppTestPingRssi.count);
+    AppTest_PrintRssi(&mAppTestPingRssi);
+    AppTest_PrintEnd();
+    FLib_MemSet(&mAppTestPingRssi, 0, sizeof(mAppTestPingRssi));
+    mAppTestRangeRxState = gRangeRxStateIdle_c;
+}
+
+static void AppTest_RangeTxSendPing(void)
+{
+    mAppTestTxPayload[0] = gAppTestCmdPing_c;
+    mAppTestTxPayload[1] = (uint8_t)mAppTestPingIndex;
+    mAppTestTxPayload[2] = (uint8_t)(mAppTestPingIndex >> 8);
+    mAppTestPingsSent++;
+    mAppTestRangeTxState = gRangeTxStateRunningTest_c;
+    AppTest_Send(mAppTestPingLen_c);
+    AppTest_Arm(gAppTestReplyMs_c);
+}
+
+/*! *********************************************************************************
+* \brief  Waits the gap before the next ping, or prints the summary after the
+*         last one.
+*
+********************************************************************************** */
+static void AppTest_RangeTxNextPing(void)
+{
+    mAppTestPingIndex++;
+    if(mAppTestPingCount && (mAppTestPingIndex >= mAppTestPingCount))
+    {
+        AppTest_RangeTxSummary();
+        mAppTestRangeTxState = gRangeTxStateIdle_c;
+        mAppTestArmed = FALSE;
+        mAppTestRole = mAppTestMenu_c;
+    }
+    else if(mAppTestPingGapMs)
+    {
+        mAppTestRangeTxState = gRangeTxWaitStartTest_c;
+        AppTest_Arm(mAppTestPingGapMs);
+    }
+    else
+    {
+        AppTest_RangeTxSendPing();
+    }
+}
+
+static void AppTest_RangeTxSummary(void)
+{
+    mAppTestRangeTxState = gRangeTxStatePrintTestResults_c;
+    AppTest_PrintRecord("#L,S");
+    AppTest_PrintDec(mAppTestPingsSent);
+    AppTest_PrintDec(mAppTestLocalRssi.count);
+    AppTest_PrintRssi(&mAppTestRemoteRssi);
+    AppTest_PrintRssi(&mAppTestLocalRssi);
+    AppTest_PrintEnd();
+}
+
+/*! *********************************************************************************
+* \brief  Tunes the radio to a test link, reconfiguring it only when the data
+*         rate changes.
+*
+* \param[in] pLink  data rate, channel and TX power
+*
+********************************************************************************** */
+static void AppTest_Tune(const app_test_link_t* pLink)
+{
+    GENFSK_AbortAll();
+    if(!mAppTestTunedValid || (mAppTestTuned.rate != pLink->rate))
+    {
+        mAppTestRadioConfig.dataRate = mAppTestGenfskRates[pLink->rate];
+        (void)GENFSK_RadioConfig(mAppTestGenfskId, &mAppTestRadioConfig);
+    }
+    (void)GENFSK_SetChannelNumber(mAppTestGenfskId, pLink->channel);
+    (void)GENFSK_SetTxPowerLevel(mAppTestGenfskId, pLink->power);
+    mAppTestTuned = *pLink;
+    mAppTestTunedValid = TRUE;
+}
+
+static void AppTest_Listen(void)
+{
+    GENFSK_AbortAll();
+    (void)GENFSK_StartRx(mAppTestGenfskId, mAppTestRxBuffer, sizeof(mAppTestRxBuffer), 0, 0);
+}
+
+/*sends the first length bytes of mAppTestTxPayload*/
+static void AppTest_Send(uint8_t length)
+{
+    mAppTestTxPacket.header.lengthField = length;
+    GENFSK_PacketToByteArray(mAppTestGenfskId, &mAppTestTxPacket, mAppTestTxBuffer);
+    GENFSK_AbortAll();
+    (void)GENFSK_StartTx(mAppTestGenfskId, mAppTestTxBuffer, mAppTestFrameBytes(length), 0);
+    mAppTestTxBusy = TRUE;
+}
+
+static void AppTest_Arm(uint32_t delayMs)
+{
+    mAppTestDeadline = OSA_TimeGetMsec() + delayMs;
+    mAppTestArmed = TRUE;
+}
+
+static uint32_t AppTest_WaitMs(void)
+{
+    int32_t left;
+
+    if(!mAppTestArmed)
+    {
+        return 0;
+    }
+    left = (int32_t)(mAppTestDeadline - OSA_TimeGetMsec());
+    return (left > 0) ? (uint32_t)left : 1U;
+}
+
+/*narrowband RSSI of the receiver armed by AppTest_Listen, dBm*/
+static int8_t AppTest_ReadRssi(void)
+{
+    return (int8_t)((XCVR_RX_DIG->NB_RSSI_RES0 & XCVR_RX_DIG_NB_RSSI_RES0_RSSI_NB_MASK) >>
+                    XCVR_RX_DIG_NB_RSSI_RES0_RSSI_NB_SHIFT);
+}
+
+static void AppTest_RssiAdd(app_test_rssi_t* pRssi, int8_t rssi)
+{
+    if(!pRssi->count || (rssi < pRssi->min))
+    {
+        pRssi->min = rssi;
+    }
+    if(!pRssi->count || (rssi > pRssi->max))
+    {
+        pRssi->max = rssi;
+    }
+    pRssi->sum += rssi;
+    pRssi->count++;
+}
+
+/*! *********************************************************************************
+* \brief  Prints the '#L,P' and '#L,Q' records of a PER point. Goodput counts the
+*         payload bytes of the frames after the first over the time between the
+*         first and the last one.
+*
+* \param[in] pPoint   point as set up
+* \param[in] pResult  what the responder heard
+*
+********************************************************************************** */
+static void AppTest_PrintPoint(const app_test_point_t* pPoint, const app_test_result_t* pResult)
+{
+    uint32_t received = (pResult->received <= pPoint->count) ? pResult->received : pPoint->count;
+    uint32_t goodput = 0;
+    uint8_t i;
+
+    if((received > 1U) && pResult->spanUs)
+    {
+        goodput = (uint32_t)(((uint64_t)(received - 1U) * pPoint->len * 8U * 1000000U) / pResult->spanUs);
+    }
+    AppTest_PrintRecord("#L,P");
+    AppTest_PrintDec(pPoint->point);
+    AppTest_PrintDec(pPoint->link.rate);
+    AppTest_PrintDec(pPoint->link.channel);
+    AppTest_PrintDec(pPoint->link.power);
+    AppTest_PrintDec(pPoint->len);
+    AppTest_PrintDec(pPoint->count);
+    AppTest_PrintDec(pResult->received);
+    AppTest_PrintDec(pResult->crcErrors);
+    AppTest_PrintDec(((pPoint->count - received) * 10000U) / pPoint->count);
+    AppTest_PrintDec(goodput);
+    AppTest_PrintRssi(&pResult->rssi);
+    AppTest_PrintEnd();
+
+    AppTest_PrintRecord("#L,Q");
+    AppTest_PrintDec(pPoint->point);
+    AppTest_PrintInt(gAppTestRssiLowDbm_c);
+    AppTest_PrintDec(gAppTestRssiStepDb_c);
+    for(i = 0; i < gAppTestRssiBuckets_c; i++)
+    {
+        AppTest_PrintDec(pResult->hist[i]);
+    }
+    AppTest_PrintEnd();
+}
+
+/*min, mean and max fields, 0 when nothing was heard*/
+static void AppTest_PrintRssi(const app_test_rssi_t* pRssi)
+{
+    int32_t mean = 0;
+
+    if(pRssi->count)
+    {
+        mean = pRssi->sum / (int32_t)pRssi->count;
+    }
+    AppTest_PrintInt(pRssi->count ? pRssi->min : 0);
+    AppTest_PrintInt(mean);
+    AppTest_PrintInt(pRssi->count ? pRssi->max : 0);
+}
+
+static void AppTest_PrintRecord(const char* pRecord)
+{
+    Serial_Print(mAppTestSerId, (char*)pRecord, gAllowToBlock_d);
+}
+
+static void AppTest_PrintDec(uint32_t value)
+{
+    Serial_Print(mAppTestSerId, ",", gAllowToBlock_d);
+    Serial_PrintDec(mAppTestSerId, value);
+}
+
+static void AppTest_PrintInt(int32_t value)
+{
+    Serial_Print(mAppTestSerId, (value < 0) ? ",-" : ",", gAllowToBlock_d);
+    Serial_PrintDec(mAppTestSerId, (uint32_t)((value < 0) ? -value : value));
+}
+
+static void AppTest_PrintEnd(void)
+{
+    Serial_Print(mAppTestSerId, "\r\n", gAllowToBlock_d);
+}
+
+#endif /* gAppUseRadioTest_d */
@@ -0,0 +1,170 @@
+#ifndef _LEDCONTROL_TEST_H_
+#define _LEDCONTROL_TEST_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "gen_fsk_tests_states.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Radio test mode, gAppUseRadioTest_d build. The 't' UART command hands the
+ * radio of a master or a slave to the test state machines of
+ * gen_fsk_tests_states.h until 'q'. Test frames use their own sync address,
+ * the LED network neither hears them nor disturbs them. Commands are lines,
+ * fields separated by spaces or commas:
+ *
+ *   L rate channel power   home link of the tests, rate 0 = 1Mbps,
+ *                          1 = 500kbps, 2 = 250kbps; both nodes need the same
+ *   R                      responder: answers PER setups, runs their bursts
+ *                          and answers range pings (ct_per_rx_states_t,
+ *                          ct_range_rx_states_t)
+ *   P count len gap        PER test at the home link (ct_per_tx_states_t)
+ *   W rates chFirst chLast chStep pwrFirst pwrLast pwrStep count len gap
+ *                          PER test for every data rate of the rates bit
+ *                          mask, channel and TX power
+ *   G count gap            range test at the home link, count 0 runs until a
+ *                          key is pressed (ct_range_tx_states_t)
+ *   C mode                 continuous test at the home link, mode counts from
+ *                          gContStateRunIdle_c: 0 idle, 1 PRBS9, 2 modulated
+ *                          ones, 3 zeros, 4 PN, 5 unmodulated carrier, 6 RX,
+ *                          7 energy detect (ct_cont_tests_states_t)
+ *
+ * A key pressed while a test runs stops it. len is the payload length of the
+ * PER frames, gap the delay in ms between two frames, 0 sends back to back.
+ *
+ * Each PER point is set up on the home link, where the responder answers
+ * with the report of its burst:
+ *
+ *   tx -> responder  'S' point, rate, channel, power, count, len, gap
+ *   responder -> tx  'a' point, then both tune to the point
+ *   tx -> responder  'D' point, index, count, padding up to len, count times
+ *                    the responder goes home after the last index or once
+ *                    nothing was heard for gAppTestBurstIdleMs_c + gap
+ *   tx -> responder  'E' point, on the home link until answered
+ *   responder -> tx  'r' point, received, CRC errors, RSSI min/max/sum,
+ *                    time between the first and last frame, RSSI histogram
+ *
+ *   tx -> responder  'G' index          range ping
+ *   responder -> tx  'g' index, RSSI    the ping as the responder heard it
+ *
+ * Results are '#L' records on the UART, both nodes print the PER records:
+ *
+ *   #L,A,<command>              command accepted
+ *   #L,F,<command>              command refused, a test stopped or a point
+ *                               whose setup or report went unanswered
+ *   #L,P,point,rate,channel,power,len,sent,received,crcErrors,per,goodput,
+ *        rssiMin,rssiMean,rssiMax
+ *                               per in 1/10000, goodput in payload bit/s
+ *   #L,Q,point,lowDbm,stepDb,count0,...   RSSI histogram of the point
+ *   #L,Z,points                 sweep over
+ *   #L,G,index,ok,rssiRemote,rssiLocal    range ping
+ *   #L,S,sent,received,remoteMin,remoteMean,remoteMax,localMin,localMean,localMax
+ *   #L,R,heard,rssiMin,rssiMean,rssiMax   responder, pings of a range test
+ *   #L,D,channel,rssi           energy detect sample
+ *   #L,X,len,rssi,crcValid      frame heard in continuous RX
+ *
+ * tools/linktest.py drives the tests and tabulates the records.
+ */
+
+/*UART command that enters the test mode, and the one that leaves it*/
+#define gAppTestCmd_c                't'
+#define gAppTestQuitCmd_c            'q'
+
+/*sync address of test frames, not the gGenFskDefaultSyncAddress_c of the LED network*/
+#define gAppTestSyncAddress_c        (0x4C54A5C3)
+
+/*frame commands*/
+#define gAppTestCmdSetup_c           'S'
+#define gAppTestCmdSetupAck_c        'a'
+#define gAppTestCmdData_c            'D'
+#define gAppTestCmdEnd_c             'E'
+#define gAppTestCmdReport_c          'r'
+#define gAppTestCmdPing_c            'G'
+#define gAppTestCmdPong_c            'g'
+
+/*data rates, indexes of the L and W commands*/
+#define gAppTestRate1Mbps_c          (0)
+#define gAppTestRate500Kbps_c        (1)
+#define gAppTestRate250Kbps_c        (2)
+#define gAppTestRates_c              (3)
+
+/*channel and TX power limits, gGenFskMaxChannel_c and gGenFskMaxTxPowerLevel_c*/
+#define gAppTestMaxChannel_c         (0x7F)
+#define gAppTestMaxTxPowerLevel_c    (0x20)
+
+/*PER frame payload, 'D' header to gGenFskMaxPayloadLen_c*/
+#define gAppTestMinLen_c             (6)
+#define gAppTestMaxLen_c             (63)
+
+/*frames one PER point may send*/
+#define gAppTestMaxCount_c           (60000)
+
+/*RSSI histogram of a PER point: buckets of gAppTestRssiStepDb_c from
+  gAppTestRssiLowDbm_c, the outer ones also take what lies beyond*/
+#define gAppTestRssiBuckets_c        (16)
+#define gAppTestRssiLowDbm_c         (-105)
+#define gAppTestRssiStepDb_c         (5)
+
+/*time a reply may take before the request is repeated*/
+#define gAppTestReplyMs_c            (20)
+
+/*time the transmitter gives the responder to tune to a point*/
+#define gAppTestSettleMs_c           (5)
+
+/*a burst is over once the responder heard nothing for this long plus the gap*/
+#define gAppTestBurstIdleMs_c        (100)
+
+/*setups sent for a point before it is skipped*/
+#define gAppTestSetupTries_c         (10)
+
+/*a responder reports the pings of a range test after this long without one*/
+#define gAppTestRangeIdleMs_c        (2000)
+
+/*energy detect sampling period*/
+#define gAppTestEdPeriodMs_c         (100)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+#if gAppUseRadioTest_d
+/*
+ * Every call below returns the time in ms after which AppTest_Timer is due,
+ * 0 if no timer is needed.
+ */
+
+/*keeps the GENFSK instance and the UART the records go to*/
+void AppTest_Init(uint8_t genfskId, uint8_t serId);
+
+/*TRUE while the test mode owns the radio*/
+bool_t AppTest_Active(void);
+
+/*enters the test mode, the home link starts as the LED network link at 1Mbps*/
+uint32_t AppTest_Start(uint8_t channel, uint8_t txPowerLevel);
+
+/*one UART byte; after 'q' AppTest_Active is FALSE and the caller restores
+  its own radio configuration*/
+uint32_t AppTest_UartByte(uint8_t byte);
+
+/*a frame heard by the receiver AppTest_... armed; timestamp in microseconds*/
+uint32_t AppTest_RxDone(const uint8_t* pBuffer, uint64_t timestamp, uint8_t rssi, bool_t crcValid);
+
+/*the frame AppTest_... sent is off the air*/
+uint32_t AppTest_TxDone(void);
+
+/*the time returned by the last call is over*/
+uint32_t AppTest_Timer(void);
+#endif
+
+#endif /* _LEDCONTROL_TEST_H_ */
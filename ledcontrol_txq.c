@@ -0,0 +1,218 @@
+#include "ledcontrol_txq.h"
+
+#include "FunctionLib.h"
+#include "SerialManager.h"
+#include "TimersManager.h"
+#include "ledcontrol_stats.h"
+
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+typedef struct app_txq_entry_tag
+{
+    app_frame_t frame;
+    app_ack_rx_t* pAckRx;
+    uint64_t queuedAt;
+    uint8_t data[gAppTxqDataLen_c];
+}app_txq_entry_t;
+
+typedef struct app_txq_tag
+{
+    uint8_t head;
+    uint8_t count;
+    app_txq_entry_t entries[gAppTxqDepth_c];
+}app_txq_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+static app_txq_t mAppTxq[gAppTxClassMax_c];
+static app_txq_stats_t mAppTxqStats[gAppTxClassMax_c];
+
+/*data of the frame handed out by AppTxq_Dequeue, the queue slot is reused*/
+static uint8_t mAppTxqCurrentData[gAppTxqDataLen_c];
+
+/*the frame on air expects an ack*/
+static bool_t mAppTxqAwaitReply;
+
+/*background classes are held until this timestamp*/
+static uint64_t mAppTxqGuardUntil;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Appends a frame to the FIFO of its class. The frame and its command data
+*         are copied; sequence numbers must already be allocated, the ack owed to
+*         the peer is attached at send time so it is as fresh as possible.
+*
+* \param[in] txClass  traffic class
+* \param[in] pFrame   frame to send
+* \param[in] pAckRx   receive state of the destination peer, NULL if none
+*
+* \return  FALSE if the frame was dropped
+*
+********************************************************************************** */
+bool_t AppTxq_Enqueue(app_tx_class_t txClass, const app_frame_t* pFrame, app_ack_rx_t* pAckRx)
+{
+    app_txq_t* pQueue = &mAppTxq[txClass];
+    app_txq_entry_t* pEntry;
+
+    mAppTxqStats[txClass].queued++;
+    if((pQueue->count == gAppTxqDepth_c) || (pFrame->dataLen > gAppTxqDataLen_c))
+    {
+        mAppTxqStats[txClass].dropped++;
+        return FALSE;
+    }
+
+    pEntry = &pQueue->entries[(pQueue->head + pQueue->count) & (gAppTxqDepth_c - 1U)];
+    pEntry->frame = *pFrame;
+    pEntry->pAckRx = pAckRx;
+    pEntry->queuedAt = TMR_GetTimestamp();
+    if(pFrame->dataLen)
+    {
+        FLib_MemCpy(pEntry->data, pFrame->pData, pFrame->dataLen);
+    }
+    pQueue->count++;
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief  Picks the oldest frame of the highest class that may be sent now. The
+*         caller must only call it while the radio is not transmitting.
+*
+* \param[out] pFrame   frame to send, pData stays valid until the next call
+* \param[out] ppAckRx  receive state to attach the pending ack from
+* \param[out] pWaitMs  when FALSE is returned, milliseconds until the reply guard
+*                      releases a held frame, 0 if no frame is queued
+*
+* \return  TRUE if a frame was taken
+*
+********************************************************************************** */
+bool_t AppTxq_Dequeue(app_frame_t* pFrame, app_ack_rx_t** ppAckRx, uint32_t* pWaitMs)
+{
+    uint64_t now = TMR_GetTimestamp();
+    uint32_t txClass;
+
+    *pWaitMs = 0;
+    for(txClass = 0; txClass < gAppTxClassMax_c; txClass++)
+    {
+        app_txq_t* pQueue = &mAppTxq[txClass];
+        app_txq_entry_t* pEntry = &pQueue->entries[pQueue->head];
+        uint32_t delay;
+
+        if(!pQueue->count)
+        {
+            continue;
+        }
+        if((txClass >= gAppTxClassBackground_c) && (now < mAppTxqGuardUntil))
+        {
+            /*round up so the timer never fires before the guard ends*/
+            *pWaitMs = (uint32_t)((mAppTxqGuardUntil - now + 999U) / 1000U);
+            return FALSE;
+        }
+
+        *pFrame = pEntry->frame;
+        *ppAckRx = pEntry->pAckRx;
+        if(pFrame->dataLen)
+        {
+            FLib_MemCpy(mAppTxqCurrentData, pEntry->data, pFrame->dataLen);
+            pFrame->pData = mAppTxqCurrentData;
+        }
+        pQueue->head = (pQueue->head + 1U) & (gAppTxqDepth_c - 1U);
+        pQueue->count--;
+
+        delay = (uint32_t)(now - pEntry->queuedAt);
+        mAppTxqStats[txClass].sent++;
+        mAppTxqStats[txClass].delaySum += delay;
+        if(delay > mAppTxqStats[txClass].delayMax)
+        {
+            mAppTxqStats[txClass].delayMax = delay;
+        }
+        /*a forwarded frame keeps the sequence flag of its originator, the ack
+          it asks for is not for this node*/
+        mAppTxqAwaitReply = ((pFrame->flags & (gAppFrameFlagSeq_c | gAppFrameFlagRaw_c)) == gAppFrameFlagSeq_c) ? TRUE : FALSE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*! *********************************************************************************
+* \brief  Tells how many frames wait in a class, lets a producer keep only one
+*         frame queued and build the next once it left.
+*
+* \param[in] txClass  traffic class
+*
+* \return  frames queued in the class
+*
+********************************************************************************** */
+uint8_t AppTxq_Pending(app_tx_class_t txClass)
+{
+    return mAppTxq[txClass].count;
+}
+
+/*! *********************************************************************************
+* \brief  Starts the reply guard if the frame just sent expects an ack.
+*
+********************************************************************************** */
+void AppTxq_TxDone(void)
+{
+    if(mAppTxqAwaitReply)
+    {
+        mAppTxqGuardUntil = TMR_GetTimestamp() + (gAppTxqReplyGuardMs_c * 1000U);
+        mAppTxqAwaitReply = FALSE;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Ends the reply guard early.
+*
+********************************************************************************** */
+void AppTxq_ReplyReceived(void)
+{
+    mAppTxqGuardUntil = 0;
+}
+
+/*! *********************************************************************************
+* \brief  Prints one CSV record per traffic class:
+*           #X,class,queued,sent,dropped,delaySumUs,delayMaxUs
+*           #E,0,cycles
+*         tools/ctstats.py decodes the records.
+*
+* \param[in]  serId  Serial Manager interface to print on
+*
+********************************************************************************** */
+void AppTxq_Dump(uint8_t serId)
+{
+    uint32_t txClass;
+
+    for(txClass = 0; txClass < gAppTxClassMax_c; txClass++)
+    {
+        Serial_Print(serId, "#X,", gAllowToBlock_d);
+        Serial_PrintDec(serId, txClass);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppTxqStats[txClass].queued);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppTxqStats[txClass].sent);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppTxqStats[txClass].dropped);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppTxqStats[txClass].delaySum);
+        Serial_Print(serId, ",", gAllowToBlock_d);
+        Serial_PrintDec(serId, mAppTxqStats[txClass].delayMax);
+        Serial_Print(serId, "\r\n", gAllowToBlock_d);
+    }
+    Serial_Print(serId, "#E,0,", gAllowToBlock_d);
+    Serial_PrintDec(serId, AppStats_GetCycles());
+    Serial_Print(serId, "\r\n", gAllowToBlock_d);
+}
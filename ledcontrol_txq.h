@@ -0,0 +1,113 @@
+#ifndef _LEDCONTROL_TXQ_H_
+#define _LEDCONTROL_TXQ_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "ledcontrol_frame.h"
+#include "ledcontrol_ack.h"
+#include "ledcontrol_relay.h"
+#include "ledcontrol_ota.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Every frame goes through one FIFO per traffic class and leaves it only when
+ * the radio is free, highest class first. After a frame that expects an ack
+ * the background classes are also held for gAppTxqReplyGuardMs_c, so a
+ * presence probe cannot abort the reception of that ack.
+ */
+
+/*frames held per class, power of two*/
+#ifndef gAppTxqDepth_c
+#define gAppTxqDepth_c               (8)
+#endif
+
+/*command data bytes a queued frame can carry, a join assignment is the largest;
+  relay builds also queue forwarded frames as raw payloads, OTA builds blocks*/
+#if gAppUseRelay_d
+#define gAppTxqDataLen_c             (gAppRelayMaxPayloadLen_c)
+#elif gAppUseOta_d
+#define gAppTxqDataLen_c             (gAppOtaMaxDataLen_c)
+#else
+#define gAppTxqDataLen_c             (12)
+#endif
+
+/*time a sequenced frame keeps the background classes off the air, the slave
+  holds its ack up to gAppAckDelayMs_c, plus turnaround and air time; relayed
+  frames and their acks also wait out the jitter of every hop both ways*/
+#if gAppUseRelay_d
+#define gAppTxqReplyGuardMs_c        (gAppAckDelayMs_c + 2 + (2 * gAppRelayMaxHops_c * (gAppRelayJitterMs_c + 1)))
+#else
+#define gAppTxqReplyGuardMs_c        (gAppAckDelayMs_c + 2)
+#endif
+
+/*UART command that dumps the per class queueing statistics*/
+#define gAppTxqDumpCmd_c             'q'
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*traffic classes, in priority order*/
+typedef enum
+{
+    gAppTxClassCommand_c = 0, /*interactive LED commands*/
+    gAppTxClassAck_c,         /*standalone acks*/
+    gAppTxClassRelay_c,       /*frames forwarded for other nodes, relay builds only*/
+    gAppTxClassSync_c,        /*time sync, held by the reply guard*/
+    gAppTxClassProbe_c,       /*presence probes and replies, held by the reply guard*/
+    gAppTxClassOta_c,         /*OTA blocks, queries and answers, OTA builds only*/
+    gAppTxClassMax_c
+}app_tx_class_t;
+
+/*classes from this one on are background traffic*/
+#define gAppTxClassBackground_c      gAppTxClassSync_c
+
+/*per class counters, delays in microseconds from enqueue to GENFSK_StartTx*/
+typedef struct app_txq_stats_tag
+{
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t delaySum;
+    uint32_t delayMax;
+}app_txq_stats_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*queues a copy of the frame, the ack owed to pAckRx is attached when it is sent;
+  FALSE if the class queue is full or the data does not fit*/
+bool_t AppTxq_Enqueue(app_tx_class_t txClass, const app_frame_t* pFrame, app_ack_rx_t* pAckRx);
+
+/*takes the frame to send next; FALSE if none may go now, *pWaitMs is then the
+  time until a held frame is released, 0 if nothing is held*/
+bool_t AppTxq_Dequeue(app_frame_t* pFrame, app_ack_rx_t** ppAckRx, uint32_t* pWaitMs);
+
+/*frames waiting in a class*/
+uint8_t AppTxq_Pending(app_tx_class_t txClass);
+
+/*the frame taken by the last AppTxq_Dequeue is off the air*/
+void AppTxq_TxDone(void);
+
+/*every ack the reply guard waits for has arrived, release the background classes*/
+void AppTxq_ReplyReceived(void);
+
+/*print the per class counters on the given serial interface*/
+void AppTxq_Dump(uint8_t serId);
+
+#endif /* _LEDCONTROL_TXQ_H_ */
@@ -0,0 +1,691 @@
+#define _GNU_SOURCE
+#include "web_api.h"
+#include "web_json.h"
+#include "web_link.h"
+#include "web_route.h"
+#include "web_serial.h"
+#include "web_state.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+/*JSON body of a response, the head is added in front; GET /api/leds of
+  WEBSERVER_SLAVES slaves takes about 1.7 KB, it fits WEBSERVER_RESPONSE_MAX
+  with the head*/
+#define mWebApiBodyMax_c             1920
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static bool WebApi_Leds(const web_http_request_t* pRequest, web_response_t* pResponse);
+static bool WebApi_Put(const web_http_request_t* pRequest, const char* pPath, uint32_t pathLen,
+                       web_response_t* pResponse);
+static bool WebApi_Batch(const web_http_request_t* pRequest, web_response_t* pResponse);
+static bool WebApi_Events(web_response_t* pResponse);
+static bool WebApi_Link(const web_http_request_t* pRequest, web_response_t* pResponse);
+static bool WebApi_Operation(const char* pText, const web_json_token_t* pTokens, uint32_t obj,
+                             web_mask_t* pSetMask, web_mask_t* pValues, web_mask_t* pFlipMask);
+static int32_t WebApi_Colour(const char* pName, uint32_t len);
+static void WebApi_PutLeds(web_json_writer_t* pWriter, const web_state_t* pState);
+static void WebApi_PutColours(web_json_writer_t* pWriter, uint32_t slave, web_mask_t leds);
+static bool WebApi_Reply(const web_http_request_t* pRequest, web_response_t* pResponse,
+                         const char* pStatus, const web_json_writer_t* pBody);
+static bool WebApi_Error(const web_http_request_t* pRequest, web_response_t* pResponse,
+                         const char* pStatus, const char* pMessage);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+static const char* const mWebApiColours[WEBSERVER_LEDS_PER_SLAVE] = {"red", "green", "blue"};
+
+static uint64_t mWebApiOperations;
+static uint64_t mWebApiCommands;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Routes a request under /api/ by path and method.
+*
+* \param[in]  pRequest   parsed request
+* \param[out] pResponse  rendered into pResponse->pBuf
+*
+* \return  false if the target is not under /api/
+*
+********************************************************************************** */
+bool WebApi_Handle(const web_http_request_t* pRequest, web_response_t* pResponse)
+{
+    static const char slaves[] = "/api/slaves/";
+    const char* pQuery = memchr(pRequest->pTarget, '?', pRequest->targetLen);
+    uint32_t pathLen = pQuery ? (uint32_t)(pQuery - pRequest->pTarget) : pRequest->targetLen;
+    const char* pPath = pRequest->pTarget;
+
+    if((pathLen < 5) || (memcmp(pPath, "/api/", 5) != 0))
+    {
+        return false;
+    }
+
+    if(WebHttp_Equal(pPath, pathLen, "/api/leds"))
+    {
+        if(!WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "GET"))
+        {
+            return WebApi_Error(pRequest, pResponse, "405 Method Not Allowed", "use GET");
+        }
+        return WebApi_Leds(pRequest, pResponse);
+    }
+    if(WebHttp_Equal(pPath, pathLen, "/api/events"))
+    {
+        if(!WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "GET"))
+        {
+            return WebApi_Error(pRequest, pResponse, "405 Method Not Allowed", "use GET");
+        }
+        return WebApi_Events(pResponse);
+    }
+    if(WebHttp_Equal(pPath, pathLen, "/api/link"))
+    {
+        if(!WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "GET"))
+        {
+            return WebApi_Error(pRequest, pResponse, "405 Method Not Allowed", "use GET");
+        }
+        return WebApi_Link(pRequest, pResponse);
+    }
+    if(WebHttp_Equal(pPath, pathLen, "/api/batch"))
+    {
+        if(!WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "POST"))
+        {
+            return WebApi_Error(pRequest, pResponse, "405 Method Not Allowed", "use POST");
+        }
+        return WebApi_Batch(pRequest, pResponse);
+    }
+    if((pathLen > sizeof(slaves) - 1) && (memcmp(pPath, slaves, sizeof(slaves) - 1) == 0))
+    {
+        if(!WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "PUT"))
+        {
+            return WebApi_Error(pRequest, pResponse, "405 Method Not Allowed", "use PUT");
+        }
+        return WebApi_Put(pRequest, pPath + sizeof(slaves) - 1, pathLen - (uint32_t)(sizeof(slaves) - 1), pResponse);
+    }
+    return WebApi_Error(pRequest, pResponse, "404 Not Found", "no such resource");
+}
+
+/*! *********************************************************************************
+* \brief  Updates the shared state and queues the toggle digits of the LEDs that
+*         changed, one serial write per master, lowest digit first. The masters
+*         take their commands side by side.
+*
+* \param[in]  setMask     LEDs given an absolute state
+* \param[in]  values      their state
+* \param[in]  flipMask    LEDs toggled after the sets
+* \param[in]  operations  logical LED operations requested
+* \param[out] pLeds       new state mask
+* \param[out] pChanged    LEDs that changed, one command each
+*
+* \return  false if the serial queue of a master was full; the LEDs of that
+*          master are restored
+*
+********************************************************************************** */
+bool WebApi_Apply(web_mask_t setMask, web_mask_t values, web_mask_t flipMask, uint32_t operations,
+                  web_mask_t* pLeds, web_mask_t* pChanged)
+{
+    char digits[WEBSERVER_SLAVES_PER_MASTER * WEBSERVER_LEDS_PER_SLAVE];
+    web_mask_t changed = WebState_Apply(setMask, values, flipMask, pLeds);
+    web_mask_t refused = 0;
+    web_mask_t unacked = 0;
+    uint32_t commands = 0;
+    uint32_t master;
+
+    for(master = 0; changed && (master < WEBSERVER_MASTERS); master++)
+    {
+        uint32_t count = WebRoute_Digits(master, changed, digits);
+
+        //without a port the commands are dropped and the state still follows requests
+        if(count && !WebSerial_Write(master, digits, count) && WebSerial_IsOpen(master))
+        {
+            refused |= changed & WebRoute_Leds(master);
+            continue;
+        }
+        if(!WebSerial_IsDuplex(master))
+        {
+            unacked |= changed & WebRoute_Leds(master);
+        }
+        commands += count;
+    }
+    if(refused)
+    {
+        //toggling the same LEDs again undoes them, whatever ran meanwhile
+        (void)WebState_Apply(0, 0, refused, pLeds);
+        changed &= ~refused;
+    }
+    //no acks will come, the requests are all there is to show
+    WebState_Confirm(unacked);
+
+    __atomic_add_fetch(&mWebApiOperations, operations, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mWebApiCommands, commands, __ATOMIC_RELAXED);
+    *pChanged = changed;
+    if(changed)
+    {
+        WebLoop_Push();
+    }
+    return !refused;
+}
+
+/*! *********************************************************************************
+* \brief  Renders the current state as one event of /api/events:
+*         id: n, event: leds, data: {"version": n, "leds": mask,
+*         "requested": mask, "connected": mask}.
+*
+* \param[out] pEvent    event text
+* \param[in]  eventMax  room for it
+*
+* \return  length of the event, 0 if it did not fit
+*
+********************************************************************************** */
+uint32_t WebApi_Event(char* pEvent, uint32_t eventMax)
+{
+    web_state_t state;
+    uint32_t version = WebState_Get(&state);
+    int len = snprintf(pEvent, eventMax,
+                       "id: %u\nevent: leds\ndata: {\"version\":%u,\"leds\":%" PRIu64 ",\"requested\":%" PRIu64
+                       ",\"connected\":%" PRIu64 "}\n\n",
+                       version, version, state.confirmed, state.leds, state.present & WebRoute_Slaves());
+
+    return ((len > 0) && ((uint32_t)len < eventMax)) ? (uint32_t)len : 0;
+}
+
+void WebApi_Stats(uint64_t* pOperations, uint64_t* pCommands)
+{
+    *pOperations = __atomic_load_n(&mWebApiOperations, __ATOMIC_RELAXED);
+    *pCommands = __atomic_load_n(&mWebApiCommands, __ATOMIC_RELAXED);
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  GET /api/leds: {"version": n, "slaves": [{"id": 0, "connected": true,
+*         "leds": {"red": false, "green": true, "blue": false}, "pending": {...}},
+*         ...]}, leds as the master confirmed them, pending where a request
+*         is still on its way.
+*
+********************************************************************************** */
+static bool WebApi_Leds(const web_http_request_t* pRequest, web_response_t* pResponse)
+{
+    char body[mWebApiBodyMax_c];
+    web_json_writer_t writer;
+    web_state_t state;
+    uint32_t version = WebState_Get(&state);
+
+    WebJson_WriterInit(&writer, body, sizeof(body));
+    WebJson_PutRaw(&writer, "{\"version\":");
+    WebJson_PutUint(&writer, version);
+    WebJson_PutRaw(&writer, ",");
+    WebApi_PutLeds(&writer, &state);
+    WebJson_PutRaw(&writer, "}");
+    return WebApi_Reply(pRequest, pResponse, "200 OK", &writer);
+}
+
+/*! *********************************************************************************
+* \brief  PUT /api/slaves/{id}/leds/{colour} with {"on": bool} or {"toggle": true}.
+*
+* \param[in] pPath    path after /api/slaves/
+* \param[in] pathLen  its length
+*
+********************************************************************************** */
+static bool WebApi_Put(const web_http_request_t* pRequest, const char* pPath, uint32_t pathLen,
+                       web_response_t* pResponse)
+{
+    web_json_token_t tokens[8];
+    char body[mWebApiBodyMax_c];
+    web_json_writer_t writer;
+    uint32_t slave = 0;
+    uint32_t digits = 0;
+    web_mask_t setMask = 0;
+    web_mask_t values = 0;
+    web_mask_t flipMask = 0;
+    web_mask_t leds;
+    web_mask_t changed;
+    int32_t colour;
+    int32_t on;
+    int32_t toggle;
+    bool value;
+
+    //{id}/leds/{colour}
+    while((digits < pathLen) && (digits < 3) && (pPath[digits] >= '0') && (pPath[digits] <= '9'))
+    {
+        slave = (slave * 10U) + (uint32_t)(pPath[digits] - '0');
+        digits++;
+    }
+    if(!digits || (pathLen - digits < 6) || (memcmp(&pPath[digits], "/leds/", 6) != 0) ||
+       !WebRoute_Find(slave, NULL, NULL))
+    {
+        return WebApi_Error(pRequest, pResponse, "404 Not Found", "no such slave LED");
+    }
+    colour = WebApi_Colour(&pPath[digits + 6], pathLen - digits - 6);
+    if(colour < 0)
+    {
+        return WebApi_Error(pRequest, pResponse, "404 Not Found", "no such slave LED");
+    }
+
+    if(WebJson_Parse(pRequest->pBody, pRequest->bodyLen, tokens, sizeof(tokens) / sizeof(tokens[0])) < 0)
+    {
+        return WebApi_Error(pRequest, pResponse, "400 Bad Request", "body is not JSON");
+    }
+    on = WebJson_Find(pRequest->pBody, tokens, 0, "on");
+    toggle = WebJson_Find(pRequest->pBody, tokens, 0, "toggle");
+    if((on >= 0) && (toggle < 0) && WebJson_GetBool(&tokens[on], &value))
+    {
+        setMask = WebState_Bit(slave, (uint32_t)colour);
+        values = value ? setMask : 0;
+    }
+    else if((toggle >= 0) && (on < 0) && WebJson_GetBool(&tokens[toggle], &value) && value)
+    {
+        flipMask = WebState_Bit(slave, (uint32_t)colour);
+    }
+    else
+    {
+        return WebApi_Error(pRequest, pResponse, "400 Bad Request", "expected {\"on\": bool} or {\"toggle\": true}");
+    }
+
+    if(!WebApi_Apply(setMask, values, flipMask, 1, &leds, &changed))
+    {
+        return WebApi_Error(pRequest, pResponse, "503 Service Unavailable", "serial queue full");
+    }
+
+    WebJson_WriterInit(&writer, body, sizeof(body));
+    WebJson_PutRaw(&writer, "{\"slave\":");
+    WebJson_PutUint(&writer, slave);
+    WebJson_PutRaw(&writer, ",\"colour\":\"");
+    WebJson_PutRaw(&writer, mWebApiColours[colour]);
+    WebJson_PutRaw(&writer, "\",\"on\":");
+    WebJson_PutBool(&writer, (leds & WebState_Bit(slave, (uint32_t)colour)) != 0);
+    WebJson_PutRaw(&writer, ",\"commands\":");
+    WebJson_PutUint(&writer, changed ? 1 : 0);
+    WebJson_PutRaw(&writer, "}");
+    return WebApi_Reply(pRequest, pResponse, "200 OK", &writer);
+}
+
+/*! *********************************************************************************
+* \brief  POST /api/batch: folds the operations in order into one set/toggle
+*         update, nothing is applied if any operation is invalid.
+*
+********************************************************************************** */
+static bool WebApi_Batch(const web_http_request_t* pRequest, web_response_t* pResponse)
+{
+    web_json_token_t tokens[WEBSERVER_API_TOKENS];
+    char body[mWebApiBodyMax_c];
+    web_json_writer_t writer;
+    web_state_t state;
+    web_mask_t setMask = 0;
+    web_mask_t values = 0;
+    web_mask_t flipMask = 0;
+    web_mask_t leds;
+    web_mask_t changed;
+    uint32_t commands = 0;
+    uint32_t op;
+    uint32_t i = 1;
+
+    if((WebJson_Parse(pRequest->pBody, pRequest->bodyLen, tokens, WEBSERVER_API_TOKENS) < 0) ||
+       (tokens[0].type != gWebJsonArray_c))
+    {
+        return WebApi_Error(pRequest, pResponse, "400 Bad Request", "body is not a JSON array");
+    }
+    for(op = 0; op < tokens[0].size; op++)
+    {
+        if(!WebApi_Operation(pRequest->pBody, tokens, i, &setMask, &values, &flipMask))
+        {
+            return WebApi_Error(pRequest, pResponse, "400 Bad Request",
+                                "each operation needs slave, colour and on or toggle");
+        }
+        i = tokens[i].next;
+    }
+
+    if(!WebApi_Apply(setMask, values, flipMask, tokens[0].size, &leds, &changed))
+    {
+        return WebApi_Error(pRequest, pResponse, "503 Service Unavailable", "serial queue full");
+    }
+    for(; changed; changed &= changed - 1)
+    {
+        commands++;
+    }
+
+    WebJson_WriterInit(&writer, body, sizeof(body));
+    WebJson_PutRaw(&writer, "{\"operations\":");
+    WebJson_PutUint(&writer, tokens[0].size);
+    WebJson_PutRaw(&writer, ",\"commands\":");
+    WebJson_PutUint(&writer, commands);
+    WebJson_PutRaw(&writer, ",");
+    (void)WebState_Get(&state);
+    WebApi_PutLeds(&writer, &state);
+    WebJson_PutRaw(&writer, "}");
+    return WebApi_Reply(pRequest, pResponse, "200 OK", &writer);
+}
+
+/*! *********************************************************************************
+* \brief  GET /api/events: starts a Server-Sent Events stream with the current
+*         state, the loop then sends an event after each change.
+*
+********************************************************************************** */
+static bool WebApi_Events(web_response_t* pResponse)
+{
+    static const char head[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-store\r\n\r\n"
+        "retry: 1000\n";
+    uint32_t len;
+
+    if(pResponse->bufMax < sizeof(head))
+    {
+        return false;
+    }
+    memcpy(pResponse->pBuf, head, sizeof(head) - 1);
+    len = WebApi_Event(&pResponse->pBuf[sizeof(head) - 1], pResponse->bufMax - (uint32_t)(sizeof(head) - 1));
+    if(len == 0)
+    {
+        return false;
+    }
+    pResponse->pData = pResponse->pBuf;
+    pResponse->len = (uint32_t)(sizeof(head) - 1) + len;
+    pResponse->stream = true;
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  GET /api/link: toggles sent to the masters, acked and lost, and the
+*         queue to ack latency: percentiles of the latest acks and the latest
+*         of each LED, in microseconds; then the same counts for each master
+*         with the bytes written to its port.
+*
+********************************************************************************** */
+static bool WebApi_Link(const web_http_request_t* pRequest, web_response_t* pResponse)
+{
+    char body[mWebApiBodyMax_c];
+    web_json_writer_t writer;
+    web_link_stats_t stats;
+    const char* pSep = "{\"id\":";
+    bool duplex = false;
+    uint32_t master;
+    uint32_t slave;
+
+    WebLink_Stats(&stats);
+    for(master = 0; master < WEBSERVER_MASTERS; master++)
+    {
+        duplex |= WebSerial_IsDuplex(master);
+    }
+    WebJson_WriterInit(&writer, body, sizeof(body));
+    WebJson_PutRaw(&writer, "{\"duplex\":");
+    WebJson_PutBool(&writer, duplex);
+    WebJson_PutRaw(&writer, ",\"sent\":");
+    WebJson_PutUint(&writer, stats.sent);
+    WebJson_PutRaw(&writer, ",\"acked\":");
+    WebJson_PutUint(&writer, stats.acked);
+    WebJson_PutRaw(&writer, ",\"lost\":");
+    WebJson_PutUint(&writer, stats.lost);
+    WebJson_PutRaw(&writer, ",\"unexpected\":");
+    WebJson_PutUint(&writer, stats.unexpected);
+    WebJson_PutRaw(&writer, ",\"late\":");
+    WebJson_PutUint(&writer, stats.late);
+    WebJson_PutRaw(&writer, ",\"outstanding\":");
+    WebJson_PutUint(&writer, stats.outstanding);
+    WebJson_PutRaw(&writer, ",\"refused\":");
+    WebJson_PutUint(&writer, stats.refused);
+    WebJson_PutRaw(&writer, ",\"records\":{\"received\":");
+    WebJson_PutUint(&writer, stats.records);
+    WebJson_PutRaw(&writer, ",\"bad\":");
+    WebJson_PutUint(&writer, stats.badRecords);
+    WebJson_PutRaw(&writer, ",\"missed\":");
+    WebJson_PutUint(&writer, stats.missedRecords);
+    WebJson_PutRaw(&writer, "},\"latency_us\":{\"samples\":");
+    WebJson_PutUint(&writer, stats.samples);
+    WebJson_PutRaw(&writer, ",\"p50\":");
+    WebJson_PutUint(&writer, stats.p50Us);
+    WebJson_PutRaw(&writer, ",\"p99\":");
+    WebJson_PutUint(&writer, stats.p99Us);
+    WebJson_PutRaw(&writer, ",\"max\":");
+    WebJson_PutUint(&writer, stats.maxUs);
+    WebJson_PutRaw(&writer, "},\"masters\":[");
+    for(master = 0; master < WEBSERVER_MASTERS; master++)
+    {
+        uint64_t written;
+        uint64_t cancelled;
+
+        if(!WebRoute_Leds(master))
+        {
+            continue;
+        }
+        WebSerial_Stats(master, &written, &cancelled);
+        WebJson_PutRaw(&writer, pSep);
+        pSep = ",{\"id\":";
+        WebJson_PutUint(&writer, master);
+        WebJson_PutRaw(&writer, ",\"open\":");
+        WebJson_PutBool(&writer, WebSerial_IsOpen(master));
+        WebJson_PutRaw(&writer, ",\"duplex\":");
+        WebJson_PutBool(&writer, WebSerial_IsDuplex(master));
+        WebJson_PutRaw(&writer, ",\"bytes\":");
+        WebJson_PutUint(&writer, written);
+        WebJson_PutRaw(&writer, ",\"cancelled\":");
+        WebJson_PutUint(&writer, cancelled);
+        WebJson_PutRaw(&writer, ",\"sent\":");
+        WebJson_PutUint(&writer, stats.masters[master].sent);
+        WebJson_PutRaw(&writer, ",\"acked\":");
+        WebJson_PutUint(&writer, stats.masters[master].acked);
+        WebJson_PutRaw(&writer, ",\"lost\":");
+        WebJson_PutUint(&writer, stats.masters[master].lost);
+        WebJson_PutRaw(&writer, "}");
+    }
+    WebJson_PutRaw(&writer, "],\"slaves\":[");
+    pSep = "{\"id\":";
+    for(slave = 0; slave < WEBSERVER_SLAVES; slave++)
+    {
+        uint32_t led;
+
+        if(!WebRoute_Find(slave, NULL, NULL))
+        {
+            continue;
+        }
+        WebJson_PutRaw(&writer, pSep);
+        pSep = ",{\"id\":";
+        WebJson_PutUint(&writer, slave);
+        WebJson_PutRaw(&writer, ",\"last_ack_us\":{");
+        for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+        {
+            WebJson_PutRaw(&writer, led ? ",\"" : "\"");
+            WebJson_PutRaw(&writer, mWebApiColours[led]);
+            WebJson_PutRaw(&writer, "\":");
+            WebJson_PutUint(&writer, stats.lastUs[(slave * WEBSERVER_LEDS_PER_SLAVE) + led]);
+        }
+        WebJson_PutRaw(&writer, "}}");
+    }
+    WebJson_PutRaw(&writer, "]}");
+    return WebApi_Reply(pRequest, pResponse, "200 OK", &writer);
+}
+
+/*! *********************************************************************************
+* \brief  Folds one batch operation into the update: "on" overrides earlier
+*         operations on the LED, "toggle" flips its set value or its pending
+*         toggle, so a toggle pair cancels out.
+*
+* \return  false if the operation is malformed
+*
+********************************************************************************** */
+static bool WebApi_Operation(const char* pText, const web_json_token_t* pTokens, uint32_t obj,
+                             web_mask_t* pSetMask, web_mask_t* pValues, web_mask_t* pFlipMask)
+{
+    int32_t slaveTok = WebJson_Find(pText, pTokens, obj, "slave");
+    int32_t colourTok = WebJson_Find(pText, pTokens, obj, "colour");
+    int32_t on = WebJson_Find(pText, pTokens, obj, "on");
+    int32_t toggle = WebJson_Find(pText, pTokens, obj, "toggle");
+    uint32_t slave;
+    int32_t colour;
+    web_mask_t bit;
+    bool value;
+
+    if(colourTok < 0)
+    {
+        colourTok = WebJson_Find(pText, pTokens, obj, "color");
+    }
+    if((slaveTok < 0) || (colourTok < 0) || !WebJson_GetUint(pText, &pTokens[slaveTok], &slave) ||
+       !WebRoute_Find(slave, NULL, NULL) || (pTokens[colourTok].type != gWebJsonString_c))
+    {
+        return false;
+    }
+    colour = WebApi_Colour(&pText[pTokens[colourTok].start], pTokens[colourTok].len);
+    if(colour < 0)
+    {
+        return false;
+    }
+    bit = WebState_Bit(slave, (uint32_t)colour);
+
+    if((on >= 0) && (toggle < 0) && WebJson_GetBool(&pTokens[on], &value))
+    {
+        *pSetMask |= bit;
+        *pValues = value ? (*pValues | bit) : (*pValues & ~bit);
+        *pFlipMask &= ~bit;
+        return true;
+    }
+    if((toggle >= 0) && (on < 0) && WebJson_GetBool(&pTokens[toggle], &value) && value)
+    {
+        if(*pSetMask & bit)
+        {
+            *pValues ^= bit;
+        }
+        else
+        {
+            *pFlipMask ^= bit;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*! *********************************************************************************
+* \brief  LED index of a colour name.
+*
+* \return  0 red, 1 green, 2 blue, -1 unknown
+*
+********************************************************************************** */
+static int32_t WebApi_Colour(const char* pName, uint32_t len)
+{
+    int32_t led;
+
+    for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+    {
+        if(WebHttp_Equal(pName, len, mWebApiColours[led]))
+        {
+            return led;
+        }
+    }
+    return -1;
+}
+
+/*! *********************************************************************************
+* \brief  Appends "slaves": [...] with the presence of every slave routed to a
+*         master, its LEDs as confirmed and those with a request pending.
+*
+********************************************************************************** */
+static void WebApi_PutLeds(web_json_writer_t* pWriter, const web_state_t* pState)
+{
+    const char* pSep = "{\"id\":";
+    uint32_t master;
+    uint32_t slave;
+
+    WebJson_PutRaw(pWriter, "\"slaves\":[");
+    for(slave = 0; slave < WEBSERVER_SLAVES; slave++)
+    {
+        if(!WebRoute_Find(slave, &master, NULL))
+        {
+            continue;
+        }
+        WebJson_PutRaw(pWriter, pSep);
+        pSep = ",{\"id\":";
+        WebJson_PutUint(pWriter, slave);
+        WebJson_PutRaw(pWriter, ",\"master\":");
+        WebJson_PutUint(pWriter, master);
+        WebJson_PutRaw(pWriter, ",\"connected\":");
+        WebJson_PutBool(pWriter, (pState->present & ((web_mask_t)1U << slave)) != 0);
+        WebJson_PutRaw(pWriter, ",\"leds\":");
+        WebApi_PutColours(pWriter, slave, pState->confirmed);
+        WebJson_PutRaw(pWriter, ",\"pending\":");
+        WebApi_PutColours(pWriter, slave, pState->leds ^ pState->confirmed);
+        WebJson_PutRaw(pWriter, "}");
+    }
+    WebJson_PutRaw(pWriter, "]");
+}
+
+/*! *********************************************************************************
+* \brief  Appends {"red": bool, "green": bool, "blue": bool} of a slave's bits.
+*
+********************************************************************************** */
+static void WebApi_PutColours(web_json_writer_t* pWriter, uint32_t slave, web_mask_t leds)
+{
+    uint32_t led;
+
+    WebJson_PutRaw(pWriter, "{");
+    for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+    {
+        WebJson_PutRaw(pWriter, led ? ",\"" : "\"");
+        WebJson_PutRaw(pWriter, mWebApiColours[led]);
+        WebJson_PutRaw(pWriter, "\":");
+        WebJson_PutBool(pWriter, (leds & WebState_Bit(slave, led)) != 0);
+    }
+    WebJson_PutRaw(pWriter, "}");
+}
+
+/*! *********************************************************************************
+* \brief  Renders status line, headers and the JSON body into the connection
+*         buffer.
+*
+* \return  false if it did not fit, the connection is dropped
+*
+********************************************************************************** */
+static bool WebApi_Reply(const web_http_request_t* pRequest, web_response_t* pResponse,
+                         const char* pStatus, const web_json_writer_t* pBody)
+{
+    int len;
+
+    if(pBody->overflow)
+    {
+        return false;
+    }
+    len = snprintf(pResponse->pBuf, pResponse->bufMax,
+                   "HTTP/1.1 %s\r\nConnection: %s\r\nContent-Type: application/json\r\n"
+                   "Cache-Control: no-store\r\nContent-Length: %u\r\n\r\n",
+                   pStatus, pRequest->keepAlive ? "keep-alive" : "close", pBody->len);
+    if((len <= 0) || ((uint32_t)len + pBody->len > pResponse->bufMax))
+    {
+        return false;
+    }
+    memcpy(&pResponse->pBuf[len], pBody->pBuf, pBody->len);
+    pResponse->pData = pResponse->pBuf;
+    pResponse->len = (uint32_t)len + pBody->len;
+    return true;
+}
+
+static bool WebApi_Error(const web_http_request_t* pRequest, web_response_t* pResponse,
+                         const char* pStatus, const char* pMessage)
+{
+    char body[256];
+    web_json_writer_t writer;
+
+    WebJson_WriterInit(&writer, body, sizeof(body));
+    WebJson_PutRaw(&writer, "{\"error\":");
+    WebJson_PutString(&writer, pMessage, (uint32_t)strlen(pMessage));
+    WebJson_PutRaw(&writer, "}");
+    return WebApi_Reply(pRequest, pResponse, pStatus, &writer);
+}
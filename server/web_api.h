@@ -0,0 +1,77 @@
+#ifndef __WEB_API_H_
+#define __WEB_API_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "web_loop.h"
+#include "web_state.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * REST API of the bridge for machine clients, JSON both ways:
+ *
+ *   GET  /api/leds                        state of every LED of every slave
+ *   GET  /api/events                      Server-Sent Events, one "leds" event with
+ *                                         the state now and one after each change
+ *   GET  /api/link                        toggles sent to the masters, acked and lost,
+ *                                         request to ack latency; with -f also
+ *                                         records received, bad and missed and
+ *                                         toggles the masters refused; the counts
+ *                                         of each master
+ *   PUT  /api/slaves/{id}/leds/{colour}   {"on": true|false} or {"toggle": true}
+ *   POST /api/batch                       [{"slave": 0, "colour": "red", "on": true},
+ *                                          {"slave": 2, "colour": "blue", "toggle": true}, ...]
+ *
+ * colour is red, green or blue, slave one routed to a master (web_route.c). A
+ * batch is checked as a whole and applied as one update of the shared state:
+ * operations on the same LED fold together and only an LED that ends up
+ * changed costs a serial command, the single toggle digit its master takes
+ * for it, sent in one write per master.
+ *
+ * LED states read back are those the master confirmed (web_link.c), with the
+ * requested ones still pending marked. The data of an event is {"version": n,
+ * "leds": mask, "requested": mask, "connected": mask}, bit slave * 3 + led of
+ * a mask set for an LED that is on, led 0 red, 1 green, 2 blue, bit slave of
+ * connected set for a slave routed to a master and present. Events carry the
+ * latest state rather than each change, a client that falls behind skips to
+ * it.
+ */
+
+/*JSON tokens a request body may hold, a batch operation takes 7*/
+#define WEBSERVER_API_TOKENS         512
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*answers a request whose target is under /api/, false for any other target*/
+bool WebApi_Handle(const web_http_request_t* pRequest, web_response_t* pResponse);
+
+/*applies LED requests to the shared state (WebState_Apply) and queues one
+  toggle digit per LED that changed to its master; operations is the number
+  of logical LED operations they stand for. False if the serial queue of a
+  master refused its digits, its LEDs are then left as they were*/
+bool WebApi_Apply(web_mask_t setMask, web_mask_t values, web_mask_t flipMask, uint32_t operations,
+                  web_mask_t* pLeds, web_mask_t* pChanged);
+
+/*renders the event streams get, for WebLoop_Init*/
+uint32_t WebApi_Event(char* pEvent, uint32_t eventMax);
+
+/*logical LED operations and serial commands since start*/
+void WebApi_Stats(uint64_t* pOperations, uint64_t* pCommands);
+
+#endif /* __WEB_API_H_ */
@@ -0,0 +1,899 @@
+/*
+ * Load benchmark of the web bridge. For each connection count it keeps that
+ * many clients busy against a running server for a while, every client sending
+ * a request as soon as the answer to its previous one is complete, and reports
+ * requests/second and latency percentiles. By default every request opens a
+ * connection and asks for it to be closed, it is timed from the start of its
+ * connect to the end of the response so the TCP handshake is included. -k
+ * keeps each connection open and times a request from its send to the end of
+ * its response, found from Content-Length; -P n pipelines n requests per
+ * send on a kept connection.
+ *
+ *   gcc -O2 -Wall -pthread -o web_bench web_bench.c
+ *   ./webserver -p 8080 -w 4 &
+ *   ./web_bench -p 8080 -d 10 -c 1,100,10000 -j 4
+ *   ./web_bench -p 8080 -d 10 -c 1,100,10000 -j 4 -k
+ *
+ * -m picks the request: page (GET /, the default), toggle (a dashboard button
+ * post, also -t), leds (GET /api/leds), put (PUT of one slave LED) or batch
+ * (POST /api/batch of eight operations, some folding together); the server
+ * prints serial bytes per LED operation when it stops. -j spreads the
+ * clients over that many threads, each with its own epoll, so the client side
+ * keeps up with a multi-worker server; their samples are merged. Client and server
+ * each need a descriptor per connection, both raise RLIMIT_NOFILE to its hard
+ * limit.
+ *
+ * -e ms measures the push to dashboards instead: each -c level opens that many
+ * /api/events streams, then an LED is toggled every ms milliseconds, the next
+ * toggle waiting until every stream got the event of the previous one. A
+ * latency is from the send of the toggle to the arrival of its event on one
+ * stream; a stream without it after a second is counted as an error.
+ *   ./web_bench -p 8080 -d 10 -c 100,1000 -e 10
+ */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#define mBenchMaxLevels_c            16
+#define mBenchEvents_c               512
+#define mBenchMaxThreads_c           64
+#define mBenchMaxDepth_c             64
+#define mBenchHeadMax_c              1024
+#define mBenchEventWaitNs_c          1000000000ULL
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+typedef enum
+{
+    mBenchConnecting_c = 0,
+    mBenchSending_c,
+    mBenchReceiving_c
+}bench_state_t;
+
+typedef struct bench_client_tag
+{
+    int fd;
+    bench_state_t state;
+    uint32_t sent;
+    uint32_t received;
+    uint64_t startNs;
+    /*keep-alive: responses still expected for the requests sent, and the
+      response being parsed*/
+    uint32_t pending;
+    uint32_t headLen;
+    uint32_t bodyLeft;
+    bool inBody;
+    char head[mBenchHeadMax_c];
+}bench_client_t;
+
+typedef struct bench_result_tag
+{
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t bytes;
+    uint32_t* pLatencyUs;
+    uint64_t latencyCount;
+    uint64_t latencyMax;
+}bench_result_t;
+
+typedef struct bench_mode_tag
+{
+    const char* pName;
+    const char* pMethod;
+    const char* pPath;
+    const char* pType;          /*NULL without a body*/
+    const char* pBody;
+}bench_mode_t;
+
+/*an /api/events stream of -e*/
+typedef struct bench_stream_tag
+{
+    int fd;
+    /*toggle whose event arrived last*/
+    uint32_t seen;
+    uint32_t lineLen;
+    char line[64];
+}bench_stream_t;
+
+/*one load thread and its share of the clients*/
+typedef struct bench_thread_tag
+{
+    pthread_t thread;
+    int epollFd;
+    bench_client_t* pClients;
+    uint32_t connections;
+    uint64_t warmEndNs;
+    uint64_t endNs;
+    bench_result_t result;
+}bench_thread_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+static struct sockaddr_in mBenchAddr;
+static char* mpBenchRequest;
+static uint32_t mBenchRequestLen;
+static bool mBenchKeepAlive;
+static uint32_t mBenchDepth = 1;
+
+/*request of each -m mode*/
+static const bench_mode_t mBenchModes[] =
+{
+    {"page",   "GET",  "/",                        NULL, NULL},
+    {"toggle", "POST", "/",                        "application/x-www-form-urlencoded", "button=0"},
+    {"leds",   "GET",  "/api/leds",                NULL, NULL},
+    {"put",    "PUT",  "/api/slaves/1/leds/green", "application/json", "{\"toggle\":true}"},
+    {"batch",  "POST", "/api/batch",               "application/json",
+     "[{\"slave\":0,\"colour\":\"red\",\"toggle\":true},{\"slave\":0,\"colour\":\"red\",\"toggle\":true},"
+     "{\"slave\":1,\"colour\":\"green\",\"on\":true},{\"slave\":1,\"colour\":\"green\",\"on\":false},"
+     "{\"slave\":2,\"colour\":\"blue\",\"toggle\":true},{\"slave\":0,\"colour\":\"green\",\"toggle\":true},"
+     "{\"slave\":2,\"colour\":\"red\",\"toggle\":true},{\"slave\":1,\"colour\":\"blue\",\"on\":true}]"}
+};
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+static uint64_t Bench_NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+static void Bench_Record(bench_result_t* pResult, uint64_t latencyNs)
+{
+    if((pResult->latencyCount & (pResult->latencyCount - 1)) == 0)
+    {
+        //power of two reached, double the sample array
+        uint64_t capacity = pResult->latencyCount ? pResult->latencyCount * 2 : 1024;
+
+        pResult->pLatencyUs = realloc(pResult->pLatencyUs, capacity * sizeof(uint32_t));
+        if(!pResult->pLatencyUs)
+        {
+            perror("realloc"), exit(-1);
+        }
+    }
+    pResult->pLatencyUs[pResult->latencyCount++] = (uint32_t)(latencyNs / 1000U);
+    if(latencyNs > pResult->latencyMax)
+    {
+        pResult->latencyMax = latencyNs;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Starts a new request on a client: a fresh non-blocking connect, the
+*         request goes out once it completes.
+*
+********************************************************************************** */
+static bool Bench_Start(int epollFd, bench_client_t* pClient)
+{
+    struct epoll_event ev;
+    int one = 1;
+
+    pClient->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(pClient->fd < 0)
+    {
+        return false;
+    }
+    (void)setsockopt(pClient->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    pClient->state = mBenchConnecting_c;
+    pClient->sent = 0;
+    pClient->received = 0;
+    pClient->headLen = 0;
+    pClient->inBody = false;
+    pClient->startNs = Bench_NowNs();
+
+    if((connect(pClient->fd, (struct sockaddr*)&mBenchAddr, sizeof(mBenchAddr)) < 0) &&
+       (errno != EINPROGRESS))
+    {
+        close(pClient->fd);
+        pClient->fd = -1;
+        return false;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLOUT;
+    ev.data.ptr = pClient;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, pClient->fd, &ev) < 0)
+    {
+        close(pClient->fd);
+        pClient->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+static void Bench_Stop(bench_client_t* pClient)
+{
+    if(pClient->fd >= 0)
+    {
+        close(pClient->fd);
+        pClient->fd = -1;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Follows the responses on a kept connection: head up to the empty line,
+*         then Content-Length body bytes.
+*
+* \return  number of responses completed by these bytes, -1 if one is malformed
+*
+********************************************************************************** */
+static int32_t Bench_Parse(bench_client_t* pClient, const char* pData, uint32_t len)
+{
+    int32_t done = 0;
+
+    while(len)
+    {
+        if(!pClient->inBody)
+        {
+            const char* pLength;
+
+            if(pClient->headLen == mBenchHeadMax_c - 1)
+            {
+                return -1;
+            }
+            pClient->head[pClient->headLen++] = *pData++;
+            len--;
+            if((pClient->headLen < 4) || memcmp(&pClient->head[pClient->headLen - 4], "\r\n\r\n", 4))
+            {
+                continue;
+            }
+            pClient->head[pClient->headLen] = '\0';
+            pLength = strcasestr(pClient->head, "\r\ncontent-length:");
+            if(!pLength)
+            {
+                return -1;
+            }
+            pClient->bodyLeft = (uint32_t)strtoul(pLength + 17, NULL, 10);
+            pClient->inBody = true;
+        }
+        else
+        {
+            uint32_t take = (len < pClient->bodyLeft) ? len : pClient->bodyLeft;
+
+            pClient->bodyLeft -= take;
+            pData += take;
+            len -= take;
+        }
+
+        if(pClient->inBody && (pClient->bodyLeft == 0))
+        {
+            pClient->inBody = false;
+            pClient->headLen = 0;
+            done++;
+        }
+    }
+    return done;
+}
+
+/*! *********************************************************************************
+* \brief  Advances a client on its epoll events. Without keep-alive the server
+*         closes the connection after the response and end of stream completes
+*         the request; with it the responses are counted off as they complete
+*         and the next batch of requests goes out on the same connection.
+*
+********************************************************************************** */
+static void Bench_Event(int epollFd, bench_client_t* pClient, uint32_t events, bench_result_t* pResult, bool record)
+{
+    struct epoll_event ev;
+    char buf[4096];
+
+    if(pClient->state == mBenchConnecting_c)
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+
+        (void)getsockopt(pClient->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if(err || (events & EPOLLERR))
+        {
+            goto fail;
+        }
+        pClient->state = mBenchSending_c;
+    }
+
+    if(pClient->state == mBenchSending_c)
+    {
+        while(pClient->sent < mBenchRequestLen)
+        {
+            ssize_t sent = send(pClient->fd, mpBenchRequest + pClient->sent,
+                                mBenchRequestLen - pClient->sent, MSG_NOSIGNAL);
+
+            if(sent > 0)
+            {
+                pClient->sent += (uint32_t)sent;
+            }
+            else if((sent < 0) && (errno == EAGAIN))
+            {
+                return;
+            }
+            else
+            {
+                goto fail;
+            }
+        }
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = pClient;
+        (void)epoll_ctl(epollFd, EPOLL_CTL_MOD, pClient->fd, &ev);
+        pClient->state = mBenchReceiving_c;
+        pClient->pending = mBenchDepth;
+        return;
+    }
+
+    for(;;)
+    {
+        ssize_t got = recv(pClient->fd, buf, sizeof(buf), 0);
+
+        if((got > 0) && mBenchKeepAlive)
+        {
+            int32_t done = Bench_Parse(pClient, buf, (uint32_t)got);
+            uint64_t now = Bench_NowNs();
+
+            if((done < 0) || ((uint32_t)done > pClient->pending))
+            {
+                goto fail;
+            }
+            pClient->pending -= (uint32_t)done;
+            if(record)
+            {
+                pResult->requests += (uint32_t)done;
+                pResult->bytes += (uint64_t)got;
+                for(; done > 0; done--)
+                {
+                    Bench_Record(pResult, now - pClient->startNs);
+                }
+            }
+            if(pClient->pending == 0)
+            {
+                //next batch on the same connection
+                pClient->sent = 0;
+                pClient->startNs = now;
+                pClient->state = mBenchSending_c;
+                Bench_Event(epollFd, pClient, EPOLLOUT, pResult, record);
+                return;
+            }
+            continue;
+        }
+        if(got > 0)
+        {
+            pClient->received += (uint32_t)got;
+            continue;
+        }
+        if((got < 0) && (errno == EAGAIN))
+        {
+            return;
+        }
+        if((got == 0) && pClient->received && !mBenchKeepAlive)
+        {
+            if(record)
+            {
+                pResult->requests++;
+                pResult->bytes += pClient->received;
+                Bench_Record(pResult, Bench_NowNs() - pClient->startNs);
+            }
+            Bench_Stop(pClient);
+            (void)Bench_Start(epollFd, pClient);
+            return;
+        }
+        goto fail;
+    }
+
+fail:
+    if(record)
+    {
+        pResult->errors++;
+    }
+    Bench_Stop(pClient);
+    (void)Bench_Start(epollFd, pClient);
+}
+
+static int Bench_Compare(const void* pA, const void* pB)
+{
+    uint32_t a = *(const uint32_t*)pA;
+    uint32_t b = *(const uint32_t*)pB;
+
+    return (a > b) - (a < b);
+}
+
+static double Bench_Percentile(const bench_result_t* pResult, double fraction)
+{
+    uint64_t index;
+
+    if(!pResult->latencyCount)
+    {
+        return 0.0;
+    }
+    index = (uint64_t)(fraction * (double)(pResult->latencyCount - 1));
+    return pResult->pLatencyUs[index] / 1000.0;
+}
+
+/*! *********************************************************************************
+* \brief  Load thread: drives its clients until the end of the level, recording
+*         only after the warm-up.
+*
+********************************************************************************** */
+static void* Bench_Thread(void* pArg)
+{
+    bench_thread_t* pThread = pArg;
+    struct epoll_event events[mBenchEvents_c];
+
+    for(;;)
+    {
+        uint64_t now = Bench_NowNs();
+        int count;
+        int n;
+
+        if(now >= pThread->endNs)
+        {
+            break;
+        }
+        count = epoll_wait(pThread->epollFd, events, mBenchEvents_c, (int)((pThread->endNs - now) / 1000000U) + 1);
+        for(n = 0; n < count; n++)
+        {
+            Bench_Event(pThread->epollFd, events[n].data.ptr, events[n].events, &pThread->result,
+                        now >= pThread->warmEndNs);
+        }
+    }
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Runs one level: opens the clients, split over the threads, lets them
+*         settle for a second, then counts completed requests for the measured
+*         period.
+*
+********************************************************************************** */
+static void Bench_Level(uint32_t connections, double seconds, uint32_t threads)
+{
+    bench_client_t* pClients = calloc(connections, sizeof(bench_client_t));
+    bench_thread_t pool[mBenchMaxThreads_c];
+    bench_result_t result;
+    uint64_t warmEndNs;
+    uint64_t endNs;
+    uint32_t started = 0;
+    uint32_t first = 0;
+    uint32_t i;
+    uint32_t t;
+
+    if(threads > connections)
+    {
+        threads = connections;
+    }
+    memset(&result, 0, sizeof(result));
+    memset(pool, 0, sizeof(pool));
+    if(!pClients)
+    {
+        perror("setup"), exit(-1);
+    }
+
+    warmEndNs = Bench_NowNs() + 1000000000ULL;
+    endNs = warmEndNs + (uint64_t)(seconds * 1e9);
+    for(t = 0; t < threads; t++)
+    {
+        bench_thread_t* pThread = &pool[t];
+
+        pThread->pClients = &pClients[first];
+        pThread->connections = (connections / threads) + ((t < connections % threads) ? 1 : 0);
+        pThread->warmEndNs = warmEndNs;
+        pThread->endNs = endNs;
+        pThread->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if(pThread->epollFd < 0)
+        {
+            perror("epoll_create1"), exit(-1);
+        }
+        for(i = 0; i < pThread->connections; i++)
+        {
+            pThread->pClients[i].fd = -1;
+            started += Bench_Start(pThread->epollFd, &pThread->pClients[i]) ? 1 : 0;
+        }
+        first += pThread->connections;
+    }
+    if(started < connections)
+    {
+        fprintf(stderr, "%u of %u clients could not start: %s\n", connections - started, connections, strerror(errno));
+    }
+
+    for(t = 1; t < threads; t++)
+    {
+        if(pthread_create(&pool[t].thread, NULL, Bench_Thread, &pool[t]) != 0)
+        {
+            perror("pthread_create"), exit(-1);
+        }
+    }
+    (void)Bench_Thread(&pool[0]);
+
+    for(t = 0; t < threads; t++)
+    {
+        bench_result_t* pPart = &pool[t].result;
+
+        if(t)
+        {
+            (void)pthread_join(pool[t].thread, NULL);
+        }
+        result.requests += pPart->requests;
+        result.errors += pPart->errors;
+        result.bytes += pPart->bytes;
+        for(i = 0; i < pPart->latencyCount; i++)
+        {
+            Bench_Record(&result, (uint64_t)pPart->pLatencyUs[i] * 1000U);
+        }
+        if(pPart->latencyMax > result.latencyMax)
+        {
+            result.latencyMax = pPart->latencyMax;
+        }
+        free(pPart->pLatencyUs);
+        close(pool[t].epollFd);
+    }
+    for(i = 0; i < connections; i++)
+    {
+        Bench_Stop(&pClients[i]);
+    }
+    free(pClients);
+
+    qsort(result.pLatencyUs, result.latencyCount, sizeof(uint32_t), Bench_Compare);
+    printf("%11u %10llu %12.0f %10.2f %10.2f %10.2f %8llu\n",
+           connections, (unsigned long long)result.requests, result.requests / seconds,
+           Bench_Percentile(&result, 0.50), Bench_Percentile(&result, 0.99),
+           result.latencyMax / 1e6, (unsigned long long)result.errors);
+    fflush(stdout);
+    free(result.pLatencyUs);
+}
+
+/*! *********************************************************************************
+* \brief  Reads what arrived on a stream and counts the "leds" events in it.
+*
+* \return  events completed, -1 once the stream ended
+*
+********************************************************************************** */
+static int32_t Bench_StreamRead(bench_stream_t* pStream)
+{
+    char buf[4096];
+    int32_t events = 0;
+
+    for(;;)
+    {
+        ssize_t got = recv(pStream->fd, buf, sizeof(buf), 0);
+        ssize_t i;
+
+        if(got <= 0)
+        {
+            return ((got < 0) && (errno == EAGAIN)) ? events : -1;
+        }
+        for(i = 0; i < got; i++)
+        {
+            if(buf[i] != '\n')
+            {
+                if((buf[i] != '\r') && (pStream->lineLen < sizeof(pStream->line) - 1))
+                {
+                    pStream->line[pStream->lineLen++] = buf[i];
+                }
+                continue;
+            }
+            pStream->line[pStream->lineLen] = '\0';
+            pStream->lineLen = 0;
+            if(strcmp(pStream->line, "event: leds") == 0)
+            {
+                events++;
+            }
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Runs one -e level: subscribes, lets the first events arrive for a
+*         second, then toggles an LED at the interval and times its event on
+*         every stream.
+*
+********************************************************************************** */
+static void Bench_Events(uint32_t streams, double seconds, uint32_t intervalMs)
+{
+    static const char subscribe[] = "GET /api/events HTTP/1.1\r\nHost: bench\r\nAccept: text/event-stream\r\n\r\n";
+    static const char toggle[] = "PUT /api/slaves/2/leds/green HTTP/1.1\r\nHost: bench\r\n"
+                                 "Content-Type: application/json\r\nContent-Length: 15\r\n\r\n{\"toggle\":true}";
+    bench_stream_t* pStreams = calloc(streams, sizeof(bench_stream_t));
+    struct epoll_event events[mBenchEvents_c];
+    struct epoll_event ev;
+    bench_result_t result;
+    uint64_t startNs;
+    uint64_t endNs;
+    uint64_t toggleNs = 0;
+    uint64_t nextNs;
+    uint32_t toggles = 0;
+    uint32_t waiting = 0;
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    //without a toggling client nothing is measured
+    int toggler = -1;
+    uint32_t i;
+
+    memset(&result, 0, sizeof(result));
+    if(!pStreams || (epollFd < 0))
+    {
+        perror("setup"), exit(-1);
+    }
+
+    //streams and the toggling client connect blocking, then run non-blocking
+    for(i = 0; i <= streams; i++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+
+        if((fd < 0) || (connect(fd, (struct sockaddr*)&mBenchAddr, sizeof(mBenchAddr)) < 0))
+        {
+            fprintf(stderr, "%u of %u streams could not connect: %s\n", streams - i, streams, strerror(errno));
+            if(fd >= 0)
+            {
+                close(fd);
+            }
+            streams = i;
+            break;
+        }
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(i < streams)
+        {
+            pStreams[i].fd = fd;
+            if(send(fd, subscribe, sizeof(subscribe) - 1, MSG_NOSIGNAL) != (ssize_t)(sizeof(subscribe) - 1))
+            {
+                perror("send"), exit(-1);
+            }
+        }
+        else
+        {
+            toggler = fd;
+        }
+        (void)fcntl(fd, F_SETFL, O_NONBLOCK);
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = (i < streams) ? &pStreams[i] : NULL;
+        (void)epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    startNs = Bench_NowNs();
+    nextNs = startNs + 1000000000ULL;
+    endNs = nextNs + (uint64_t)(seconds * 1e9);
+    for(;;)
+    {
+        uint64_t now = Bench_NowNs();
+        int count;
+        int n;
+
+        if(now >= endNs)
+        {
+            break;
+        }
+        if(waiting && (now - toggleNs > mBenchEventWaitNs_c))
+        {
+            result.errors += waiting;
+            waiting = 0;
+        }
+        if(!waiting && (now >= nextNs) && (toggler >= 0))
+        {
+            if(send(toggler, toggle, sizeof(toggle) - 1, MSG_NOSIGNAL) != (ssize_t)(sizeof(toggle) - 1))
+            {
+                perror("toggle"), exit(-1);
+            }
+            toggles++;
+            toggleNs = now;
+            waiting = streams;
+            nextNs = now + (uint64_t)intervalMs * 1000000U;
+        }
+
+        count = epoll_wait(epollFd, events, mBenchEvents_c, waiting ? 1 : (int)((nextNs - now) / 1000000U) + 1);
+        now = Bench_NowNs();
+        for(n = 0; n < count; n++)
+        {
+            bench_stream_t* pStream = events[n].data.ptr;
+            int32_t got;
+
+            if(!pStream)
+            {
+                char buf[4096];
+
+                //the toggle responses are not looked at
+                while(recv(toggler, buf, sizeof(buf), 0) > 0)
+                {
+                }
+                continue;
+            }
+            got = Bench_StreamRead(pStream);
+            if(got < 0)
+            {
+                (void)epoll_ctl(epollFd, EPOLL_CTL_DEL, pStream->fd, NULL);
+                result.errors++;
+                continue;
+            }
+            //the event of the latest toggle, or a later state that includes it
+            if(got && toggles && (pStream->seen != toggles))
+            {
+                pStream->seen = toggles;
+                Bench_Record(&result, now - toggleNs);
+                if(waiting)
+                {
+                    waiting--;
+                }
+            }
+        }
+    }
+
+    for(i = 0; i < streams; i++)
+    {
+        close(pStreams[i].fd);
+    }
+    if(toggler >= 0)
+    {
+        close(toggler);
+    }
+    close(epollFd);
+    free(pStreams);
+
+    qsort(result.pLatencyUs, result.latencyCount, sizeof(uint32_t), Bench_Compare);
+    printf("%11u %10u %12llu %10.2f %10.2f %10.2f %8llu\n",
+           streams, toggles, (unsigned long long)result.latencyCount,
+           Bench_Percentile(&result, 0.50), Bench_Percentile(&result, 0.99),
+           result.latencyMax / 1e6, (unsigned long long)result.errors);
+    fflush(stdout);
+    free(result.pLatencyUs);
+}
+
+int main(int argc, char** argv)
+{
+    const char* pAddr = "127.0.0.1";
+    const char* pLevels = "1,100,10000";
+    const bench_mode_t* pMode = &mBenchModes[0];
+    char one[1024];
+    int oneLen;
+    uint32_t levels[mBenchMaxLevels_c];
+    uint32_t levelCount = 0;
+    uint16_t port = 80;
+    uint32_t threads = 1;
+    uint32_t intervalMs = 0;
+    double seconds = 5.0;
+    struct rlimit lim;
+    char* pNext;
+    uint32_t i;
+    int opt;
+
+    while((opt = getopt(argc, argv, "a:p:d:c:tm:j:kP:e:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'a': pAddr = optarg; break;
+        case 'p': port = (uint16_t)atoi(optarg); break;
+        case 'd': seconds = atof(optarg); break;
+        case 'c': pLevels = optarg; break;
+        case 't': pMode = &mBenchModes[1]; break;
+        case 'm':
+            for(i = 0; i < sizeof(mBenchModes) / sizeof(mBenchModes[0]); i++)
+            {
+                if(strcmp(optarg, mBenchModes[i].pName) == 0)
+                {
+                    pMode = &mBenchModes[i];
+                    break;
+                }
+            }
+            if(i == sizeof(mBenchModes) / sizeof(mBenchModes[0]))
+            {
+                fprintf(stderr, "mode: page, toggle, leds, put or batch\n");
+                return 1;
+            }
+            break;
+        case 'j': threads = (uint32_t)atoi(optarg); break;
+        case 'k': mBenchKeepAlive = true; break;
+        case 'P': mBenchDepth = (uint32_t)atoi(optarg); mBenchKeepAlive = true; break;
+        case 'e': intervalMs = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-a address] [-p port] [-d seconds] [-c 1,100,10000] [-t] [-m mode] [-j threads] "
+                    "[-k] [-P depth] [-e ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    if((mBenchDepth < 1) || (mBenchDepth > mBenchMaxDepth_c))
+    {
+        fprintf(stderr, "depth: 1 to %u\n", mBenchMaxDepth_c);
+        return 1;
+    }
+
+    //a batch is depth copies of the request, sent in one go
+    if(pMode->pBody)
+    {
+        oneLen = snprintf(one, sizeof(one), "%s %s HTTP/1.1\r\nHost: bench\r\n%sContent-Type: %s\r\n"
+                          "Content-Length: %u\r\n\r\n%s", pMode->pMethod, pMode->pPath,
+                          mBenchKeepAlive ? "" : "Connection: close\r\n", pMode->pType,
+                          (unsigned)strlen(pMode->pBody), pMode->pBody);
+    }
+    else
+    {
+        oneLen = snprintf(one, sizeof(one), "%s %s HTTP/1.1\r\nHost: bench\r\n%s\r\n", pMode->pMethod,
+                          pMode->pPath, mBenchKeepAlive ? "" : "Connection: close\r\n");
+    }
+    if((oneLen <= 0) || ((size_t)oneLen >= sizeof(one)))
+    {
+        fprintf(stderr, "request too long\n");
+        return 1;
+    }
+    mBenchRequestLen = (uint32_t)strlen(one) * mBenchDepth;
+    mpBenchRequest = malloc(mBenchRequestLen);
+    if(!mpBenchRequest)
+    {
+        perror("malloc"), exit(-1);
+    }
+    for(i = 0; i < mBenchDepth; i++)
+    {
+        memcpy(&mpBenchRequest[i * strlen(one)], one, strlen(one));
+    }
+    if((threads < 1) || (threads > mBenchMaxThreads_c))
+    {
+        fprintf(stderr, "threads: 1 to %u\n", mBenchMaxThreads_c);
+        return 1;
+    }
+
+    for(pNext = (char*)pLevels; *pNext && (levelCount < mBenchMaxLevels_c); )
+    {
+        levels[levelCount++] = (uint32_t)strtoul(pNext, &pNext, 10);
+        if(*pNext == ',')
+        {
+            pNext++;
+        }
+    }
+
+    if(getrlimit(RLIMIT_NOFILE, &lim) == 0)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    memset(&mBenchAddr, 0, sizeof(mBenchAddr));
+    mBenchAddr.sin_family = AF_INET;
+    mBenchAddr.sin_port = htons(port);
+    mBenchAddr.sin_addr.s_addr = inet_addr(pAddr);
+
+    if(intervalMs)
+    {
+        printf("%11s %10s %12s %10s %10s %10s %8s\n",
+               "streams", "toggles", "events", "p50 ms", "p99 ms", "max ms", "errors");
+        for(i = 0; i < levelCount; i++)
+        {
+            Bench_Events(levels[i], seconds, intervalMs);
+            sleep(1);
+        }
+        return 0;
+    }
+
+    printf("%11s %10s %12s %10s %10s %10s %8s\n",
+           "connections", "requests", "requests/s", "p50 ms", "p99 ms", "max ms", "errors");
+    for(i = 0; i < levelCount; i++)
+    {
+        Bench_Level(levels[i], seconds, threads);
+        //let the server drop the closed connections before the next level
+        sleep(1);
+    }
+    return 0;
+}
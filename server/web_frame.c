@@ -0,0 +1,194 @@
+#include "web_frame.h"
+
+#include <string.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#define mWebFrameDelimiter_c         0x00
+#define mWebFrameHeaderLen_c         2
+#define mWebFrameCrcLen_c            2
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static uint32_t WebFrame_Unstuff(uint8_t* pBuf, uint32_t len);
+static uint16_t WebFrame_Crc16(const uint8_t* pData, uint32_t len);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Collects the bytes up to a delimiter, then decodes and checks them. Text
+*         the master printed between records, a dump or a message from boot,
+*         ends up between two delimiters and is reported bad.
+*
+* \param[in,out] pRx     receive state
+* \param[in]     byte    byte read from the port
+* \param[out]    pFrame  the record on gWebFrameComplete_c
+*
+********************************************************************************** */
+web_frame_status_t WebFrame_Receive(web_frame_rx_t* pRx, uint8_t byte, web_frame_t* pFrame)
+{
+    uint32_t len;
+
+    if(byte != mWebFrameDelimiter_c)
+    {
+        if(pRx->len < sizeof(pRx->buf))
+        {
+            pRx->buf[pRx->len++] = byte;
+        }
+        else
+        {
+            pRx->overflow = true;
+        }
+        return gWebFrameIncomplete_c;
+    }
+
+    len = pRx->len;
+    pRx->len = 0;
+    if(!len)
+    {
+        //the leading delimiter of a record
+        return gWebFrameIncomplete_c;
+    }
+    if(pRx->overflow)
+    {
+        pRx->overflow = false;
+        return gWebFrameBad_c;
+    }
+    len = WebFrame_Unstuff(pRx->buf, len);
+    if((len < mWebFrameHeaderLen_c + mWebFrameCrcLen_c) ||
+       (len > mWebFrameHeaderLen_c + WEBSERVER_FRAME_PAYLOAD_MAX + mWebFrameCrcLen_c) ||
+       (WebFrame_Crc16(pRx->buf, len - mWebFrameCrcLen_c) !=
+        (uint16_t)(pRx->buf[len - 2] | ((uint16_t)pRx->buf[len - 1] << 8))))
+    {
+        return gWebFrameBad_c;
+    }
+
+    pFrame->type = pRx->buf[0];
+    pFrame->seq = pRx->buf[1];
+    pFrame->len = len - mWebFrameHeaderLen_c - mWebFrameCrcLen_c;
+    memcpy(pFrame->payload, &pRx->buf[mWebFrameHeaderLen_c], pFrame->len);
+    return gWebFrameComplete_c;
+}
+
+/*! *********************************************************************************
+* \brief  Builds type, seq, payload and CRC and stuffs them between two
+*         delimiters; the leading one ends whatever the master got before.
+*
+* \param[in]  type      web_frame_type_t
+* \param[in]  seq       sequence number of the record
+* \param[in]  pPayload  payload bytes
+* \param[in]  len       at most WEBSERVER_FRAME_PAYLOAD_MAX, longer payloads are cut
+* \param[out] pOut      WEBSERVER_FRAME_ENCODED_MAX bytes
+*
+* \return  bytes written to pOut
+*
+********************************************************************************** */
+uint32_t WebFrame_Encode(uint8_t type, uint8_t seq, const uint8_t* pPayload, uint32_t len, uint8_t* pOut)
+{
+    uint8_t body[WEBSERVER_FRAME_PAYLOAD_MAX + mWebFrameHeaderLen_c + mWebFrameCrcLen_c];
+    uint32_t bodyLen = 0;
+    uint32_t outLen = 0;
+    uint32_t code;
+    uint16_t crc;
+    uint32_t i;
+
+    if(len > WEBSERVER_FRAME_PAYLOAD_MAX)
+    {
+        len = WEBSERVER_FRAME_PAYLOAD_MAX;
+    }
+    body[bodyLen++] = type;
+    body[bodyLen++] = seq;
+    memcpy(&body[bodyLen], pPayload, len);
+    bodyLen += len;
+    crc = WebFrame_Crc16(body, bodyLen);
+    body[bodyLen++] = (uint8_t)crc;
+    body[bodyLen++] = (uint8_t)(crc >> 8);
+
+    //each run of non zero bytes is prefixed with its length + 1, a body never
+    //reaches the 254 byte runs that need an extra code
+    pOut[outLen++] = mWebFrameDelimiter_c;
+    code = outLen++;
+    pOut[code] = 1;
+    for(i = 0; i < bodyLen; i++)
+    {
+        if(body[i] == mWebFrameDelimiter_c)
+        {
+            code = outLen++;
+            pOut[code] = 1;
+        }
+        else
+        {
+            pOut[outLen++] = body[i];
+            pOut[code]++;
+        }
+    }
+    pOut[outLen++] = mWebFrameDelimiter_c;
+    return outLen;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Reverses COBS in place.
+*
+* \return  length of the decoded body, 0 if the encoding is broken
+*
+********************************************************************************** */
+static uint32_t WebFrame_Unstuff(uint8_t* pBuf, uint32_t len)
+{
+    uint32_t in = 0;
+    uint32_t out = 0;
+
+    while(in < len)
+    {
+        uint32_t code = pBuf[in++];
+        uint32_t i;
+
+        if(!code || (in + code - 1 > len))
+        {
+            return 0;
+        }
+        for(i = 1; i < code; i++)
+        {
+            pBuf[out++] = pBuf[in++];
+        }
+        if((code < 0xFF) && (in < len))
+        {
+            pBuf[out++] = mWebFrameDelimiter_c;
+        }
+    }
+    return out;
+}
+
+/*CRC-16/CCITT-FALSE of ledcontrol_host.c*/
+static uint16_t WebFrame_Crc16(const uint8_t* pData, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint32_t i;
+    uint32_t bit;
+
+    for(i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)(pData[i] << 8);
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,88 @@
+#ifndef __WEB_FRAME_H_
+#define __WEB_FRAME_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Records of the master built with gAppUseHostFrames_d, the values of
+ * ledcontrol_host.h on the bridge side:
+ *
+ *   0x00 | COBS(type, seq, payload, crc low, crc high) | 0x00
+ *
+ * with CRC-16/CCITT-FALSE over type, seq and payload. The LED records carry
+ * pairs of slave id and LED mask, bit 0 red, 1 green, 2 blue; see
+ * ledcontrol_host.h for each type.
+ */
+
+/*gAppHostPayloadMax_c, gAppHostLedPairsMax_c, gAppHostEncodedMax_c*/
+#define WEBSERVER_FRAME_PAYLOAD_MAX  32
+#define WEBSERVER_FRAME_PAIRS_MAX    ((WEBSERVER_FRAME_PAYLOAD_MAX - 1) / 2)
+#define WEBSERVER_FRAME_ENCODED_MAX  (WEBSERVER_FRAME_PAYLOAD_MAX + 4 + 1 + 2)
+
+/*gAppHostBaudRate_c, the default line rate with -f*/
+#define WEBSERVER_FRAME_BAUD         1000000
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef enum
+{
+    gWebFrameLeds_c     = 0x01,     /*to the master: pairs to toggle*/
+    gWebFrameConsole_c  = 0x02,     /*to the master: UART command bytes*/
+    gWebFrameAccepted_c = 0x81,     /*seq of a gWebFrameLeds_c record, pairs refused*/
+    gWebFrameAcks_c     = 0x82,     /*slave id, LEDs confirmed in order*/
+    gWebFramePresence_c = 0x83      /*slave id, 1 connected or 0 disconnected*/
+}web_frame_type_t;
+
+typedef enum
+{
+    gWebFrameIncomplete_c = 0,      /*more bytes needed*/
+    gWebFrameComplete_c,            /*a valid record is decoded*/
+    gWebFrameBad_c                  /*a delimiter ended bytes that were no record*/
+}web_frame_status_t;
+
+typedef struct web_frame_tag
+{
+    uint8_t type;
+    uint8_t seq;
+    uint32_t len;
+    uint8_t payload[WEBSERVER_FRAME_PAYLOAD_MAX];
+}web_frame_t;
+
+/*encoded bytes since the last delimiter*/
+typedef struct web_frame_rx_tag
+{
+    uint8_t buf[WEBSERVER_FRAME_ENCODED_MAX];
+    uint32_t len;
+    bool overflow;
+}web_frame_rx_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*takes one received byte*/
+web_frame_status_t WebFrame_Receive(web_frame_rx_t* pRx, uint8_t byte, web_frame_t* pFrame);
+
+/*encodes a record into pOut, WEBSERVER_FRAME_ENCODED_MAX bytes; returns the
+  number written*/
+uint32_t WebFrame_Encode(uint8_t type, uint8_t seq, const uint8_t* pPayload, uint32_t len, uint8_t* pOut);
+
+#endif /* __WEB_FRAME_H_ */
@@ -0,0 +1,341 @@
+#include "web_http.h"
+
+#include <string.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#define mWebHttpLower(c)             ((((c) >= 'A') && ((c) <= 'Z')) ? (char)((c) + ('a' - 'A')) : (c))
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static web_http_status_t WebHttp_ParseHead(web_http_parser_t* pParser, const char* pIn, uint32_t headLen,
+                                           uint32_t inMax);
+static bool WebHttp_NameIs(const char* pName, uint32_t nameLen, const char* pLower);
+static bool WebHttp_HasToken(const char* pValue, uint32_t valueLen, const char* pLower);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Starts the parser on a new request.
+*
+* \param[out] pParser  parser of a connection
+*
+********************************************************************************** */
+void WebHttp_Reset(web_http_parser_t* pParser)
+{
+    pParser->scanned = 0;
+    pParser->headLen = 0;
+}
+
+/*! *********************************************************************************
+* \brief  Looks for the end of the head from where the previous call stopped,
+*         parses the head once it is in and then waits for the body.
+*
+* \param[in,out] pParser   parser of the connection
+* \param[in]     pIn       first byte of the request
+* \param[in]     inLen     bytes received from pIn on
+* \param[in]     inMax     room for the request in the buffer
+* \param[out]    pRequest  the request, when complete
+*
+* \return  gWebHttpComplete_c once head and body are in
+*
+********************************************************************************** */
+web_http_status_t WebHttp_Parse(web_http_parser_t* pParser, const char* pIn, uint32_t inLen,
+                                uint32_t inMax, web_http_request_t* pRequest)
+{
+    if(pParser->headLen == 0)
+    {
+        //the CR LF CR LF may straddle the previous read
+        uint32_t i = (pParser->scanned > 3) ? pParser->scanned - 3 : 0;
+        web_http_status_t status;
+
+        for(; i + 4 <= inLen; i++)
+        {
+            if((pIn[i] == '\r') && (pIn[i + 1] == '\n') && (pIn[i + 2] == '\r') && (pIn[i + 3] == '\n'))
+            {
+                break;
+            }
+        }
+        if(i + 4 > inLen)
+        {
+            pParser->scanned = inLen;
+            return (inLen >= inMax) ? gWebHttpTooLarge_c : gWebHttpIncomplete_c;
+        }
+
+        status = WebHttp_ParseHead(pParser, pIn, i + 4, inMax);
+        if(status != gWebHttpIncomplete_c)
+        {
+            return status;
+        }
+    }
+
+    if(inLen < pParser->request.length)
+    {
+        return gWebHttpIncomplete_c;
+    }
+    *pRequest = pParser->request;
+    return gWebHttpComplete_c;
+}
+
+/*! *********************************************************************************
+* \brief  Compares a slice with a NUL terminated string.
+*
+********************************************************************************** */
+bool WebHttp_Equal(const char* pSlice, uint32_t sliceLen, const char* pLiteral)
+{
+    return (strlen(pLiteral) == sliceLen) && (memcmp(pSlice, pLiteral, sliceLen) == 0);
+}
+
+/*! *********************************************************************************
+* \brief  Finds name=value in a form, fields separated by '&'.
+*
+* \param[in]  pForm      body or query string
+* \param[in]  formLen    its length
+* \param[in]  pName      field name
+* \param[out] ppValue    first byte of the value
+* \param[out] pValueLen  length of the value
+*
+* \return  false if the field is absent
+*
+********************************************************************************** */
+bool WebHttp_FormValue(const char* pForm, uint32_t formLen, const char* pName,
+                       const char** ppValue, uint32_t* pValueLen)
+{
+    uint32_t nameLen = (uint32_t)strlen(pName);
+    uint32_t start = 0;
+
+    while(start < formLen)
+    {
+        uint32_t end = start;
+
+        while((end < formLen) && (pForm[end] != '&'))
+        {
+            end++;
+        }
+        if((end - start > nameLen) && (pForm[start + nameLen] == '=') &&
+           (memcmp(&pForm[start], pName, nameLen) == 0))
+        {
+            *ppValue = &pForm[start + nameLen + 1];
+            *pValueLen = end - start - nameLen - 1;
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Parses the request line and the headers the bridge needs: Content-Length,
+*         Connection, Content-Type, If-None-Match; Transfer-Encoding is refused.
+*
+* \param[in,out] pParser  parser, request filled in
+* \param[in]     pIn      first byte of the request
+* \param[in]     headLen  bytes up to and including the empty line
+* \param[in]     inMax    room for the request in the buffer
+*
+* \return  gWebHttpIncomplete_c if the head is valid, the body may still be missing
+*
+********************************************************************************** */
+static web_http_status_t WebHttp_ParseHead(web_http_parser_t* pParser, const char* pIn, uint32_t headLen,
+                                           uint32_t inMax)
+{
+    web_http_request_t* pRequest = &pParser->request;
+    const char* pEnd = pIn + headLen - 2;
+    const char* pLine = pIn;
+    const char* p;
+    bool hasLength = false;
+    bool close = false;
+    bool keepAlive = false;
+    uint32_t bodyLen = 0;
+
+    memset(pRequest, 0, sizeof(*pRequest));
+
+    //request line: method SP target SP HTTP/1.x CR LF
+    for(p = pLine; (p < pEnd) && (*p >= 'A') && (*p <= 'Z'); p++)
+    {
+    }
+    if((p == pLine) || (*p != ' '))
+    {
+        return gWebHttpBad_c;
+    }
+    pRequest->pMethod = pLine;
+    pRequest->methodLen = (uint32_t)(p - pLine);
+
+    pRequest->pTarget = ++p;
+    while((p < pEnd) && (*p != ' ') && (*p != '\r'))
+    {
+        p++;
+    }
+    if((p == pRequest->pTarget) || (*p != ' '))
+    {
+        return gWebHttpBad_c;
+    }
+    pRequest->targetLen = (uint32_t)(p - pRequest->pTarget);
+
+    p++;
+    if((pEnd - p < 10) || (memcmp(p, "HTTP/1.", 7) != 0) || (p[7] < '0') || (p[7] > '9') ||
+       (p[8] != '\r') || (p[9] != '\n'))
+    {
+        return gWebHttpBad_c;
+    }
+    pRequest->versionMinor = (uint8_t)(p[7] - '0');
+    pLine = p + 10;
+
+    //header lines up to the empty line
+    while(pLine < pEnd)
+    {
+        const char* pColon = NULL;
+        const char* pValue;
+        const char* pValueEnd;
+
+        for(p = pLine; *p != '\r'; p++)
+        {
+            if((*p == ':') && !pColon)
+            {
+                pColon = p;
+            }
+        }
+        //no name, no colon or a folded continuation line
+        if(!pColon || (pColon == pLine) || (*pLine == ' ') || (*pLine == '\t') || (p[1] != '\n'))
+        {
+            return gWebHttpBad_c;
+        }
+        for(pValue = pColon + 1; (pValue < p) && ((*pValue == ' ') || (*pValue == '\t')); pValue++)
+        {
+        }
+        for(pValueEnd = p; (pValueEnd > pValue) && ((pValueEnd[-1] == ' ') || (pValueEnd[-1] == '\t')); pValueEnd--)
+        {
+        }
+
+        if(WebHttp_NameIs(pLine, (uint32_t)(pColon - pLine), "content-length"))
+        {
+            uint32_t value = 0;
+            const char* q;
+
+            if(pValue == pValueEnd)
+            {
+                return gWebHttpBad_c;
+            }
+            for(q = pValue; q < pValueEnd; q++)
+            {
+                if((*q < '0') || (*q > '9'))
+                {
+                    return gWebHttpBad_c;
+                }
+                if(value > inMax)
+                {
+                    return gWebHttpTooLarge_c;
+                }
+                value = (value * 10U) + (uint32_t)(*q - '0');
+            }
+            //repeated with another value: the body boundary is ambiguous
+            if(hasLength && (value != bodyLen))
+            {
+                return gWebHttpBad_c;
+            }
+            hasLength = true;
+            bodyLen = value;
+        }
+        else if(WebHttp_NameIs(pLine, (uint32_t)(pColon - pLine), "connection"))
+        {
+            close |= WebHttp_HasToken(pValue, (uint32_t)(pValueEnd - pValue), "close");
+            keepAlive |= WebHttp_HasToken(pValue, (uint32_t)(pValueEnd - pValue), "keep-alive");
+        }
+        else if(WebHttp_NameIs(pLine, (uint32_t)(pColon - pLine), "content-type"))
+        {
+            pRequest->pContentType = pValue;
+            pRequest->contentTypeLen = (uint32_t)(pValueEnd - pValue);
+        }
+        else if(WebHttp_NameIs(pLine, (uint32_t)(pColon - pLine), "if-none-match"))
+        {
+            pRequest->pIfNoneMatch = pValue;
+            pRequest->ifNoneMatchLen = (uint32_t)(pValueEnd - pValue);
+        }
+        else if(WebHttp_NameIs(pLine, (uint32_t)(pColon - pLine), "transfer-encoding"))
+        {
+            return gWebHttpBad_c;
+        }
+        pLine = p + 2;
+    }
+
+    if((bodyLen > inMax) || (headLen > inMax - bodyLen))
+    {
+        return gWebHttpTooLarge_c;
+    }
+    //HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 only when asked
+    pRequest->keepAlive = !close && ((pRequest->versionMinor >= 1) || keepAlive);
+    pRequest->pBody = pIn + headLen;
+    pRequest->bodyLen = bodyLen;
+    pRequest->length = headLen + bodyLen;
+    pParser->headLen = headLen;
+    pParser->scanned = headLen;
+    return gWebHttpIncomplete_c;
+}
+
+/*! *********************************************************************************
+* \brief  Case-insensitive header name comparison.
+*
+********************************************************************************** */
+static bool WebHttp_NameIs(const char* pName, uint32_t nameLen, const char* pLower)
+{
+    uint32_t i;
+
+    for(i = 0; i < nameLen; i++)
+    {
+        if((pLower[i] == '\0') || (mWebHttpLower(pName[i]) != pLower[i]))
+        {
+            return false;
+        }
+    }
+    return pLower[nameLen] == '\0';
+}
+
+/*! *********************************************************************************
+* \brief  Looks for a token in a comma separated header value, ignoring case.
+*
+********************************************************************************** */
+static bool WebHttp_HasToken(const char* pValue, uint32_t valueLen, const char* pLower)
+{
+    uint32_t start = 0;
+
+    while(start < valueLen)
+    {
+        uint32_t end = start;
+        uint32_t last;
+
+        while((end < valueLen) && (pValue[end] != ','))
+        {
+            end++;
+        }
+        for(last = end; (last > start) && ((pValue[last - 1] == ' ') || (pValue[last - 1] == '\t')); last--)
+        {
+        }
+        while((start < last) && ((pValue[start] == ' ') || (pValue[start] == '\t')))
+        {
+            start++;
+        }
+        if(WebHttp_NameIs(&pValue[start], last - start, pLower))
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+#ifndef __WEB_HTTP_H_
+#define __WEB_HTTP_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Incremental HTTP/1.1 request parser. It is fed the bytes of a connection as
+ * they arrive and remembers how far it got, so a request split over many reads
+ * is scanned once. A complete request is described by slices of the receive
+ * buffer, nothing is copied; it ends where its Content-Length body ends and the
+ * bytes after it are the next, pipelined, request. Chunked bodies are not
+ * supported, the dashboard and API clients send Content-Length.
+ */
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef enum
+{
+    gWebHttpIncomplete_c = 0,   /*more bytes needed*/
+    gWebHttpComplete_c,         /*a whole request is described*/
+    gWebHttpBad_c,              /*malformed, answer 400 and close*/
+    gWebHttpTooLarge_c          /*head and body exceed the buffer, answer 413 and close*/
+}web_http_status_t;
+
+/*one request, pointing into the receive buffer; valid until the buffer moves*/
+typedef struct web_http_request_tag
+{
+    const char* pMethod;
+    uint32_t methodLen;
+    const char* pTarget;        /*path and query as sent*/
+    uint32_t targetLen;
+    const char* pContentType;   /*NULL if absent*/
+    uint32_t contentTypeLen;
+    const char* pIfNoneMatch;   /*entity tags of the cached copy, NULL if absent*/
+    uint32_t ifNoneMatchLen;
+    const char* pBody;
+    uint32_t bodyLen;
+    uint32_t length;            /*head and body, bytes to consume*/
+    uint8_t versionMinor;       /*HTTP/1.x*/
+    bool keepAlive;             /*the connection stays open after the response*/
+}web_http_request_t;
+
+/*state kept between reads of one request*/
+typedef struct web_http_parser_tag
+{
+    uint32_t scanned;           /*bytes searched for the end of the head*/
+    uint32_t headLen;           /*0 until the head is parsed*/
+    web_http_request_t request;
+}web_http_parser_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*forgets the request in progress, before the next one or after the buffer moved*/
+void WebHttp_Reset(web_http_parser_t* pParser);
+
+/*continues parsing the request that starts at pIn; inMax is the most the
+  buffer can hold for it*/
+web_http_status_t WebHttp_Parse(web_http_parser_t* pParser, const char* pIn, uint32_t inLen,
+                                uint32_t inMax, web_http_request_t* pRequest);
+
+/*true if the slice equals pLiteral exactly*/
+bool WebHttp_Equal(const char* pSlice, uint32_t sliceLen, const char* pLiteral);
+
+/*finds the value of a field of an application/x-www-form-urlencoded body or
+  query, not decoded; false if the field is absent*/
+bool WebHttp_FormValue(const char* pForm, uint32_t formLen, const char* pName,
+                       const char** ppValue, uint32_t* pValueLen);
+
+#endif /* __WEB_HTTP_H_ */
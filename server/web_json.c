@@ -0,0 +1,526 @@
+#include "web_json.h"
+
+#include <string.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+typedef struct web_json_parser_tag
+{
+    const char* pText;
+    uint32_t len;
+    uint32_t pos;
+    web_json_token_t* pTokens;
+    uint32_t count;
+    uint32_t max;
+}web_json_parser_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static bool WebJson_Value(web_json_parser_t* pParser, uint32_t depth);
+static bool WebJson_String(web_json_parser_t* pParser);
+static bool WebJson_Number(web_json_parser_t* pParser);
+static bool WebJson_Literal(web_json_parser_t* pParser, const char* pWord, web_json_type_t type);
+static int32_t WebJson_Token(web_json_parser_t* pParser, web_json_type_t type);
+static void WebJson_Space(web_json_parser_t* pParser);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Tokenizes a JSON document in place.
+*
+* \param[in]  pText      document, need not be NUL terminated
+* \param[in]  len        its length
+* \param[out] pTokens    token array, the first token is the root value
+* \param[in]  maxTokens  size of the array
+*
+* \return  token count, -1 if invalid or too many tokens
+*
+********************************************************************************** */
+int32_t WebJson_Parse(const char* pText, uint32_t len, web_json_token_t* pTokens, uint32_t maxTokens)
+{
+    web_json_parser_t parser;
+
+    parser.pText = pText;
+    parser.len = len;
+    parser.pos = 0;
+    parser.pTokens = pTokens;
+    parser.count = 0;
+    parser.max = maxTokens;
+
+    if(!WebJson_Value(&parser, 0))
+    {
+        return -1;
+    }
+    WebJson_Space(&parser);
+    return (parser.pos == len) ? (int32_t)parser.count : -1;
+}
+
+/*! *********************************************************************************
+* \brief  Looks up a member of an object by key.
+*
+* \param[in] pText    document
+* \param[in] pTokens  its tokens
+* \param[in] obj      index of an object token
+* \param[in] pKey     member name
+*
+* \return  index of the member value, -1 if absent or obj is not an object
+*
+********************************************************************************** */
+int32_t WebJson_Find(const char* pText, const web_json_token_t* pTokens, uint32_t obj, const char* pKey)
+{
+    uint32_t i = obj + 1;
+    uint32_t member;
+
+    if(pTokens[obj].type != gWebJsonObject_c)
+    {
+        return -1;
+    }
+    for(member = 0; member < pTokens[obj].size; member++)
+    {
+        //key, then value
+        if(WebJson_StringIs(pText, &pTokens[i], pKey))
+        {
+            return (int32_t)(i + 1);
+        }
+        i = pTokens[i + 1].next;
+    }
+    return -1;
+}
+
+bool WebJson_StringIs(const char* pText, const web_json_token_t* pToken, const char* pLiteral)
+{
+    return (pToken->type == gWebJsonString_c) && (strlen(pLiteral) == pToken->len) &&
+           (memcmp(&pText[pToken->start], pLiteral, pToken->len) == 0);
+}
+
+bool WebJson_GetUint(const char* pText, const web_json_token_t* pToken, uint32_t* pValue)
+{
+    uint64_t value = 0;
+    uint32_t i;
+
+    if((pToken->type != gWebJsonNumber_c) || (pToken->len > 10))
+    {
+        return false;
+    }
+    for(i = 0; i < pToken->len; i++)
+    {
+        char c = pText[pToken->start + i];
+
+        //no sign, fraction or exponent
+        if((c < '0') || (c > '9'))
+        {
+            return false;
+        }
+        value = (value * 10U) + (uint64_t)(c - '0');
+    }
+    if(value > UINT32_MAX)
+    {
+        return false;
+    }
+    *pValue = (uint32_t)value;
+    return true;
+}
+
+bool WebJson_GetBool(const web_json_token_t* pToken, bool* pValue)
+{
+    if((pToken->type != gWebJsonTrue_c) && (pToken->type != gWebJsonFalse_c))
+    {
+        return false;
+    }
+    *pValue = (pToken->type == gWebJsonTrue_c);
+    return true;
+}
+
+void WebJson_WriterInit(web_json_writer_t* pWriter, char* pBuf, uint32_t max)
+{
+    pWriter->pBuf = pBuf;
+    pWriter->len = 0;
+    pWriter->max = max;
+    pWriter->overflow = false;
+}
+
+/*! *********************************************************************************
+* \brief  Appends text as is: punctuation, keys known to need no escaping.
+*
+********************************************************************************** */
+void WebJson_PutRaw(web_json_writer_t* pWriter, const char* pText)
+{
+    uint32_t len = (uint32_t)strlen(pText);
+
+    if(len > pWriter->max - pWriter->len)
+    {
+        pWriter->overflow = true;
+        return;
+    }
+    memcpy(&pWriter->pBuf[pWriter->len], pText, len);
+    pWriter->len += len;
+}
+
+/*! *********************************************************************************
+* \brief  Appends a quoted string, escaping quotes, backslashes and control
+*         characters.
+*
+********************************************************************************** */
+void WebJson_PutString(web_json_writer_t* pWriter, const char* pText, uint32_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint32_t i;
+
+    WebJson_PutRaw(pWriter, "\"");
+    for(i = 0; (i < len) && !pWriter->overflow; i++)
+    {
+        unsigned char c = (unsigned char)pText[i];
+        char escaped[7];
+
+        if((c == '"') || (c == '\\'))
+        {
+            escaped[0] = '\\';
+            escaped[1] = (char)c;
+            escaped[2] = '\0';
+        }
+        else if(c < 0x20)
+        {
+            memcpy(escaped, "\\u00", 4);
+            escaped[4] = hex[c >> 4];
+            escaped[5] = hex[c & 0x0F];
+            escaped[6] = '\0';
+        }
+        else
+        {
+            escaped[0] = (char)c;
+            escaped[1] = '\0';
+        }
+        WebJson_PutRaw(pWriter, escaped);
+    }
+    WebJson_PutRaw(pWriter, "\"");
+}
+
+void WebJson_PutUint(web_json_writer_t* pWriter, uint64_t value)
+{
+    char digits[21];
+    uint32_t i = sizeof(digits) - 1;
+
+    digits[i] = '\0';
+    do
+    {
+        digits[--i] = (char)('0' + (value % 10U));
+        value /= 10U;
+    }while(value);
+    WebJson_PutRaw(pWriter, &digits[i]);
+}
+
+void WebJson_PutBool(web_json_writer_t* pWriter, bool value)
+{
+    WebJson_PutRaw(pWriter, value ? "true" : "false");
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Parses one value and its children, recursion bounded by
+*         WEBSERVER_JSON_DEPTH.
+*
+********************************************************************************** */
+static bool WebJson_Value(web_json_parser_t* pParser, uint32_t depth)
+{
+    int32_t index;
+    char c;
+
+    WebJson_Space(pParser);
+    if(pParser->pos >= pParser->len)
+    {
+        return false;
+    }
+    c = pParser->pText[pParser->pos];
+
+    if((c == '{') || (c == '['))
+    {
+        bool isObject = (c == '{');
+        char close = isObject ? '}' : ']';
+
+        if(depth >= WEBSERVER_JSON_DEPTH)
+        {
+            return false;
+        }
+        index = WebJson_Token(pParser, isObject ? gWebJsonObject_c : gWebJsonArray_c);
+        if(index < 0)
+        {
+            return false;
+        }
+        pParser->pos++;
+        WebJson_Space(pParser);
+        if((pParser->pos < pParser->len) && (pParser->pText[pParser->pos] == close))
+        {
+            pParser->pos++;
+        }
+        else
+        {
+            for(;;)
+            {
+                if(isObject)
+                {
+                    WebJson_Space(pParser);
+                    if((pParser->pos >= pParser->len) || (pParser->pText[pParser->pos] != '"') ||
+                       !WebJson_String(pParser))
+                    {
+                        return false;
+                    }
+                    WebJson_Space(pParser);
+                    if((pParser->pos >= pParser->len) || (pParser->pText[pParser->pos] != ':'))
+                    {
+                        return false;
+                    }
+                    pParser->pos++;
+                }
+                if(!WebJson_Value(pParser, depth + 1))
+                {
+                    return false;
+                }
+                pParser->pTokens[index].size++;
+
+                WebJson_Space(pParser);
+                if(pParser->pos >= pParser->len)
+                {
+                    return false;
+                }
+                c = pParser->pText[pParser->pos++];
+                if(c == close)
+                {
+                    break;
+                }
+                if(c != ',')
+                {
+                    return false;
+                }
+            }
+        }
+        pParser->pTokens[index].len = pParser->pos - pParser->pTokens[index].start;
+        pParser->pTokens[index].next = pParser->count;
+        return true;
+    }
+    if(c == '"')
+    {
+        return WebJson_String(pParser);
+    }
+    if((c == '-') || ((c >= '0') && (c <= '9')))
+    {
+        return WebJson_Number(pParser);
+    }
+    if(c == 't')
+    {
+        return WebJson_Literal(pParser, "true", gWebJsonTrue_c);
+    }
+    if(c == 'f')
+    {
+        return WebJson_Literal(pParser, "false", gWebJsonFalse_c);
+    }
+    if(c == 'n')
+    {
+        return WebJson_Literal(pParser, "null", gWebJsonNull_c);
+    }
+    return false;
+}
+
+/*! *********************************************************************************
+* \brief  Parses a string starting at its opening quote; escapes are checked,
+*         not decoded.
+*
+********************************************************************************** */
+static bool WebJson_String(web_json_parser_t* pParser)
+{
+    int32_t index = WebJson_Token(pParser, gWebJsonString_c);
+    uint32_t pos = pParser->pos + 1;
+
+    if(index < 0)
+    {
+        return false;
+    }
+    while(pos < pParser->len)
+    {
+        unsigned char c = (unsigned char)pParser->pText[pos];
+
+        if(c == '"')
+        {
+            pParser->pTokens[index].start = pParser->pos + 1;
+            pParser->pTokens[index].len = pos - pParser->pos - 1;
+            pParser->pTokens[index].next = pParser->count;
+            pParser->pos = pos + 1;
+            return true;
+        }
+        if(c < 0x20)
+        {
+            return false;
+        }
+        if(c == '\\')
+        {
+            if(++pos >= pParser->len)
+            {
+                return false;
+            }
+            c = (unsigned char)pParser->pText[pos];
+            if(c == 'u')
+            {
+                uint32_t i;
+
+                for(i = 1; i <= 4; i++)
+                {
+                    char h = ((pos + i) < pParser->len) ? pParser->pText[pos + i] : '\0';
+
+                    if(!(((h >= '0') && (h <= '9')) || ((h >= 'a') && (h <= 'f')) || ((h >= 'A') && (h <= 'F'))))
+                    {
+                        return false;
+                    }
+                }
+                pos += 4;
+            }
+            else if(!strchr("\"\\/bfnrt", c) || (c == '\0'))
+            {
+                return false;
+            }
+        }
+        pos++;
+    }
+    return false;
+}
+
+/*! *********************************************************************************
+* \brief  Parses a number: optional minus, integer part without leading zeros,
+*         optional fraction and exponent.
+*
+********************************************************************************** */
+static bool WebJson_Number(web_json_parser_t* pParser)
+{
+    const char* p = pParser->pText;
+    uint32_t start = pParser->pos;
+    uint32_t pos = start;
+    int32_t index;
+
+    if((pos < pParser->len) && (p[pos] == '-'))
+    {
+        pos++;
+    }
+    if((pos < pParser->len) && (p[pos] == '0'))
+    {
+        pos++;
+    }
+    else if((pos < pParser->len) && (p[pos] >= '1') && (p[pos] <= '9'))
+    {
+        while((pos < pParser->len) && (p[pos] >= '0') && (p[pos] <= '9'))
+        {
+            pos++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    if((pos < pParser->len) && (p[pos] == '.'))
+    {
+        if((++pos >= pParser->len) || (p[pos] < '0') || (p[pos] > '9'))
+        {
+            return false;
+        }
+        while((pos < pParser->len) && (p[pos] >= '0') && (p[pos] <= '9'))
+        {
+            pos++;
+        }
+    }
+    if((pos < pParser->len) && ((p[pos] == 'e') || (p[pos] == 'E')))
+    {
+        pos++;
+        if((pos < pParser->len) && ((p[pos] == '+') || (p[pos] == '-')))
+        {
+            pos++;
+        }
+        if((pos >= pParser->len) || (p[pos] < '0') || (p[pos] > '9'))
+        {
+            return false;
+        }
+        while((pos < pParser->len) && (p[pos] >= '0') && (p[pos] <= '9'))
+        {
+            pos++;
+        }
+    }
+
+    index = WebJson_Token(pParser, gWebJsonNumber_c);
+    if(index < 0)
+    {
+        return false;
+    }
+    pParser->pTokens[index].len = pos - start;
+    pParser->pTokens[index].next = pParser->count;
+    pParser->pos = pos;
+    return true;
+}
+
+static bool WebJson_Literal(web_json_parser_t* pParser, const char* pWord, web_json_type_t type)
+{
+    uint32_t len = (uint32_t)strlen(pWord);
+    int32_t index;
+
+    if((pParser->len - pParser->pos < len) || (memcmp(&pParser->pText[pParser->pos], pWord, len) != 0))
+    {
+        return false;
+    }
+    index = WebJson_Token(pParser, type);
+    if(index < 0)
+    {
+        return false;
+    }
+    pParser->pTokens[index].len = len;
+    pParser->pTokens[index].next = pParser->count;
+    pParser->pos += len;
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Takes the next token from the array, starting at the current position.
+*
+* \return  its index, -1 if the array is full
+*
+********************************************************************************** */
+static int32_t WebJson_Token(web_json_parser_t* pParser, web_json_type_t type)
+{
+    web_json_token_t* pToken;
+
+    if(pParser->count >= pParser->max)
+    {
+        return -1;
+    }
+    pToken = &pParser->pTokens[pParser->count];
+    pToken->type = type;
+    pToken->start = pParser->pos;
+    pToken->len = 0;
+    pToken->size = 0;
+    pToken->next = pParser->count + 1;
+    return (int32_t)pParser->count++;
+}
+
+static void WebJson_Space(web_json_parser_t* pParser)
+{
+    while(pParser->pos < pParser->len)
+    {
+        char c = pParser->pText[pParser->pos];
+
+        if((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n'))
+        {
+            return;
+        }
+        pParser->pos++;
+    }
+}
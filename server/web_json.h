@@ -0,0 +1,91 @@
+#ifndef __WEB_JSON_H_
+#define __WEB_JSON_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * JSON for the REST API without allocation. The decoder splits a document
+ * into tokens held in an array the caller provides, each token an offset and
+ * length into the text, and strings are compared in place, never copied. The
+ * encoder appends to a fixed buffer and remembers an overflow instead of
+ * failing each call.
+ */
+
+/*nesting the decoder follows*/
+#define WEBSERVER_JSON_DEPTH         8
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef enum
+{
+    gWebJsonObject_c = 0,
+    gWebJsonArray_c,
+    gWebJsonString_c,           /*start and len exclude the quotes*/
+    gWebJsonNumber_c,
+    gWebJsonTrue_c,
+    gWebJsonFalse_c,
+    gWebJsonNull_c
+}web_json_type_t;
+
+typedef struct web_json_token_tag
+{
+    web_json_type_t type;
+    uint32_t start;
+    uint32_t len;
+    uint32_t size;              /*elements of an array, members of an object*/
+    uint32_t next;              /*index of the token after this one and its children*/
+}web_json_token_t;
+
+typedef struct web_json_writer_tag
+{
+    char* pBuf;
+    uint32_t len;
+    uint32_t max;
+    bool overflow;
+}web_json_writer_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*tokenizes one document, returns the number of tokens, -1 if it is not valid
+  JSON or needs more than maxTokens*/
+int32_t WebJson_Parse(const char* pText, uint32_t len, web_json_token_t* pTokens, uint32_t maxTokens);
+
+/*index of the value of a member of object token obj, -1 if absent*/
+int32_t WebJson_Find(const char* pText, const web_json_token_t* pTokens, uint32_t obj, const char* pKey);
+
+/*true if token is a string equal to pLiteral*/
+bool WebJson_StringIs(const char* pText, const web_json_token_t* pToken, const char* pLiteral);
+
+/*value of a non-negative integer token, false for any other token*/
+bool WebJson_GetUint(const char* pText, const web_json_token_t* pToken, uint32_t* pValue);
+
+/*value of a true/false token, false for any other token*/
+bool WebJson_GetBool(const web_json_token_t* pToken, bool* pValue);
+
+void WebJson_WriterInit(web_json_writer_t* pWriter, char* pBuf, uint32_t max);
+void WebJson_PutRaw(web_json_writer_t* pWriter, const char* pText);
+void WebJson_PutString(web_json_writer_t* pWriter, const char* pText, uint32_t len);
+void WebJson_PutUint(web_json_writer_t* pWriter, uint64_t value);
+void WebJson_PutBool(web_json_writer_t* pWriter, bool value);
+
+#endif /* __WEB_JSON_H_ */
@@ -0,0 +1,581 @@
+#include "web_link.h"
+#include "web_frame.h"
+#include "web_loop.h"
+#include "web_route.h"
+#include "web_serial.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#define mWebLinkLineMax_c            64
+/*toggle digits of one master, '1' + id * 3 + led*/
+#define mWebLinkDigits_c             (WEBSERVER_SLAVES_PER_MASTER * WEBSERVER_LEDS_PER_SLAVE)
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/*toggles of one LED written and not acked yet, oldest first*/
+typedef struct web_link_led_tag
+{
+    uint64_t sentUs[WEBSERVER_LINK_OUTSTANDING];
+    uint32_t first;
+    uint32_t count;
+}web_link_led_t;
+
+/*what one master printed so far, serial thread of the master only*/
+typedef struct web_link_master_tag
+{
+    uint32_t index;
+    char line[mWebLinkLineMax_c];
+    uint32_t lineLen;
+    web_frame_rx_t frameRx;
+    web_frame_t frame;
+    bool seqValid;
+    uint8_t seq;
+    /*bit per slave with toggles the master refused, tried again after its
+      next ack*/
+    web_mask_t retry;
+    /*read by WebLink_Stats*/
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t lost;
+}web_link_master_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static bool WebLink_Ack(web_link_master_t* pMaster, uint32_t id, uint32_t led, uint64_t now);
+static bool WebLink_Line(web_link_master_t* pMaster, const char* pLine, uint32_t len);
+static bool WebLink_Record(web_link_master_t* pMaster, const web_frame_t* pFrame, uint64_t now);
+static bool WebLink_Presence(web_link_master_t* pMaster, uint32_t id, bool present);
+static void WebLink_Retry(web_link_master_t* pMaster);
+static void WebLink_Reconcile(uint32_t slave);
+static void WebLink_Drop(web_link_master_t* pMaster, uint32_t bit);
+static void WebLink_Refuse(web_link_master_t* pMaster, uint32_t bit);
+static web_link_master_t* WebLink_Master(uint32_t master);
+static int WebLink_Compare(const void* pA, const void* pB);
+static uint64_t WebLink_NowUs(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+static web_link_master_t mWebLinkMasters[WEBSERVER_MASTERS];
+
+/*an LED only on the serial thread of the master it is routed to*/
+static web_link_led_t mWebLinkLeds[WEBSERVER_LEDS];
+
+/*written by the serial threads, read by WebLink_Stats*/
+static uint64_t mWebLinkUnexpected;
+static uint32_t mWebLinkOutstanding;
+static uint32_t mWebLinkMaxUs;
+static uint32_t mWebLinkLastUs[WEBSERVER_LEDS];
+static uint32_t mWebLinkSamplesUs[WEBSERVER_LINK_SAMPLES];
+static uint64_t mWebLinkSamples;
+static uint64_t mWebLinkRecords;
+static uint64_t mWebLinkBadRecords;
+static uint64_t mWebLinkMissedRecords;
+static uint64_t mWebLinkRefused;
+static uint64_t mWebLinkLate;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Splits a master's output into ack digits and lines. Digits are acks
+*         only where a line would start, so the numbers inside a line are not
+*         taken for them; the clients get one event per call that changed the
+*         state.
+*
+* \param[in] master  index of the master
+* \param[in] pData   bytes read from its port
+* \param[in] len     their number
+*
+********************************************************************************** */
+void WebLink_Receive(uint32_t master, const char* pData, uint32_t len)
+{
+    web_link_master_t* pMaster = WebLink_Master(master);
+    uint64_t now = WebLink_NowUs();
+    bool changed = false;
+    uint32_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        char c = pData[i];
+
+        if((pMaster->lineLen == 0) && (c >= '1') && (c < '1' + mWebLinkDigits_c))
+        {
+            changed |= WebLink_Ack(pMaster, (uint32_t)(c - '1') / WEBSERVER_LEDS_PER_SLAVE,
+                                   (uint32_t)(c - '1') % WEBSERVER_LEDS_PER_SLAVE, now);
+        }
+        else if(c == '\n')
+        {
+            changed |= WebLink_Line(pMaster, pMaster->line, pMaster->lineLen);
+            pMaster->lineLen = 0;
+        }
+        else if((c != '\r') && (pMaster->lineLen < sizeof(pMaster->line)))
+        {
+            pMaster->line[pMaster->lineLen++] = c;
+        }
+    }
+
+    if(changed)
+    {
+        WebLoop_Push();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Decodes the records of a master built with gAppUseHostFrames_d. Text
+*         between records and records that fail their CRC are counted bad, gaps
+*         in the sequence numbers missed; the clients get one event per call
+*         that changed the state.
+*
+* \param[in] master  index of the master
+* \param[in] pData   bytes read from its port
+* \param[in] len     their number
+*
+********************************************************************************** */
+void WebLink_ReceiveFrames(uint32_t master, const char* pData, uint32_t len)
+{
+    web_link_master_t* pMaster = WebLink_Master(master);
+    uint64_t now = WebLink_NowUs();
+    bool changed = false;
+    uint32_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        switch(WebFrame_Receive(&pMaster->frameRx, (uint8_t)pData[i], &pMaster->frame))
+        {
+        case gWebFrameComplete_c:
+            __atomic_add_fetch(&mWebLinkRecords, 1, __ATOMIC_RELAXED);
+            if(pMaster->seqValid && (pMaster->frame.seq != (uint8_t)(pMaster->seq + 1)))
+            {
+                __atomic_add_fetch(&mWebLinkMissedRecords, (uint8_t)(pMaster->frame.seq - pMaster->seq - 1),
+                                   __ATOMIC_RELAXED);
+            }
+            pMaster->seqValid = true;
+            pMaster->seq = pMaster->frame.seq;
+            changed |= WebLink_Record(pMaster, &pMaster->frame, now);
+            break;
+        case gWebFrameBad_c:
+            __atomic_add_fetch(&mWebLinkBadRecords, 1, __ATOMIC_RELAXED);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if(changed)
+    {
+        WebLoop_Push();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Records when a toggle was queued. With more toggles of the LED in flight
+*         than the master tracks, the oldest is given up; one to a slave the
+*         master reported gone is lost at once, its reconnection resends it.
+*
+* \param[in] master    index of the master
+* \param[in] digit     toggle digit written to it
+* \param[in] queuedUs  when it was taken from the queue
+*
+********************************************************************************** */
+void WebLink_Sent(uint32_t master, char digit, uint64_t queuedUs)
+{
+    web_link_master_t* pMaster = WebLink_Master(master);
+    web_link_led_t* pLed;
+    web_state_t state;
+    uint32_t slave;
+    uint32_t bit;
+
+    if((digit < '1') || (digit >= '1' + mWebLinkDigits_c))
+    {
+        return;
+    }
+    slave = WebRoute_Slave(master, (uint32_t)(digit - '1') / WEBSERVER_LEDS_PER_SLAVE);
+    if(slave >= WEBSERVER_SLAVES)
+    {
+        return;
+    }
+    bit = (slave * WEBSERVER_LEDS_PER_SLAVE) + ((uint32_t)(digit - '1') % WEBSERVER_LEDS_PER_SLAVE);
+    __atomic_add_fetch(&pMaster->sent, 1, __ATOMIC_RELAXED);
+    (void)WebState_Get(&state);
+    if(!(state.present & ((web_mask_t)1U << slave)))
+    {
+        __atomic_add_fetch(&pMaster->lost, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    pLed = &mWebLinkLeds[bit];
+    if(pLed->count == WEBSERVER_LINK_OUTSTANDING)
+    {
+        WebLink_Drop(pMaster, bit);
+    }
+    pLed->sentUs[(pLed->first + pLed->count) % WEBSERVER_LINK_OUTSTANDING] = queuedUs;
+    pLed->count++;
+    __atomic_add_fetch(&mWebLinkOutstanding, 1, __ATOMIC_RELAXED);
+}
+
+/*! *********************************************************************************
+* \brief  Copies the counters and takes the percentiles of the latest ack
+*         latencies. A close estimate while the serial thread runs.
+*
+* \param[out] pStats  counters and latencies
+*
+********************************************************************************** */
+void WebLink_Stats(web_link_stats_t* pStats)
+{
+    uint32_t samplesUs[WEBSERVER_LINK_SAMPLES];
+    uint64_t samples = __atomic_load_n(&mWebLinkSamples, __ATOMIC_ACQUIRE);
+    uint32_t count = (samples < WEBSERVER_LINK_SAMPLES) ? (uint32_t)samples : WEBSERVER_LINK_SAMPLES;
+    uint32_t i;
+
+    memset(pStats, 0, sizeof(*pStats));
+    for(i = 0; i < WEBSERVER_MASTERS; i++)
+    {
+        pStats->masters[i].sent = __atomic_load_n(&mWebLinkMasters[i].sent, __ATOMIC_RELAXED);
+        pStats->masters[i].acked = __atomic_load_n(&mWebLinkMasters[i].acked, __ATOMIC_RELAXED);
+        pStats->masters[i].lost = __atomic_load_n(&mWebLinkMasters[i].lost, __ATOMIC_RELAXED);
+        pStats->sent += pStats->masters[i].sent;
+        pStats->acked += pStats->masters[i].acked;
+        pStats->lost += pStats->masters[i].lost;
+    }
+    pStats->unexpected = __atomic_load_n(&mWebLinkUnexpected, __ATOMIC_RELAXED);
+    pStats->outstanding = __atomic_load_n(&mWebLinkOutstanding, __ATOMIC_RELAXED);
+    pStats->maxUs = __atomic_load_n(&mWebLinkMaxUs, __ATOMIC_RELAXED);
+    for(i = 0; i < WEBSERVER_LEDS; i++)
+    {
+        pStats->lastUs[i] = __atomic_load_n(&mWebLinkLastUs[i], __ATOMIC_RELAXED);
+    }
+
+    pStats->records = __atomic_load_n(&mWebLinkRecords, __ATOMIC_RELAXED);
+    pStats->badRecords = __atomic_load_n(&mWebLinkBadRecords, __ATOMIC_RELAXED);
+    pStats->missedRecords = __atomic_load_n(&mWebLinkMissedRecords, __ATOMIC_RELAXED);
+    pStats->refused = __atomic_load_n(&mWebLinkRefused, __ATOMIC_RELAXED);
+    pStats->late = __atomic_load_n(&mWebLinkLate, __ATOMIC_RELAXED);
+
+    for(i = 0; i < count; i++)
+    {
+        samplesUs[i] = __atomic_load_n(&mWebLinkSamplesUs[i], __ATOMIC_RELAXED);
+    }
+    if(count)
+    {
+        qsort(samplesUs, count, sizeof(samplesUs[0]), WebLink_Compare);
+        pStats->samples = count;
+        //nearest rank: the smallest sample at least p percent of all are not above
+        pStats->p50Us = samplesUs[((count * 50 + 99) / 100) - 1];
+        pStats->p99Us = samplesUs[((count * 99 + 99) / 100) - 1];
+    }
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  An ack digit: the master confirmed a toggle of the LED. It is the oldest
+*         one outstanding, however late; an ack of none still toggles the
+*         confirmed state, the master saw a command the bridge did not send or
+*         gave up on.
+*
+* \param[in] pMaster  master that sent the ack
+* \param[in] id       its slave id
+* \param[in] led      LED of the slave
+*
+* \return  true if the confirmed state changed, false for an id not routed
+*
+********************************************************************************** */
+static bool WebLink_Ack(web_link_master_t* pMaster, uint32_t id, uint32_t led, uint64_t now)
+{
+    uint32_t slave = WebRoute_Slave(pMaster->index, id);
+    uint32_t bit = (slave * WEBSERVER_LEDS_PER_SLAVE) + led;
+    web_link_led_t* pLed;
+
+    if(slave >= WEBSERVER_SLAVES)
+    {
+        return false;
+    }
+    pLed = &mWebLinkLeds[bit];
+    if(pLed->count)
+    {
+        uint64_t latencyUs = now - pLed->sentUs[pLed->first];
+        uint32_t us = (latencyUs > UINT32_MAX) ? UINT32_MAX : (uint32_t)latencyUs;
+        //the masters' threads take turns in the ring
+        uint64_t samples = __atomic_fetch_add(&mWebLinkSamples, 1, __ATOMIC_RELAXED);
+        uint32_t maxUs = __atomic_load_n(&mWebLinkMaxUs, __ATOMIC_RELAXED);
+
+        pLed->first = (pLed->first + 1) % WEBSERVER_LINK_OUTSTANDING;
+        pLed->count--;
+        __atomic_sub_fetch(&mWebLinkOutstanding, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&pMaster->acked, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&mWebLinkLastUs[bit], us, __ATOMIC_RELAXED);
+        __atomic_store_n(&mWebLinkSamplesUs[samples % WEBSERVER_LINK_SAMPLES], us, __ATOMIC_RELAXED);
+        if(latencyUs > WEBSERVER_LINK_ACK_TIMEOUT_MS * 1000ULL)
+        {
+            __atomic_add_fetch(&mWebLinkLate, 1, __ATOMIC_RELAXED);
+        }
+        while((us > maxUs) &&
+              !__atomic_compare_exchange_n(&mWebLinkMaxUs, &maxUs, us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+        }
+    }
+    else
+    {
+        __atomic_add_fetch(&mWebLinkUnexpected, 1, __ATOMIC_RELAXED);
+    }
+    WebState_Confirm((web_mask_t)1U << bit);
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  A complete line: "Slave N connected" or "Slave N disconnected"
+*         updates the presence of the slave, other lines are ignored.
+*
+* \param[in] pMaster  master that printed it
+* \param[in] pLine    line without its CR LF
+* \param[in] len      its length
+*
+* \return  true if the state changed
+*
+********************************************************************************** */
+static bool WebLink_Line(web_link_master_t* pMaster, const char* pLine, uint32_t len)
+{
+    static const char slave[] = "Slave ";
+    uint32_t id;
+    bool present;
+
+    if((len < sizeof(slave) + 1) || (memcmp(pLine, slave, sizeof(slave) - 1) != 0) ||
+       (pLine[sizeof(slave) - 1] < '1') || (pLine[sizeof(slave) - 1] >= '1' + WEBSERVER_SLAVES_PER_MASTER))
+    {
+        return false;
+    }
+    id = (uint32_t)(pLine[sizeof(slave) - 1] - '1');
+    pLine += sizeof(slave);
+    len -= (uint32_t)sizeof(slave);
+    if((len == 10) && (memcmp(pLine, " connected", 10) == 0))
+    {
+        present = true;
+    }
+    else if((len == 13) && (memcmp(pLine, " disconnected", 13) == 0))
+    {
+        present = false;
+    }
+    else
+    {
+        return false;
+    }
+    return WebLink_Presence(pMaster, id, present);
+}
+
+/*! *********************************************************************************
+* \brief  Decoded record: acks and presence reports as in text, and the toggles
+*         the master refused for a full command queue, counted lost and tried
+*         again once it acks something.
+*
+* \return  true if the state changed
+*
+********************************************************************************** */
+static bool WebLink_Record(web_link_master_t* pMaster, const web_frame_t* pFrame, uint64_t now)
+{
+    bool changed = false;
+    uint32_t slave;
+    uint32_t i;
+    uint32_t led;
+
+    switch(pFrame->type)
+    {
+    case gWebFrameAcks_c:
+        for(i = 1; i < pFrame->len; i++)
+        {
+            if(pFrame->payload[i] < WEBSERVER_LEDS_PER_SLAVE)
+            {
+                changed |= WebLink_Ack(pMaster, pFrame->payload[0], pFrame->payload[i], now);
+            }
+        }
+        WebLink_Retry(pMaster);
+        break;
+    case gWebFramePresence_c:
+        if(pFrame->len >= 2)
+        {
+            changed = WebLink_Presence(pMaster, pFrame->payload[0], pFrame->payload[1] != 0);
+        }
+        break;
+    case gWebFrameAccepted_c:
+        //the seq of our record, then the pairs refused
+        for(i = 1; i + 1 < pFrame->len; i += 2)
+        {
+            slave = WebRoute_Slave(pMaster->index, pFrame->payload[i]);
+            if(slave >= WEBSERVER_SLAVES)
+            {
+                continue;
+            }
+            for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+            {
+                if(pFrame->payload[i + 1] & (1U << led))
+                {
+                    WebLink_Refuse(pMaster, (slave * WEBSERVER_LEDS_PER_SLAVE) + led);
+                }
+            }
+            pMaster->retry |= (web_mask_t)1U << slave;
+        }
+        break;
+    default:
+        break;
+    }
+    return changed;
+}
+
+/*! *********************************************************************************
+* \brief  A slave reported present or gone: the toggles in flight to one that
+*         dropped off are counted lost and one that comes back is brought to
+*         the requested state.
+*
+* \param[in] pMaster  master that reported it
+* \param[in] id       its slave id
+* \param[in] present  connected or disconnected
+*
+* \return  true if the state changed
+*
+********************************************************************************** */
+static bool WebLink_Presence(web_link_master_t* pMaster, uint32_t id, bool present)
+{
+    uint32_t slave = WebRoute_Slave(pMaster->index, id);
+    uint32_t led;
+
+    if(!WebState_SetPresent(slave, present))
+    {
+        return false;
+    }
+    if(present)
+    {
+        WebLink_Reconcile(slave);
+    }
+    else
+    {
+        for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+        {
+            while(mWebLinkLeds[(slave * WEBSERVER_LEDS_PER_SLAVE) + led].count)
+            {
+                WebLink_Drop(pMaster, (slave * WEBSERVER_LEDS_PER_SLAVE) + led);
+            }
+        }
+    }
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Queues a toggle for each LED of the slave whose confirmed state is not
+*         the requested one and has no toggle in flight, on the serial thread
+*         of its master.
+*
+********************************************************************************** */
+static void WebLink_Reconcile(uint32_t slave)
+{
+    char digits[WEBSERVER_LEDS_PER_SLAVE];
+    web_state_t state;
+    uint32_t master;
+    uint32_t id;
+    uint32_t count = 0;
+    uint32_t led;
+
+    if(!WebRoute_Find(slave, &master, &id))
+    {
+        return;
+    }
+    (void)WebState_Get(&state);
+    for(led = 0; led < WEBSERVER_LEDS_PER_SLAVE; led++)
+    {
+        uint32_t bit = (slave * WEBSERVER_LEDS_PER_SLAVE) + led;
+
+        if(((state.leds ^ state.confirmed) & ((web_mask_t)1U << bit)) && !mWebLinkLeds[bit].count)
+        {
+            digits[count++] = WebRoute_Digit(id, led);
+        }
+    }
+    if(count)
+    {
+        (void)WebSerial_Write(master, digits, count);
+    }
+}
+
+static void WebLink_Drop(web_link_master_t* pMaster, uint32_t bit)
+{
+    web_link_led_t* pLed = &mWebLinkLeds[bit];
+
+    pLed->first = (pLed->first + 1) % WEBSERVER_LINK_OUTSTANDING;
+    pLed->count--;
+    __atomic_sub_fetch(&mWebLinkOutstanding, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pMaster->lost, 1, __ATOMIC_RELAXED);
+}
+
+/*the newest toggle of the LED, the one in the record the master refused*/
+static void WebLink_Refuse(web_link_master_t* pMaster, uint32_t bit)
+{
+    if(mWebLinkLeds[bit].count)
+    {
+        mWebLinkLeds[bit].count--;
+        __atomic_sub_fetch(&mWebLinkOutstanding, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&pMaster->lost, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mWebLinkRefused, 1, __ATOMIC_RELAXED);
+}
+
+/*an ack made room in the command queue of the master*/
+static void WebLink_Retry(web_link_master_t* pMaster)
+{
+    uint32_t slave;
+
+    for(slave = 0; pMaster->retry >> slave; slave++)
+    {
+        if(pMaster->retry & ((web_mask_t)1U << slave))
+        {
+            pMaster->retry &= ~((web_mask_t)1U << slave);
+            WebLink_Reconcile(slave);
+        }
+    }
+}
+
+/*parse state of a master, index set on first use*/
+static web_link_master_t* WebLink_Master(uint32_t master)
+{
+    web_link_master_t* pMaster = &mWebLinkMasters[master];
+
+    pMaster->index = master;
+    return pMaster;
+}
+
+static int WebLink_Compare(const void* pA, const void* pB)
+{
+    uint32_t a = *(const uint32_t*)pA;
+    uint32_t b = *(const uint32_t*)pB;
+
+    return (a > b) - (a < b);
+}
+
+static uint64_t WebLink_NowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
@@ -0,0 +1,108 @@
+#ifndef __WEB_LINK_H_
+#define __WEB_LINK_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "web_state.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * What a master tells the bridge over its UART, read on the serial thread of
+ * its port:
+ *
+ *   digits '1'-'9'             an ack confirmed those toggles, printed as one
+ *                              string without a line end (App_ConfirmCommands)
+ *   Slave N connected\r\n      N the slave id from 1, the connection check found
+ *                              the slave
+ *   Slave N disconnected\r\n   or lost it
+ *   any other line             ignored
+ *
+ * Acks toggle the confirmed LEDs of web_state.c, the reports set the slaves
+ * present, so the state clients see is what the master confirmed. Each toggle
+ * written is timed until its ack, acks of one LED come back in the order its
+ * toggles went out. A slave that connects again gets the toggles that bring
+ * its LEDs to the requested state. A toggle is written again only then, or
+ * after the master refused it: one whose ack is merely late stays matched to
+ * it, as a second toggle would flip the LED back once both went through.
+ *
+ * A master built with gAppUseHostFrames_d sends the same as web_frame.h
+ * records instead, and tells which toggles its command queue had no room for.
+ *
+ * Slave ids are the master's own, web_route.c turns them into the slaves of
+ * the bridge. Each LED is only ever touched by the thread of its master.
+ */
+
+/*toggles of one LED awaiting their ack, gAppAckWindowBits_c of the master*/
+#define WEBSERVER_LINK_OUTSTANDING   8
+
+/*an ack later than this is counted late, its toggle is still waited for*/
+#define WEBSERVER_LINK_ACK_TIMEOUT_MS 2000
+
+/*latest ack latencies the percentiles are taken from*/
+#define WEBSERVER_LINK_SAMPLES       1024
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+/*toggles of one master*/
+typedef struct web_link_master_stats_tag
+{
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t lost;
+}web_link_master_stats_t;
+
+typedef struct web_link_stats_tag
+{
+    uint64_t sent;              /*toggle digits written to the masters*/
+    uint64_t acked;
+    uint64_t lost;              /*refused, or the slave disconnected first*/
+    uint64_t unexpected;        /*acks of no toggle outstanding*/
+    uint64_t late;              /*acked after WEBSERVER_LINK_ACK_TIMEOUT_MS*/
+    uint32_t outstanding;
+    uint32_t samples;           /*latencies the percentiles cover*/
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint64_t records;           /*framed: records decoded*/
+    uint64_t badRecords;        /*framed: text or records failing their CRC*/
+    uint64_t missedRecords;     /*framed: gaps in the sequence numbers*/
+    uint64_t refused;           /*framed: toggles refused by a full command queue*/
+    /*queue to ack of the latest toggle of each LED, 0 before the first*/
+    uint32_t lastUs[WEBSERVER_LEDS];
+    web_link_master_stats_t masters[WEBSERVER_MASTERS];
+}web_link_stats_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*web_serial_rx_t: parses what a master printed*/
+void WebLink_Receive(uint32_t master, const char* pData, uint32_t len);
+
+/*web_serial_rx_t of the framed link: decodes the records of a master*/
+void WebLink_ReceiveFrames(uint32_t master, const char* pData, uint32_t len);
+
+/*web_serial_sent_t: starts timing a toggle*/
+void WebLink_Sent(uint32_t master, char digit, uint64_t queuedUs);
+
+/*counters and latencies since start, from any thread*/
+void WebLink_Stats(web_link_stats_t* pStats);
+
+#endif /* __WEB_LINK_H_ */
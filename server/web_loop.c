@@ -0,0 +1,1153 @@
+#define _GNU_SOURCE
+#include "web_loop.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/*first member of everything epoll hands back, tells what the event is for*/
+typedef enum
+{
+    mWebKindListener_c = 0,
+    mWebKindConn_c,
+    mWebKindWake_c
+}web_kind_t;
+
+typedef enum
+{
+    mWebConnReading_c = 0,
+    mWebConnWriting_c,
+    mWebConnClosing_c,
+    mWebConnStreaming_c
+}web_conn_state_t;
+
+typedef struct web_conn_tag
+{
+    web_kind_t kind;
+    int fd;
+    web_conn_state_t state;
+    /*epoll events registered*/
+    uint32_t events;
+    /*start of the request being parsed, earlier bytes are answered requests*/
+    uint32_t inStart;
+    uint32_t inLen;
+    /*response being sent, out or a handler's cached bytes*/
+    const char* pOut;
+    uint32_t outLen;
+    uint32_t outSent;
+    /*the connection is kept for another request once the response is out*/
+    bool keepAlive;
+    /*the response starts an event stream*/
+    bool stream;
+    /*event of the worker the stream got last, a newer one is sent once the
+      socket takes it*/
+    uint32_t pushSeq;
+    web_http_parser_t parser;
+    uint64_t deadlineMs;
+    struct web_worker_tag* pWorker;
+    /*deadline list the connection is on, free connections are chained by pNext*/
+    struct web_conn_list_tag* pList;
+    struct web_conn_tag* pPrev;
+    struct web_conn_tag* pNext;
+    char in[WEBSERVER_REQUEST_MAX];
+    char out[WEBSERVER_RESPONSE_MAX];
+}web_conn_t;
+
+/*connections sharing one timeout, appended on activity so the list stays in
+  deadline order*/
+typedef struct web_conn_list_tag
+{
+    web_conn_t* pOldest;
+    web_conn_t* pNewest;
+    uint32_t timeoutMs;
+}web_conn_list_t;
+
+/*one event loop thread with its own listening socket and connections*/
+typedef struct web_worker_tag
+{
+    pthread_t thread;
+    int epollFd;
+    int listenFd;
+    /*eventfd WebLoop_Stop and WebLoop_Push write to end epoll_wait*/
+    int wakeFd;
+    /*set by WebLoop_Push, the first setter rings wakeFd*/
+    uint32_t pushPending;
+    /*latest event, encoded once and written to every stream of the worker*/
+    uint32_t pushSeq;
+    uint32_t pushLen;
+    char push[WEBSERVER_EVENT_MAX];
+    /*kept open so a client can still be accepted and closed once no fd is left*/
+    int spareFd;
+    web_kind_t listenKind;
+    web_kind_t wakeKind;
+    web_conn_t* pFree;
+    web_conn_list_t active;
+    web_conn_list_t idle;
+    web_conn_list_t lingering;
+    /*event streams, pinged when their deadline passes*/
+    web_conn_list_t streams;
+    web_loop_stats_t stats;
+}web_worker_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static bool WebLoop_WorkerInit(web_worker_t* pWorker, const char* pAddr, uint16_t port);
+static void* WebLoop_WorkerRun(void* pArg);
+static void WebLoop_Accept(web_worker_t* pWorker);
+static void WebLoop_ConnEvent(web_conn_t* pConn, uint32_t events);
+static bool WebLoop_ConnRead(web_conn_t* pConn);
+static void WebLoop_ConnServe(web_conn_t* pConn, web_http_status_t status, const web_http_request_t* pRequest);
+static bool WebLoop_ConnWrite(web_conn_t* pConn);
+static void WebLoop_ConnLinger(web_conn_t* pConn);
+static void WebLoop_ConnStream(web_conn_t* pConn, uint32_t events);
+static bool WebLoop_StreamSend(web_conn_t* pConn, const char* pData, uint32_t len);
+static void WebLoop_Fanout(web_worker_t* pWorker);
+static void WebLoop_ConnClose(web_conn_t* pConn);
+static void WebLoop_ConnTouch(web_conn_t* pConn, web_conn_list_t* pList);
+static void WebLoop_ConnUnlink(web_conn_t* pConn);
+static bool WebLoop_ConnWait(web_conn_t* pConn, uint32_t events);
+static void WebLoop_Expire(web_worker_t* pWorker, web_conn_list_t* pList);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*answers to requests the parser refused, the connection closes after them*/
+static const char mWebBadRequest[] =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char mWebTooLarge[] =
+    "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static web_worker_t* mpWebWorkers;
+static uint32_t mWebWorkerCount;
+static web_handler_t mWebHandler;
+static web_event_t mWebEvent;
+static volatile sig_atomic_t mWebStop;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Creates the workers, each with its own epoll instance and non-blocking
+*         listening socket bound with SO_REUSEPORT, so the kernel spreads new
+*         connections over the workers and no lock is taken on accept.
+*
+* \param[in] pAddr    IPv4 address to bind, NULL for any
+* \param[in] port     TCP port
+* \param[in] handler  renders the response to each request, called from every
+*                     worker thread
+* \param[in] event    renders the event WebLoop_Push sends to every stream, NULL
+*                     without streams
+* \param[in] workers  number of event loop threads, at least 1
+*
+* \return  false with errno set if a socket could not be set up
+*
+********************************************************************************** */
+bool WebLoop_Init(const char* pAddr, uint16_t port, web_handler_t handler, web_event_t event,
+                  uint32_t workers)
+{
+    uint32_t i;
+
+    mWebHandler = handler;
+    mWebEvent = event;
+    mWebWorkerCount = workers ? workers : 1;
+    mpWebWorkers = calloc(mWebWorkerCount, sizeof(web_worker_t));
+    if(!mpWebWorkers)
+    {
+        return false;
+    }
+    for(i = 0; i < mWebWorkerCount; i++)
+    {
+        if(!WebLoop_WorkerInit(&mpWebWorkers[i], pAddr, port))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Runs a worker per thread, the first one on the calling thread, until
+*         WebLoop_Stop, then waits for the others.
+*
+********************************************************************************** */
+void WebLoop_Run(void)
+{
+    uint32_t started;
+    uint32_t i;
+
+    for(started = 1; started < mWebWorkerCount; started++)
+    {
+        if(pthread_create(&mpWebWorkers[started].thread, NULL, WebLoop_WorkerRun, &mpWebWorkers[started]) != 0)
+        {
+            perror("pthread_create");
+            break;
+        }
+    }
+    (void)WebLoop_WorkerRun(&mpWebWorkers[0]);
+    for(i = 1; i < started; i++)
+    {
+        (void)pthread_join(mpWebWorkers[i].thread, NULL);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Makes every worker return after its current batch of events. Only sets
+*         a flag and writes the eventfd of each worker, so it may be called from
+*         a signal handler.
+*
+********************************************************************************** */
+void WebLoop_Stop(void)
+{
+    uint64_t one = 1;
+    uint32_t i;
+
+    mWebStop = 1;
+    for(i = 0; i < mWebWorkerCount; i++)
+    {
+        ssize_t written = write(mpWebWorkers[i].wakeFd, &one, sizeof(one));
+
+        (void)written;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Asks every worker to send a fresh event to its streams. Workers that
+*         are already asked are not woken again, a burst of changes costs one
+*         wake-up and one event per worker, each stream gets the latest state.
+*         Safe from any thread.
+*
+********************************************************************************** */
+void WebLoop_Push(void)
+{
+    uint64_t one = 1;
+    uint32_t i;
+
+    for(i = 0; i < mWebWorkerCount; i++)
+    {
+        if(!__atomic_exchange_n(&mpWebWorkers[i].pushPending, 1, __ATOMIC_ACQ_REL))
+        {
+            ssize_t written = write(mpWebWorkers[i].wakeFd, &one, sizeof(one));
+
+            (void)written;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Sums the counters of the workers; exact once WebLoop_Run returned, a
+*         close estimate while they run.
+*
+* \param[out] pStats  counters since WebLoop_Init
+*
+********************************************************************************** */
+void WebLoop_Stats(web_loop_stats_t* pStats)
+{
+    uint32_t i;
+
+    memset(pStats, 0, sizeof(*pStats));
+    for(i = 0; i < mWebWorkerCount; i++)
+    {
+        const web_loop_stats_t* pWorker = &mpWebWorkers[i].stats;
+
+        pStats->accepted += pWorker->accepted;
+        pStats->refused += pWorker->refused;
+        pStats->requests += pWorker->requests;
+        pStats->timeouts += pWorker->timeouts;
+        pStats->errors += pWorker->errors;
+        pStats->pushed += pWorker->pushed;
+        pStats->open += pWorker->open;
+        pStats->peakOpen += pWorker->peakOpen;
+    }
+}
+
+uint64_t WebLoop_NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Sets up the epoll instance, listening socket and wake eventfd of one
+*         worker.
+*
+* \param[out] pWorker  worker to set up
+* \param[in]  pAddr    IPv4 address to bind, NULL for any
+* \param[in]  port     TCP port
+*
+* \return  false with errno set on failure
+*
+********************************************************************************** */
+static bool WebLoop_WorkerInit(web_worker_t* pWorker, const char* pAddr, uint16_t port)
+{
+    struct sockaddr_in addr;
+    struct epoll_event ev;
+    int one = 1;
+
+    pWorker->listenKind = mWebKindListener_c;
+    pWorker->wakeKind = mWebKindWake_c;
+    pWorker->active.timeoutMs = WEBSERVER_IDLE_TIMEOUT_MS;
+    pWorker->idle.timeoutMs = WEBSERVER_KEEPALIVE_MS;
+    pWorker->lingering.timeoutMs = WEBSERVER_LINGER_MS;
+    pWorker->streams.timeoutMs = WEBSERVER_STREAM_PING_MS;
+    pWorker->listenFd = -1;
+    pWorker->wakeFd = -1;
+
+    pWorker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(pWorker->epollFd < 0)
+    {
+        return false;
+    }
+
+    pWorker->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(pWorker->listenFd < 0)
+    {
+        return false;
+    }
+    (void)setsockopt(pWorker->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(setsockopt(pWorker->listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+    {
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = pAddr ? inet_addr(pAddr) : htonl(INADDR_ANY);
+    if((bind(pWorker->listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0) ||
+       (listen(pWorker->listenFd, WEBSERVER_BACKLOG) < 0))
+    {
+        return false;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &pWorker->listenKind;
+    if(epoll_ctl(pWorker->epollFd, EPOLL_CTL_ADD, pWorker->listenFd, &ev) < 0)
+    {
+        return false;
+    }
+
+    pWorker->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.data.ptr = &pWorker->wakeKind;
+    if((pWorker->wakeFd < 0) ||
+       (epoll_ctl(pWorker->epollFd, EPOLL_CTL_ADD, pWorker->wakeFd, &ev) < 0))
+    {
+        return false;
+    }
+
+    pWorker->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Dispatches the epoll events of one worker until WebLoop_Stop. The wait
+*         is bounded by the oldest deadline so idle clients are dropped in time.
+*
+* \param[in] pArg  web_worker_t
+*
+********************************************************************************** */
+static void* WebLoop_WorkerRun(void* pArg)
+{
+    web_worker_t* pWorker = pArg;
+    struct epoll_event events[WEBSERVER_EVENTS];
+
+    while(!mWebStop)
+    {
+        uint64_t deadlineMs = UINT64_MAX;
+        int timeoutMs = -1;
+        int count;
+        int i;
+
+        if(pWorker->active.pOldest)
+        {
+            deadlineMs = pWorker->active.pOldest->deadlineMs;
+        }
+        if(pWorker->idle.pOldest && (pWorker->idle.pOldest->deadlineMs < deadlineMs))
+        {
+            deadlineMs = pWorker->idle.pOldest->deadlineMs;
+        }
+        if(pWorker->lingering.pOldest && (pWorker->lingering.pOldest->deadlineMs < deadlineMs))
+        {
+            deadlineMs = pWorker->lingering.pOldest->deadlineMs;
+        }
+        if(pWorker->streams.pOldest && (pWorker->streams.pOldest->deadlineMs < deadlineMs))
+        {
+            deadlineMs = pWorker->streams.pOldest->deadlineMs;
+        }
+        if(deadlineMs != UINT64_MAX)
+        {
+            uint64_t now = WebLoop_NowMs();
+
+            timeoutMs = (deadlineMs > now) ? (int)(deadlineMs - now) : 0;
+        }
+
+        count = epoll_wait(pWorker->epollFd, events, WEBSERVER_EVENTS, timeoutMs);
+        if(count < 0)
+        {
+            if(errno != EINTR)
+            {
+                perror("epoll_wait");
+                break;
+            }
+            continue;
+        }
+
+        for(i = 0; i < count; i++)
+        {
+            web_kind_t* pKind = events[i].data.ptr;
+
+            if(*pKind == mWebKindListener_c)
+            {
+                WebLoop_Accept(pWorker);
+            }
+            else if(*pKind == mWebKindConn_c)
+            {
+                WebLoop_ConnEvent((web_conn_t*)pKind, events[i].events);
+            }
+            else
+            {
+                uint64_t count;
+                ssize_t got = read(pWorker->wakeFd, &count, sizeof(count));
+
+                (void)got;
+                //WebLoop_Stop sets its flag, checked at the top; WebLoop_Push its own
+                if(__atomic_exchange_n(&pWorker->pushPending, 0, __ATOMIC_ACQ_REL))
+                {
+                    WebLoop_Fanout(pWorker);
+                }
+            }
+        }
+        WebLoop_Expire(pWorker, &pWorker->active);
+        WebLoop_Expire(pWorker, &pWorker->idle);
+        WebLoop_Expire(pWorker, &pWorker->lingering);
+        WebLoop_Expire(pWorker, &pWorker->streams);
+    }
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Accepts every pending client. A client beyond WEBSERVER_MAX_CONNS, or
+*         arriving when the process is out of descriptors, is closed at once
+*         instead of being left in the backlog where it would wake the loop
+*         forever.
+*
+********************************************************************************** */
+static void WebLoop_Accept(web_worker_t* pWorker)
+{
+    for(;;)
+    {
+        web_conn_t* pConn;
+        struct epoll_event ev;
+        int one = 1;
+        int fd = accept4(pWorker->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if(fd < 0)
+        {
+            if(((errno == EMFILE) || (errno == ENFILE)) && (pWorker->spareFd >= 0))
+            {
+                //free the spare descriptor for one accept and close that client
+                close(pWorker->spareFd);
+                fd = accept(pWorker->listenFd, NULL, NULL);
+                if(fd >= 0)
+                {
+                    close(fd);
+                    pWorker->stats.refused++;
+                }
+                pWorker->spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            //EAGAIN: backlog empty; ECONNABORTED and the like: client gone
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                return;
+            }
+            if((errno == ECONNABORTED) || (errno == EINTR) || (errno == EPROTO))
+            {
+                continue;
+            }
+            perror("accept");
+            return;
+        }
+
+        if(pWorker->stats.open >= WEBSERVER_MAX_CONNS / mWebWorkerCount)
+        {
+            close(fd);
+            pWorker->stats.refused++;
+            continue;
+        }
+
+        pConn = pWorker->pFree;
+        if(pConn)
+        {
+            pWorker->pFree = pConn->pNext;
+        }
+        else
+        {
+            //connections are allocated as the peak grows and then reused
+            pConn = malloc(sizeof(web_conn_t));
+            if(!pConn)
+            {
+                close(fd);
+                pWorker->stats.refused++;
+                continue;
+            }
+        }
+        pConn->kind = mWebKindConn_c;
+        pConn->fd = fd;
+        pConn->pWorker = pWorker;
+        pConn->state = mWebConnReading_c;
+        pConn->events = EPOLLIN | EPOLLRDHUP;
+        pConn->inStart = 0;
+        pConn->inLen = 0;
+        pConn->pOut = pConn->out;
+        pConn->outLen = 0;
+        pConn->outSent = 0;
+        pConn->keepAlive = false;
+        pConn->stream = false;
+        WebHttp_Reset(&pConn->parser);
+        pConn->pList = NULL;
+        pConn->pPrev = NULL;
+        pConn->pNext = NULL;
+
+        //responses go out in one segment, do not wait for the ack of the last one
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = pConn->events;
+        ev.data.ptr = pConn;
+        if(epoll_ctl(pWorker->epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            close(fd);
+            pConn->pNext = pWorker->pFree;
+            pWorker->pFree = pConn;
+            pWorker->stats.errors++;
+            continue;
+        }
+
+        pWorker->stats.accepted++;
+        pWorker->stats.open++;
+        if(pWorker->stats.open > pWorker->stats.peakOpen)
+        {
+            pWorker->stats.peakOpen = pWorker->stats.open;
+        }
+        WebLoop_ConnTouch(pConn, &pConn->pWorker->idle);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Runs the state machine of a connection on its epoll events, as long as
+*         a step leaves work for the next one: a parsed request is answered
+*         at once and a pipelined request already buffered is parsed as soon as
+*         the previous response is out.
+*
+* \param[in] pConn   connection
+* \param[in] events  epoll events
+*
+********************************************************************************** */
+static void WebLoop_ConnEvent(web_conn_t* pConn, uint32_t events)
+{
+    bool more = true;
+
+    if(events & EPOLLERR)
+    {
+        pConn->pWorker->stats.errors++;
+        WebLoop_ConnClose(pConn);
+        return;
+    }
+
+    while(more)
+    {
+        switch(pConn->state)
+        {
+        case mWebConnReading_c:
+            more = WebLoop_ConnRead(pConn);
+            break;
+        case mWebConnWriting_c:
+            more = WebLoop_ConnWrite(pConn);
+            break;
+        case mWebConnStreaming_c:
+            WebLoop_ConnStream(pConn, events);
+            more = false;
+            break;
+        default:
+            WebLoop_ConnLinger(pConn);
+            more = false;
+            break;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Parses what is buffered and takes more from the socket until a request
+*         is complete, then hands it to the handler. The parser continues where
+*         the previous read left it.
+*
+* \param[in] pConn  connection in the READING state
+*
+* \return  true if a response is ready to be written
+*
+********************************************************************************** */
+static bool WebLoop_ConnRead(web_conn_t* pConn)
+{
+    web_http_request_t request;
+    web_http_status_t status;
+
+    for(;;)
+    {
+        ssize_t got;
+
+        status = WebHttp_Parse(&pConn->parser, &pConn->in[pConn->inStart], pConn->inLen - pConn->inStart,
+                               sizeof(pConn->in), &request);
+        if(status != gWebHttpIncomplete_c)
+        {
+            break;
+        }
+
+        if(pConn->inStart && (pConn->inLen == sizeof(pConn->in)))
+        {
+            //the request started late in the buffer, move it to the front
+            memmove(pConn->in, &pConn->in[pConn->inStart], pConn->inLen - pConn->inStart);
+            pConn->inLen -= pConn->inStart;
+            pConn->inStart = 0;
+            WebHttp_Reset(&pConn->parser);
+            continue;
+        }
+
+        got = recv(pConn->fd, &pConn->in[pConn->inLen], sizeof(pConn->in) - pConn->inLen, 0);
+        if(got > 0)
+        {
+            pConn->inLen += (uint32_t)got;
+        }
+        else if(got == 0)
+        {
+            //peer closed, between requests that is the normal end of keep-alive
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+        else if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        {
+            WebLoop_ConnTouch(pConn, (pConn->inLen == pConn->inStart) ? &pConn->pWorker->idle
+                                                                      : &pConn->pWorker->active);
+            return false;
+        }
+        else if(errno != EINTR)
+        {
+            pConn->pWorker->stats.errors++;
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+    }
+
+    WebLoop_ConnServe(pConn, status, &request);
+    if(pConn->outLen == 0)
+    {
+        pConn->pWorker->stats.errors++;
+        WebLoop_ConnClose(pConn);
+        return false;
+    }
+    pConn->outSent = 0;
+    pConn->state = mWebConnWriting_c;
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Renders the response to a complete request, or the error answer to a
+*         refused one, and consumes the request from the buffer.
+*
+* \param[in] pConn     connection
+* \param[in] status    parser result, not gWebHttpIncomplete_c
+* \param[in] pRequest  the request when status is gWebHttpComplete_c
+*
+********************************************************************************** */
+static void WebLoop_ConnServe(web_conn_t* pConn, web_http_status_t status, const web_http_request_t* pRequest)
+{
+    if(status == gWebHttpComplete_c)
+    {
+        web_response_t response;
+
+        response.pBuf = pConn->out;
+        response.bufMax = sizeof(pConn->out);
+        response.pData = NULL;
+        response.len = 0;
+        response.stream = false;
+        pConn->pWorker->stats.requests++;
+        pConn->keepAlive = pRequest->keepAlive;
+        pConn->outLen = (mWebHandler(pRequest, &response) && response.pData) ? response.len : 0;
+        pConn->pOut = response.pData;
+        //the response carries the current state, later events follow it
+        pConn->stream = response.stream && mWebEvent;
+        pConn->pushSeq = pConn->pWorker->pushSeq;
+        pConn->inStart += pRequest->length;
+        if(pConn->inStart == pConn->inLen)
+        {
+            pConn->inStart = 0;
+            pConn->inLen = 0;
+        }
+        WebHttp_Reset(&pConn->parser);
+        return;
+    }
+
+    pConn->pWorker->stats.errors++;
+    pConn->keepAlive = false;
+    if(status == gWebHttpTooLarge_c)
+    {
+        pConn->pOut = mWebTooLarge;
+        pConn->outLen = sizeof(mWebTooLarge) - 1;
+    }
+    else
+    {
+        pConn->pOut = mWebBadRequest;
+        pConn->outLen = sizeof(mWebBadRequest) - 1;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Sends as much of the response as the socket takes, waits for EPOLLOUT
+*         for the rest. Once all is sent a keep-alive connection reads the next
+*         request, any other starts closing.
+*
+* \param[in] pConn  connection in the WRITING state
+*
+* \return  true if a pipelined request is already buffered
+*
+********************************************************************************** */
+static bool WebLoop_ConnWrite(web_conn_t* pConn)
+{
+    while(pConn->outSent < pConn->outLen)
+    {
+        ssize_t sent = send(pConn->fd, &pConn->pOut[pConn->outSent],
+                            pConn->outLen - pConn->outSent, MSG_NOSIGNAL);
+
+        if(sent > 0)
+        {
+            pConn->outSent += (uint32_t)sent;
+        }
+        else if((sent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            if(!WebLoop_ConnWait(pConn, EPOLLOUT))
+            {
+                WebLoop_ConnClose(pConn);
+                return false;
+            }
+            WebLoop_ConnTouch(pConn, &pConn->pWorker->active);
+            return false;
+        }
+        else if((sent < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else
+        {
+            pConn->pWorker->stats.errors++;
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+    }
+
+    if(pConn->stream)
+    {
+        pConn->state = mWebConnStreaming_c;
+        pConn->outLen = 0;
+        pConn->outSent = 0;
+        if(!WebLoop_ConnWait(pConn, EPOLLIN | EPOLLRDHUP))
+        {
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+        WebLoop_ConnTouch(pConn, &pConn->pWorker->streams);
+        if(pConn->pushSeq != pConn->pWorker->pushSeq)
+        {
+            //an event went out while the response was still being written
+            pConn->pushSeq = pConn->pWorker->pushSeq;
+            (void)WebLoop_StreamSend(pConn, pConn->pWorker->push, pConn->pWorker->pushLen);
+        }
+        return false;
+    }
+
+    if(pConn->keepAlive)
+    {
+        pConn->state = mWebConnReading_c;
+        if(!WebLoop_ConnWait(pConn, EPOLLIN | EPOLLRDHUP))
+        {
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+        if(pConn->inLen > pConn->inStart)
+        {
+            return true;
+        }
+        WebLoop_ConnTouch(pConn, &pConn->pWorker->idle);
+        return false;
+    }
+
+    //the response ends with the connection
+    (void)shutdown(pConn->fd, SHUT_WR);
+    pConn->state = mWebConnClosing_c;
+    if(!WebLoop_ConnWait(pConn, EPOLLIN | EPOLLRDHUP))
+    {
+        WebLoop_ConnClose(pConn);
+        return false;
+    }
+    WebLoop_ConnTouch(pConn, &pConn->pWorker->lingering);
+    return false;
+}
+
+/*! *********************************************************************************
+* \brief  Drains a closing connection, closes it once the peer did.
+*
+* \param[in] pConn  connection in the CLOSING state
+*
+********************************************************************************** */
+static void WebLoop_ConnLinger(web_conn_t* pConn)
+{
+    char drain[256];
+
+    for(;;)
+    {
+        ssize_t got = recv(pConn->fd, drain, sizeof(drain), 0);
+
+        if(got > 0)
+        {
+            continue;
+        }
+        if((got < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            return;
+        }
+        if((got < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        WebLoop_ConnClose(pConn);
+        return;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Serves the epoll events of an event stream: finishes an event the
+*         socket did not take at once, then sends the latest one if it moved
+*         on meanwhile. What the client sends is drained, end of stream closes.
+*
+* \param[in] pConn   connection in the STREAMING state
+* \param[in] events  epoll events
+*
+********************************************************************************** */
+static void WebLoop_ConnStream(web_conn_t* pConn, uint32_t events)
+{
+    web_worker_t* pWorker = pConn->pWorker;
+
+    if(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+    {
+        char drain[256];
+        ssize_t got;
+
+        while((got = recv(pConn->fd, drain, sizeof(drain), 0)) > 0)
+        {
+        }
+        if((got == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+        {
+            WebLoop_ConnClose(pConn);
+            return;
+        }
+    }
+
+    if((events & EPOLLOUT) && (pConn->outSent < pConn->outLen))
+    {
+        if(!WebLoop_StreamSend(pConn, &pConn->out[pConn->outSent], pConn->outLen - pConn->outSent))
+        {
+            return;
+        }
+        if(pConn->outSent == pConn->outLen)
+        {
+            if(pConn->pushSeq != pWorker->pushSeq)
+            {
+                pConn->pushSeq = pWorker->pushSeq;
+                (void)WebLoop_StreamSend(pConn, pWorker->push, pWorker->pushLen);
+            }
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Writes an event to a stream with one send. A part the socket does not
+*         take is kept in the connection buffer and finished on EPOLLOUT; until
+*         then newer events are skipped, the latest is sent after.
+*
+* \param[in] pConn  connection in the STREAMING state
+* \param[in] pData  event, or the unsent rest of one in pConn->out
+* \param[in] len    its length
+*
+* \return  false if the connection was closed
+*
+********************************************************************************** */
+static bool WebLoop_StreamSend(web_conn_t* pConn, const char* pData, uint32_t len)
+{
+    ssize_t sent;
+
+    do
+    {
+        sent = send(pConn->fd, pData, len, MSG_NOSIGNAL);
+    }while((sent < 0) && (errno == EINTR));
+
+    if((sent < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+    {
+        //a dashboard that went away is how a stream normally ends
+        if((errno != EPIPE) && (errno != ECONNRESET))
+        {
+            pConn->pWorker->stats.errors++;
+        }
+        WebLoop_ConnClose(pConn);
+        return false;
+    }
+    if(sent < 0)
+    {
+        sent = 0;
+    }
+    if((uint32_t)sent == len)
+    {
+        pConn->outLen = 0;
+        pConn->outSent = 0;
+        pConn->pWorker->stats.pushed++;
+        if(!WebLoop_ConnWait(pConn, EPOLLIN | EPOLLRDHUP))
+        {
+            WebLoop_ConnClose(pConn);
+            return false;
+        }
+        return true;
+    }
+
+    if(pData != &pConn->out[pConn->outSent])
+    {
+        //the worker buffer is reused by the next event, keep a copy of the rest
+        memcpy(pConn->out, pData + sent, len - (uint32_t)sent);
+        pConn->outLen = len - (uint32_t)sent;
+        pConn->outSent = 0;
+    }
+    else
+    {
+        pConn->outSent += (uint32_t)sent;
+    }
+    if(!WebLoop_ConnWait(pConn, EPOLLIN | EPOLLRDHUP | EPOLLOUT))
+    {
+        WebLoop_ConnClose(pConn);
+        return false;
+    }
+    return true;
+}
+
+/*! *********************************************************************************
+* \brief  Encodes the current event once and writes it to every stream of the
+*         worker that is not still busy with an earlier one.
+*
+* \param[in] pWorker  worker woken by WebLoop_Push
+*
+********************************************************************************** */
+static void WebLoop_Fanout(web_worker_t* pWorker)
+{
+    web_conn_t* pConn;
+
+    if(!mWebEvent)
+    {
+        return;
+    }
+    pWorker->pushLen = mWebEvent(pWorker->push, sizeof(pWorker->push));
+    if(pWorker->pushLen == 0)
+    {
+        return;
+    }
+    pWorker->pushSeq++;
+
+    pConn = pWorker->streams.pOldest;
+    while(pConn)
+    {
+        web_conn_t* pNext = pConn->pNext;
+
+        if(pConn->outSent >= pConn->outLen)
+        {
+            pConn->pushSeq = pWorker->pushSeq;
+            (void)WebLoop_StreamSend(pConn, pWorker->push, pWorker->pushLen);
+        }
+        pConn = pNext;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Closes the socket and puts the connection back on the free list.
+*
+* \param[in] pConn  open connection
+*
+********************************************************************************** */
+static void WebLoop_ConnClose(web_conn_t* pConn)
+{
+    //closing the fd also removes it from the epoll set
+    close(pConn->fd);
+    pConn->fd = -1;
+    WebLoop_ConnUnlink(pConn);
+
+    pConn->pPrev = NULL;
+    pConn->pNext = pConn->pWorker->pFree;
+    pConn->pWorker->pFree = pConn;
+    pConn->pWorker->stats.open--;
+}
+
+/*! *********************************************************************************
+* \brief  Sets a new deadline and moves the connection to the newest end of the
+*         deadline list of its timeout.
+*
+* \param[in] pConn  open connection
+* \param[in] pList  active or lingering list of the worker
+*
+********************************************************************************** */
+static void WebLoop_ConnTouch(web_conn_t* pConn, web_conn_list_t* pList)
+{
+    WebLoop_ConnUnlink(pConn);
+
+    pConn->deadlineMs = WebLoop_NowMs() + pList->timeoutMs;
+    pConn->pList = pList;
+    pConn->pPrev = pList->pNewest;
+    pConn->pNext = NULL;
+    if(pList->pNewest)
+    {
+        pList->pNewest->pNext = pConn;
+    }
+    else
+    {
+        pList->pOldest = pConn;
+    }
+    pList->pNewest = pConn;
+}
+
+/*! *********************************************************************************
+* \brief  Takes the connection off its deadline list, if it is on one.
+*
+* \param[in] pConn  open connection
+*
+********************************************************************************** */
+static void WebLoop_ConnUnlink(web_conn_t* pConn)
+{
+    web_conn_list_t* pList = pConn->pList;
+
+    if(!pList)
+    {
+        return;
+    }
+    if(pConn->pPrev)
+    {
+        pConn->pPrev->pNext = pConn->pNext;
+    }
+    else
+    {
+        pList->pOldest = pConn->pNext;
+    }
+    if(pConn->pNext)
+    {
+        pConn->pNext->pPrev = pConn->pPrev;
+    }
+    else
+    {
+        pList->pNewest = pConn->pPrev;
+    }
+    pConn->pList = NULL;
+    pConn->pPrev = NULL;
+    pConn->pNext = NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Switches the events a connection waits for.
+*
+* \param[in] pConn   open connection
+* \param[in] events  EPOLLIN/EPOLLOUT mask
+*
+* \return  false if epoll refused
+*
+********************************************************************************** */
+static bool WebLoop_ConnWait(web_conn_t* pConn, uint32_t events)
+{
+    struct epoll_event ev;
+
+    if(events == pConn->events)
+    {
+        return true;
+    }
+    pConn->events = events;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = pConn;
+    return epoll_ctl(pConn->pWorker->epollFd, EPOLL_CTL_MOD, pConn->fd, &ev) == 0;
+}
+
+/*! *********************************************************************************
+* \brief  Closes the connections whose deadline passed, a list is in deadline
+*         order so only its head is looked at. A stream is pinged instead,
+*         unless it is still stuck on an earlier event.
+*
+* \param[in] pList  deadline list of the worker
+*
+********************************************************************************** */
+static void WebLoop_Expire(web_worker_t* pWorker, web_conn_list_t* pList)
+{
+    uint64_t now = WebLoop_NowMs();
+
+    while(pList->pOldest && (pList->pOldest->deadlineMs <= now))
+    {
+        web_conn_t* pConn = pList->pOldest;
+
+        if(pList == &pWorker->active)
+        {
+            pWorker->stats.timeouts++;
+        }
+        if((pList == &pWorker->streams) && (pConn->outSent >= pConn->outLen))
+        {
+            static const char ping[] = ":\n\n";
+
+            //an SSE comment keeps proxies from closing the stream and finds dead peers
+            WebLoop_ConnTouch(pConn, pList);
+            (void)WebLoop_StreamSend(pConn, ping, sizeof(ping) - 1);
+            continue;
+        }
+        //a stream that did not take its previous event for a whole period is given up
+        WebLoop_ConnClose(pConn);
+    }
+}
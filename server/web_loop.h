@@ -0,0 +1,147 @@
+#ifndef __WEB_LOOP_H_
+#define __WEB_LOOP_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "web_http.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Event loops of the Linux web bridge. Each worker thread owns an epoll
+ * instance, a listening socket bound with SO_REUSEPORT and the connections the
+ * kernel hands to that socket, so workers share nothing on the request path
+ * but the handler's own state. Sockets are non-blocking and each connection
+ * is a small state machine:
+ *
+ *   READING  bytes are appended to the connection buffer and fed to the
+ *            incremental parser of web_http.c until a whole request (head and
+ *            Content-Length body) is in, then the handler renders the response
+ *            into the output buffer
+ *   WRITING  the response is sent as far as the socket takes it, the rest on
+ *            EPOLLOUT; a keep-alive connection then goes back to READING and
+ *            starts on the pipelined requests already buffered
+ *   CLOSING  the write side is shut down and the socket drained until the peer
+ *            closes, so a response is not cut by a reset
+ *   STREAMING a response that starts a Server-Sent Events stream is followed
+ *            by the events WebLoop_Push asks for. Each worker encodes an event
+ *            once and writes it to each of its streams with one send; a stream
+ *            the socket cannot keep up with skips to the latest event
+ *
+ * A slow client only ever holds its own connection. Connections in the middle
+ * of a request that make no progress for WEBSERVER_IDLE_TIMEOUT_MS, and
+ * keep-alive connections idle for WEBSERVER_KEEPALIVE_MS, are dropped, oldest
+ * first, from lists kept in activity order.
+ */
+
+/*connections served at once by all workers, further clients are closed on
+  accept*/
+#ifndef WEBSERVER_MAX_CONNS
+#define WEBSERVER_MAX_CONNS          16384
+#endif
+
+/*request head and body a connection buffers*/
+#define WEBSERVER_REQUEST_MAX        4096
+
+/*response a connection renders, cached responses are sent from where they are*/
+#define WEBSERVER_RESPONSE_MAX       2048
+
+/*a connection without progress in a request for this long is closed*/
+#define WEBSERVER_IDLE_TIMEOUT_MS    10000
+
+/*a keep-alive connection without a new request for this long is closed*/
+#define WEBSERVER_KEEPALIVE_MS       5000
+
+/*time a closing connection is drained before it is dropped*/
+#define WEBSERVER_LINGER_MS          1000
+
+/*listen backlog, also capped by net.core.somaxconn*/
+#define WEBSERVER_BACKLOG            4096
+
+/*event pushed to streams*/
+#define WEBSERVER_EVENT_MAX          256
+
+/*period of the SSE comment every stream gets, finds peers that are gone*/
+#define WEBSERVER_STREAM_PING_MS     15000
+
+/*epoll events taken per wait*/
+#define WEBSERVER_EVENTS             256
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*response to one request, status line and headers included. The handler
+  either renders it into pBuf, or points pData at bytes that stay valid and
+  unchanged while the connection sends them, such as a cached page*/
+typedef struct web_response_tag
+{
+    char* pBuf;             /*buffer of the connection*/
+    uint32_t bufMax;
+    const char* pData;      /*bytes to send*/
+    uint32_t len;
+    bool stream;            /*the connection then receives the events of WebLoop_Push*/
+}web_response_t;
+
+/*answers one complete request, false drops the connection. The response
+  must carry a Content-Length, and Connection: close unless
+  pRequest->keepAlive. Called from every worker thread at once*/
+typedef bool (*web_handler_t)(const web_http_request_t* pRequest, web_response_t* pResponse);
+
+/*renders the event for the streams, returns its length, 0 for none. Called
+  once per worker and push*/
+typedef uint32_t (*web_event_t)(char* pEvent, uint32_t eventMax);
+
+/*loop counters, printed when the loop stops*/
+typedef struct web_loop_stats_tag
+{
+    uint64_t accepted;
+    uint64_t refused;       /*closed on accept, WEBSERVER_MAX_CONNS or no fd left*/
+    uint64_t requests;
+    uint64_t timeouts;      /*in the middle of a request, idle keep-alive not counted*/
+    uint64_t errors;        /*malformed or oversized requests, socket errors*/
+    uint64_t pushed;        /*events written to streams*/
+    uint32_t open;
+    uint32_t peakOpen;      /*sum of the peaks of the workers*/
+}web_loop_stats_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*binds pAddr:port once per worker and prepares the loops; false with errno
+  set on failure*/
+bool WebLoop_Init(const char* pAddr, uint16_t port, web_handler_t handler, web_event_t event,
+                  uint32_t workers);
+
+/*serves on every worker until WebLoop_Stop*/
+void WebLoop_Run(void);
+
+/*makes WebLoop_Run return, safe from a signal handler*/
+void WebLoop_Stop(void);
+
+/*sends a fresh event to every stream, from any thread*/
+void WebLoop_Push(void);
+
+/*counters of all workers since WebLoop_Init*/
+void WebLoop_Stats(web_loop_stats_t* pStats);
+
+/*monotonic milliseconds*/
+uint64_t WebLoop_NowMs(void);
+
+#endif /* __WEB_LOOP_H_ */
@@ -0,0 +1,142 @@
+#include "web_route.h"
+
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+
+/*master * WEBSERVER_SLAVES_PER_MASTER + id + 1 of each slave, 0 if not routed*/
+static uint8_t mWebRouteOf[WEBSERVER_SLAVES];
+/*slave + 1 of each id of each master, 0 if none*/
+static uint8_t mWebRouteSlave[WEBSERVER_MASTERS][WEBSERVER_SLAVES_PER_MASTER];
+/*LEDs of each master*/
+static web_mask_t mWebRouteLeds[WEBSERVER_MASTERS];
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+void WebRoute_Default(uint32_t masters)
+{
+    uint32_t slave;
+
+    for(slave = 0; (slave < WEBSERVER_SLAVES) && (slave / WEBSERVER_SLAVES_PER_MASTER < masters); slave++)
+    {
+        (void)WebRoute_Set(slave, slave / WEBSERVER_SLAVES_PER_MASTER, slave % WEBSERVER_SLAVES_PER_MASTER);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Routes a slave to an id of a master. A slave routed before leaves its
+*         old id free.
+*
+* \param[in] slave   slave of the bridge
+* \param[in] master  index of the master, the order of its -s
+* \param[in] id      slave id on that master, 0-2
+*
+* \return  false if any is out of range or the id belongs to another slave
+*
+********************************************************************************** */
+bool WebRoute_Set(uint32_t slave, uint32_t master, uint32_t id)
+{
+    uint32_t old;
+
+    if((slave >= WEBSERVER_SLAVES) || (master >= WEBSERVER_MASTERS) || (id >= WEBSERVER_SLAVES_PER_MASTER) ||
+       (mWebRouteSlave[master][id] && (mWebRouteSlave[master][id] != slave + 1U)))
+    {
+        return false;
+    }
+    if(mWebRouteOf[slave])
+    {
+        old = mWebRouteOf[slave] - 1U;
+        mWebRouteSlave[old / WEBSERVER_SLAVES_PER_MASTER][old % WEBSERVER_SLAVES_PER_MASTER] = 0;
+        mWebRouteLeds[old / WEBSERVER_SLAVES_PER_MASTER] &= ~WebState_SlaveMask(slave);
+    }
+    mWebRouteOf[slave] = (uint8_t)((master * WEBSERVER_SLAVES_PER_MASTER) + id + 1U);
+    mWebRouteSlave[master][id] = (uint8_t)(slave + 1U);
+    mWebRouteLeds[master] |= WebState_SlaveMask(slave);
+    return true;
+}
+
+bool WebRoute_Find(uint32_t slave, uint32_t* pMaster, uint32_t* pId)
+{
+    if((slave >= WEBSERVER_SLAVES) || !mWebRouteOf[slave])
+    {
+        return false;
+    }
+    if(pMaster)
+    {
+        *pMaster = (mWebRouteOf[slave] - 1U) / WEBSERVER_SLAVES_PER_MASTER;
+    }
+    if(pId)
+    {
+        *pId = (mWebRouteOf[slave] - 1U) % WEBSERVER_SLAVES_PER_MASTER;
+    }
+    return true;
+}
+
+uint32_t WebRoute_Slave(uint32_t master, uint32_t id)
+{
+    if((master >= WEBSERVER_MASTERS) || (id >= WEBSERVER_SLAVES_PER_MASTER) || !mWebRouteSlave[master][id])
+    {
+        return WEBSERVER_SLAVES;
+    }
+    return mWebRouteSlave[master][id] - 1U;
+}
+
+web_mask_t WebRoute_Leds(uint32_t master)
+{
+    return (master < WEBSERVER_MASTERS) ? mWebRouteLeds[master] : 0;
+}
+
+web_mask_t WebRoute_Slaves(void)
+{
+    web_mask_t slaves = 0;
+    uint32_t slave;
+
+    for(slave = 0; slave < WEBSERVER_SLAVES; slave++)
+    {
+        if(mWebRouteOf[slave])
+        {
+            slaves |= (web_mask_t)1U << slave;
+        }
+    }
+    return slaves;
+}
+
+/*! *********************************************************************************
+* \brief  Turns the LEDs one master drives into its toggle digits, in the order
+*         of its slave ids and LEDs, the order web_serial.c releases them in.
+*
+* \param[in]  master   index of the master
+* \param[in]  toggles  LEDs to toggle, those of other masters are skipped
+* \param[out] pDigits  the digits
+*
+* \return  number of digits
+*
+********************************************************************************** */
+uint32_t WebRoute_Digits(uint32_t master, web_mask_t toggles, char* pDigits)
+{
+    uint32_t count = 0;
+    uint32_t id;
+    uint32_t led;
+
+    toggles &= WebRoute_Leds(master);
+    for(id = 0; toggles && (id < WEBSERVER_SLAVES_PER_MASTER); id++)
+    {
+        uint32_t slave = WebRoute_Slave(master, id);
+
+        for(led = 0; (slave < WEBSERVER_SLAVES) && (led < WEBSERVER_LEDS_PER_SLAVE); led++)
+        {
+            if(toggles & WebState_Bit(slave, led))
+            {
+                pDigits[count++] = WebRoute_Digit(id, led);
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,66 @@
+#ifndef __WEB_ROUTE_H_
+#define __WEB_ROUTE_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "web_state.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Which master drives each slave of the bridge. The API and the state masks
+ * number the slaves across all masters; a master knows its own by the ids 0-2
+ * its UART digits and records carry. By default master m drives slaves 3m to
+ * 3m + 2 as ids 0-2; -r routes a slave elsewhere, e.g. where it joined or to
+ * spread the commands evenly over the masters. Each master has its serial
+ * port and thread (web_serial.c) and may run on its own GENFSK channel, so the
+ * command rate grows with the masters attached.
+ *
+ * The table is set up before the serial threads start and only read after.
+ */
+
+/*toggle digit of an LED of a master's slave id*/
+#define WebRoute_Digit(id, led)      ((char)('1' + ((id) * WEBSERVER_LEDS_PER_SLAVE) + (led)))
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*routes slaves 3m to 3m + 2 to master m, ids 0-2, for each of masters*/
+void WebRoute_Default(uint32_t masters);
+
+/*routes slave to id of master, replacing its route; false if out of range or
+  the id is routed to another slave*/
+bool WebRoute_Set(uint32_t slave, uint32_t master, uint32_t id);
+
+/*master and id of a slave, either may be NULL; false if it is not routed*/
+bool WebRoute_Find(uint32_t slave, uint32_t* pMaster, uint32_t* pId);
+
+/*slave of a master's id, WEBSERVER_SLAVES if none*/
+uint32_t WebRoute_Slave(uint32_t master, uint32_t id);
+
+/*LEDs of the slaves routed to master*/
+web_mask_t WebRoute_Leds(uint32_t master);
+
+/*bit per slave routed to any master*/
+web_mask_t WebRoute_Slaves(void);
+
+/*toggle digits of the LEDs of toggles routed to master, lowest digit first;
+  pDigits holds WEBSERVER_SLAVES_PER_MASTER * WEBSERVER_LEDS_PER_SLAVE.
+  Returns their number*/
+uint32_t WebRoute_Digits(uint32_t master, web_mask_t toggles, char* pDigits);
+
+#endif /* __WEB_ROUTE_H_ */
@@ -0,0 +1,743 @@
+#include "web_serial.h"
+#include "web_frame.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+************************************************************************************/
+#if (WEBSERVER_SERIAL_QUEUE & (WEBSERVER_SERIAL_QUEUE - 1))
+#error "WEBSERVER_SERIAL_QUEUE must be a power of two"
+#endif
+
+/*toggle digits of the master, '1' + slave * 3 + led*/
+#define mWebSerialDigits_c           9
+#define mWebSerialIsDigit(c)         (((c) >= '1') && ((c) < '1' + mWebSerialDigits_c))
+#define mWebSerialLedsPerSlave_c     3
+
+/*output one byte from the queue may add at most: raw, the byte and the held
+  toggles it releases; framed, the records closed by its type change, by the
+  release and by the end of the drain*/
+#define mWebSerialRoom(framed)       ((framed) ? (6U * WEBSERVER_FRAME_ENCODED_MAX) : (mWebSerialDigits_c + 1U))
+#if (6 * WEBSERVER_FRAME_ENCODED_MAX) >= WEBSERVER_SERIAL_QUEUE
+#error "WEBSERVER_SERIAL_QUEUE too small for framed output"
+#endif
+
+/************************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+************************************************************************************/
+
+/*one queued byte; seq is pos + 1 once the byte for position pos is written*/
+typedef struct web_serial_slot_tag
+{
+    uint32_t seq;
+    char data;
+}web_serial_slot_t;
+
+/*the port of one master and the thread that owns it*/
+typedef struct web_serial_port_tag
+{
+    uint32_t master;
+    int fd;
+    int epollFd;
+    int bellFd;
+    int timerFd;
+    pthread_t thread;
+    /*the thread was started, WebSerial_Close joins it*/
+    bool started;
+    bool running;
+    /*only a tty is read, a pipe would hand back what was written to it*/
+    bool isTty;
+
+    /*queue from the workers: producers reserve positions with a CAS on the
+      tail, the serial thread alone advances the head*/
+    web_serial_slot_t slots[WEBSERVER_SERIAL_QUEUE];
+    uint32_t tail;
+    uint32_t head;
+    /*set by the producer that rings the doorbell, cleared by the serial thread
+      before it drains*/
+    uint32_t rung;
+    bool open;
+
+    /*bytes taken from the queue and not yet accepted by the UART, serial
+      thread only*/
+    char out[WEBSERVER_SERIAL_QUEUE];
+    uint32_t outHead;
+    uint32_t outLen;
+    bool waitOut;
+
+    /*toggles held back for the cancel window, bit n for digit '1' + n; serial
+      thread only*/
+    uint32_t held;
+    bool armed;
+    /*when each held toggle was taken from the queue*/
+    uint64_t heldUs[mWebSerialDigits_c];
+
+    /*framed: the record being filled, serial thread only*/
+    uint8_t recType;
+    uint8_t rec[WEBSERVER_FRAME_PAYLOAD_MAX];
+    uint32_t recLen;
+    uint8_t recSeq;
+
+    /*counted by the serial thread, read by WebSerial_Stats*/
+    uint64_t written;
+    uint64_t cancelled;
+}web_serial_port_t;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static speed_t WebSerial_Speed(uint32_t baud);
+static void WebSerial_Shut(web_serial_port_t* pPort);
+static void* WebSerial_Thread(void* pArg);
+static void WebSerial_Drain(web_serial_port_t* pPort);
+static void WebSerial_Take(web_serial_port_t* pPort, char data);
+static void WebSerial_Release(web_serial_port_t* pPort);
+static void WebSerial_Put(web_serial_port_t* pPort, char data);
+static void WebSerial_Record(web_serial_port_t* pPort, uint8_t type, const uint8_t* pData, uint32_t len);
+static void WebSerial_Emit(web_serial_port_t* pPort);
+static void WebSerial_Flush(web_serial_port_t* pPort);
+static void WebSerial_Read(web_serial_port_t* pPort);
+static uint64_t WebSerial_NowUs(void);
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+static web_serial_port_t mWebSerialPorts[WEBSERVER_MASTERS];
+
+/*the same for every port, set before the first one opens*/
+static web_serial_rx_t mWebSerialRx;
+static web_serial_sent_t mWebSerialSent;
+static uint32_t mWebSerialWindowMs;
+static bool mWebSerialFramed;
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Opens the port of a master raw (8N1, no flow control, no echo) and
+*         non-blocking and starts the thread that owns it. Every master opened
+*         takes the same settings.
+*
+* \param[in] master    index of the master, below WEBSERVER_MASTERS
+* \param[in] pPath     device, e.g. /dev/ttyACM0
+* \param[in] baud      line rate
+* \param[in] windowMs  how long a toggle is held back so a second toggle of
+*                      the same LED cancels it, 0 to send at once
+* \param[in] framed    write web_frame.h records instead of the bytes, for a
+*                      master built with gAppUseHostFrames_d
+* \param[in] rx        gets what the master prints, NULL to ignore it
+* \param[in] sent      told of each toggle digit written, NULL if not needed
+*
+* \return  false with errno set if the port could not be opened or configured
+*
+********************************************************************************** */
+bool WebSerial_Open(uint32_t master, const char* pPath, uint32_t baud, uint32_t windowMs, bool framed,
+                     web_serial_rx_t rx, web_serial_sent_t sent)
+{
+    web_serial_port_t* pPort;
+    struct epoll_event ev;
+    struct termios tio;
+    speed_t speed = WebSerial_Speed(baud);
+    uint32_t i;
+
+    if((master >= WEBSERVER_MASTERS) || mWebSerialPorts[master].started || (speed == B0))
+    {
+        errno = EINVAL;
+        return false;
+    }
+    pPort = &mWebSerialPorts[master];
+    pPort->master = master;
+    pPort->fd = -1;
+    pPort->epollFd = -1;
+    pPort->bellFd = -1;
+    pPort->timerFd = -1;
+
+    pPort->fd = open(pPath, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(pPort->fd < 0)
+    {
+        return false;
+    }
+
+    pPort->isTty = (tcgetattr(pPort->fd, &tio) == 0);
+    if(pPort->isTty)
+    {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+        (void)cfsetispeed(&tio, speed);
+        (void)cfsetospeed(&tio, speed);
+        if(tcsetattr(pPort->fd, TCSANOW, &tio) < 0)
+        {
+            goto fail;
+        }
+    }
+    //not a tty, e.g. a pipe standing in for the master: used as is
+
+    pPort->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    pPort->bellFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pPort->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if((pPort->epollFd < 0) || (pPort->bellFd < 0) || (pPort->timerFd < 0))
+    {
+        goto fail;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = pPort->bellFd;
+    if(epoll_ctl(pPort->epollFd, EPOLL_CTL_ADD, pPort->bellFd, &ev) < 0)
+    {
+        goto fail;
+    }
+    ev.data.fd = pPort->timerFd;
+    if(epoll_ctl(pPort->epollFd, EPOLL_CTL_ADD, pPort->timerFd, &ev) < 0)
+    {
+        goto fail;
+    }
+    mWebSerialRx = rx;
+    mWebSerialSent = sent;
+    mWebSerialWindowMs = windowMs;
+    mWebSerialFramed = framed;
+    ev.events = (pPort->isTty && rx) ? EPOLLIN : 0;
+    ev.data.fd = pPort->fd;
+    if(epoll_ctl(pPort->epollFd, EPOLL_CTL_ADD, pPort->fd, &ev) < 0)
+    {
+        goto fail;
+    }
+
+    for(i = 0; i < WEBSERVER_SERIAL_QUEUE; i++)
+    {
+        pPort->slots[i].seq = 0;
+    }
+    pPort->head = 0;
+    pPort->tail = 0;
+    pPort->rung = 0;
+    pPort->outLen = 0;
+    pPort->waitOut = false;
+    pPort->held = 0;
+    pPort->armed = false;
+    pPort->recLen = 0;
+    pPort->running = true;
+    if((errno = pthread_create(&pPort->thread, NULL, WebSerial_Thread, pPort)) != 0)
+    {
+        goto fail;
+    }
+    pPort->started = true;
+    __atomic_store_n(&pPort->open, true, __ATOMIC_RELEASE);
+    return true;
+
+fail:
+    i = (uint32_t)errno;
+    WebSerial_Shut(pPort);
+    errno = (int)i;
+    return false;
+}
+
+/*! *********************************************************************************
+* \brief  Queues bytes for the serial thread of a master. Safe from any number of
+*         threads; the bytes of one call are reserved with a single CAS and stay
+*         contiguous.
+*
+* \param[in] master  index of the master
+* \param[in] pData   bytes
+* \param[in] len     number of bytes
+*
+* \return  false if the port is not open or the queue is full; nothing is queued
+*
+********************************************************************************** */
+bool WebSerial_Write(uint32_t master, const char* pData, uint32_t len)
+{
+    web_serial_port_t* pPort;
+    uint32_t tail;
+    uint32_t i;
+
+    if(!WebSerial_IsOpen(master) || !len || (len > WEBSERVER_SERIAL_QUEUE))
+    {
+        return false;
+    }
+    pPort = &mWebSerialPorts[master];
+
+    tail = __atomic_load_n(&pPort->tail, __ATOMIC_RELAXED);
+    do
+    {
+        //positions below the head are consumed and free to be reused
+        if(tail + len - __atomic_load_n(&pPort->head, __ATOMIC_ACQUIRE) > WEBSERVER_SERIAL_QUEUE)
+        {
+            return false;
+        }
+    }while(!__atomic_compare_exchange_n(&pPort->tail, &tail, tail + len, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    for(i = 0; i < len; i++)
+    {
+        web_serial_slot_t* pSlot = &pPort->slots[(tail + i) & (WEBSERVER_SERIAL_QUEUE - 1)];
+
+        pSlot->data = pData[i];
+        __atomic_store_n(&pSlot->seq, tail + i + 1, __ATOMIC_RELEASE);
+    }
+
+    //only the producer that finds the bell quiet rings it
+    if(!__atomic_exchange_n(&pPort->rung, 1, __ATOMIC_SEQ_CST))
+    {
+        uint64_t one = 1;
+
+        (void)write(pPort->bellFd, &one, sizeof(one));
+    }
+    return true;
+}
+
+bool WebSerial_IsOpen(uint32_t master)
+{
+    return (master < WEBSERVER_MASTERS) && __atomic_load_n(&mWebSerialPorts[master].open, __ATOMIC_ACQUIRE);
+}
+
+bool WebSerial_IsDuplex(uint32_t master)
+{
+    return WebSerial_IsOpen(master) && mWebSerialPorts[master].isTty && mWebSerialRx;
+}
+
+void WebSerial_Stats(uint32_t master, uint64_t* pWritten, uint64_t* pCancelled)
+{
+    *pWritten = __atomic_load_n(&mWebSerialPorts[master].written, __ATOMIC_RELAXED);
+    *pCancelled = __atomic_load_n(&mWebSerialPorts[master].cancelled, __ATOMIC_RELAXED);
+}
+
+/*! *********************************************************************************
+* \brief  Stops and joins the serial threads and closes the ports. No
+*         WebSerial_Write may run concurrently.
+*
+********************************************************************************** */
+void WebSerial_Close(void)
+{
+    uint32_t master;
+
+    for(master = 0; master < WEBSERVER_MASTERS; master++)
+    {
+        web_serial_port_t* pPort = &mWebSerialPorts[master];
+        uint64_t one = 1;
+
+        if(!pPort->started)
+        {
+            continue;
+        }
+        __atomic_store_n(&pPort->open, false, __ATOMIC_RELEASE);
+        __atomic_store_n(&pPort->running, false, __ATOMIC_RELEASE);
+        (void)write(pPort->bellFd, &one, sizeof(one));
+        (void)pthread_join(pPort->thread, NULL);
+        WebSerial_Shut(pPort);
+        pPort->started = false;
+    }
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Maps a line rate to its termios constant.
+*
+* \param[in] baud  line rate
+*
+* \return  speed_t, B0 if the rate is not supported
+*
+********************************************************************************** */
+static speed_t WebSerial_Speed(uint32_t baud)
+{
+    switch(baud)
+    {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    default:      return B0;
+    }
+}
+
+/*closes what is open of a port, its thread is not running*/
+static void WebSerial_Shut(web_serial_port_t* pPort)
+{
+    if(pPort->fd >= 0)
+    {
+        close(pPort->fd);
+        pPort->fd = -1;
+    }
+    if(pPort->epollFd >= 0)
+    {
+        close(pPort->epollFd);
+        pPort->epollFd = -1;
+    }
+    if(pPort->bellFd >= 0)
+    {
+        close(pPort->bellFd);
+        pPort->bellFd = -1;
+    }
+    if(pPort->timerFd >= 0)
+    {
+        close(pPort->timerFd);
+        pPort->timerFd = -1;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Serial thread of one port: sleeps on the doorbell, the end of the
+*         cancel window, the output of the master and, while the UART is full,
+*         on EPOLLOUT of the port.
+*
+********************************************************************************** */
+static void* WebSerial_Thread(void* pArg)
+{
+    web_serial_port_t* pPort = pArg;
+    struct epoll_event events[3];
+
+    while(__atomic_load_n(&pPort->running, __ATOMIC_ACQUIRE))
+    {
+        int count = epoll_wait(pPort->epollFd, events, 3, -1);
+        int n;
+
+        for(n = 0; n < count; n++)
+        {
+            if(events[n].data.fd == pPort->bellFd)
+            {
+                uint64_t rings;
+
+                (void)read(pPort->bellFd, &rings, sizeof(rings));
+                //cleared before the drain: bytes published after it ring again
+                __atomic_store_n(&pPort->rung, 0, __ATOMIC_SEQ_CST);
+                WebSerial_Drain(pPort);
+            }
+            else if(events[n].data.fd == pPort->timerFd)
+            {
+                uint64_t expirations;
+
+                (void)read(pPort->timerFd, &expirations, sizeof(expirations));
+                pPort->armed = false;
+                WebSerial_Release(pPort);
+                WebSerial_Drain(pPort);
+            }
+            else if(events[n].events & EPOLLIN)
+            {
+                WebSerial_Read(pPort);
+            }
+
+            if((events[n].data.fd == pPort->fd) && (events[n].events & (EPOLLERR | EPOLLHUP)))
+            {
+                //adapter unplugged or the master gone, its commands are dropped from now on
+                fprintf(stderr, "serial port of master %u lost\n", pPort->master);
+                __atomic_store_n(&pPort->open, false, __ATOMIC_RELEASE);
+                (void)epoll_ctl(pPort->epollFd, EPOLL_CTL_DEL, pPort->fd, NULL);
+                close(pPort->fd);
+                pPort->fd = -1;
+                pPort->outLen = 0;
+                pPort->held = 0;
+            }
+            else if((events[n].data.fd == pPort->fd) && (events[n].events & EPOLLOUT))
+            {
+                WebSerial_Flush(pPort);
+                //then what stayed queued while the output buffer was full
+                WebSerial_Drain(pPort);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief  Moves the published bytes from the queue to the output buffer and
+*         writes them, until the queue is empty or the UART is full. Bytes that
+*         do not fit stay queued until EPOLLOUT. Toggles taken into the cancel
+*         window are written when it ends.
+*
+********************************************************************************** */
+static void WebSerial_Drain(web_serial_port_t* pPort)
+{
+    uint32_t head = pPort->head;
+    bool more = true;
+
+    while(more && !pPort->waitOut)
+    {
+        more = false;
+        for(;;)
+        {
+            web_serial_slot_t* pSlot = &pPort->slots[head & (WEBSERVER_SERIAL_QUEUE - 1)];
+
+            //room for what this byte may add to the output
+            if(pPort->outLen + mWebSerialRoom(mWebSerialFramed) > WEBSERVER_SERIAL_QUEUE)
+            {
+                more = true;
+                break;
+            }
+            if(__atomic_load_n(&pSlot->seq, __ATOMIC_ACQUIRE) != head + 1)
+            {
+                //not reserved yet, or reserved and still being written
+                break;
+            }
+            WebSerial_Take(pPort, pSlot->data);
+            head++;
+        }
+        __atomic_store_n(&pPort->head, head, __ATOMIC_RELEASE);
+
+        if(mWebSerialWindowMs == 0)
+        {
+            //no window: only toggles that met in one drain cancel
+            WebSerial_Release(pPort);
+        }
+        else if(pPort->held && !pPort->armed)
+        {
+            struct itimerspec window;
+
+            memset(&window, 0, sizeof(window));
+            window.it_value.tv_sec = mWebSerialWindowMs / 1000U;
+            window.it_value.tv_nsec = (long)(mWebSerialWindowMs % 1000U) * 1000000L;
+            pPort->armed = (timerfd_settime(pPort->timerFd, 0, &window, NULL) == 0);
+            if(!pPort->armed)
+            {
+                WebSerial_Release(pPort);
+            }
+        }
+
+        WebSerial_Emit(pPort);
+
+        if(pPort->fd < 0)
+        {
+            pPort->outLen = 0;
+            pPort->held = 0;
+            return;
+        }
+        WebSerial_Flush(pPort);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Takes one byte off the queue. A toggle digit is held back and a second
+*         one for the same LED cancels both, the LED ends where it was; any
+*         other byte releases the held toggles first so the order is kept.
+*
+* \param[in] pPort  port of the master
+* \param[in] data   byte from the queue
+*
+********************************************************************************** */
+static void WebSerial_Take(web_serial_port_t* pPort, char data)
+{
+    uint32_t bit;
+
+    if(!mWebSerialIsDigit(data))
+    {
+        WebSerial_Release(pPort);
+        if(mWebSerialFramed)
+        {
+            WebSerial_Record(pPort, gWebFrameConsole_c, (const uint8_t*)&data, 1);
+        }
+        else
+        {
+            WebSerial_Put(pPort, data);
+        }
+        return;
+    }
+    bit = 1U << (uint32_t)(data - '1');
+    if(pPort->held & bit)
+    {
+        __atomic_add_fetch(&pPort->cancelled, 2, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        pPort->heldUs[data - '1'] = WebSerial_NowUs();
+    }
+    pPort->held ^= bit;
+}
+
+/*! *********************************************************************************
+* \brief  Moves the held toggles to the output, one digit per LED, lowest LED
+*         first; framed, one pair of slave id and LED mask per slave.
+*
+********************************************************************************** */
+static void WebSerial_Release(web_serial_port_t* pPort)
+{
+    uint32_t n;
+
+    for(n = 0; pPort->held && (n < mWebSerialDigits_c); n++)
+    {
+        if(mWebSerialFramed && !(n % mWebSerialLedsPerSlave_c))
+        {
+            uint8_t pair[2];
+
+            pair[0] = (uint8_t)(n / mWebSerialLedsPerSlave_c);
+            pair[1] = (uint8_t)((pPort->held >> n) & ((1U << mWebSerialLedsPerSlave_c) - 1U));
+            if(pair[1])
+            {
+                WebSerial_Record(pPort, gWebFrameLeds_c, pair, sizeof(pair));
+            }
+        }
+        if(pPort->held & (1U << n))
+        {
+            pPort->held &= ~(1U << n);
+            if(!mWebSerialFramed)
+            {
+                WebSerial_Put(pPort, (char)('1' + n));
+            }
+            if(mWebSerialSent)
+            {
+                mWebSerialSent(pPort->master, (char)('1' + n), pPort->heldUs[n]);
+            }
+        }
+    }
+}
+
+static void WebSerial_Put(web_serial_port_t* pPort, char data)
+{
+    if(pPort->outLen == WEBSERVER_SERIAL_QUEUE)
+    {
+        //past the room Drain keeps, e.g. a release by the window timer while
+        //the UART is full; framed, the record is dropped by its CRC
+        return;
+    }
+    pPort->out[(pPort->outHead + pPort->outLen) % WEBSERVER_SERIAL_QUEUE] = data;
+    pPort->outLen++;
+    __atomic_add_fetch(&pPort->written, 1, __ATOMIC_RELAXED);
+}
+
+/*! *********************************************************************************
+* \brief  Adds bytes to the record being filled, first closing it if it is of
+*         another type or they do not fit; the bytes of one call stay in one
+*         record.
+*
+* \param[in] pPort  port of the master
+* \param[in] type   web_frame_type_t of the bytes
+* \param[in] pData  bytes
+* \param[in] len    their number
+*
+********************************************************************************** */
+static void WebSerial_Record(web_serial_port_t* pPort, uint8_t type, const uint8_t* pData, uint32_t len)
+{
+    uint32_t max = (type == gWebFrameLeds_c) ? (2U * WEBSERVER_FRAME_PAIRS_MAX) : WEBSERVER_FRAME_PAYLOAD_MAX;
+
+    if(pPort->recLen && ((type != pPort->recType) || (pPort->recLen + len > max)))
+    {
+        WebSerial_Emit(pPort);
+    }
+    pPort->recType = type;
+    memcpy(&pPort->rec[pPort->recLen], pData, len);
+    pPort->recLen += len;
+}
+
+/*closes the record being filled into the output buffer*/
+static void WebSerial_Emit(web_serial_port_t* pPort)
+{
+    uint8_t frame[WEBSERVER_FRAME_ENCODED_MAX];
+    uint32_t len;
+    uint32_t i;
+
+    if(!pPort->recLen)
+    {
+        return;
+    }
+    len = WebFrame_Encode(pPort->recType, pPort->recSeq++, pPort->rec, pPort->recLen, frame);
+    for(i = 0; i < len; i++)
+    {
+        WebSerial_Put(pPort, (char)frame[i]);
+    }
+    pPort->recLen = 0;
+}
+
+/*! *********************************************************************************
+* \brief  Writes the output buffer until it is empty or the UART is full; in the
+*         latter case the thread waits for EPOLLOUT.
+*
+********************************************************************************** */
+static void WebSerial_Flush(web_serial_port_t* pPort)
+{
+    struct epoll_event ev;
+    bool waitOut = false;
+
+    while(pPort->outLen)
+    {
+        uint32_t chunk = WEBSERVER_SERIAL_QUEUE - pPort->outHead;
+        ssize_t written;
+
+        if(chunk > pPort->outLen)
+        {
+            chunk = pPort->outLen;
+        }
+        written = write(pPort->fd, &pPort->out[pPort->outHead], chunk);
+        if(written > 0)
+        {
+            pPort->outHead = (pPort->outHead + (uint32_t)written) % WEBSERVER_SERIAL_QUEUE;
+            pPort->outLen -= (uint32_t)written;
+        }
+        else if((written < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if((written < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            waitOut = true;
+            break;
+        }
+        else
+        {
+            perror("serial write");
+            pPort->outHead = 0;
+            pPort->outLen = 0;
+            break;
+        }
+    }
+
+    if(waitOut != pPort->waitOut)
+    {
+        pPort->waitOut = waitOut;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = (waitOut ? EPOLLOUT : 0) | ((pPort->isTty && mWebSerialRx) ? EPOLLIN : 0);
+        ev.data.fd = pPort->fd;
+        (void)epoll_ctl(pPort->epollFd, EPOLL_CTL_MOD, pPort->fd, &ev);
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Hands what the master printed to the receiver until the port is empty.
+*
+********************************************************************************** */
+static void WebSerial_Read(web_serial_port_t* pPort)
+{
+    char buf[256];
+    ssize_t got;
+
+    while((got = read(pPort->fd, buf, sizeof(buf))) > 0)
+    {
+        mWebSerialRx(pPort->master, buf, (uint32_t)got);
+    }
+}
+
+static uint64_t WebSerial_NowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
@@ -0,0 +1,102 @@
+#ifndef __WEB_SERIAL_H_
+#define __WEB_SERIAL_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "web_state.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * Serial links to the masters on Linux. One thread owns each port: the workers
+ * hand it bytes through a bounded lock-free queue and ring an eventfd doorbell
+ * only when the queue goes from idle to pending, so a burst of commands costs
+ * one wake-up. The thread writes raw and non-blocking and waits for EPOLLOUT
+ * while the UART is full, a request never waits for the serial port. Without
+ * a port the bytes are dropped and the bridge keeps serving.
+ *
+ * Everything queued by the time the thread wakes goes out in one write. A
+ * toggle digit is held for the cancel window first: the same digit again
+ * within it cancels both, the master never sees a pair that leaves its LED as
+ * it was. tools/fakemaster.py stands in for the master on a pty.
+ *
+ * A tty is read as well: what the master prints goes to the receiver given to
+ * WebSerial_Open, and each toggle digit written is reported with the time it
+ * was queued, so its ack can be timed.
+ *
+ * Framed, for a master built with gAppUseHostFrames_d, the toggles released
+ * together leave as one web_frame.h record of slave and LED mask pairs and
+ * any other bytes as console records; the workers still queue digits.
+ *
+ * Up to WEBSERVER_MASTERS masters are driven this way side by side, each port
+ * with its own queue, window and thread, so a slow or full UART holds up only
+ * its own master. Masters are numbered from 0 in the order of their -s; the
+ * digits are those of the master's own slave ids, web_route.c maps them.
+ */
+
+/*serial port of the master, overridden with -s*/
+#define WEBSERVER_SERIAL_PORT        "/dev/ttyACM0"
+
+/*APP_SERIAL_INTERFACE_SPEED of the firmware*/
+#define WEBSERVER_SERIAL_BAUD        115200
+
+/*default cancel window of toggle pairs, overridden with -c; 0 sends at once*/
+#define WEBSERVER_SERIAL_WINDOW_MS   10
+
+/*bytes queued between the workers and the serial thread, further bytes are
+  dropped; a power of two*/
+#define WEBSERVER_SERIAL_QUEUE       256
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*bytes a master printed, called on the serial thread of its port*/
+typedef void (*web_serial_rx_t)(uint32_t master, const char* pData, uint32_t len);
+
+/*a toggle digit written to a master and when, CLOCK_MONOTONIC microseconds,
+  it was taken from the queue; called on the serial thread of its port*/
+typedef void (*web_serial_sent_t)(uint32_t master, char digit, uint64_t queuedUs);
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+
+/*opens and configures the port of a master and starts its serial thread*/
+bool WebSerial_Open(uint32_t master, const char* pPath, uint32_t baud, uint32_t windowMs, bool framed,
+                     web_serial_rx_t rx, web_serial_sent_t sent);
+
+/*queues bytes for a master from any thread, false if they were dropped;
+  the bytes of one call stay together*/
+bool WebSerial_Write(uint32_t master, const char* pData, uint32_t len);
+
+/*true while the port of the master is open, false before WebSerial_Open and
+  once it was lost*/
+bool WebSerial_IsOpen(uint32_t master);
+
+/*true while what the master prints is read, a tty given a receiver*/
+bool WebSerial_IsDuplex(uint32_t master);
+
+/*bytes written to the port of a master and toggles cancelled in its window
+  since start*/
+void WebSerial_Stats(uint32_t master, uint64_t* pWritten, uint64_t* pCancelled);
+
+/*stops the serial threads and closes the ports, queued bytes are dropped*/
+void WebSerial_Close(void);
+
+#endif /* __WEB_SERIAL_H_ */
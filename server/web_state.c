@@ -0,0 +1,179 @@
+#include "web_state.h"
+
+#include <pthread.h>
+
+
+/************************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+************************************************************************************/
+/*one bit per LED, WebState_Bit*/
+static web_mask_t mWebLeds;
+static web_mask_t mWebConfirmed;
+/*unknown until the masters report otherwise*/
+static web_mask_t mWebPresent = ((web_mask_t)1U << WEBSERVER_SLAVES) - 1U;
+/*odd while an update is in progress*/
+static uint32_t mWebStateSeq;
+static pthread_mutex_t mWebStateLock = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+************************************************************************************/
+static void WebState_Store(web_mask_t* pWord, web_mask_t value);
+
+/************************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Copies the states without taking the lock, retrying while an update is
+*         in progress.
+*
+* \param[out] pLeds  snapshot of the state mask
+*
+* \return  version of the snapshot, half the sequence count
+*
+********************************************************************************** */
+uint32_t WebState_Read(web_mask_t* pLeds)
+{
+    uint32_t seq;
+
+    for(;;)
+    {
+        seq = __atomic_load_n(&mWebStateSeq, __ATOMIC_ACQUIRE);
+        if(seq & 1U)
+        {
+            continue;
+        }
+        *pLeds = __atomic_load_n(&mWebLeds, __ATOMIC_RELAXED);
+        //the copy must be complete before the count is checked again
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&mWebStateSeq, __ATOMIC_RELAXED) == seq)
+        {
+            return seq / 2U;
+        }
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Applies set and toggle requests under the writer lock. The master only
+*         knows toggles, so an LED already in the requested state costs
+*         nothing and the returned mask is the fewest commands that reach it.
+*
+* \param[in]  setMask   LEDs given an absolute state
+* \param[in]  values    their state, bits outside setMask ignored
+* \param[in]  flipMask  LEDs toggled after the sets
+* \param[out] pLeds     new state mask, may be NULL
+*
+* \return  LEDs that changed
+*
+********************************************************************************** */
+web_mask_t WebState_Apply(web_mask_t setMask, web_mask_t values, web_mask_t flipMask, web_mask_t* pLeds)
+{
+    web_mask_t leds;
+    web_mask_t changed;
+
+    pthread_mutex_lock(&mWebStateLock);
+    leds = __atomic_load_n(&mWebLeds, __ATOMIC_RELAXED);
+    changed = (((leds ^ values) & setMask) ^ flipMask) & WEBSERVER_LEDS_MASK;
+    if(changed)
+    {
+        WebState_Store(&mWebLeds, leds ^ changed);
+    }
+    pthread_mutex_unlock(&mWebStateLock);
+
+    if(pLeds)
+    {
+        *pLeds = leds ^ changed;
+    }
+    return changed;
+}
+
+/*! *********************************************************************************
+* \brief  Copies the requested and confirmed LEDs and the slaves present as one
+*         snapshot, like WebState_Read.
+*
+* \param[out] pState  snapshot
+*
+* \return  version of the snapshot
+*
+********************************************************************************** */
+uint32_t WebState_Get(web_state_t* pState)
+{
+    uint32_t seq;
+
+    for(;;)
+    {
+        seq = __atomic_load_n(&mWebStateSeq, __ATOMIC_ACQUIRE);
+        if(seq & 1U)
+        {
+            continue;
+        }
+        pState->leds = __atomic_load_n(&mWebLeds, __ATOMIC_RELAXED);
+        pState->confirmed = __atomic_load_n(&mWebConfirmed, __ATOMIC_RELAXED);
+        pState->present = __atomic_load_n(&mWebPresent, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&mWebStateSeq, __ATOMIC_RELAXED) == seq)
+        {
+            return seq / 2U;
+        }
+    }
+}
+
+void WebState_Confirm(web_mask_t flipMask)
+{
+    flipMask &= WEBSERVER_LEDS_MASK;
+    if(flipMask)
+    {
+        pthread_mutex_lock(&mWebStateLock);
+        WebState_Store(&mWebConfirmed, __atomic_load_n(&mWebConfirmed, __ATOMIC_RELAXED) ^ flipMask);
+        pthread_mutex_unlock(&mWebStateLock);
+    }
+}
+
+bool WebState_SetPresent(uint32_t slave, bool present)
+{
+    web_mask_t was;
+    web_mask_t now;
+
+    if(slave >= WEBSERVER_SLAVES)
+    {
+        return false;
+    }
+    pthread_mutex_lock(&mWebStateLock);
+    was = __atomic_load_n(&mWebPresent, __ATOMIC_RELAXED);
+    now = present ? (was | ((web_mask_t)1U << slave)) : (was & ~((web_mask_t)1U << slave));
+    if(now != was)
+    {
+        WebState_Store(&mWebPresent, now);
+    }
+    pthread_mutex_unlock(&mWebStateLock);
+    return now != was;
+}
+
+/************************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+************************************************************************************/
+
+/*! *********************************************************************************
+* \brief  Writes one word of the state between the two steps of the sequence
+*         count. The writer lock is held.
+*
+********************************************************************************** */
+static void WebState_Store(web_mask_t* pWord, web_mask_t value)
+{
+    uint32_t seq = __atomic_load_n(&mWebStateSeq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&mWebStateSeq, seq + 1U, __ATOMIC_RELAXED);
+    //readers must see the odd count before the changed state
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(pWord, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&mWebStateSeq, seq + 2U, __ATOMIC_RELEASE);
+}
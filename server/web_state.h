@@ -0,0 +1,124 @@
+#ifndef __WEB_STATE_H_
+#define __WEB_STATE_H_
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+typedef int BOOL;
+#define TRUE  1
+#define FALSE 0
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+
+/*
+ * LED states shared by the worker threads of the Linux bridge, one bit per LED
+ * of every slave the masters' UART digits reach. Readers take a consistent
+ * snapshot without a lock through a sequence counter (seqlock): the writer
+ * makes it odd while it updates the states and even again afterwards, a
+ * reader retries when it saw an odd count or the count moved under it.
+ * Writers, the comparatively rare LED commands, are serialised by a mutex.
+ *
+ * Besides the LEDs clients requested the state holds those the masters
+ * confirmed, toggled by their ack digits, and the slaves they report
+ * connected; the serial threads update them as the masters' output arrives
+ * (web_link.c). Without a master, requests confirm themselves.
+ *
+ * Slaves are numbered across all masters; web_route.c knows which master and
+ * which of its slave ids each one is.
+ */
+
+/*masters the bridge drives at once, one serial port each; their LEDs must fit
+  a web_mask_t, and stay below 2^53 for the JSON numbers of the events*/
+#define WEBSERVER_MASTERS            4
+
+/*slaves the UART digits '1'-'9' of one master address,
+  LEDCONTROL_DEVICE_ID_ZERO to _TWO*/
+#define WEBSERVER_SLAVES_PER_MASTER  3
+
+/*slaves of all masters*/
+#define WEBSERVER_SLAVES             (WEBSERVER_MASTERS * WEBSERVER_SLAVES_PER_MASTER)
+
+/*red, green and blue, LEDCONTROL_LEDS_PER_DEVICE*/
+#define WEBSERVER_LEDS_PER_SLAVE     3
+
+#define WEBSERVER_LEDS               (WEBSERVER_SLAVES * WEBSERVER_LEDS_PER_SLAVE)
+
+/*bit of an LED in the state mask*/
+#define WebState_Bit(slave, led)     ((web_mask_t)1U << (((slave) * WEBSERVER_LEDS_PER_SLAVE) + (led)))
+
+/*every LED*/
+#define WEBSERVER_LEDS_MASK          (((web_mask_t)1U << WEBSERVER_LEDS) - 1U)
+
+/*LEDs of one slave in the state mask*/
+#define WebState_SlaveMask(slave)    ((((web_mask_t)1U << WEBSERVER_LEDS_PER_SLAVE) - 1U) << \
+                                      ((slave) * WEBSERVER_LEDS_PER_SLAVE))
+
+#if WEBSERVER_LEDS > 53
+#error "WEBSERVER_MASTERS too large for the LED masks"
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public type definitions
+*************************************************************************************
+********************************************************************************** */
+
+/*LEDs of the dashboard, those of slave 0*/
+typedef struct
+{
+	BOOL RedState;
+	BOOL GreenState;
+	BOOL BlueState;
+}LEDStates;
+
+#ifndef _WIN32
+/*one bit per LED, WebState_Bit, or per slave*/
+typedef uint64_t web_mask_t;
+
+typedef struct web_state_tag
+{
+    web_mask_t leds;            /*requested by clients, WebState_Bit*/
+    web_mask_t confirmed;       /*acked by the masters*/
+    web_mask_t present;         /*bit per slave its master reports connected*/
+}web_state_t;
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+#ifndef _WIN32
+/*consistent copy of the state mask; returns its version, which changes with
+  every update*/
+uint32_t WebState_Read(web_mask_t* pLeds);
+
+/*sets the LEDs of setMask to their bits in values, then toggles those of
+  flipMask, as one update; returns the mask of LEDs that changed, each needing
+  one toggle command. pLeds, if not NULL, gets the new state*/
+web_mask_t WebState_Apply(web_mask_t setMask, web_mask_t values, web_mask_t flipMask, web_mask_t* pLeds);
+
+/*consistent copy of the whole state; returns its version*/
+uint32_t WebState_Get(web_state_t* pState);
+
+/*toggles confirmed LEDs, one bit per ack digit*/
+void WebState_Confirm(web_mask_t flipMask);
+
+/*records a slave connecting or disconnecting, false if it was so already*/
+bool WebState_SetPresent(uint32_t slave, bool present);
+#endif
+
+#endif /* __WEB_STATE_H_ */
@@ -1,4 +1,28 @@
-
+/*
+ * Web bridge between the LED dashboard and the LEDControl master UART.
+ *
+ * Windows: the original blocking loop, one client at a time, COM port through
+ * overlapped WriteFile.
+ *
+ * Linux: non-blocking epoll workers (web_loop.c), one per core by default,
+ * serving every client at once over keep-alive HTTP/1.1 (web_http.c); the
+ * dashboard drives the LEDs of slave 0, the JSON API of web_api.c those of
+ * every slave, and open dashboards follow changes over /api/events. LED
+ * states shared through web_state.c, each serial port owned by a thread of
+ * web_serial.c, the masters' acks and presence reports parsed by web_link.c.
+ * With -f the masters are built with gAppUseHostFrames_d and both ways carry
+ * the COBS records of web_frame.c, by default at WEBSERVER_FRAME_BAUD.
+ * Every -s adds a master, up to WEBSERVER_MASTERS, each with its slaves
+ * (web_route.c): by default slaves 3m to 3m + 2 on master m, -r slave=m:id
+ * routes a slave to the slave id of master m instead, the first -r replaces
+ * the defaults.
+ *   gcc -O2 -Wall -pthread -o webserver webserver.c web_loop.c web_http.c web_api.c web_json.c \
+ *       web_link.c web_frame.c web_route.c web_serial.c web_state.c
+ *   ./webserver [-a address] [-p port] [-s serial port]... [-r slave=master:id]... [-w workers]
+ *       [-c cancel window ms] [-b baud] [-f]
+ * web_bench.c measures it.
+ */
+#define _GNU_SOURCE
 #include "webserver.h"
 //	socket for client &	server
 extern int client_sockfd;
@@ -18,6 +42,81 @@ extern char bt_off[];
 //	avoid socket/bind ERR when run it next time
 extern void signal_exit(int sig);
 
+/*LED states are three bits: red, green, blue*/
+#define mWebServerStates_c          8
+
+/*dashboard of one LED state as whole responses, [1] for a connection kept
+  open after it, [0] for one closed*/
+typedef struct web_page_tag
+{
+	char page[2][WEBSERVER_PAGE_MAX];
+	unsigned int pageLen[2];
+	char notModified[2][WEBSERVER_NOT_MODIFIED_MAX];
+	unsigned int notModifiedLen[2];
+	char etag[16];
+}web_page_t;
+
+//	every dashboard response, rendered once at start up
+static web_page_t pages[mWebServerStates_c];
+
+/*! *********************************************************************************
+* \brief  Renders the dashboard of all eight LED states, each as a complete
+*         response with Content-Length and an ETag naming the state, so a
+*         request costs one send of bytes that never change. Cache-Control makes
+*         browsers revalidate, a matching If-None-Match gets the 304.
+*
+* \return  FALSE if a page does not fit WEBSERVER_PAGE_MAX
+*
+********************************************************************************** */
+static BOOL WebServer_CacheInit(void)
+{
+	unsigned int state;
+	int keepAlive;
+
+	for(state = 0; state < mWebServerStates_c; state++)
+	{
+		web_page_t* pPage = &pages[state];
+		const char* pRed = (state & 1U) ? redOn : redOff;
+		const char* pGreen = (state & 2U) ? greenOn : greenOff;
+		const char* pBlue = (state & 4U) ? blueOn : blueOff;
+#ifdef _WIN32
+		const char* pLive = "";
+#else
+		const char* pLive = bodyLive;
+#endif
+		size_t bodyLen = strlen(body1) + strlen(pRed) + strlen(pGreen) + strlen(pBlue) + strlen(pLive) +
+		                 strlen(body2);
+
+		(void)snprintf(pPage->etag, sizeof(pPage->etag), "\"leds-%u\"", state);
+		for(keepAlive = 0; keepAlive < 2; keepAlive++)
+		{
+			const char* pConnection = keepAlive ? "keep-alive" : "close";
+			int len;
+
+			len = snprintf(pPage->page[keepAlive], sizeof(pPage->page[keepAlive]),
+			               "%s\r\nConnection: %s\r\nContent-Length: %u\r\nETag: %s\r\nCache-Control: no-cache\r\n%s%s%s%s%s%s%s",
+			               status, pConnection, (unsigned int)bodyLen, pPage->etag, header,
+			               body1, pRed, pGreen, pBlue, pLive, body2);
+			if((len <= 0) || ((size_t)len >= sizeof(pPage->page[keepAlive])))
+			{
+				return FALSE;
+			}
+			pPage->pageLen[keepAlive] = (unsigned int)len;
+
+			len = snprintf(pPage->notModified[keepAlive], sizeof(pPage->notModified[keepAlive]),
+			               "HTTP/1.1 304 Not Modified\r\nConnection: %s\r\nETag: %s\r\nCache-Control: no-cache\r\n\r\n",
+			               pConnection, pPage->etag);
+			if((len <= 0) || ((size_t)len >= sizeof(pPage->notModified[keepAlive])))
+			{
+				return FALSE;
+			}
+			pPage->notModifiedLen[keepAlive] = (unsigned int)len;
+		}
+	}
+	return TRUE;
+}
+
+#ifdef _WIN32
 HANDLE hComm; 
 
 int main(void)
@@ -28,6 +127,11 @@ int main(void)
 	ledstates.RedState = FALSE;
 	ledstates.GreenState = FALSE;
 	ledstates.BlueState = FALSE;
+	if(!WebServer_CacheInit())
+	{
+		printf("dashboard larger than WEBSERVER_PAGE_MAX\n");
+		return 1;
+	}
 	
 	WSADATA wsaData;
 	int iResult;
@@ -49,7 +153,7 @@ int main(void)
 	struct sockaddr_in addr;
 	memset(&addr,0,sizeof(addr));
 	addr.sin_family = AF_INET;
-	addr.sin_port	= htons(80);
+	addr.sin_port	= htons(WEBSERVER_PORT);
 	addr.sin_addr.s_addr	= inet_addr("127.0.0.1");
 
 	int res = bind(server_sockfd,(struct sockaddr*)&addr,sizeof(addr));
@@ -83,7 +187,9 @@ int main(void)
 		}
 		int tmp_sockfd = client_sockfd;
 		char buf[1024];
-		recv(client_sockfd,buf,1024,0);
+		res = recv(client_sockfd,buf,sizeof(buf)-1,0);
+		//strlen and strstr below need the terminator
+		buf[(res > 0) ? res : 0] = '\0';
 		printf("Buf length: %d", strlen(buf));
 		printf("%s",buf);
 		
@@ -103,58 +209,34 @@ int main(void)
 		char *str_bt2=NULL;
 		str_bt2=strstr(buf,"button=2");
 		
+		//UART digits '1'-'3' toggle the red, green and blue LED of slave 0
 		char dataToSend;
-		send(client_sockfd,status,sizeof(status),0);
-		send(client_sockfd,header,sizeof(header),0);
-		send(client_sockfd,body1,sizeof(body1),0);
 
 		if(str_bt0!=NULL && str_bt1==NULL && str_bt2==NULL)
 		{
 			ledstates.RedState = !ledstates.RedState;
-			dataToSend = 'r';
+			dataToSend = '1';
 			WriteABuffer(&dataToSend,1);
 		}	
 		else if(str_bt0==NULL && str_bt1!=NULL && str_bt2==NULL)//if click LED OFF
 		{
 			ledstates.GreenState = !ledstates.GreenState;
-			dataToSend = 'g';
+			dataToSend = '2';
 			WriteABuffer(&dataToSend,1);
 		}	
 		else if(str_bt0==NULL && str_bt1==NULL && str_bt2!=NULL)
 		{
 			ledstates.BlueState = !ledstates.BlueState;
-			dataToSend = 'b';
+			dataToSend = '3';
 			WriteABuffer(&dataToSend,1);
 		}
 		else
 		{
 			//no button pressed, do nothing
 		}
-		if(ledstates.RedState)
-		{
-			send(client_sockfd,redOn,sizeof(redOn),0);
-		}
-		else
-		{
-			send(client_sockfd,redOff,sizeof(redOff),0);
-		}
-		if(ledstates.GreenState)
-		{
-			send(client_sockfd,greenOn,sizeof(greenOn),0);
-		}
-		else
-		{
-			send(client_sockfd,greenOff,sizeof(greenOff),0);
-		}
-		if(ledstates.BlueState)
-		{
-			send(client_sockfd,blueOn,sizeof(blueOn),0);
-		}
-		else
-		{
-			send(client_sockfd,blueOff,sizeof(blueOff),0);
-		}
-		send(client_sockfd,body2,sizeof(body2),0);
+		//the page of the new state in one send
+		web_page_t* pPage = &pages[(ledstates.RedState ? 1 : 0) | (ledstates.GreenState ? 2 : 0) | (ledstates.BlueState ? 4 : 0)];
+		send(client_sockfd,pPage->page[0],pPage->pageLen[0],0);
 		close(client_sockfd);
 	}
 	WSACleanup();
@@ -219,7 +301,244 @@ BOOL WriteABuffer(char * lpBuf, DWORD dwToWrite)
    CloseHandle(osWrite.hEvent);
    return fRes;
 }
+#else
+#include "web_api.h"
+#include "web_frame.h"
+#include "web_link.h"
+#include "web_loop.h"
+#include "web_route.h"
+#include "web_serial.h"
 
+#include <errno.h>
+#include <sys/resource.h>
 
+/*! *********************************************************************************
+* \brief  web_handler_t of the bridge: /api/ goes to the JSON API. A form post of
+*         button=0, 1 or 2 toggles that LED of slave 0 and sends its digit to
+*         the master and gets the page of the requested state; any other
+*         request the cached page of the state the master confirmed, or its 304
+*         when the client holds it already. Runs on every worker at once.
+*
+********************************************************************************** */
+static bool WebServer_Handle(const web_http_request_t* pRequest, web_response_t* pResponse)
+{
+	const web_page_t* pPage;
+	int keepAlive = pRequest->keepAlive ? 1 : 0;
+	const char* pButton;
+	uint32_t buttonLen;
+	web_mask_t leds;
+	web_mask_t changed = 0;
 
+	if(WebApi_Handle(pRequest, pResponse))
+	{
+		return pResponse->pData != NULL;
+	}
 
+	if(WebHttp_Equal(pRequest->pMethod, pRequest->methodLen, "POST") &&
+	   WebHttp_FormValue(pRequest->pBody, pRequest->bodyLen, "button", &pButton, &buttonLen) &&
+	   (buttonLen == 1) && (*pButton >= '0') && (*pButton < '0' + WEBSERVER_LEDS_PER_SLAVE))
+	{
+		//a full serial queue leaves the LED as it was, the page shows that
+		(void)WebApi_Apply(0, 0, WebState_Bit(0, (uint32_t)(*pButton - '0')), 1, &leds, &changed);
+	}
+	else
+	{
+		web_state_t state;
+
+		(void)WebState_Get(&state);
+		leds = state.confirmed;
+	}
+
+	//the red, green and blue bits of slave 0 index the pages
+	pPage = &pages[leds & (mWebServerStates_c - 1)];
+	if(!changed && pRequest->pIfNoneMatch &&
+	   memmem(pRequest->pIfNoneMatch, pRequest->ifNoneMatchLen, pPage->etag, strlen(pPage->etag)))
+	{
+		pResponse->pData = pPage->notModified[keepAlive];
+		pResponse->len = pPage->notModifiedLen[keepAlive];
+	}
+	else
+	{
+		pResponse->pData = pPage->page[keepAlive];
+		pResponse->len = pPage->pageLen[keepAlive];
+	}
+	return true;
+}
+
+static void WebServer_Signal(int sig)
+{
+	(void)sig;
+	WebLoop_Stop();
+}
+
+int main(int argc, char** argv)
+{
+	const char* pAddr = NULL;
+	const char* pSerial[WEBSERVER_MASTERS] = {WEBSERVER_SERIAL_PORT};
+	uint32_t masters = 0;
+	const char* pRoute[WEBSERVER_SLAVES];
+	uint32_t routes = 0;
+	uint16_t port = WEBSERVER_PORT;
+	struct sigaction sa;
+	struct rlimit lim;
+	web_loop_stats_t stats;
+	uint64_t operations;
+	uint64_t commands;
+	uint64_t written;
+	uint64_t cancelled;
+	web_link_stats_t link;
+	uint32_t master;
+	uint32_t i;
+	long window = WEBSERVER_SERIAL_WINDOW_MS;
+	long workers = sysconf(_SC_NPROCESSORS_ONLN);
+	long baud = 0;
+	bool framed = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "a:p:s:r:w:c:b:f")) != -1)
+	{
+		switch(opt)
+		{
+		case 'a': pAddr = optarg; break;
+		case 'p': port = (uint16_t)atoi(optarg); break;
+		case 's':
+			if(masters == WEBSERVER_MASTERS)
+			{
+				fprintf(stderr, "at most %u masters\n", WEBSERVER_MASTERS);
+				return 1;
+			}
+			pSerial[masters++] = optarg;
+			break;
+		case 'r':
+			if(routes == WEBSERVER_SLAVES)
+			{
+				fprintf(stderr, "at most %u routes\n", WEBSERVER_SLAVES);
+				return 1;
+			}
+			pRoute[routes++] = optarg;
+			break;
+		case 'w': workers = atol(optarg); break;
+		case 'c': window = atol(optarg); break;
+		case 'b': baud = atol(optarg); break;
+		case 'f': framed = true; break;
+		default:
+			fprintf(stderr, "usage: %s [-a address] [-p port] [-s serial port]... [-r slave=master:id]... "
+			        "[-w workers] [-c cancel window ms] [-b baud] [-f]\n", argv[0]);
+			return 1;
+		}
+	}
+	if(masters == 0)
+	{
+		masters = 1;
+	}
+	if(routes == 0)
+	{
+		WebRoute_Default(masters);
+	}
+	for(i = 0; i < routes; i++)
+	{
+		unsigned int slave;
+		unsigned int id;
+		char end;
+
+		if((sscanf(pRoute[i], "%u=%u:%u%c", &slave, &master, &id, &end) != 3) || (master >= masters) ||
+		   !WebRoute_Set(slave, master, id))
+		{
+			fprintf(stderr, "route %s: expected slave=master:id, slave below %u, master below %u, "
+			        "id below %u and each id of a master once\n",
+			        pRoute[i], WEBSERVER_SLAVES, masters, WEBSERVER_SLAVES_PER_MASTER);
+			return 1;
+		}
+	}
+
+	//one descriptor per client
+	if(getrlimit(RLIMIT_NOFILE, &lim) == 0)
+	{
+		lim.rlim_cur = lim.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &lim);
+	}
+
+	if(workers < 1)
+	{
+		workers = 1;
+	}
+	if(window < 0)
+	{
+		window = 0;
+	}
+	if(baud <= 0)
+	{
+		baud = framed ? WEBSERVER_FRAME_BAUD : WEBSERVER_SERIAL_BAUD;
+	}
+	if(!WebServer_CacheInit())
+	{
+		fprintf(stderr, "dashboard larger than WEBSERVER_PAGE_MAX\n");
+		return 1;
+	}
+	if(!WebLoop_Init(pAddr, port, WebServer_Handle, WebApi_Event, (uint32_t)workers))
+	{
+		perror("listen"),exit(-1);
+	}
+	for(master = 0; master < masters; master++)
+	{
+		if(!WebSerial_Open(master, pSerial[master], (uint32_t)baud, (uint32_t)window, framed,
+		                   framed ? WebLink_ReceiveFrames : WebLink_Receive, WebLink_Sent))
+		{
+			fprintf(stderr, "serial port %s: %s, LED commands of master %u are dropped\n",
+			        pSerial[master], strerror(errno), master);
+		}
+	}
+
+	//no SA_RESTART, the signal ends epoll_wait
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = WebServer_Signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("listening on port %u with %ld workers and %u masters, close web server --- ctrl+c\n",
+	       port, workers, masters);
+	WebLoop_Run();
+	WebSerial_Close();
+
+	WebLoop_Stats(&stats);
+	printf("web server closed: %llu connections (%llu refused), %llu requests, "
+	       "%llu timeouts, %llu errors, %u at most open, %llu events pushed\n",
+	       (unsigned long long)stats.accepted, (unsigned long long)stats.refused,
+	       (unsigned long long)stats.requests, (unsigned long long)stats.timeouts,
+	       (unsigned long long)stats.errors, stats.peakOpen, (unsigned long long)stats.pushed);
+	WebApi_Stats(&operations, &commands);
+	written = 0;
+	cancelled = 0;
+	for(master = 0; master < masters; master++)
+	{
+		uint64_t bytes;
+		uint64_t pairs;
+
+		WebSerial_Stats(master, &bytes, &pairs);
+		written += bytes;
+		cancelled += pairs;
+	}
+	printf("%llu LED operations, %llu serial commands, %llu cancelled in the window, "
+	       "%llu bytes written (%.2f per operation)\n",
+	       (unsigned long long)operations, (unsigned long long)commands, (unsigned long long)cancelled,
+	       (unsigned long long)written, operations ? (double)written / (double)operations : 0.0);
+	WebLink_Stats(&link);
+	printf("%llu toggles acked, %llu lost, %llu unexpected acks, ack latency p50 %u us, p99 %u us, max %u us\n",
+	       (unsigned long long)link.acked, (unsigned long long)link.lost, (unsigned long long)link.unexpected,
+	       link.p50Us, link.p99Us, link.maxUs);
+	if(framed)
+	{
+		printf("%llu records from the masters, %llu bad, %llu missed, %llu toggles refused by their queues\n",
+		       (unsigned long long)link.records, (unsigned long long)link.badRecords,
+		       (unsigned long long)link.missedRecords, (unsigned long long)link.refused);
+	}
+	for(master = 0; (masters > 1) && (master < masters); master++)
+	{
+		printf("master %u: %llu toggles sent, %llu acked, %llu lost\n", master,
+		       (unsigned long long)link.masters[master].sent, (unsigned long long)link.masters[master].acked,
+		       (unsigned long long)link.masters[master].lost);
+	}
+	return 0;
+}
+#endif
@@ -6,11 +6,21 @@
 #include <string.h>
 #include <sys/types.h>
 #include <signal.h>
+#ifdef _WIN32
 #include <ws2tcpip.h>
 #include <windows.h>
+#endif
+#include "web_state.h"
 
 #define WEBSERVER_COM_PORT "\\\\.\\COM5"
 
+/*TCP port of the dashboard, overridden with -p on Linux*/
+#define WEBSERVER_PORT 80
+
+/*a whole dashboard response, headers included, and a 304 answer*/
+#define WEBSERVER_PAGE_MAX          2048
+#define WEBSERVER_NOT_MODIFIED_MAX  192
+
 //	socket for client &	server
 int client_sockfd;
 int server_sockfd;
@@ -30,6 +40,26 @@ char body1[] = \
 						</form>";
 char body2[] = "</body></html>";
 
+/*Linux: the states follow /api/events as the master confirms them and the
+  buttons toggle through the API, the form still posts where scripts are off*/
+char bodyLive[] = \
+			"<script>\
+						var names = ['Red', 'Green', 'Blue'], colours = ['red', 'green', 'blue'];\
+						var states = document.getElementsByTagName('h3');\
+						if(window.EventSource && window.fetch) {\
+							new EventSource('/api/events').addEventListener('leds', function(e) {\
+								var state = JSON.parse(e.data), pending = state.requested ^ state.leds;\
+								for(var i = 0; i < 3; i++) states[i].textContent = names[i] + ((state.leds >> i) & 1 ? ' on' : ' off') +\
+									((pending >> i) & 1 ? ' (switching)' : '') + ((state.connected & 1) ? '' : ' (slave offline)');\
+							});\
+							document.forms[0].onsubmit = function(e) {\
+								if(!e.submitter) return;\
+								e.preventDefault();\
+								fetch('/api/slaves/0/leds/' + colours[e.submitter.value], {method: 'PUT', body: '{\"toggle\": true}'});\
+							};\
+						}\
+					</script>";
+
 
 char redOn[]	=	"<h3>Red on</h3>";
 char redOff[]	=	"<h3>Red off</h3>";
@@ -38,14 +68,7 @@ char greenOff[] =   "<h3>Green off</h3>";
 char blueOn[]   =   "<h3>Blue on</h3>";
 char blueOff[]  =   "<h3>Blue off</h3>";
 
-
-typedef struct
-{
-	BOOL RedState;
-	BOOL GreenState;
-	BOOL BlueState;
-}LEDStates;
-
+#ifdef _WIN32
 BOOL WriteABuffer(char*,DWORD);
 
 void signal_exit(int sig)
@@ -60,6 +83,7 @@ void signal_exit(int sig)
 	printf("web server closed\n");
 	exit(0);
 }
+#endif
 
 
 #endif
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""Decoder for the LEDControl statistics dumps.
+
+Reads the '#'-prefixed CSV records printed by AppStats_Dump ('s' command,
+gAppUseRunTimeStats_d build), AppStats_LatencyDump ('h' command), the
+boot report (gAppUseLatencyStats_d build), AppTxq_Dump ('q' command,
+every build), AppSec_Dump ('k' command, gAppUseSecLib_d build) and
+AppRelay_Dump ('y' command, gAppUseRelay_d build) either from a serial port
+(sending the dump commands itself) or from a captured log. Prints per-task
+CPU load, stack head-room, MEM pool usage, radio counters, latency
+percentiles, boot phase timing, TX queueing delay per traffic class, the
+frame protection cost against the frame air time and the relay depth and
+forwarding counters. When more than one dump is seen, CPU load is computed
+over the interval between consecutive dumps instead of since boot. With
+--baseline, the latency percentiles are set against those of the last dump
+of another capture, e.g. to measure what gAppUseRamFunc_d gains.
+
+    ctstats.py --port /dev/ttyACM0 --interval 2 --commands shq
+    ctstats.py capture.log
+    ctstats.py --baseline flash_build.log ram_build.log
+"""
+
+import argparse
+import sys
+import time
+
+WRAP = 1 << 32
+
+# must match app_stats_latency_t and the gAppStatsLatency* layout macros
+LATENCY_PROBES = ('rx->dispatch', 'dispatch->end', 'rx->rearm', 'rx->reply')
+LATENCY_MIN_LOG2 = 6
+# must match app_stats_boot_t
+BOOT_PHASES = ('hardware', 'radio init', 'rx armed', 'boot done')
+# must match app_tx_class_t
+TX_CLASSES = ('command', 'ack', 'relay', 'sync', 'probe', 'ota')
+# must match app_sec_op_t
+SEC_OPS = ('protect', 'unprotect')
+
+
+def delta(new, old):
+    return (new - old) % WRAP
+
+
+class Dump:
+    def __init__(self):
+        self.tasks = {}
+        self.radio = None
+        self.pools = []
+        self.total = 0
+        self.cycles = 0
+        self.clock = None
+        self.latency = {}
+        self.boot = {}
+        self.txq = {}
+        self.sec = {}
+        self.relay = None
+
+
+def parse(lines):
+    """Yield one Dump per '#E' record, ignoring any other console output."""
+    dump = Dump()
+    for line in lines:
+        line = line.strip()
+        if not line.startswith('#') or len(line) < 2:
+            continue
+        kind, fields = line[1], line[3:].split(',') if len(line) > 3 else []
+        try:
+            if kind == 'T':
+                name = fields[0]
+                dump.tasks[name] = (int(fields[1]), int(fields[2]), int(fields[3]))
+            elif kind == 'R':
+                dump.radio = [int(f) for f in fields]
+            elif kind == 'M':
+                dump.pools.append(tuple(int(f) for f in fields))
+            elif kind == 'C':
+                dump.clock = int(fields[0])
+            elif kind == 'H':
+                values = [int(f) for f in fields]
+                dump.latency[values[0]] = (values[1], values[2], values[3:])
+            elif kind == 'X':
+                values = [int(f) for f in fields]
+                dump.txq[values[0]] = tuple(values[1:6])
+            elif kind == 'K':
+                values = [int(f) for f in fields]
+                dump.sec[values[0]] = tuple(values[1:6])
+            elif kind == 'Y':
+                dump.relay = [int(f) for f in fields[:5]]
+            elif kind == 'B':
+                dump.boot[int(fields[0])] = int(fields[1])
+            elif kind == 'E':
+                dump.total, dump.cycles = int(fields[0]), int(fields[1])
+                yield dump
+                dump = Dump()
+        except (IndexError, ValueError):
+            # partial line from a reset or a missed byte, drop it
+            continue
+
+
+def bucket_upper(bucket):
+    """Upper bound in cycles of a log2 histogram bucket."""
+    return 1 << (LATENCY_MIN_LOG2 + bucket + 1)
+
+
+def percentile(buckets, fraction):
+    target = fraction * sum(buckets)
+    seen = 0
+    for i, count in enumerate(buckets):
+        seen += count
+        if count and seen >= target:
+            return bucket_upper(i)
+    return 0
+
+
+def report_latency(dump, out):
+    scale = 1e6 / dump.clock if dump.clock else 1.0
+    unit = 'us' if dump.clock else 'cycles'
+    out.write('%-14s %8s %10s %10s %10s  (%s, p50/p99 are bucket upper bounds)\n'
+              % ('interval', 'count', 'p50', 'p99', 'max', unit))
+    for probe, (count, peak, buckets) in sorted(dump.latency.items()):
+        name = LATENCY_PROBES[probe] if probe < len(LATENCY_PROBES) else str(probe)
+        out.write('%-14s %8d %10.1f %10.1f %10.1f\n'
+                  % (name, count, percentile(buckets, 0.5) * scale,
+                     percentile(buckets, 0.99) * scale, peak * scale))
+    out.write('\n')
+
+
+def report_latency_change(dump, base, out):
+    """Latency of this build against a baseline capture, e.g. the
+    gAppUseRamFunc_d 0 build against the default one."""
+    scale = 1e6 / dump.clock if dump.clock else 1.0
+    base_scale = 1e6 / base.clock if base.clock else 1.0
+    unit = 'us' if dump.clock else 'cycles'
+    out.write('%-14s %10s %10s %10s %10s  (%s, against the baseline)\n'
+              % ('interval', 'base p50', 'p50', 'base p99', 'p99', unit))
+    for probe, (_, _, buckets) in sorted(dump.latency.items()):
+        if probe not in base.latency:
+            continue
+        name = LATENCY_PROBES[probe] if probe < len(LATENCY_PROBES) else str(probe)
+        base_buckets = base.latency[probe][2]
+        out.write('%-14s %10.1f %10.1f %10.1f %10.1f\n'
+                  % (name, percentile(base_buckets, 0.5) * base_scale,
+                     percentile(buckets, 0.5) * scale,
+                     percentile(base_buckets, 0.99) * base_scale,
+                     percentile(buckets, 0.99) * scale))
+    out.write('\n')
+
+
+def report_boot(dump, out):
+    scale = 1e6 / dump.clock if dump.clock else 1.0
+    unit = 'us' if dump.clock else 'cycles'
+    last = 0
+    out.write('%-14s %10s %10s  (%s since scheduler start)\n' % ('boot phase', 'at', 'took', unit))
+    for phase, stamp in sorted(dump.boot.items()):
+        name = BOOT_PHASES[phase] if phase < len(BOOT_PHASES) else str(phase)
+        out.write('%-14s %10.1f %10.1f\n' % (name, stamp * scale, delta(stamp, last) * scale))
+        last = stamp
+    out.write('\n')
+
+
+def report_txq(dump, out):
+    out.write('%-10s %8s %8s %8s %12s %12s\n'
+              % ('tx class', 'queued', 'sent', 'dropped', 'mean us', 'max us'))
+    for tx_class, (queued, sent, dropped, delay_sum, delay_max) in sorted(dump.txq.items()):
+        name = TX_CLASSES[tx_class] if tx_class < len(TX_CLASSES) else str(tx_class)
+        out.write('%-10s %8d %8d %8d %12.1f %12d\n'
+                  % (name, queued, sent, dropped,
+                     float(delay_sum) / sent if sent else 0.0, delay_max))
+    out.write('\n')
+
+
+def report_sec(dump, out):
+    scale = 1e6 / dump.clock if dump.clock else 1.0
+    unit = 'us' if dump.clock else 'cycles'
+    out.write('%-10s %8s %10s %10s %9s %10s  (%s)\n'
+              % ('operation', 'count', 'mean', 'max', 'rejected', 'max/air', unit))
+    for op, (count, cycles_sum, cycles_max, rejected, air_us) in sorted(dump.sec.items()):
+        name = SEC_OPS[op] if op < len(SEC_OPS) else str(op)
+        mean = float(cycles_sum) / count if count else 0.0
+        ratio = '%9.1f%%' % (100.0 * cycles_max * scale / air_us) if dump.clock and air_us else '%10s' % '-'
+        out.write('%-10s %8d %10.1f %10.1f %9d %s\n'
+                  % (name, count, mean * scale, cycles_max * scale, rejected, ratio))
+    out.write('\n')
+
+
+def report_relay(dump, out):
+    depth, forwarded, suppressed, duplicates, overflow = dump.relay
+    out.write('relay: depth=%s forwarded=%d suppressed=%d duplicates=%d overflow=%d\n\n'
+              % (depth if depth < 7 else '?', forwarded, suppressed, duplicates, overflow))
+
+
+def report(dump, prev, out, base=None):
+    if dump.txq:
+        report_txq(dump, out)
+    if dump.sec:
+        report_sec(dump, out)
+    if dump.relay:
+        report_relay(dump, out)
+    if dump.boot:
+        report_boot(dump, out)
+    if dump.latency:
+        report_latency(dump, out)
+        if base:
+            report_latency_change(dump, base, out)
+    if not dump.tasks:
+        return
+    out.write('%-20s %8s %10s\n' % ('task', 'cpu %', 'stack free'))
+    span = delta(dump.total, prev.total) if prev and prev.tasks else dump.total
+    for name, (run, permille, stack) in sorted(dump.tasks.items()):
+        if prev and name in prev.tasks:
+            pct = 100.0 * delta(run, prev.tasks[name][0]) / span if span else 0.0
+        else:
+            pct = permille / 10.0
+        out.write('%-20s %8.1f %10d\n' % (name, pct, stack))
+    if dump.radio:
+        names = ('rxDone', 'rxCrcError', 'rxFailed', 'rxTimeout', 'txDone')
+        out.write('radio: ' + ' '.join('%s=%d' % kv for kv in zip(names, dump.radio)) + '\n')
+    for size, blocks, free in dump.pools:
+        out.write('pool %4dB: %d/%d in use\n' % (size, blocks - free, blocks))
+    out.write('\n')
+
+
+def serial_lines(port, baud, interval, commands):
+    import serial  # pyserial, only needed for live capture
+    with serial.Serial(port, baud, timeout=0.5) as ser:
+        while True:
+            ser.write(commands.encode('ascii'))
+            deadline = time.time() + interval
+            while time.time() < deadline:
+                line = ser.readline()
+                if line:
+                    yield line.decode('ascii', 'replace')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('log', nargs='?', help='captured console output (default: stdin)')
+    ap.add_argument('--port', help='serial port to poll live')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--interval', type=float, default=2.0, help='seconds between dumps')
+    ap.add_argument('--commands', default='s', help="dump commands to send, e.g. 'sh'")
+    ap.add_argument('--baseline', help='captured log of another build to compare the latency with')
+    args = ap.parse_args()
+
+    base = None
+    if args.baseline:
+        with open(args.baseline, errors='replace') as f:
+            for dump in parse(f):
+                if dump.latency:
+                    base = dump
+
+    if args.port:
+        lines = serial_lines(args.port, args.baud, args.interval, args.commands)
+    elif args.log:
+        lines = open(args.log, errors='replace')
+    else:
+        lines = sys.stdin
+
+    prev = None
+    for dump in parse(lines):
+        report(dump, prev, sys.stdout, base)
+        sys.stdout.flush()
+        if dump.tasks:
+            prev = dump
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""Stand-in for the LEDControl master on a pseudo terminal.
+
+Opens a pty and prints the path of its slave side, which the web bridge
+(server/webserver -s PATH) takes instead of the master's USB port. Like
+LEDControl.c built with LEDCONTROL_MASTER it reads the toggle digits '1'-'9'
+(digit - '1' = slave * 3 + led) and ignores any other byte, toggles the LED
+of the addressed slave and, one radio round trip later, prints the digits the
+slave's ack confirms as one string, in the order they were sent. Each frame
+sent is followed by "Finished transmission". The UART is paced to --baud, so a
+bridge that writes faster than the line sees the pty fill up.
+
+--flap makes a slave drop off and come back every so many seconds, printed as
+"Slave N disconnected" / "Slave N connected"; commands to it meanwhile are not
+acked. --loss drops that fraction of the commands on air. Ctrl+C or SIGTERM
+prints what arrived, the LED states and the toggle pairs of one LED that
+arrived within --pair-ms, the ones a bridge cancel window as long removes.
+
+--frames speaks the records of the gAppUseHostFrames_d build instead
+(ledcontrol_host.h): LED records of slave and mask pairs are answered with an
+accepted record, acks and presence go back as records, and the UART is paced
+to 1 Mbaud unless --baud says otherwise. --refuse makes the master refuse that
+fraction of the toggles, as if its TX queue were full.
+
+    fakemaster.py --delay-ms 4 --flap 5
+    server/webserver -p 8080 -s /dev/pts/3 -c 10
+
+    fakemaster.py --frames --refuse 0.05
+    server/webserver -p 8080 -s /dev/pts/3 -f
+
+One instance stands in for one master; start one per -s to try a bridge
+driving several, each prints its own pty.
+
+    fakemaster.py & fakemaster.py
+    server/webserver -p 8080 -s /dev/pts/3 -s /dev/pts/4
+"""
+
+import argparse
+import os
+import pty
+import random
+import select
+import signal
+import sys
+import termios
+import time
+import tty
+
+SLAVES = 3                 # LEDCONTROL_MAX_SLAVES
+LEDS_PER_SLAVE = 3         # LEDCONTROL_LEDS_PER_DEVICE
+COLOURS = ('red', 'green', 'blue')
+BITS_PER_BYTE = 10         # 8N1
+
+REC_LEDS = 0x01            # app_host_rec_t
+REC_CONSOLE = 0x02
+REC_ACCEPTED = 0x81
+REC_ACKS = 0x82
+REC_PRESENCE = 0x83
+PAYLOAD_MAX = 32           # gAppHostPayloadMax_c
+PAIRS_MAX = (PAYLOAD_MAX - 1) // 2
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE of ledcontrol_host.c."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def encode(rtype, seq, payload):
+    body = bytes([rtype, seq]) + bytes(payload)
+    crc = crc16(body)
+    body += bytes([crc & 0xFF, crc >> 8])
+    out = bytearray(b'\0')
+    for run in body.split(b'\0'):
+        out += bytes([len(run) + 1]) + run
+    return bytes(out + b'\0')
+
+
+def decode(data):
+    """Body of one record between delimiters, None if it is no valid record."""
+    body = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if not code or i + code > len(data):
+            return None
+        body += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            body.append(0)
+    if len(body) < 4 or len(body) > PAYLOAD_MAX + 4 or crc16(body[:-2]) != body[-2] | body[-1] << 8:
+        return None
+    return bytes(body[:-2])
+
+
+class Master:
+    def __init__(self, fd, args):
+        self.fd = fd
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.leds = [0] * SLAVES
+        self.connected = [True] * SLAVES
+        self.pending = [[] for _ in range(SLAVES)]
+        self.ack_due = [None] * SLAVES
+        self.flap_due = time.monotonic() + args.flap if args.flap else None
+        self.flap_slave = 0
+        self.line_free = 0.0
+        self.unpaired = {}
+        self.received = 0
+        self.commands = 0
+        self.acked = 0
+        self.lost = 0
+        self.pairs = 0
+        self.rx = bytearray()
+        self.tx_seq = 0
+        self.records = 0
+        self.bad = 0
+        self.refused = 0
+
+    def write(self, text):
+        os.write(self.fd, text.encode())
+
+    def record(self, rtype, payload):
+        os.write(self.fd, encode(rtype, self.tx_seq, payload))
+        self.tx_seq = (self.tx_seq + 1) & 0xFF
+
+    def command(self, slave, led, now):
+        index = slave * LEDS_PER_SLAVE + led
+        self.commands += 1
+        first = self.unpaired.pop(index, None)
+        if first is None or now - first > self.args.pair_ms / 1000.0:
+            self.unpaired[index] = now
+        else:
+            self.pairs += 1
+        if not self.args.frames:
+            self.write('Finished transmission\r\n')
+        if not self.connected[slave] or self.rng.random() < self.args.loss:
+            self.lost += 1
+            return
+        self.leds[slave] ^= 1 << led
+        self.pending[slave].append(led)
+        if self.ack_due[slave] is None:
+            self.ack_due[slave] = now + self.args.delay_ms / 1000.0
+
+    def console(self, byte, now):
+        if '1' <= byte <= '9':
+            self.command(*divmod(ord(byte) - ord('1'), LEDS_PER_SLAVE), now)
+
+    def frame_byte(self, byte, now):
+        if byte:
+            self.rx.append(byte)
+            return
+        data, self.rx = bytes(self.rx), bytearray()
+        if not data:
+            return
+        body = decode(data)
+        if body is None:
+            self.bad += 1
+            return
+        self.records += 1
+        rtype, seq, payload = body[0], body[1], body[2:]
+        if rtype == REC_LEDS:
+            refused = bytearray()
+            for i in range(0, min(len(payload) // 2, PAIRS_MAX) * 2, 2):
+                slave, mask = payload[i], payload[i + 1]
+                kept = 0
+                for led in range(LEDS_PER_SLAVE):
+                    if not mask >> led & 1:
+                        continue
+                    if slave >= SLAVES or self.rng.random() < self.args.refuse:
+                        kept |= 1 << led
+                        self.refused += 1
+                    else:
+                        self.command(slave, led, now)
+                if kept:
+                    refused += bytes([slave, kept])
+            self.record(REC_ACCEPTED, bytes([seq]) + refused)
+        elif rtype == REC_CONSOLE:
+            for byte in payload.decode('latin-1'):
+                self.console(byte, now)
+
+    def timers(self, now):
+        for slave in range(SLAVES):
+            if self.ack_due[slave] is not None and now >= self.ack_due[slave]:
+                if self.args.frames:
+                    self.record(REC_ACKS, bytes([slave] + self.pending[slave]))
+                else:
+                    self.write(''.join(chr(ord('1') + slave * LEDS_PER_SLAVE + led)
+                                       for led in self.pending[slave]))
+                self.acked += len(self.pending[slave])
+                self.pending[slave] = []
+                self.ack_due[slave] = None
+        if self.flap_due is not None and now >= self.flap_due:
+            slave = self.flap_slave
+            self.connected[slave] = not self.connected[slave]
+            if self.args.frames:
+                self.record(REC_PRESENCE, bytes([slave, self.connected[slave]]))
+            else:
+                self.write('Slave %d %s\r\n' % (slave + 1, 'connected' if self.connected[slave] else 'disconnected'))
+            if self.connected[slave]:
+                self.flap_slave = (slave + 1) % SLAVES
+            self.flap_due = now + self.args.flap
+
+    def next_due(self):
+        due = [d for d in self.ack_due if d is not None]
+        if self.flap_due is not None:
+            due.append(self.flap_due)
+        return min(due) if due else None
+
+    def run(self):
+        while True:
+            now = time.monotonic()
+            self.timers(now)
+            due = self.next_due()
+            # the UART takes the next byte once the previous one is on the line
+            wait_line = max(0.0, self.line_free - now)
+            timeout = None if due is None else max(0.0, due - now)
+            if wait_line:
+                timeout = wait_line if timeout is None else min(timeout, wait_line)
+                select.select([], [], [], timeout)
+                continue
+            ready, _, _ = select.select([self.fd], [], [], timeout)
+            if not ready:
+                continue
+            data = os.read(self.fd, 1 if self.args.baud else 4096)
+            now = time.monotonic()
+            if self.args.baud:
+                self.line_free = now + len(data) * BITS_PER_BYTE / self.args.baud
+            self.received += len(data)
+            if self.args.echo:
+                sys.stdout.write(data.hex(' ') if self.args.frames else data.decode('latin-1'))
+                sys.stdout.flush()
+            for byte in data:
+                if self.args.frames:
+                    self.frame_byte(byte, now)
+                else:
+                    self.console(chr(byte), now)
+
+    def report(self, out):
+        out.write('\n%d bytes, %d commands, %d acked, %d lost, %d toggle pairs within %g ms\n'
+                  % (self.received, self.commands, self.acked, self.lost, self.pairs, self.args.pair_ms))
+        if self.args.frames:
+            out.write('%d records, %d bad, %d toggles refused\n' % (self.records, self.bad, self.refused))
+        for slave in range(SLAVES):
+            out.write('slave %d: %s\n' % (slave, ', '.join(
+                '%s %s' % (COLOURS[led], 'on' if self.leds[slave] >> led & 1 else 'off')
+                for led in range(LEDS_PER_SLAVE))))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('--delay-ms', type=float, default=4.0,
+                    help='command frame to ack printed, radio round trip and ack delay')
+    ap.add_argument('--baud', type=int,
+                    help='APP_SERIAL_INTERFACE_SPEED the UART is paced to, 0 for unpaced; '
+                         'defaults to 115200, gAppHostBaudRate_c with --frames')
+    ap.add_argument('--flap', type=float, default=0.0,
+                    help='seconds between a slave disconnecting and connecting again, 0 for never')
+    ap.add_argument('--loss', type=float, default=0.0, help='fraction of commands lost on air')
+    ap.add_argument('--pair-ms', type=float, default=10.0,
+                    help='two toggles of one LED this close count as a pair, WEBSERVER_SERIAL_WINDOW_MS')
+    ap.add_argument('--frames', action='store_true', help='framed records of gAppUseHostFrames_d')
+    ap.add_argument('--refuse', type=float, default=0.0,
+                    help='fraction of framed toggles refused as if the TX queue were full')
+    ap.add_argument('--echo', action='store_true', help='print every byte received')
+    ap.add_argument('--seed', type=int, default=1)
+    args = ap.parse_args()
+    if args.baud is None:
+        args.baud = 1000000 if args.frames else 115200
+
+    master_fd, slave_fd = pty.openpty()
+    # raw both ways, like the CDC port of the board
+    tty.setraw(slave_fd)
+    attrs = termios.tcgetattr(master_fd)
+    attrs[3] &= ~termios.ECHO
+    termios.tcsetattr(master_fd, termios.TCSANOW, attrs)
+    print(os.ttyname(slave_fd))
+    sys.stdout.flush()
+
+    master = Master(master_fd, args)
+    signal.signal(signal.SIGTERM, signal.default_int_handler)
+    try:
+        master.run()
+    except KeyboardInterrupt:
+        pass
+    master.report(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
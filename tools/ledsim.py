@@ -0,0 +1,611 @@
+#!/usr/bin/env python3
+"""Host-side model of the LEDControl GENFSK network.
+
+Sub-commands:
+    airtime   bytes and microseconds on air per command for each frame profile,
+              optionally with frame protection
+    ack       slave ack frames per command with ack aggregation/piggybacking
+    join      time for a fleet of unconfigured slaves to join the master
+    relay     delivery and latency by hop count on a multi-hop line or grid
+    ota       broadcast firmware update time and per slave throughput by fleet
+              size, against updating the slaves one after another
+
+The frame constants mirror ledcontrol_frame.h and ledcontrol.h; keep them in
+step when the air format changes.
+"""
+
+import argparse
+import heapq
+import random
+import sys
+
+BITRATE = 1000000          # gGenfskDR1Mbps
+PREAMBLE_BYTES = 1         # pktConfig.preambleSizeBytes = 0 -> 1 byte
+SYNC_BYTES = 4             # gGenFskDefaultSyncAddrSize_c + 1
+HEADER_BYTES = 2           # H0 + length + H1
+PROBE_PERIOD_MS = 2000     # LEDCONTROL_CONNECTIONCHECK_TIMEOUT_MILLISECONDS
+ACK_WINDOW = 8             # gAppAckWindowBits_c
+SEC_OVERHEAD = 8           # gAppFrameSecOverhead_c, frame counter + MIC
+# ledcontrol_join.h
+JOIN_UID_LEN = 8           # gAppJoinUidLen_c
+JOIN_SLOT_MS = 2           # gAppJoinSlotMs_c
+JOIN_MIN_WINDOW = 16       # gAppJoinMinWindow_c
+JOIN_MAX_WINDOW = 1024     # gAppJoinMaxWindow_c
+JOIN_REPLY_TIMEOUT_MS = 10 # gAppJoinReplyTimeoutMs_c
+# ledcontrol_relay.h
+RELAY_HEADER = 2           # gAppRelayHeaderLen_c
+RELAY_MAX_HOPS = 4         # gAppRelayMaxHops_c
+RELAY_DEPTH_UNKNOWN = 7    # gAppRelayDepthUnknown_c
+RELAY_MIN_RSSI = -85       # gAppRelayMinRssi_c
+RELAY_DUP_CACHE = 16       # gAppRelayDupCacheLen_c
+RELAY_JITTER_MS = 4        # gAppRelayJitterMs_c
+# ledcontrol_ota.h
+OTA_MAX_PAYLOAD = 63       # gAppOtaMaxPayloadLen_c
+OTA_WINDOW_BLOCKS = 32     # gAppOtaWindowBlocks_c
+OTA_MAX_ROUNDS = 8         # gAppOtaMaxRounds_c
+OTA_SLOT_MS = 2            # gAppOtaSlotMs_c
+OTA_NACK_SLOTS = 8         # gAppOtaNackSlots_c
+OTA_MAX_NACK_SLOTS = 128   # gAppOtaMaxNackSlots_c
+OTA_STATUS_SLOTS = 128     # gAppOtaStatusSlots_c
+OTA_REPEAT = 3             # gAppOtaRepeat_c
+OTA_PAGE = 2048            # gAppOtaPageSize_c
+OTA_VERIFY_MS = 500        # mAppOtaVerifyMs_c
+# radio model for the relay simulation
+SENSITIVITY_DBM = -95      # KW41Z GFSK 1 Mbps, PER 50 % here
+PER_SLOPE_DB = 1.5         # width of the PER waterfall
+PATH_LOSS_1M_DB = 40.0     # 2.4 GHz free space at 1 m
+
+
+class Profile:
+    """One gAppFrameProfile_c / gAppFrameCrcSize_c combination."""
+
+    def __init__(self, name, overhead, min_payload, crc, sec=0):
+        self.name = name
+        self.overhead = overhead
+        self.min_payload = min_payload
+        self.crc = crc
+        self.sec = sec
+
+    def air_bytes(self, data_len=0):
+        payload = max(self.overhead + data_len, self.min_payload) + self.sec
+        return PREAMBLE_BYTES + SYNC_BYTES + HEADER_BYTES + payload + self.crc
+
+    def air_us(self, data_len=0):
+        return self.air_bytes(data_len) * 8 * 1e6 / BITRATE
+
+
+PROFILES = {
+    'legacy': Profile('legacy', overhead=3, min_payload=6, crc=3),
+    'compact': Profile('compact', overhead=1, min_payload=1, crc=2),
+    'compact-crc24': Profile('compact-crc24', overhead=1, min_payload=1, crc=3),
+}
+
+
+def secured(profile):
+    return Profile(profile.name, profile.overhead, profile.min_payload, profile.crc, SEC_OVERHEAD)
+
+
+def cmd_airtime(args):
+    profiles = dict((name, secured(p) if args.secure else p) for name, p in PROFILES.items())
+    # each frame is protected by its sender and unprotected by its receiver
+    crypto_us = 2 * args.crypto_us if args.secure else 0
+    base = profiles['legacy']
+    exchange_base = 2 * base.air_us(args.data) + args.turnaround_us + crypto_us
+    out = sys.stdout
+    out.write('%-14s %6s %9s %13s %9s\n' % ('profile', 'bytes', 'frame us', 'cmd+ack us', 'saving'))
+    for name in ('legacy', 'compact-crc24', 'compact'):
+        profile = profiles[name]
+        exchange = 2 * profile.air_us(args.data) + args.turnaround_us + crypto_us
+        out.write('%-14s %6d %9.0f %13.0f %8.1f%%\n'
+                  % (name, profile.air_bytes(args.data), profile.air_us(args.data),
+                     exchange, 100.0 * (exchange_base - exchange) / exchange_base))
+    out.write('\n(cmd+ack = command frame + reply frame + %d us turnaround, %d data bytes)\n'
+              % (args.turnaround_us, args.data))
+    if args.secure:
+        out.write('(protected: +%d bytes per frame, %.0f us crypto per frame, %.0f%% of a compact frame)\n'
+                  % (SEC_OVERHEAD, args.crypto_us,
+                     100.0 * args.crypto_us / profiles['compact'].air_us(args.data)))
+
+
+def simulate_acks(rate, slaves, delay_ms, duration_s, seed):
+    """Poisson command stream spread over the slaves, presence probes round
+    robin. Returns (commands, ack frames, piggybacked acks, mean ack delay ms)."""
+    rng = random.Random(seed)
+    events = []
+    t = 0.0
+    end = duration_s * 1000.0
+    while True:
+        t += rng.expovariate(rate / 1000.0)
+        if t >= end:
+            break
+        events.append((t, 'cmd', rng.randrange(slaves)))
+    probe = 0
+    t = PROBE_PERIOD_MS
+    while t < end:
+        events.append((t, 'probe', probe))
+        probe = (probe + 1) % slaves
+        t += PROBE_PERIOD_MS
+    events.sort()
+
+    commands = ack_frames = piggybacked = acked = 0
+    latency = 0.0
+    # per slave: time the ack timer fires and the commands it is holding
+    timer = [None] * slaves
+    held = [[] for _ in range(slaves)]
+
+    def flush(slave, now):
+        nonlocal latency, acked
+        # one ack covers the latest command and the ACK_WINDOW before it
+        covered = held[slave][-(ACK_WINDOW + 1):]
+        latency += sum(now - sent for sent in covered)
+        acked += len(covered)
+        held[slave] = []
+        timer[slave] = None
+
+    for now, kind, slave in events:
+        for other in range(slaves):
+            if timer[other] is not None and timer[other] <= now:
+                ack_frames += 1
+                flush(other, timer[other])
+        if kind == 'cmd':
+            commands += 1
+            held[slave].append(now)
+            if delay_ms == 0:
+                ack_frames += 1
+                flush(slave, now)
+            elif timer[slave] is None:
+                timer[slave] = now + delay_ms
+        elif held[slave]:
+            # the probe reply carries the pending ack
+            piggybacked += 1
+            flush(slave, now)
+    for slave in range(slaves):
+        if timer[slave] is not None:
+            ack_frames += 1
+            flush(slave, timer[slave])
+    return commands, ack_frames, piggybacked, latency / acked if acked else 0.0
+
+
+def cmd_ack(args):
+    out = sys.stdout
+    out.write('%-9s %9s %11s %12s %14s %12s\n'
+              % ('delay ms', 'commands', 'ack frames', 'piggybacked', 'frames/cmd', 'ack delay ms'))
+    for delay in args.delay:
+        commands, acks, piggy, latency = simulate_acks(args.rate, args.slaves, delay,
+                                                       args.duration, args.seed)
+        out.write('%-9d %9d %11d %12d %14.3f %12.2f\n'
+                  % (delay, commands, acks, piggy,
+                     (commands + acks) / float(commands) if commands else 0.0, latency))
+    out.write('\n(frames/cmd counts the command frame and the slave ack frames, '
+              'legacy replies give 2.000)\n')
+
+
+def simulate_join(slaves, spread_ms, process_us, turnaround_us, seed):
+    """Event driven model of the join backoff on one channel without capture
+    effect: a frame is lost if anything else is on air while it is sent, and a
+    half duplex node misses frames sent while it transmits itself.
+
+    Returns (join time in ms per slave, requests sent, requests lost)."""
+    rng = random.Random(seed)
+    profile = PROFILES['compact']
+    req_us = profile.air_us(JOIN_UID_LEN)
+    asg_us = profile.air_us(JOIN_UID_LEN + 1)
+
+    window = [JOIN_MIN_WINDOW] * slaves
+    joined = [None] * slaves
+    on_air = []                  # (start, end, sender), sender -1 is the master
+    master_free = 0.0
+    requests = lost = 0
+    events = []
+
+    def next_attempt_us(slave):
+        slot = rng.randrange(window[slave])
+        window[slave] = min(window[slave] * 2, JOIN_MAX_WINDOW)
+        return (JOIN_REPLY_TIMEOUT_MS + slot * JOIN_SLOT_MS) * 1000.0
+
+    def clean(start, end, sender):
+        for other_start, other_end, other in on_air:
+            if other == sender or other_start >= end or other_end <= start:
+                continue
+            return False
+        return True
+
+    for slave in range(slaves):
+        power_up = rng.uniform(0, spread_ms * 1000.0)
+        heapq.heappush(events, (power_up + next_attempt_us(slave), 'attempt', slave, 0.0))
+
+    while events:
+        now, kind, slave, start = heapq.heappop(events)
+        on_air = [tx for tx in on_air if tx[1] > now - 20000.0]
+        if joined[slave] is not None:
+            continue
+        if kind == 'attempt':
+            requests += 1
+            end = now + turnaround_us + req_us
+            on_air.append((now + turnaround_us, end, slave))
+            heapq.heappush(events, (end, 'request', slave, now + turnaround_us))
+            heapq.heappush(events, (now + next_attempt_us(slave), 'attempt', slave, 0.0))
+        elif kind == 'request':
+            if not clean(start, now, slave):
+                lost += 1
+                continue
+            tx_start = max(now + process_us + turnaround_us, master_free)
+            master_free = tx_start + asg_us
+            on_air.append((tx_start, master_free, -1))
+            heapq.heappush(events, (master_free, 'assign', slave, tx_start))
+        elif kind == 'assign':
+            if clean(start, now, -1):
+                joined[slave] = now / 1000.0
+            else:
+                lost += 1
+    return joined, requests, lost
+
+
+def cmd_join(args):
+    out = sys.stdout
+    out.write('%-6s %9s %9s %9s %9s %9s\n' % ('seed', 'requests', 'lost', 'p50 ms', 'p95 ms', 'all ms'))
+    worst = 0.0
+    for seed in range(args.seed, args.seed + args.runs):
+        joined, requests, lost = simulate_join(args.slaves, args.spread_ms, args.process_us,
+                                               args.turnaround_us, seed)
+        times = sorted(joined)
+        worst = max(worst, times[-1])
+        out.write('%-6d %9d %9d %9.0f %9.0f %9.0f\n'
+                  % (seed, requests, lost, times[len(times) // 2],
+                     times[int(0.95 * (len(times) - 1))], times[-1]))
+    out.write('\n%d slaves powered up within %d ms: all joined within %.0f ms in every run\n'
+              % (args.slaves, args.spread_ms, worst))
+
+
+class RelayNode:
+    """State of one node as kept by ledcontrol_relay.c."""
+
+    def __init__(self, index, depth, forward):
+        self.index = index
+        self.depth = depth
+        self.forward = forward
+        self.routes = {}         # devId -> below
+        self.seen = []           # duplicate cache, oldest first
+        self.pending = None      # (key, frame), one forward at a time
+        self.busy_until = 0.0
+
+
+def link_rssi(positions, tx_dbm, exponent, shadowing_db, rng):
+    """Static RSSI matrix from a log-distance path loss model with shadowing."""
+    import math
+    count = len(positions)
+    rssi = [[None] * count for _ in range(count)]
+    for a in range(count):
+        for b in range(a + 1, count):
+            dx = positions[a][0] - positions[b][0]
+            dy = positions[a][1] - positions[b][1]
+            dist = max(1.0, math.hypot(dx, dy))
+            loss = PATH_LOSS_1M_DB + 10.0 * exponent * math.log10(dist) + rng.gauss(0, shadowing_db)
+            rssi[a][b] = rssi[b][a] = tx_dbm - loss
+    return rssi
+
+
+def per(rssi):
+    import math
+    return 1.0 / (1.0 + math.exp((rssi - SENSITIVITY_DBM) / PER_SLOPE_DB))
+
+
+def simulate_relay(positions, args, seed):
+    """Event driven model of the relay rules of ledcontrol_relay.c: the master
+    (node 0) sends one command at a time to a random slave, which answers at
+    once. A frame is lost on the PER of its link, when another frame audible at
+    the receiver overlaps it (no capture) or while the receiver transmits.
+    Depths are the hop counts over links of RELAY_MIN_RSSI or better, which is
+    what the firmware converges to after the first probes.
+
+    Returns per slave depth the list of round trip latencies in ms, None for
+    lost exchanges, and the number of frames put on air."""
+    rng = random.Random(seed)
+    count = len(positions)
+    rssi = link_rssi(positions, args.tx_dbm, args.path_loss_exp, args.shadowing_db, rng)
+    profile = PROFILES['compact']
+    frame_us = profile.air_us(RELAY_HEADER - profile.overhead + 1 + 3)
+    turnaround_us = 150.0
+
+    depth = [RELAY_DEPTH_UNKNOWN] * count
+    depth[0] = 0
+    frontier = [0]
+    while frontier:
+        nxt = []
+        for a in frontier:
+            for b in range(1, count):
+                if depth[b] == RELAY_DEPTH_UNKNOWN and depth[a] < RELAY_MAX_HOPS and rssi[a][b] >= RELAY_MIN_RSSI:
+                    depth[b] = depth[a] + 1
+                    nxt.append(b)
+        frontier = nxt
+    nodes = [RelayNode(i, depth[i], i > 0 and not args.no_relay) for i in range(count)]
+
+    results = dict()
+    frames = 0
+    frame_id = [0] * count
+    for _ in range(args.commands):
+        target = rng.randrange(1, count)
+        events = []
+        on_air = []            # (start, end, sender)
+        start = 0.0
+        done = [None]
+
+        def send(now, node, frame):
+            nonlocal frames
+            begin = max(now, node.busy_until) + turnaround_us
+            end = begin + frame_us
+            node.busy_until = end
+            on_air.append((begin, end, node.index))
+            frames += 1
+            for r in range(count):
+                if r != node.index and rssi[node.index][r] > SENSITIVITY_DBM - 10:
+                    heapq.heappush(events, (end, id(frame), 'rx', r, node.index, begin, frame))
+
+        def originate(now, node, dev, up):
+            key = (dev, up, frame_id[node.index] & 0xFF)
+            frame_id[node.index] += 1
+            node.seen = (node.seen + [key])[-RELAY_DUP_CACHE:]
+            send(now, node, dict(key=key, dev=dev, up=up, tx_depth=node.depth, hops=0))
+
+        def receive(now, node, frame):
+            key, up, tx_depth = frame['key'], frame['up'], frame['tx_depth']
+            if key in node.seen:
+                if node.pending and node.pending[0] == key and \
+                        (tx_depth <= node.depth if up else tx_depth >= node.depth):
+                    node.pending = None
+                return
+            node.seen = (node.seen + [key])[-RELAY_DUP_CACHE:]
+            if node.index == 0:
+                if up and frame['dev'] == target:
+                    done[0] = now
+                return
+            if up:
+                if node.pending and not node.pending[0][1] and node.pending[0][0] == frame['dev']:
+                    node.pending = None     # the destination already answers
+                node.routes[frame['dev']] = tx_depth > node.depth
+                forward = tx_depth > node.depth
+            elif frame['dev'] == node.index:
+                originate(now, node, node.index, True)
+                return
+            else:
+                forward = tx_depth < node.depth and node.routes.get(frame['dev'], True)
+            if not forward or not node.forward or node.depth == RELAY_DEPTH_UNKNOWN or \
+                    frame['hops'] >= RELAY_MAX_HOPS or node.pending:
+                return
+            copy = dict(frame, tx_depth=node.depth, hops=frame['hops'] + 1)
+            node.pending = (key, copy)
+            delay = (1 + rng.randrange(RELAY_JITTER_MS)) * 1000.0
+            heapq.heappush(events, (now + delay, id(copy), 'release', node.index, 0, 0.0, copy))
+
+        originate(start, nodes[0], target, False)
+        while events:
+            now, _, kind, r, sender, begin, frame = heapq.heappop(events)
+            node = nodes[r]
+            if kind == 'release':
+                if node.pending and node.pending[1] is frame:
+                    node.pending = None
+                    send(now, node, frame)
+                continue
+            if any(s == r and b < now and e > begin for b, e, s in on_air):
+                continue        # half duplex, was sending
+            if any(s != sender and s != r and b < now and e > begin and
+                   rssi[s][r] > SENSITIVITY_DBM for b, e, s in on_air):
+                continue        # collision
+            if rng.random() < per(rssi[sender][r]):
+                continue
+            receive(now, node, frame)
+        for node in nodes:
+            node.busy_until = 0.0
+            node.pending = None
+        results.setdefault(depth[target], []).append(done[0] / 1000.0 if done[0] is not None else None)
+    return results, frames
+
+
+def cmd_relay(args):
+    if args.topology == 'line':
+        positions = [(i * args.spacing, 0.0) for i in range(args.nodes + 1)]
+    else:
+        side = args.side
+        positions = [(x * args.spacing, y * args.spacing) for y in range(side) for x in range(side)]
+    results, frames = simulate_relay(positions, args, args.seed)
+    out = sys.stdout
+    out.write('%-6s %9s %10s %9s %9s\n' % ('depth', 'commands', 'delivered', 'mean ms', 'p95 ms'))
+    total = 0
+    for depth in sorted(results):
+        samples = results[depth]
+        total += len(samples)
+        ok = sorted(t for t in samples if t is not None)
+        name = str(depth) if depth != RELAY_DEPTH_UNKNOWN else 'none'
+        out.write('%-6s %9d %9.1f%% %9.2f %9.2f\n'
+                  % (name, len(samples), 100.0 * len(ok) / len(samples),
+                     sum(ok) / len(ok) if ok else 0.0,
+                     ok[int(0.95 * (len(ok) - 1))] if ok else 0.0))
+    out.write('\n%d nodes, %s, %.0f m spacing: %.2f frames on air per command and reply%s\n'
+              % (len(positions), args.topology, args.spacing, float(frames) / total,
+                 ' (relaying off)' if args.no_relay else ''))
+    out.write('(depth = hops over links of %d dBm or better, round trip = command + answer, no retries)\n'
+              % RELAY_MIN_RSSI)
+
+
+def ota_block_len(profile):
+    """gAppOtaBlockLen_c for a profile, no relay header."""
+    return (OTA_MAX_PAYLOAD - profile.sec - profile.overhead - 2) & ~7
+
+
+def simulate_ota(size, slaves, per_of, args, seed):
+    """Round based model of the ledcontrol_ota.c session: every frame of the
+    master reaches each slave with that slave's own PER, NACKs collide when
+    two slaves pick the same slot, which the master sees as a CRC error and
+    answers with twice the slots (halved after a clean round), and a slave stays quiet when an earlier
+    NACK it heard covers its gaps. The page buffers of the slaves are assumed
+    to keep up. Returns (session ms, blocks sent, repairs, slaves left
+    behind)."""
+    rng = random.Random(seed)
+    profile = secured(PROFILES['compact']) if args.secure else PROFILES['compact']
+    block_len = ota_block_len(profile)
+    per_page = (OTA_PAGE + block_len - 1) // block_len
+    blocks = (size // OTA_PAGE) * per_page + ((size % OTA_PAGE) + block_len - 1) // block_len
+    windows = (blocks + OTA_WINDOW_BLOCKS - 1) // OTA_WINDOW_BLOCKS
+    frame_ms = (profile.air_us(2 + block_len) + args.frame_gap_us) / 1000.0
+    short_ms = (profile.air_us(10) + args.frame_gap_us) / 1000.0
+    slots = OTA_NACK_SLOTS
+    pers = [per_of(rng) for _ in range(slaves)]
+    missing = [set(range(blocks)) for _ in range(slaves)]
+
+    ms = OTA_REPEAT * short_ms
+    sent = repairs = 0
+
+    def broadcast(indices):
+        for s in range(slaves):
+            lost = pers[s]
+            missing[s].difference_update(i for i in indices if rng.random() >= lost)
+
+    for window in range(windows):
+        send = list(range(window * OTA_WINDOW_BLOCKS, min(blocks, (window + 1) * OTA_WINDOW_BLOCKS)))
+        quiet = 0
+        round_ = 0
+        while True:
+            broadcast(send)
+            sent += len(send)
+            repairs += len(send) if round_ else 0
+            ms += len(send) * frame_ms + short_ms + (slots + 2) * OTA_SLOT_MS
+            # slaves that heard the query answer with their first gap
+            answers = []
+            for s in range(slaves):
+                if rng.random() < pers[s]:
+                    continue
+                gaps = sorted(i for i in missing[s] if i < (window + 1) * OTA_WINDOW_BLOCKS)
+                if gaps:
+                    first = gaps[0] // OTA_WINDOW_BLOCKS
+                    mask = frozenset(i for i in gaps if i // OTA_WINDOW_BLOCKS == first)
+                    answers.append((rng.randrange(slots), first, mask, s))
+            answers.sort()
+            heard = []
+            garbled = False
+            lowest, union = None, set()
+            for slot, first, mask, s in answers:
+                if not args.secure and any(h[0] < slot and h[1] == first and mask <= h[2] and
+                                           rng.random() >= pers[s] for h in heard):
+                    continue        # suppressed by a NACK covering its gaps
+                if sum(1 for a in answers if a[0] == slot) > 1:
+                    garbled = True
+                    continue        # collided
+                heard.append((slot, first, mask))
+                if rng.random() < args.uplink_per:
+                    continue
+                if lowest is None or first < lowest:
+                    lowest, union = first, set(mask)
+                elif first == lowest:
+                    union |= mask
+            if garbled and slots < OTA_MAX_NACK_SLOTS:
+                slots *= 2
+            elif not garbled and slots > OTA_NACK_SLOTS:
+                slots //= 2
+            round_ += 1
+            if (lowest is not None or garbled) and round_ < OTA_MAX_ROUNDS:
+                send, quiet = sorted(union), 0
+            elif window + 1 == windows and quiet + 1 < OTA_REPEAT:
+                send, quiet = [], quiet + 1
+            else:
+                break
+    ms += OTA_REPEAT * short_ms + OTA_VERIFY_MS + (OTA_STATUS_SLOTS + 2) * OTA_SLOT_MS
+    left = sum(1 for m in missing if m)
+    return ms, sent, repairs, left
+
+
+def cmd_ota(args):
+    size = args.size * 1024
+
+    def per_of(rng):
+        return min(0.9, max(0.0, rng.gauss(args.per, args.per_spread)))
+
+    out = sys.stdout
+    out.write('%-7s %10s %12s %10s %9s %12s %9s\n'
+              % ('slaves', 'fleet s', 'B/s/slave', 'fleet B/s', 'repairs', 'unicast s', 'speedup'))
+    single = [simulate_ota(size, 1, per_of, args, args.seed + run)[0] for run in range(args.runs)]
+    single_ms = sum(single) / len(single)
+    for slaves in args.slaves:
+        runs = [simulate_ota(size, slaves, per_of, args, args.seed + run) for run in range(args.runs)]
+        ms = sum(r[0] for r in runs) / len(runs)
+        repairs = sum(r[2] for r in runs) / float(sum(r[1] for r in runs))
+        left = sum(r[3] for r in runs)
+        # the same image sent to each slave in turn, one session per slave
+        unicast_ms = single_ms * slaves
+        out.write('%-7d %10.1f %12.0f %10.0f %8.1f%% %12.1f %8.1fx%s\n'
+                  % (slaves, ms / 1000.0, size * 1000.0 / ms, size * slaves * 1000.0 / ms,
+                     100.0 * repairs, unicast_ms / 1000.0, unicast_ms / ms,
+                     '  (%d left behind)' % left if left else ''))
+    profile = secured(PROFILES['compact']) if args.secure else PROFILES['compact']
+    out.write('\n%d KiB image, %d byte blocks, PER %.1f%% +- %.1f%%, mean of %d runs%s\n'
+              % (args.size, ota_block_len(profile), 100.0 * args.per, 100.0 * args.per_spread,
+                 args.runs, ', protected' if args.secure else ''))
+    out.write('(B/s/slave = image bytes per second of session seen by each slave; '
+              'unicast = one session per slave)\n')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = ap.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('airtime', help='air time per command for each frame profile')
+    p.add_argument('--data', type=int, default=0, help='command data bytes after the command byte')
+    p.add_argument('--turnaround-us', type=int, default=150,
+                   help='abort + StartTx/StartRx switch time between the two frames')
+    p.add_argument('--secure', action='store_true', help='gAppUseSecLib_d build, frame counter + MIC')
+    p.add_argument('--crypto-us', type=float, default=40.0,
+                   help='protect + unprotect time per frame, mean of the #K records of a k dump')
+    p.set_defaults(func=cmd_airtime)
+
+    p = sub.add_parser('ack', help='ack frames per command under sustained load')
+    p.add_argument('--rate', type=float, default=50.0, help='commands per second, all slaves')
+    p.add_argument('--slaves', type=int, default=3)
+    p.add_argument('--delay', type=int, nargs='+', default=[0, 2, 5, 10, 20],
+                   help='gAppAckDelayMs_c values to compare')
+    p.add_argument('--duration', type=float, default=60.0, help='simulated seconds')
+    p.add_argument('--seed', type=int, default=1)
+    p.set_defaults(func=cmd_ack)
+
+    p = sub.add_parser('join', help='join time of a fleet of slaves powering up together')
+    p.add_argument('--slaves', type=int, default=100)
+    p.add_argument('--spread-ms', type=int, default=50, help='power-up jitter across the fleet')
+    p.add_argument('--process-us', type=int, default=300,
+                   help='master time from request received to assignment queued')
+    p.add_argument('--turnaround-us', type=int, default=150)
+    p.add_argument('--runs', type=int, default=10)
+    p.add_argument('--seed', type=int, default=1)
+    p.set_defaults(func=cmd_join)
+
+    p = sub.add_parser('relay', help='delivery and latency by hop count with relaying slaves')
+    p.add_argument('--topology', choices=('line', 'grid'), default='line',
+                   help='line: master at one end; grid: master in a corner')
+    p.add_argument('--nodes', type=int, default=6, help='slaves on the line')
+    p.add_argument('--side', type=int, default=5, help='nodes per side of the grid')
+    p.add_argument('--spacing', type=float, default=20.0, help='metres between neighbours')
+    p.add_argument('--tx-dbm', type=float, default=0.0)
+    p.add_argument('--path-loss-exp', type=float, default=3.0, help='indoor 2.7 .. 3.5')
+    p.add_argument('--shadowing-db', type=float, default=3.0)
+    p.add_argument('--commands', type=int, default=500)
+    p.add_argument('--no-relay', action='store_true', help='build without LEDCONTROL_RELAY slaves')
+    p.add_argument('--seed', type=int, default=1)
+    p.set_defaults(func=cmd_relay)
+
+    p = sub.add_parser('ota', help='broadcast firmware update time by fleet size')
+    p.add_argument('--size', type=int, default=128, help='image KiB')
+    p.add_argument('--slaves', type=int, nargs='+', default=[1, 3, 10, 30, 100])
+    p.add_argument('--per', type=float, default=0.02, help='mean packet error rate master -> slave')
+    p.add_argument('--per-spread', type=float, default=0.02, help='standard deviation across slaves')
+    p.add_argument('--uplink-per', type=float, default=0.02, help='NACK loss besides collisions')
+    p.add_argument('--frame-gap-us', type=float, default=400.0,
+                   help='TX done to next StartTx on the master: event, queue, encode, turnaround')
+    p.add_argument('--secure', action='store_true', help='gAppUseSecLib_d build')
+    p.add_argument('--runs', type=int, default=5)
+    p.add_argument('--seed', type=int, default=1)
+    p.set_defaults(func=cmd_ota)
+
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Drives the LEDControl radio test mode and tabulates its results.
+
+Sends the 't' command (gAppUseRadioTest_d build) and the test command lines
+of ledcontrol_test.h, then collects the '#L' records: packet error rate,
+goodput and RSSI per data rate, channel and TX power of a PER sweep, the
+RSSI of both ends of a range test, or energy detect samples. The peer node
+is put into responder mode either by hand or through its own port
+(--peer-port). A captured log can be tabulated instead of a port.
+
+    linktest.py --port /dev/ttyACM0 --peer-port /dev/ttyACM1 --count 1000 per
+    linktest.py --port /dev/ttyACM0 --rates 7 --channels 0:120:20 --powers 2:32:10 sweep
+    linktest.py --port /dev/ttyACM0 --peer-port /dev/ttyACM1 --count 100 range
+    linktest.py --port /dev/ttyACM0 --seconds 10 ed
+    linktest.py --log capture.log --csv per.csv
+"""
+
+import argparse
+import csv
+import sys
+import time
+
+TEST_CMD = b't'            # gAppTestCmd_c
+QUIT_CMD = b'q'            # gAppTestQuitCmd_c
+# indexes of the L and W commands, gAppTestRate*_c
+RATES = ('1M', '500k', '250k')
+RSSI_LOW_DBM = -105        # gAppTestRssiLowDbm_c
+RSSI_STEP_DB = 5           # gAppTestRssiStepDb_c
+ED_MODE = 7                # gContStateRunEnergyDetect_c - gContStateRunIdle_c
+
+PER_FIELDS = ('point', 'rate', 'channel', 'power', 'len', 'sent', 'received',
+              'crc_errors', 'per', 'goodput', 'rssi_min', 'rssi_mean', 'rssi_max')
+
+
+def rate_name(index):
+    return RATES[index] if index < len(RATES) else str(index)
+
+
+def split(line):
+    """Fields of a '#L' record, None for any other console output."""
+    line = line.strip()
+    if not line.startswith('#L,'):
+        return None
+    return line.split(',')[1:]
+
+
+def records(ser, deadline):
+    """Yield the fields of each '#L' record until the deadline."""
+    while time.time() < deadline:
+        fields = split(ser.readline().decode('ascii', 'replace'))
+        if fields:
+            yield fields
+
+
+def percentile(buckets, fraction):
+    """Upper edge in dBm of the RSSI histogram bucket holding the fraction."""
+    total = sum(buckets)
+    if total == 0:
+        return None
+    target = fraction * total
+    seen = 0
+    for index, count in enumerate(buckets):
+        seen += count
+        if seen >= target:
+            return RSSI_LOW_DBM + (index + 1) * RSSI_STEP_DB
+    return RSSI_LOW_DBM + len(buckets) * RSSI_STEP_DB
+
+
+class Results:
+    def __init__(self):
+        self.points = {}
+        self.histograms = {}
+        self.pings = []
+        self.range_summary = None
+        self.responder = None
+        self.ed = []
+        self.failed = []
+        self.done = False
+
+    def add(self, fields):
+        kind, values = fields[0], fields[1:]
+        if kind == 'P':
+            point = dict(zip(PER_FIELDS, (int(v) for v in values)))
+            self.points[point['point']] = point
+        elif kind == 'Q':
+            self.histograms[int(values[0])] = [int(v) for v in values[3:]]
+        elif kind == 'Z':
+            self.done = True
+        elif kind == 'G':
+            self.pings.append([int(v) for v in values])
+        elif kind == 'S':
+            self.range_summary = [int(v) for v in values]
+            self.done = True
+        elif kind == 'R':
+            self.responder = [int(v) for v in values]
+        elif kind == 'D':
+            self.ed.append((int(values[0]), int(values[1])))
+        elif kind == 'F':
+            self.failed.append(','.join(values))
+            if values and values[0] == 'stop':
+                self.done = True
+
+
+def report_per(results, out):
+    if not results.points:
+        return
+    out.write('%5s %5s %3s %3s %3s %6s %6s %5s %7s %9s %5s %5s %5s %5s %5s\n'
+              % ('point', 'rate', 'ch', 'pwr', 'len', 'sent', 'recv', 'crc',
+                 'per%', 'goodput', 'min', 'mean', 'max', 'p10', 'p90'))
+    for index in sorted(results.points):
+        p = results.points[index]
+        buckets = results.histograms.get(index, [])
+        p10 = percentile(buckets, 0.1)
+        p90 = percentile(buckets, 0.9)
+        out.write('%5d %5s %3d %3d %3d %6d %6d %5d %7.2f %9s %5d %5d %5d %5s %5s\n'
+                  % (index, rate_name(p['rate']), p['channel'], p['power'], p['len'],
+                     p['sent'], p['received'], p['crc_errors'], p['per'] / 100.0,
+                     '%.1fk' % (p['goodput'] / 1000.0), p['rssi_min'], p['rssi_mean'],
+                     p['rssi_max'], '-' if p10 is None else '<%d' % p10,
+                     '-' if p90 is None else '<%d' % p90))
+    skipped = [f for f in results.failed if f.startswith(('S,', 'E,'))]
+    if skipped:
+        out.write('unanswered setups or reports: %s\n' % ' '.join(skipped))
+
+
+def report_range(results, out):
+    if results.range_summary:
+        s = results.range_summary
+        lost = s[0] - s[1]
+        out.write('range: %d pings, %d answered (%.1f%% lost)\n'
+                  % (s[0], s[1], 100.0 * lost / max(s[0], 1)))
+        if s[1]:
+            out.write('  rssi at responder min/mean/max %d/%d/%d dBm\n' % (s[2], s[3], s[4]))
+            out.write('  rssi at tester    min/mean/max %d/%d/%d dBm\n' % (s[5], s[6], s[7]))
+    if results.responder:
+        r = results.responder
+        out.write('responder: %d pings heard, rssi min/mean/max %d/%d/%d dBm\n' % tuple(r[:4]))
+
+
+def report_ed(results, out):
+    if not results.ed:
+        return
+    levels = sorted(rssi for _, rssi in results.ed)
+    out.write('energy detect ch %d: %d samples, min %d, median %d, max %d dBm\n'
+              % (results.ed[0][0], len(levels), levels[0], levels[len(levels) // 2], levels[-1]))
+
+
+def write_csv(results, path):
+    with open(path, 'w', newline='') as f:
+        writer = csv.writer(f)
+        if results.points:
+            writer.writerow(PER_FIELDS + tuple('rssi_bucket_%d' % (RSSI_LOW_DBM + i * RSSI_STEP_DB)
+                                               for i in range(16)))
+            for index in sorted(results.points):
+                p = results.points[index]
+                writer.writerow([p[k] for k in PER_FIELDS] + results.histograms.get(index, []))
+        elif results.pings:
+            writer.writerow(('index', 'ok', 'rssi_remote', 'rssi_local'))
+            writer.writerows(results.pings)
+        elif results.ed:
+            writer.writerow(('channel', 'rssi'))
+            writer.writerows(results.ed)
+
+
+def send(ser, line):
+    ser.write(line.encode('ascii') + b'\r')
+
+
+def command(ser, line, timeout):
+    """Sends a command line and waits until the node takes or refuses it."""
+    send(ser, line)
+    for fields in records(ser, time.time() + timeout):
+        if fields[0] == 'A':
+            return
+        if fields[0] == 'F' and fields[1:] != ['stop']:
+            raise RuntimeError('command refused: %s' % line)
+    raise RuntimeError('no answer to: %s' % line)
+
+
+def enter(ser, link, timeout):
+    ser.reset_input_buffer()
+    ser.write(TEST_CMD)
+    for fields in records(ser, time.time() + timeout):
+        if fields == ['A', 't']:
+            break
+    else:
+        raise RuntimeError('test mode not entered, gAppUseRadioTest_d build?')
+    if link:
+        command(ser, 'L %d %d %d' % link, timeout)
+
+
+def run(ser, line, seconds, results, timeout):
+    """Runs a test command until its closing record or for seconds."""
+    command(ser, line, timeout)
+    deadline = time.time() + seconds
+    for fields in records(ser, deadline):
+        results.add(fields)
+        if results.done:
+            return
+    # stop an open ended test
+    ser.write(b' ')
+    for fields in records(ser, time.time() + timeout):
+        results.add(fields)
+        if fields[0] == 'F':
+            return
+
+
+def span(text):
+    first, last, step = (int(v) for v in text.split(':'))
+    return first, last, step
+
+
+def live(args, results):
+    import serial
+    link = (args.rate, args.channel, args.power)
+    ser = serial.Serial(args.port, args.baud, timeout=0.5)
+    peer = serial.Serial(args.peer_port, args.baud, timeout=0.5) if args.peer_port else None
+    try:
+        if peer:
+            enter(peer, link, args.timeout)
+            command(peer, 'R', args.timeout)
+        enter(ser, link, args.timeout)
+        if args.test == 'per':
+            run(ser, 'P %d %d %d' % (args.count, args.len, args.gap), args.seconds, results, args.timeout)
+        elif args.test == 'sweep':
+            ch = span(args.channels)
+            pwr = span(args.powers)
+            run(ser, 'W %d %d %d %d %d %d %d %d %d %d'
+                % ((args.rates,) + ch + pwr + (args.count, args.len, args.gap)),
+                args.seconds, results, args.timeout)
+        elif args.test == 'range':
+            run(ser, 'G %d %d' % (args.count, args.gap), args.seconds, results, args.timeout)
+        elif args.test == 'ed':
+            run(ser, 'C %d' % ED_MODE, args.seconds, results, args.timeout)
+        if peer:
+            # the responder prints its range summary once it is stopped
+            peer.write(b' ')
+            for fields in records(peer, time.time() + args.timeout):
+                if fields[0] == 'R':
+                    results.add(fields)
+                if fields[0] == 'F':
+                    break
+    finally:
+        for s in (ser, peer):
+            if s:
+                s.write(QUIT_CMD)
+                s.close()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('test', nargs='?', choices=('per', 'sweep', 'range', 'ed'),
+                    help='test to run through --port')
+    ap.add_argument('--log', help='captured console output to tabulate instead (default: stdin)')
+    ap.add_argument('--port', help='serial port of the node running the test')
+    ap.add_argument('--peer-port', help='serial port of the node to put into responder mode')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--timeout', type=float, default=2.0, help='seconds to wait for a command answer')
+    ap.add_argument('--csv', help='also write the points, pings or samples to this file')
+    ap.add_argument('--rate', type=int, default=0, help='home link rate index: 0 1M, 1 500k, 2 250k')
+    ap.add_argument('--channel', type=int, default=42, help='home link channel')
+    ap.add_argument('--power', type=int, default=8, help='home link TX power level')
+    ap.add_argument('--count', type=int, help='frames per point (default 1000), '
+                    'pings of a range test (default 0, until stopped)')
+    ap.add_argument('--len', type=int, default=32, help='PER frame payload length')
+    ap.add_argument('--gap', type=int, help='ms between two frames (default 0, range 100)')
+    ap.add_argument('--seconds', type=float, help='stop the test after this long (default 600, ed 10)')
+    ap.add_argument('--rates', type=int, default=7, help='sweep: bit mask of the rate indexes')
+    ap.add_argument('--channels', default='0:120:20', help='sweep: first:last:step')
+    ap.add_argument('--powers', default='2:32:10', help='sweep: first:last:step')
+    args = ap.parse_args()
+    if args.count is None:
+        args.count = 0 if args.test == 'range' else 1000
+    if args.gap is None:
+        args.gap = 100 if args.test == 'range' else 0
+    if args.seconds is None:
+        args.seconds = 10.0 if args.test == 'ed' else 600.0
+
+    results = Results()
+    if args.port:
+        if not args.test:
+            ap.error('a test is needed with --port')
+        live(args, results)
+    else:
+        lines = open(args.log) if args.log else sys.stdin
+        for line in lines:
+            fields = split(line)
+            if fields:
+                results.add(fields)
+
+    report_per(results, sys.stdout)
+    report_range(results, sys.stdout)
+    report_ed(results, sys.stdout)
+    if args.csv:
+        write_csv(results, args.csv)
+
+
+if __name__ == '__main__':
+    main()
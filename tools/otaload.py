@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Uploads a firmware image to the LEDControl master for an OTA update.
+
+Sends the 'o' command (gAppUseOta_d build), then the upload header and the
+image in gAppOtaUartChunk_c byte chunks, waiting for the '#O,A' ack of each
+so the master can program its storage between chunks. Once the master has
+checked the image it broadcasts it to the slaves; the tool then follows the
+session and prints the status of every slave ('#O,S') and the totals of the
+master ('#O,D').
+
+    otaload.py --port /dev/ttyACM0 LEDControl_slave.bin
+    otaload.py --port /dev/ttyACM0 --no-follow LEDControl_slave.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+UPLOAD_CMD = b'o'          # gAppOtaUploadCmd_c
+UPLOAD_MAGIC = 0x544F434C  # gAppOtaUploadMagic_c
+UART_CHUNK = 64            # gAppOtaUartChunk_c, below the gSerialMgrRxBufSize_c of the master
+# must match app_ota_status_t
+STATUS = ('ok', 'missing blocks', 'crc mismatch', 'flash error', 'too large')
+
+
+def status_name(code):
+    return STATUS[code] if code < len(STATUS) else str(code)
+
+
+def records(ser, deadline):
+    """Yield the fields of each '#O' record until the deadline, ignoring any
+    other console output."""
+    while time.time() < deadline:
+        line = ser.readline().decode('ascii', 'replace').strip()
+        if line.startswith('#O,'):
+            yield line.split(',')[1:]
+
+
+def wait_ack(ser, offset, timeout):
+    for fields in records(ser, time.time() + timeout):
+        if fields[0] == 'A' and int(fields[1]) == offset:
+            return None
+        if fields[0] == 'U':
+            return int(fields[2])
+    raise RuntimeError('no ack for offset %d' % offset)
+
+
+def upload(ser, image, timeout, out):
+    header = struct.pack('<IIII', UPLOAD_MAGIC, len(image), zlib.crc32(image) & 0xFFFFFFFF, 0)
+    ser.reset_input_buffer()
+    ser.write(UPLOAD_CMD + header)
+    status = wait_ack(ser, 0, timeout)
+    if status is not None:
+        return status
+    started = time.time()
+    for offset in range(0, len(image), UART_CHUNK):
+        ser.write(image[offset:offset + UART_CHUNK])
+        end = min(offset + UART_CHUNK, len(image))
+        if end == len(image):
+            break
+        status = wait_ack(ser, end, timeout)
+        if status is not None:
+            return status
+        if (end // UART_CHUNK) % 64 == 0:
+            out.write('\r%d/%d bytes' % (end, len(image)))
+            out.flush()
+    for fields in records(ser, time.time() + timeout):
+        if fields[0] == 'U':
+            elapsed = time.time() - started
+            out.write('\r%d bytes uploaded in %.1f s (%.0f bytes/s)\n'
+                      % (len(image), elapsed, len(image) / max(elapsed, 1e-3)))
+            return int(fields[2])
+    raise RuntimeError('no upload result')
+
+
+def follow(ser, timeout, out):
+    """Prints the slave statuses and the session totals, returns the number
+    of slaves that verified the image."""
+    updated = 0
+    for fields in records(ser, time.time() + timeout):
+        if fields[0] == 'S':
+            code = int(fields[2])
+            updated += (code == 0)
+            out.write('slave %s: %s\n' % (fields[1], status_name(code)))
+        elif fields[0] == 'D':
+            size, ms, blocks, repairs = (int(f) for f in fields[1:5])
+            out.write('session: %d bytes in %.1f s, %.0f bytes/s, %d blocks sent, %d repairs (%.1f%%)\n'
+                      % (size, ms / 1000.0, size * 1000.0 / max(ms, 1), blocks, repairs,
+                         100.0 * repairs / max(blocks, 1)))
+            return updated
+    raise RuntimeError('session did not end')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('image', help='raw binary image for the slaves')
+    ap.add_argument('--port', required=True, help='serial port of the master')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--timeout', type=float, default=5.0, help='seconds to wait for each ack')
+    ap.add_argument('--session-timeout', type=float, default=600.0,
+                    help='seconds to wait for the broadcast to end')
+    ap.add_argument('--no-follow', action='store_true', help='return once the master has the image')
+    args = ap.parse_args()
+
+    import serial  # pyserial
+    image = open(args.image, 'rb').read()
+    with serial.Serial(args.port, args.baud, timeout=0.5) as ser:
+        status = upload(ser, image, args.timeout, sys.stdout)
+        if status:
+            sys.stderr.write('upload rejected: %s\n' % status_name(status))
+            return 1
+        if args.no_follow:
+            return 0
+        sys.stdout.write('%d slaves updated\n' % follow(ser, args.session_timeout, sys.stdout))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Generate PoolsDetails_c (app_pools.h) from captured MEM usage profiles.
+
+Capture the output of the 'm' UART command (gAppUseMemStats_d build) after
+exercising the node under its heaviest expected load, possibly several times
+and on several nodes, then:
+
+    poolgen.py capture1.log capture2.log -o app_pools.h
+
+and build with gAppUseGeneratedPools_d set. Each pool is sized to the peak
+number of blocks seen in use plus head-room, and never below that peak plus
+--margin; pools that reported allocation failures are grown. Pools never seen
+in use keep --margin blocks: framework allocations are only seen while live at
+a sample, so an idle capture does not prove a pool unneeded. --drop-unused
+removes them. The RAM freed compared with the current layout is printed on
+stderr.
+"""
+
+import argparse
+import math
+import sys
+
+
+class Pool:
+    def __init__(self, size, blocks):
+        self.size = size
+        self.blocks = blocks
+        self.peak = 0
+        self.max_request = 0
+        self.requests = 0
+        self.failures = 0
+
+
+def parse(paths):
+    """Merge the '#P' records of all captures: peaks are maxed, counts summed."""
+    pools = {}
+    classes = {}
+    for path in paths:
+        with open(path, errors='replace') as capture:
+            for line in capture:
+                line = line.strip()
+                try:
+                    fields = [int(f) for f in line[3:].split(',')]
+                    if line.startswith('#P,'):
+                        size, blocks, peak, max_request, requests, failures = fields
+                        pool = pools.setdefault(size, Pool(size, blocks))
+                        pool.peak = max(pool.peak, peak)
+                        pool.max_request = max(pool.max_request, max_request)
+                        pool.requests += requests
+                        pool.failures += failures
+                    elif line.startswith('#Q,'):
+                        classes[fields[0]] = classes.get(fields[0], 0) + fields[1]
+                except ValueError:
+                    continue
+    return [pools[size] for size in sorted(pools)], classes
+
+
+def plan(pools, headroom, margin, shrink, drop_unused):
+    """Return the new (blockSize, numBlocks) layout."""
+    layout = {}
+    for pool in pools:
+        if drop_unused and pool.peak == 0 and pool.requests == 0:
+            continue
+        need = pool.peak + pool.failures
+        blocks = max(need + margin, int(math.ceil(need * (1.0 + headroom))), 1)
+        size = pool.size
+        if shrink and pool.max_request and pool.peak <= pool.requests:
+            # only application requests were seen in this pool, trim the block
+            size = (pool.max_request + 3) & ~3
+        layout[size] = layout.get(size, 0) + blocks
+    return sorted(layout.items())
+
+
+def ram(layout):
+    return sum(size * blocks for size, blocks in layout)
+
+
+def render(layout, sources):
+    out = ['/* Generated by tools/poolgen.py from %s, do not edit. */' % ', '.join(sources),
+           '#ifndef _APP_POOLS_H_',
+           '#define _APP_POOLS_H_',
+           '',
+           '#define PoolsDetails_c \\']
+    for i, (size, blocks) in enumerate(layout):
+        tail = '  \\' if i < len(layout) - 1 else ''
+        out.append('         _block_size_ %3d  _number_of_blocks_ %4d _eol_%s' % (size, blocks, tail))
+    out += ['', '#endif /* _APP_POOLS_H_ */', '']
+    return '\n'.join(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('captures', nargs='+', help="logs containing the 'm' dump")
+    ap.add_argument('-o', '--output', help='header to write (default: stdout)')
+    ap.add_argument('--headroom', type=float, default=0.25, help='fraction added to the peak')
+    ap.add_argument('--margin', type=int, default=1, help='minimum spare blocks per pool')
+    ap.add_argument('--shrink', action='store_true',
+                    help='trim block sizes to the largest request when only the app used the pool')
+    ap.add_argument('--drop-unused', action='store_true',
+                    help='leave out pools never seen in use instead of keeping --margin blocks')
+    args = ap.parse_args()
+
+    pools, classes = parse(args.captures)
+    if not pools:
+        sys.exit('no #P records found')
+    layout = plan(pools, args.headroom, args.margin, args.shrink, args.drop_unused)
+    if not layout:
+        sys.exit('no pool was used, refusing to generate an empty layout')
+
+    header = render(layout, args.captures)
+    if args.output:
+        with open(args.output, 'w') as out:
+            out.write(header)
+    else:
+        sys.stdout.write(header)
+
+    before = ram([(p.size, p.blocks) for p in pools])
+    after = ram(layout)
+    for pool in pools:
+        if pool.failures:
+            sys.stderr.write('pool %dB: %d allocation failures\n' % (pool.size, pool.failures))
+    for upper in sorted(classes):
+        sys.stderr.write('requests <= %4dB: %d\n' % (upper, classes[upper]))
+    sys.stderr.write('pool RAM: %d -> %d bytes (%+d)\n' % (before, after, after - before))
+
+
+if __name__ == '__main__':
+    main()
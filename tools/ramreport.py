@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""RAM usage per subsystem, from the GNU ld map file of a LEDControl build.
+
+Objects placed with APP_STATIC_SECTION (ledcontrol_static.h) are reported
+under their own subsystem; everything else is attributed by object file.
+Functions copied to SRAM with APP_RAMFUNC (gAppUseRamFunc_d build) are
+listed per object file and summed against the link time budget.
+Run it as a post-build step to get the report with every build:
+
+    ramreport.py LEDControl.map
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+# output sections that live in RAM (see MKW41Z512xxx4_connectivity.ld)
+RAM_SECTIONS = ('.mtb', '.interrupts_ram', '.data', '.bss', '.heap', '.stack')
+
+# object file name patterns -> subsystem, first match wins
+OBJECT_SUBSYSTEMS = (
+    (r'MemManager', 'MEM pools'),
+    (r'heap_\d', 'FreeRTOS heap'),
+    (r'^(tasks|queue|list|timers|event_groups|port|croutine)\.o', 'FreeRTOS kernel'),
+    (r'fsl_os_abstraction', 'OS abstraction'),
+    (r'(genfsk|fsl_xcvr|ifr_radio|dbg_ram_capture)', 'radio link layer'),
+    (r'(SerialManager|fsl_lpuart|UART_Adapter)', 'serial'),
+    (r'(TimersManager|fsl_tpm|fsl_lptmr)', 'timers'),
+    (r'(SecLib|fsl_ltc|aes)', 'security'),
+    (r'(LED|fsl_gpio|GPIO_Adapter)', 'LED / GPIO'),
+    (r'^ledcontrol_', 'application'),
+    (r'^LEDControl', 'application'),
+    (r'lib(c|gcc|nosys)', 'C library'),
+)
+
+# code run from SRAM (APP_RAMFUNC), reported per object file
+RAMFUNC_PREFIX = 'code in RAM: '
+
+INPUT_RE = re.compile(r'^ (\S+)\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(.*)$')
+CONT_RE = re.compile(r'^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(.*)$')
+OUTPUT_RE = re.compile(r'^(\.\S+)\s*(0x[0-9a-fA-F]+)?\s*(0x[0-9a-fA-F]+)?')
+
+
+def subsystem(section, obj):
+    match = re.match(r'\.bss\.app_([A-Za-z0-9]+)', section)
+    if match:
+        return 'app: ' + match.group(1)
+    name = os.path.basename(obj)
+    archive = re.match(r'.*\((.*)\)$', name)
+    if archive:
+        name = archive.group(1)
+    if section.startswith('.ramfunc'):
+        return RAMFUNC_PREFIX + name
+    for pattern, label in OBJECT_SUBSYSTEMS:
+        if re.search(pattern, name):
+            return label
+    return 'other (' + name + ')' if name else 'other'
+
+
+def parse(mapfile):
+    usage = collections.Counter()
+    in_map = False
+    output = None
+    pending = None
+    for line in mapfile:
+        line = line.rstrip('\n')
+        if line.startswith('Linker script and memory map'):
+            in_map = True
+            continue
+        if not in_map:
+            continue
+        if line and not line[0].isspace():
+            match = OUTPUT_RE.match(line)
+            output = match.group(1) if match else None
+            if output in ('.heap', '.stack') and match.group(3):
+                usage[output[1:]] += int(match.group(3), 16)
+            pending = None
+            continue
+        if output not in RAM_SECTIONS or output in ('.heap', '.stack'):
+            continue
+        match = INPUT_RE.match(line)
+        if match:
+            section, _, size, obj = match.groups()
+            usage[subsystem(section, obj)] += int(size, 16)
+            pending = None
+            continue
+        if pending:
+            match = CONT_RE.match(line)
+            if match:
+                usage[subsystem(pending, match.group(3))] += int(match.group(2), 16)
+            pending = None
+            continue
+        stripped = line.strip()
+        if stripped.startswith('.') and ' ' not in stripped:
+            # long input section names put address/size/object on the next line
+            pending = stripped
+    return usage
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('map', help='linker map file (-Wl,-Map=...)')
+    ap.add_argument('--ramfunc-budget', type=int, default=3072,
+                    help='gRamFuncBudgetLink_d the image was linked with')
+    args = ap.parse_args()
+
+    with open(args.map, errors='replace') as mapfile:
+        usage = parse(mapfile)
+
+    total = sum(usage.values())
+    for name, size in usage.most_common():
+        if not size:
+            continue
+        sys.stdout.write('%-32s %7d B %5.1f %%\n' % (name, size, 100.0 * size / total if total else 0))
+    sys.stdout.write('%-32s %7d B\n' % ('total', total))
+    ramfunc = sum(size for name, size in usage.items() if name.startswith(RAMFUNC_PREFIX))
+    if ramfunc:
+        sys.stdout.write('%-32s %7d B of %d B budget (gRamFuncBudgetLink_d)\n'
+                         % ('code in RAM', ramfunc, args.ramfunc_budget))
+
+
+if __name__ == '__main__':
+    main()